@@ -59,13 +59,28 @@ async function scanNetworks() {
 
         showStatus('Scanning for networks...', 'info');
 
-        const response = await fetch('/api/scan');
-        
-        if (!response.ok) {
-            throw new Error('Scan failed');
+        // The device scans in the background; 202 means the first scan is
+        // still running, so poll until cached results are available.
+        let data = null;
+        let pending = true;
+        for (let attempt = 0; attempt < 10; attempt++) {
+            const response = await fetch('/api/scan');
+
+            if (!response.ok) {
+                throw new Error('Scan failed');
+            }
+
+            data = await response.json();
+            pending = response.status === 202;
+            if (!pending) break;
+            await new Promise(resolve => setTimeout(resolve, 1000));
+        }
+
+        if (pending) {
+            showStatus('Scan still running. Press Scan again in a few seconds.', 'info');
+            return;
         }
 
-        const data = await response.json();
         const networks = data.networks || [];
 
         if (networks.length === 0) {
@@ -92,12 +107,8 @@ function displayNetworks(networks) {
     networkList.innerHTML = '';
     networkList.classList.remove('hidden');
 
-    // Remove duplicates and sort by signal strength
-    const uniqueNetworks = Array.from(
-        new Map(networks.map(n => [n.ssid, n])).values()
-    ).sort((a, b) => b.rssi - a.rssi);
-
-    uniqueNetworks.forEach(network => {
+    // Device already de-duplicates and sorts by signal strength
+    networks.forEach(network => {
         const item = createNetworkItem(network);
         networkList.appendChild(item);
     });
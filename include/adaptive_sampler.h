@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// -----------------------------------
+// Adaptive Sampling Scheduler
+// Tracks the rate of change of PM2.5 and TVOC with EWMA mean/variance and
+// picks the next sampling interval: short while values move, stretching
+// towards maxIntervalMs while the air is stable.
+// Plain C++ (no Arduino dependencies) so tools/adaptive_sampler_sim.cpp
+// can replay traces on the host.
+// -----------------------------------
+class AdaptiveSampler {
+public:
+    struct Settings {
+        uint32_t minIntervalMs  = 2000;
+        uint32_t maxIntervalMs  = 20000;   // bounds the error at an unforeseen onset
+        uint32_t baseIntervalMs = 10000;   // first interval after boot
+        float    alpha          = 0.2f;    // EWMA weight of the newest sample
+        float    fastScore      = 3.0f;    // |rate| in noise sigmas => sample fast
+        float    stableScore    = 1.0f;    // below this => stretch interval
+        float    growth         = 1.5f;    // interval multiplier per stable sample
+        float    changeBudget   = 2.0f;    // most a trend may move between samples, in noise floors
+    };
+
+private:
+    // Online EWMA mean/variance of one channel's rate of change
+    struct Channel {
+        float noiseFloor;   // reading jitter (units) treated as no change
+        float last;
+        float mean;
+        float var;
+        bool  primed;
+
+        // Returns activity score: |rate| relative to recent rate noise
+        float update(float value, float dtS, float alpha) {
+            if (isnan(value)) return 0;
+            if (!primed) {
+                last = value;
+                mean = 0;
+                var = 0;
+                primed = true;
+                return 0;
+            }
+
+            float rate = (value - last) / dtS;
+            last = value;
+
+            float sigma = sqrtf(var);
+            if (sigma < noiseFloor / dtS) sigma = noiseFloor / dtS;
+            float diff = rate - mean;
+            float score = fabsf(diff) / sigma;
+
+            // Learn after scoring so a spike doesn't mask itself
+            mean += alpha * diff;
+            var = (1.0f - alpha) * (var + alpha * diff * diff);
+            return score;
+        }
+
+        // Longest interval (ms) over which the current trend moves less
+        // than budget noise floors; 0 = no trend to bound it
+        float intervalCapMs(float budget) const {
+            float rate = fabsf(mean);
+            return primed && rate > 0 ? budget * noiseFloor / rate * 1000.0f : 0;
+        }
+    };
+
+    Settings cfg;
+    Channel pm25  = {2.0f, 0, 0, 0, false};    // ZH07 reports whole ug/m3
+    Channel tvoc  = {10.0f, 0, 0, 0, false};   // AGS02MA ppb jitter
+    uint32_t interval = 10000;
+    uint32_t lastMs = 0;
+    bool started = false;
+    float lastScore = 0;
+
+    static uint32_t clampInterval(float ms, const Settings& s) {
+        if (ms < s.minIntervalMs) return s.minIntervalMs;
+        if (ms > s.maxIntervalMs) return s.maxIntervalMs;
+        return (uint32_t)ms;
+    }
+
+    float capMs(const Channel& c) const { return c.intervalCapMs(cfg.changeBudget); }
+
+public:
+    void begin(const Settings& settings) {
+        cfg = settings;
+        interval = clampInterval(cfg.baseIntervalMs, cfg);
+    }
+
+    // Feed a new reading; returns the interval until the next one
+    uint32_t update(uint32_t nowMs, float pm25Value, float tvocValue) {
+        float dtS = started ? (uint32_t)(nowMs - lastMs) / 1000.0f : 0;
+        lastMs = nowMs;
+        if (!started || dtS <= 0) {
+            started = true;
+            pm25.update(pm25Value, 1.0f, cfg.alpha);
+            tvoc.update(tvocValue, 1.0f, cfg.alpha);
+            return interval;
+        }
+
+        float s1 = pm25.update(pm25Value, dtS, cfg.alpha);
+        float s2 = tvoc.update(tvocValue, dtS, cfg.alpha);
+        lastScore = s1 > s2 ? s1 : s2;
+
+        if (lastScore >= cfg.fastScore) {
+            // Something is happening (cooking, incense...) - sample fast
+            interval = cfg.minIntervalMs;
+        } else if (lastScore < cfg.stableScore) {
+            interval = clampInterval(interval * cfg.growth, cfg);
+        }
+
+        // A steady rise or decay scores as stable, but a long interval
+        // across it would cut the corner at its peak: cap the interval so
+        // the trend moves at most changeBudget noise floors per sample
+        float cap = capMs(pm25);
+        float capTvoc = capMs(tvoc);
+        if (capTvoc > 0 && (cap == 0 || capTvoc < cap)) cap = capTvoc;
+        if (cap > 0 && cap < interval) interval = clampInterval(cap, cfg);
+
+        return interval;
+    }
+
+    uint32_t nextIntervalMs() const { return interval; }
+    float activityScore() const { return lastScore; }
+};
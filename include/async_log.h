@@ -0,0 +1,486 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include <type_traits>
+#include <ctype.h>
+#include <string.h>
+#include "config.h"
+
+// -----------------------------------
+// Async Logger
+//   LOG_E / LOG_W / LOG_I / LOG_D ("fmt", args...)   - newline added
+//
+// The caller only stores the format pointer and its arguments (strings
+// are copied, up to LOG_MAX_STR) in a lock-free multi-producer ring;
+// a low-priority task formats them and writes to Serial, so a slow UART
+// never stalls a sensor or network task. A full ring drops the record
+// (counted, reported by the drain task). Formatted lines are mirrored to
+// a RAM tail served at /api/logs.
+//
+// Levels above LOG_COMPILE_LEVEL compile to nothing (arguments are not
+// evaluated). Until begin() starts the task - early boot, low-power
+// cycles, the native build - records are formatted and printed inline.
+// Format strings must be literals (only the pointer is stored).
+// -----------------------------------
+class Log {
+public:
+    enum Level : uint8_t { ERROR = 1, WARN, INFO, DEBUG };
+
+    static constexpr size_t RING = LOG_RING_BYTES;
+    static constexpr size_t TAIL = LOG_TAIL_BYTES;
+    static constexpr size_t LINE = 192;          // longest formatted line
+    static constexpr size_t MAX_RECORD = 320;    // header + encoded arguments
+    static_assert((RING & (RING - 1)) == 0, "LOG_RING_BYTES must be a power of two");
+
+private:
+    enum ArgType : uint8_t { I32, U32, I64, U64, F64, STR, PTR };
+    enum Slot : uint8_t { FREE = 0, READY, PAD };
+
+    // Start of every record, 4-byte aligned. PAD records only use len/state.
+    struct Header {
+        uint16_t len;        // whole record, multiple of 4
+        uint8_t state;       // Slot, published with release ordering
+        uint8_t level;
+        uint32_t tMs;
+        const char* fmt;
+        uint8_t nargs;
+    };
+
+    struct State {
+        alignas(4) uint8_t ring[RING];
+        std::atomic<uint32_t> head{0};      // producers reserve with CAS
+        std::atomic<uint32_t> tail{0};      // drain task only
+        std::atomic<uint32_t> dropped{0};
+        uint32_t reported = 0;              // drops already announced
+        uint32_t records = 0;               // drained
+        TaskHandle_t task = nullptr;
+
+        char tail_[TAIL];                   // formatted mirror for /api/logs
+        size_t tailHead = 0;
+        bool tailWrapped = false;
+        SemaphoreHandle_t tailLock = nullptr;
+    };
+
+    static State& s() {
+        static State st;
+        return st;
+    }
+
+    // -----------------------------
+    // Argument encoding (measure pass when p == nullptr)
+    // -----------------------------
+    struct Enc {
+        uint8_t* p;
+        uint8_t* end;
+        size_t size;
+        uint8_t count;
+
+        bool room(size_t n) {
+            if (!p) {
+                size += n;
+                return true;
+            }
+            return p + n <= end;
+        }
+        void raw(const void* v, size_t n) {
+            if (p) {
+                memcpy(p, v, n);
+                p += n;
+            }
+        }
+    };
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    put(Enc& e, T v) {
+        using U = typename std::conditional<std::is_enum<T>::value, int, T>::type;
+        bool sgn = std::is_signed<U>::value;
+        if (sizeof(U) <= 4) {
+            if (!e.room(5)) return;
+            uint8_t t = sgn ? I32 : U32;
+            uint32_t x = (uint32_t)(U)v;
+            e.raw(&t, 1);
+            e.raw(&x, 4);
+        } else {
+            if (!e.room(9)) return;
+            uint8_t t = sgn ? I64 : U64;
+            uint64_t x = (uint64_t)(U)v;
+            e.raw(&t, 1);
+            e.raw(&x, 8);
+        }
+        e.count++;
+    }
+
+    static void put(Enc& e, double v) {
+        if (!e.room(9)) return;
+        uint8_t t = F64;
+        e.raw(&t, 1);
+        e.raw(&v, 8);
+        e.count++;
+    }
+
+    static void put(Enc& e, const char* str) {
+        if (!str) str = "(null)";
+        uint8_t n = (uint8_t)strnlen(str, LOG_MAX_STR);
+        if (!e.room(2 + n)) return;
+        uint8_t t = STR;
+        e.raw(&t, 1);
+        e.raw(&n, 1);
+        e.raw(str, n);
+        e.count++;
+    }
+
+    static void put(Enc& e, const void* ptr) {
+        if (!e.room(1 + sizeof(ptr))) return;
+        uint8_t t = PTR;
+        e.raw(&t, 1);
+        e.raw(&ptr, sizeof(ptr));
+        e.count++;
+    }
+
+    static void put(Enc& e, float v) { put(e, (double)v); }
+    static void put(Enc& e, char* str) { put(e, (const char*)str); }
+
+    // -----------------------------
+    // Ring (multi-producer, single consumer)
+    // -----------------------------
+    static uint8_t* reserve(size_t n) {
+        State& st = s();
+        uint32_t h = st.head.load(std::memory_order_relaxed);
+        for (;;) {
+            uint32_t t = st.tail.load(std::memory_order_acquire);
+            uint32_t off = h & (RING - 1);
+            uint32_t pad = (RING - off < n) ? RING - off : 0;   // records never wrap
+            if (h + pad + n - t > RING) return nullptr;
+            if (st.head.compare_exchange_weak(h, h + pad + n, std::memory_order_acq_rel,
+                                              std::memory_order_relaxed)) {
+                if (pad) {
+                    Header* ph = (Header*)(st.ring + off);
+                    ph->len = pad;
+                    __atomic_store_n(&ph->state, (uint8_t)PAD, __ATOMIC_RELEASE);
+                }
+                return st.ring + ((h + pad) & (RING - 1));
+            }
+        }
+    }
+
+    // -----------------------------
+    // Formatting (drain side)
+    // -----------------------------
+    struct Arg {
+        uint8_t type;
+        uint64_t bits;
+        double d;
+        char str[LOG_MAX_STR + 1];
+        const void* ptr;
+    };
+
+    static bool readArg(const uint8_t*& a, const uint8_t* end, Arg& out) {
+        if (a >= end) return false;
+        out.type = *a++;
+        switch (out.type) {
+            case I32:
+            case U32: {
+                uint32_t x;
+                memcpy(&x, a, 4);
+                a += 4;
+                out.bits = (out.type == I32) ? (uint64_t)(int64_t)(int32_t)x : x;
+                return true;
+            }
+            case I64:
+            case U64:
+                memcpy(&out.bits, a, 8);
+                a += 8;
+                return true;
+            case F64:
+                memcpy(&out.d, a, 8);
+                a += 8;
+                return true;
+            case STR: {
+                uint8_t n = *a++;
+                memcpy(out.str, a, n);
+                out.str[n] = 0;
+                a += n;
+                return true;
+            }
+            case PTR:
+                memcpy(&out.ptr, a, sizeof(out.ptr));
+                a += sizeof(out.ptr);
+                return true;
+        }
+        return false;
+    }
+
+    // printf semantics on the stored argument width: %u of an int -1 is
+    // 4294967295, %d of a uint32_t wraps negative, as with the real call
+    static long long asSigned(const Arg& a) {
+        if (a.type == F64) return (long long)a.d;
+        if (a.type == I32 || a.type == U32) return (int32_t)(uint32_t)a.bits;
+        return (long long)a.bits;
+    }
+    static unsigned long long asUnsigned(const Arg& a) {
+        if (a.type == F64) return (unsigned long long)a.d;
+        if (a.type == I32 || a.type == U32) return (uint32_t)a.bits;
+        return a.bits;
+    }
+
+    static size_t format(char* out, size_t cap, const char* f, const uint8_t* a,
+                         const uint8_t* end, uint8_t nargs) {
+        size_t pos = 0;
+        Arg arg;
+        auto left = [&]() { return pos < cap ? cap - pos : 0; };
+
+        while (*f && pos + 1 < cap) {
+            if (*f != '%') {
+                out[pos++] = *f++;
+                continue;
+            }
+            if (f[1] == '%') {
+                out[pos++] = '%';
+                f += 2;
+                continue;
+            }
+
+            // %[flags][width][.precision][length]conv - length is re-derived
+            // from the stored argument, so it is parsed and dropped here
+            char spec[24];
+            size_t k = 0;
+            spec[k++] = *f++;
+            while (*f && strchr("-+ #0", *f) && k < 16) spec[k++] = *f++;
+            while (isdigit((unsigned char)*f) && k < 16) spec[k++] = *f++;
+            if (*f == '.') {
+                spec[k++] = *f++;
+                while (isdigit((unsigned char)*f) && k < 16) spec[k++] = *f++;
+            }
+            while (*f && strchr("hlLqjzt", *f)) f++;
+            char conv = *f;
+            if (!conv) break;
+            f++;
+
+            if (!nargs-- || !readArg(a, end, arg)) {
+                pos += snprintf(out + pos, left(), "?");
+                continue;
+            }
+
+            int n = 0;
+            switch (conv) {
+                case 'd': case 'i':
+                    spec[k++] = 'l'; spec[k++] = 'l'; spec[k++] = conv; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec, asSigned(arg));
+                    break;
+                case 'u': case 'x': case 'X': case 'o':
+                    spec[k++] = 'l'; spec[k++] = 'l'; spec[k++] = conv; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec, asUnsigned(arg));
+                    break;
+                case 'c':
+                    spec[k++] = 'c'; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec, (int)asSigned(arg));
+                    break;
+                case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                    spec[k++] = conv; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec,
+                                 arg.type == F64 ? arg.d : (double)asSigned(arg));
+                    break;
+                case 's':
+                    spec[k++] = 's'; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec, arg.type == STR ? arg.str : "?");
+                    break;
+                case 'p':
+                    spec[k++] = 'p'; spec[k] = 0;
+                    n = snprintf(out + pos, left(), spec, arg.ptr);
+                    break;
+                default:
+                    n = snprintf(out + pos, left(), "?");
+                    break;
+            }
+            if (n > 0) pos += n;
+        }
+        if (pos >= cap) pos = cap - 1;
+        out[pos] = 0;
+        return pos;
+    }
+
+    static void tailAppend(State& st, const char* p, size_t n) {
+        while (n--) {
+            st.tail_[st.tailHead++] = *p++;
+            if (st.tailHead == TAIL) {
+                st.tailHead = 0;
+                st.tailWrapped = true;
+            }
+        }
+    }
+
+    static void emit(uint8_t level, uint32_t tMs, const char* line, size_t n) {
+        Serial.write((const uint8_t*)line, n);
+        Serial.write('\n');
+
+        State& st = s();
+        static const char letters[] = "?EWID";
+        char prefix[24];
+        int p = snprintf(prefix, sizeof(prefix), "[%6lu.%03lu] %c ", (unsigned long)(tMs / 1000),
+                         (unsigned long)(tMs % 1000), letters[level <= DEBUG ? level : 0]);
+        if (st.tailLock) xSemaphoreTake(st.tailLock, portMAX_DELAY);
+        tailAppend(st, prefix, p);
+        tailAppend(st, line, n);
+        tailAppend(st, "\n", 1);
+        if (st.tailLock) xSemaphoreGive(st.tailLock);
+    }
+
+    static void emitRecord(const uint8_t* rec) {
+        const Header* h = (const Header*)rec;
+        char line[LINE];
+        size_t n = format(line, sizeof(line), h->fmt, rec + sizeof(Header), rec + h->len, h->nargs);
+        emit(h->level, h->tMs, line, n);
+    }
+
+    // Drain task: one record per call
+    static bool drainOne() {
+        State& st = s();
+        uint32_t t = st.tail.load(std::memory_order_relaxed);
+        if (t == st.head.load(std::memory_order_acquire)) return false;
+
+        uint8_t* rec = st.ring + (t & (RING - 1));
+        Header* h = (Header*)rec;
+        uint8_t state = __atomic_load_n(&h->state, __ATOMIC_ACQUIRE);
+        if (state == FREE) return false;   // reserved, still being written
+
+        uint16_t len = h->len;
+        if (state == READY) {
+            emitRecord(rec);
+            st.records++;
+        }
+        memset(rec, 0, len);   // reserved-but-unwritten space must read FREE
+        st.tail.store(t + len, std::memory_order_release);
+        return true;
+    }
+
+    static void taskMain(void*) {
+        State& st = s();
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            while (drainOne()) {}
+
+            uint32_t d = st.dropped.load(std::memory_order_relaxed);
+            if (d != st.reported) {
+                char line[64];
+                int n = snprintf(line, sizeof(line), "⚠️ Log: %lu records dropped (ring full)",
+                                 (unsigned long)(d - st.reported));
+                st.reported = d;
+                emit(WARN, millis(), line, n);
+            }
+        }
+    }
+
+    template <typename... A>
+    static size_t recordSize(const A&... args) {
+        Enc measure = {nullptr, nullptr, sizeof(Header), 0};
+        (put(measure, args), ...);
+        return (min(measure.size, MAX_RECORD) + 3) & ~(size_t)3;
+    }
+
+    template <typename... A>
+    static void encode(uint8_t* rec, size_t n, Level level, const char* fmt, const A&... args) {
+        Header* h = (Header*)rec;
+        h->len = n;
+        h->level = level;
+        h->tMs = millis();
+        h->fmt = fmt;
+        Enc e = {rec + sizeof(Header), rec + n, 0, 0};
+        (put(e, args), ...);
+        h->nargs = e.count;
+    }
+
+    // No drain task yet: format and print on the caller
+    template <typename... A>
+    static void __attribute__((noinline)) writeInline(Level level, const char* fmt, const A&... args) {
+        alignas(4) uint8_t rec[MAX_RECORD];
+        encode(rec, recordSize(args...), level, fmt, args...);
+        emitRecord(rec);
+    }
+
+public:
+    // Start the drain task; before this, records print inline
+    static bool begin(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY) {
+        State& st = s();
+        if (st.task) return true;
+        if (!st.tailLock) st.tailLock = xSemaphoreCreateMutex();
+        return xTaskCreatePinnedToCore(taskMain, "LogDrain", 3072, nullptr, priority, &st.task, core) == pdPASS;
+    }
+
+    // Wait (bounded) for queued records to reach Serial, e.g. before a restart
+    static void flush(uint32_t timeoutMs = 500) {
+        State& st = s();
+        if (!st.task) return;
+        xTaskNotifyGive(st.task);
+        uint32_t t0 = millis();
+        while (st.head.load() != st.tail.load() && millis() - t0 < timeoutMs) delay(5);
+        Serial.flush();
+    }
+
+    template <typename... A>
+    static void write(Level level, const char* fmt, const A&... args) {
+        State& st = s();
+        if (!st.task) {
+            writeInline(level, fmt, args...);
+            return;
+        }
+
+        size_t n = recordSize(args...);
+        uint8_t* rec = reserve(n);
+        if (!rec) {
+            st.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        encode(rec, n, level, fmt, args...);
+        __atomic_store_n(&((Header*)rec)->state, (uint8_t)READY, __ATOMIC_RELEASE);
+        xTaskNotifyGive(st.task);
+    }
+
+    // Compile-time printf checking for the LOG_* macros (never called)
+    __attribute__((format(printf, 1, 2))) static void check(const char*, ...) {}
+
+    static uint32_t dropped() { return s().dropped.load(); }
+
+    // Recent formatted lines, oldest first (starts at a line boundary)
+    static void writeTail(Print& out) {
+        State& st = s();
+        if (st.tailLock) xSemaphoreTake(st.tailLock, portMAX_DELAY);
+        if (st.tailWrapped) {
+            size_t i = st.tailHead;
+            while (i < TAIL && st.tail_[i] != '\n') i++;   // skip the partial first line
+            if (i + 1 < TAIL) out.write((const uint8_t*)st.tail_ + i + 1, TAIL - i - 1);
+        }
+        out.write((const uint8_t*)st.tail_, st.tailHead);
+        if (st.tailLock) xSemaphoreGive(st.tailLock);
+    }
+};
+
+#define LOG_AT_(lvl, fmt, ...)                              \
+    do {                                                    \
+        if (false) Log::check(fmt, ##__VA_ARGS__);          \
+        Log::write(lvl, fmt, ##__VA_ARGS__);                \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL >= 1
+#define LOG_E(fmt, ...) LOG_AT_(Log::ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_E(fmt, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= 2
+#define LOG_W(fmt, ...) LOG_AT_(Log::WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_W(fmt, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= 3
+#define LOG_I(fmt, ...) LOG_AT_(Log::INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_I(fmt, ...) do { } while (0)
+#endif
+#if LOG_COMPILE_LEVEL >= 4
+#define LOG_D(fmt, ...) LOG_AT_(Log::DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_D(fmt, ...) do { } while (0)
+#endif
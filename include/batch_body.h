@@ -0,0 +1,93 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "sample_json.h"
+#include "sample_cbor.h"
+
+// -----------------------------------
+// Batch Body
+// {"aggregator":"<id>","devices":[{"device":"<id>","sample":{...}},...]}
+// in JSON or CBOR, written in one pass into a caller buffer. The fleet
+// aggregator sends the group's samples in it, and the low-power flush
+// sends one unit's buffered samples (README "Batch Uploads").
+// -----------------------------------
+class BatchBody {
+    uint8_t* out;
+    size_t cap;
+    size_t pos = 0;
+    bool cbor;
+    bool ok = true;
+    uint8_t n = 0;
+    char hex[9] = {};
+
+    void put(const char* s, size_t len) {
+        if (!ok || cap - pos < len) {
+            ok = false;
+            return;
+        }
+        memcpy(out + pos, s, len);
+        pos += len;
+    }
+
+public:
+    // Device wrapper per record, and the envelope, on top of the samples
+    static constexpr size_t ENTRY_OVERHEAD = 32;
+    static constexpr size_t HEAD_LEN = 40;
+
+    // Buffer for a body of up to n records
+    static constexpr size_t maxLen(size_t n) { return HEAD_LEN + n * (SampleJson::MAX_LEN + ENTRY_OVERHEAD); }
+
+    static void putHex(char* dst, uint32_t id) {
+        for (int i = 7; i >= 0; i--, id >>= 4) dst[i] = "0123456789abcdef"[id & 15];
+    }
+
+    // entries: exact record count (CBOR writes it up front)
+    BatchBody(uint8_t* buf, size_t bufCap, bool useCbor, uint32_t aggregator, uint8_t entries)
+    : out(buf), cap(bufCap), cbor(useCbor) {
+        putHex(hex, aggregator);
+        if (cbor) {
+            SampleCbor::Writer w(out, cap);
+            w.map(2);
+            w.key("aggregator"); w.text(hex);
+            w.key("devices");    w.array(entries);
+            pos = w.finish(out);
+            ok = pos > 0;
+        } else {
+            put("{\"aggregator\":\"", 15);
+            put(hex, 8);
+            put("\",\"devices\":[", 13);
+        }
+    }
+
+    // false once the body no longer fits
+    bool add(uint32_t device, const SampleJson::Fields& f) {
+        putHex(hex, device);
+        size_t len = 0;
+        if (cbor) {
+            SampleCbor::Writer w(out + pos, cap - pos);
+            w.map(2);
+            w.key("device"); w.text(hex);
+            w.key("sample");
+            size_t head = ok ? w.finish(out + pos) : 0;
+            pos += head;
+            len = head ? SampleCbor::write(out + pos, cap - pos, f) : 0;
+        } else {
+            put(n ? ",{\"device\":\"" : "{\"device\":\"", n ? 12 : 11);
+            put(hex, 8);
+            put("\",\"sample\":", 11);
+            len = ok ? SampleJson::write((char*)out + pos, cap - pos, f) : 0;
+        }
+        ok = ok && len;
+        pos += len;
+        if (!cbor) put("}", 1);
+        n++;
+        return ok;
+    }
+
+    // Body length, 0 if anything did not fit
+    size_t finish() {
+        if (!cbor) put("]}", 2);
+        return ok ? pos : 0;
+    }
+};
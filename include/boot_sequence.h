@@ -0,0 +1,280 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "config.h"
+#include "async_log.h"
+
+// -----------------------------------
+// Boot Sequence
+// Runs independent init steps concurrently and times every boot phase
+// against its budget.
+//   spawn()     step on its own short-lived task (sensor inits)
+//   run()       step on the caller, timed (must-be-first work)
+//   open/close  phases that finish asynchronously (WiFi association,
+//               first sample, deferred OTA check)
+//   join()      waits for the spawned steps, each no longer than its
+//               budget; a step still running is marked timed out and
+//               boot continues without it
+// The report lives in RTC memory that survives software and watchdog
+// resets, so the previous boot's report is still readable after a hang.
+// Printed once the boot phases settle and served at /api/boot.
+// -----------------------------------
+class BootSequence {
+public:
+    typedef bool (*StepFn)(void* arg);
+
+    enum Status : uint8_t {
+        PENDING,        // running
+        OK,
+        FAILED,         // step returned false
+        OVER_BUDGET,    // finished, but late
+        TIMED_OUT       // join() gave up on it (still running)
+    };
+
+    static constexpr uint8_t MAX_PHASES = BOOT_MAX_PHASES;
+
+    static const char* statusName(uint8_t s) {
+        switch (s) {
+            case PENDING:     return "pending";
+            case OK:          return "ok";
+            case FAILED:      return "failed";
+            case OVER_BUDGET: return "over_budget";
+            case TIMED_OUT:   return "timed_out";
+        }
+        return "?";
+    }
+
+private:
+    struct Phase {
+        char name[12];
+        uint32_t startMs;       // since reset
+        uint32_t endMs;         // 0 while pending
+        uint32_t budgetMs;
+        uint8_t status;
+        bool spawned;
+    };
+
+    struct Report {
+        uint32_t magic;
+        uint32_t bootCount;
+        uint8_t resetReason;    // esp_reset_reason_t
+        uint8_t count;
+        uint32_t readyMs;       // setup() done; 0 = did not get there
+        Phase phases[MAX_PHASES];
+    };
+
+    static constexpr uint32_t RTC_MAGIC = 0x424F5431;  // "BOT1"
+
+    // [0] this boot, [1] the previous one
+    static Report* reports() {
+        RTC_NOINIT_ATTR static Report r[2];
+        return r;
+    }
+
+    struct StepArgs {
+        StepFn fn;
+        void* arg;
+        uint8_t id;
+    };
+
+    struct State {
+        StepArgs steps[MAX_PHASES];
+        TaskHandle_t waiter;
+        bool reported;
+    };
+
+    static State& state() {
+        static State s = {};
+        return s;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    static uint32_t now() { return (uint32_t)(esp_timer_get_time() / 1000); }
+
+    static int add(const char* name, uint32_t budgetMs, bool spawned) {
+        Report& r = reports()[0];
+        portENTER_CRITICAL(&mux());
+        int id = r.count < MAX_PHASES ? r.count++ : -1;
+        portEXIT_CRITICAL(&mux());
+        if (id < 0) return -1;
+        Phase& p = r.phases[id];
+        strlcpy(p.name, name, sizeof(p.name));
+        p.startMs = now();
+        p.endMs = 0;
+        p.budgetMs = budgetMs;
+        p.status = PENDING;
+        p.spawned = spawned;
+        return id;
+    }
+
+    static void stepMain(void* arg) {
+        StepArgs* a = (StepArgs*)arg;
+        bool ok = a->fn(a->arg);
+        close(a->id, ok);
+        TaskHandle_t waiter = state().waiter;
+        if (waiter) xTaskNotifyGive(waiter);
+        vTaskDelete(nullptr);
+    }
+
+    // Report is complete once nothing is pending
+    static void maybeReport() {
+        Report& r = reports()[0];
+        portENTER_CRITICAL(&mux());
+        bool done = r.readyMs && !state().reported;
+        for (uint8_t i = 0; done && i < r.count; i++) {
+            if (r.phases[i].status == PENDING || r.phases[i].status == TIMED_OUT) done = false;
+        }
+        if (done) state().reported = true;
+        portEXIT_CRITICAL(&mux());
+        if (done) printReport();
+    }
+
+    static void writeReport(Print& out, const Report& r) {
+        out.printf("{\"boot\":%lu,\"reset_reason\":%u,\"ready_ms\":%lu,\"phases\":[",
+                   (unsigned long)r.bootCount, r.resetReason, (unsigned long)r.readyMs);
+        for (uint8_t i = 0; i < r.count && i < MAX_PHASES; i++) {
+            const Phase& p = r.phases[i];
+            out.printf("%s{\"name\":\"%s\",\"start_ms\":%lu,\"end_ms\":%lu,\"budget_ms\":%lu,\"status\":\"%s\"}",
+                       i ? "," : "", p.name, (unsigned long)p.startMs, (unsigned long)p.endMs,
+                       (unsigned long)p.budgetMs, statusName(p.status));
+        }
+        out.print("]}");
+    }
+
+public:
+    // First thing in setup(): keeps the last report, starts a new one
+    static void begin() {
+        Report* r = reports();
+        uint32_t boots = 0;
+        // Power-on: RTC memory holds noise, not a report
+        if (r[0].magic == RTC_MAGIC && esp_reset_reason() != ESP_RST_POWERON) {
+            r[1] = r[0];
+            if (r[1].count > MAX_PHASES) r[1].count = MAX_PHASES;
+            boots = r[0].bootCount;
+        } else {
+            memset(&r[1], 0, sizeof(r[1]));
+        }
+        memset(&r[0], 0, sizeof(r[0]));
+        r[0].magic = RTC_MAGIC;
+        r[0].bootCount = boots + 1;
+        r[0].resetReason = (uint8_t)esp_reset_reason();
+        state().waiter = xTaskGetCurrentTaskHandle();
+    }
+
+    // Start fn on its own task; join() waits for it (bounded by budgetMs)
+    static int spawn(const char* name, uint32_t budgetMs, StepFn fn, void* arg = nullptr,
+                     uint32_t stack = 3072) {
+        int id = add(name, budgetMs, true);
+        if (id < 0) {
+            fn(arg);   // out of slots: run untimed
+            return -1;
+        }
+        StepArgs& a = state().steps[id];
+        a = {fn, arg, (uint8_t)id};
+        if (xTaskCreate(stepMain, name, stack, &a, 2, nullptr) != pdPASS) {
+            LOG_W("⚠️ Boot step %s: no task, running inline", name);
+            close(id, fn(arg));
+        }
+        return id;
+    }
+
+    // Run fn here, timed against budgetMs
+    static bool run(const char* name, uint32_t budgetMs, StepFn fn, void* arg = nullptr) {
+        int id = add(name, budgetMs, false);
+        bool ok = fn(arg);
+        close(id, ok);
+        return ok;
+    }
+
+    // Phase completed elsewhere via close()
+    static int open(const char* name, uint32_t budgetMs) {
+        return add(name, budgetMs, false);
+    }
+
+    // Safe from any task; only the first close of a phase counts
+    static void close(int id, bool ok) {
+        if (id < 0 || id >= MAX_PHASES) return;
+        Report& r = reports()[0];
+        Phase& p = r.phases[id];
+        uint32_t t = now();
+        portENTER_CRITICAL(&mux());
+        bool first = p.endMs == 0;
+        if (first) {
+            p.endMs = t ? t : 1;
+            if (!ok) p.status = FAILED;
+            else if (t - p.startMs > p.budgetMs) p.status = OVER_BUDGET;
+            else p.status = OK;
+        }
+        portEXIT_CRITICAL(&mux());
+        if (!first) return;
+        if (p.status != OK) {
+            LOG_W("⚠️ Boot %s: %s after %lums (budget %lums)", p.name, statusName(p.status),
+                  (unsigned long)(t - p.startMs), (unsigned long)p.budgetMs);
+        }
+        maybeReport();
+    }
+
+    // Wait for the spawned steps, each until its own deadline. Returns
+    // false if any is still running (marked timed out) or failed.
+    static bool join() {
+        Report& r = reports()[0];
+        bool allOk = true;
+        for (uint8_t i = 0; i < r.count; i++) {
+            Phase& p = r.phases[i];
+            if (!p.spawned) continue;
+            for (;;) {
+                if (p.endMs) break;
+                int32_t left = (int32_t)(p.startMs + p.budgetMs - now());
+                if (left <= 0) break;
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(left));
+            }
+            portENTER_CRITICAL(&mux());
+            if (!p.endMs) p.status = TIMED_OUT;
+            portEXIT_CRITICAL(&mux());
+            if (p.status == TIMED_OUT) {
+                LOG_W("⚠️ Boot %s: still running after %lums - continuing without it",
+                      p.name, (unsigned long)p.budgetMs);
+            }
+            if (p.status != OK && p.status != OVER_BUDGET) allOk = false;
+        }
+        return allOk;
+    }
+
+    // setup() finished; the report prints once open phases close
+    static void ready() {
+        reports()[0].readyMs = now();
+        LOG_I("🚀 Ready %lums after reset", (unsigned long)reports()[0].readyMs);
+        maybeReport();
+    }
+
+    static void printReport() {
+        const Report& r = reports()[0];
+        Serial.printf("⏱️ Boot #%lu: ready at %lums\n", (unsigned long)r.bootCount,
+                      (unsigned long)r.readyMs);
+        for (uint8_t i = 0; i < r.count; i++) {
+            const Phase& p = r.phases[i];
+            Serial.printf("   %-11s %6lu -> %6lums %6lums / %6lums  %s\n", p.name,
+                          (unsigned long)p.startMs, (unsigned long)p.endMs,
+                          (unsigned long)(p.endMs ? p.endMs - p.startMs : now() - p.startMs),
+                          (unsigned long)p.budgetMs, statusName(p.status));
+        }
+    }
+
+    static void writeJson(Print& out) {
+        const Report* r = reports();
+        out.print("{\"current\":");
+        writeReport(out, r[0]);
+        out.print(",\"previous\":");
+        if (r[1].magic == RTC_MAGIC) writeReport(out, r[1]);
+        else out.print("null");
+        out.print("}");
+    }
+};
@@ -0,0 +1,299 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <math.h>
+#include <string.h>
+#include "config.h"
+
+// -----------------------------------
+// Bus Trace
+// Records what the sensor drivers actually saw - raw ZH07 UART bytes,
+// AGS02MA TVOC reads, DHT results - so field glitches can be replayed
+// through the same drivers later (native/replay_main.cpp).
+//
+// File: 12-byte header ("HSTR", version, 3 reserved, startMs u32 LE),
+// then records:  tag u8 | dt varint (ms since previous record) | payload
+//   UART      len u8, len bytes (as consumed by PMSensor, in order; since
+//             version 2 the ZH07's Q&A replies, before it its stream)
+//   TVOC      float32 LE (fetched ppb, negative = failed read)
+//   DHT_TEMP  int16 LE x10 (INT16_MIN = NAN)
+//   DHT_HUM   int16 LE x10 (INT16_MIN = NAN)
+//   CYCLE     seq varint (fusion triggered the buses)
+//   GAP       count varint (records lost to a full ring)
+//
+// The bus tasks append into a RAM ring under a spinlock; a sink (LittleFS
+// on the device, a FILE* in the simulator) drains it. Calls are a single
+// flag test while not capturing.
+// -----------------------------------
+class BusTrace {
+public:
+    enum Tag : uint8_t { UART = 1, TVOC, DHT_TEMP, DHT_HUM, CYCLE, GAP };
+
+    static constexpr uint8_t VERSION = 2;
+    static constexpr size_t HEADER_SIZE = 12;
+    static constexpr size_t RING = BUS_TRACE_RING_BYTES;
+    static_assert((RING & (RING - 1)) == 0, "BUS_TRACE_RING_BYTES must be a power of two");
+
+private:
+    struct State {
+        volatile bool active = false;
+        uint8_t ring[RING];
+        uint32_t head = 0;           // free-running write index
+        uint32_t tail = 0;           // free-running read index
+        uint32_t startMs = 0;
+        uint32_t lastMs = 0;
+        uint32_t pendingGap = 0;     // records dropped since the last one written
+        uint32_t dropped = 0;
+        uint32_t records = 0;
+        bool uartOpen = false;       // last record is UART and may still grow
+        uint32_t uartLenAt = 0;      // ring index of its length byte
+    };
+
+    static State& s() {
+        static State st;
+        return st;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    static uint32_t space(const State& t) { return RING - (t.head - t.tail); }
+
+    static void putByte(State& t, uint8_t b) { t.ring[t.head++ & (RING - 1)] = b; }
+
+    static size_t varint(uint8_t* out, uint32_t v) {
+        size_t n = 0;
+        do {
+            uint8_t b = v & 0x7F;
+            v >>= 7;
+            out[n++] = b | (v ? 0x80 : 0);
+        } while (v);
+        return n;
+    }
+
+    // Caller holds mux(). Writes a pending GAP first; drops the record if
+    // either does not fit.
+    static bool putRecord(State& t, uint8_t tag, const uint8_t* payload, size_t n, uint32_t now) {
+        uint8_t hdr[1 + 5];
+        uint8_t gap[1 + 5 + 5];
+        size_t g = 0;
+        if (t.pendingGap) {
+            gap[0] = GAP;
+            g = 1 + varint(gap + 1, now - t.lastMs);
+            g += varint(gap + g, t.pendingGap);
+        }
+        hdr[0] = tag;
+        size_t h = 1 + varint(hdr + 1, g ? 0 : now - t.lastMs);
+
+        if (space(t) < g + h + n) {
+            t.pendingGap++;
+            t.dropped++;
+            t.uartOpen = false;
+            return false;
+        }
+        for (size_t i = 0; i < g; i++) putByte(t, gap[i]);
+        t.pendingGap = 0;
+        for (size_t i = 0; i < h; i++) putByte(t, hdr[i]);
+        for (size_t i = 0; i < n; i++) putByte(t, payload[i]);
+        t.lastMs = now;
+        t.records++;
+        t.uartOpen = false;
+        return true;
+    }
+
+    static int16_t x10(float v) {
+        return isnan(v) ? INT16_MIN : (int16_t)lroundf(v * 10.0f);
+    }
+
+public:
+    static bool capturing() { return s().active; }
+
+    // Discards anything not yet drained
+    static void start() {
+        State& t = s();
+        portENTER_CRITICAL(&mux());
+        t.head = t.tail = 0;
+        t.startMs = t.lastMs = millis();
+        t.pendingGap = t.dropped = t.records = 0;
+        t.uartOpen = false;
+        t.active = true;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void stop() { s().active = false; }
+
+    // 12-byte file header for the current capture
+    static size_t header(uint8_t* out) {
+        uint32_t t0 = s().startMs;
+        memcpy(out, "HSTR", 4);
+        out[4] = VERSION;
+        out[5] = out[6] = out[7] = 0;
+        for (int i = 0; i < 4; i++) out[8 + i] = (t0 >> (8 * i)) & 0xFF;
+        return HEADER_SIZE;
+    }
+
+    // Bytes PMSensor consumed. Consecutive bytes in the same millisecond
+    // extend the open UART record instead of starting a new one.
+    static void uart(const uint8_t* p, size_t n) {
+        if (!capturing()) return;
+        State& t = s();
+        portENTER_CRITICAL(&mux());
+        uint32_t now = millis();
+        while (n) {
+            uint8_t& len = t.ring[t.uartLenAt & (RING - 1)];
+            if (t.uartOpen && now == t.lastMs && len < 255 && space(t) > 0) {
+                size_t take = min(n, min((size_t)(255 - len), (size_t)space(t)));
+                for (size_t i = 0; i < take; i++) putByte(t, p[i]);
+                len += take;
+                p += take;
+                n -= take;
+                continue;
+            }
+            // New one-byte record; the branch above appends the rest
+            uint8_t payload[2] = {1, *p};
+            if (!putRecord(t, UART, payload, 2, now)) break;
+            t.uartOpen = true;
+            t.uartLenAt = t.head - 2;
+            p++;
+            n--;
+        }
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void uart(uint8_t b) { uart(&b, 1); }
+
+    static void tvoc(float raw) {
+        if (!capturing()) return;
+        uint8_t p[4];
+        memcpy(p, &raw, 4);   // ESP32 and hosts are little-endian
+        portENTER_CRITICAL(&mux());
+        putRecord(s(), TVOC, p, 4, millis());
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void dht(Tag which, float v) {
+        if (!capturing()) return;
+        int16_t q = x10(v);
+        uint8_t p[2] = {(uint8_t)(q & 0xFF), (uint8_t)((uint16_t)q >> 8)};
+        portENTER_CRITICAL(&mux());
+        putRecord(s(), which, p, 2, millis());
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void cycle(uint32_t seq) {
+        if (!capturing()) return;
+        uint8_t p[5];
+        size_t n = varint(p, seq);
+        portENTER_CRITICAL(&mux());
+        putRecord(s(), CYCLE, p, n, millis());
+        portEXIT_CRITICAL(&mux());
+    }
+
+    // Copy up to max staged bytes out (sink side)
+    static size_t drain(uint8_t* out, size_t max) {
+        State& t = s();
+        portENTER_CRITICAL(&mux());
+        size_t n = min((size_t)(t.head - t.tail), max);
+        for (size_t i = 0; i < n; i++) out[i] = t.ring[t.tail++ & (RING - 1)];
+        if (n) t.uartOpen = false;   // its length byte may be gone
+        portEXIT_CRITICAL(&mux());
+        return n;
+    }
+
+    static uint32_t records() { return s().records; }
+    static uint32_t dropped() { return s().dropped; }
+
+    // -----------------------------
+    // Reader (replay side, portable)
+    // -----------------------------
+    struct Record {
+        Tag tag;
+        uint32_t tMs;            // device millis()
+        const uint8_t* data;     // UART bytes
+        uint8_t len;
+        float value;             // TVOC raw, DHT value (NAN), CYCLE seq, GAP count
+    };
+
+    class Reader {
+        const uint8_t* buf;
+        size_t size;
+        size_t pos = 0;
+        uint32_t nowMs = 0;
+
+        bool readVarint(uint32_t& v) {
+            v = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                if (pos >= size) return false;
+                uint8_t b = buf[pos++];
+                v |= (uint32_t)(b & 0x7F) << shift;
+                if (!(b & 0x80)) return true;
+            }
+            return false;
+        }
+
+    public:
+        bool error = false;      // partial record or unknown tag
+        uint32_t startMs = 0;
+
+        Reader(const uint8_t* data, size_t len) : buf(data), size(len) {}
+
+        bool begin() {
+            if (size < HEADER_SIZE || memcmp(buf, "HSTR", 4) != 0 || buf[4] != VERSION) return false;
+            startMs = buf[8] | (buf[9] << 8) | (buf[10] << 16) | ((uint32_t)buf[11] << 24);
+            nowMs = startMs;
+            pos = HEADER_SIZE;
+            return true;
+        }
+
+        // false at the end of the trace or on a bad record (see error)
+        bool next(Record& r) {
+            if (pos >= size) return false;
+            uint32_t dt, v;
+            r.tag = (Tag)buf[pos++];
+            if (!readVarint(dt)) return fail();
+            nowMs += dt;
+            r.tMs = nowMs;
+            r.data = nullptr;
+            r.len = 0;
+            r.value = NAN;
+
+            switch (r.tag) {
+                case UART:
+                    if (pos >= size || pos + 1 + buf[pos] > size) return fail();
+                    r.len = buf[pos++];
+                    r.data = buf + pos;
+                    pos += r.len;
+                    return true;
+                case TVOC:
+                    if (pos + 4 > size) return fail();
+                    memcpy(&r.value, buf + pos, 4);
+                    pos += 4;
+                    return true;
+                case DHT_TEMP:
+                case DHT_HUM: {
+                    if (pos + 2 > size) return fail();
+                    int16_t q = (int16_t)(buf[pos] | (buf[pos + 1] << 8));
+                    pos += 2;
+                    r.value = (q == INT16_MIN) ? NAN : q / 10.0f;
+                    return true;
+                }
+                case CYCLE:
+                case GAP:
+                    if (!readVarint(v)) return fail();
+                    r.value = (float)v;
+                    return true;
+                default:
+                    return fail();   // unknown tag: cannot resync
+            }
+        }
+
+    private:
+        bool fail() {
+            pos = size;
+            error = true;
+            return false;
+        }
+    };
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "config.h"
+#include "bus_trace.h"
+#include "async_log.h"
+
+// -----------------------------------
+// Bus Trace Store
+// LittleFS sink for BusTrace. Web handlers only post start/stop requests;
+// all file I/O happens in service(), called by the pipeline's Log task,
+// so flash writes never run on a bus task or the async web task.
+// The finished trace is served as BUS_TRACE_FILE by the static handler.
+// -----------------------------------
+class BusTraceStore {
+private:
+    struct State {
+        File file;
+        bool open = false;
+        volatile bool startRequested = false;
+        volatile bool stopRequested = false;
+        volatile uint32_t bytes = 0;
+    };
+
+    static State& s() {
+        static State st;
+        return st;
+    }
+
+    static void flush(State& t) {
+        static uint8_t chunk[512];
+        size_t n;
+        while ((n = BusTrace::drain(chunk, sizeof(chunk))) > 0) {
+            t.file.write(chunk, n);
+            t.bytes += n;
+        }
+    }
+
+public:
+    static void requestStart() { s().startRequested = true; }
+    static void requestStop() { s().stopRequested = true; }
+    static bool capturing() { return s().open; }
+
+    // Log task: open/close the file and move staged records to flash
+    static void service() {
+        State& t = s();
+
+        if (t.startRequested) {
+            t.startRequested = false;
+            t.stopRequested = false;
+            if (t.open) t.file.close();
+            t.file = LittleFS.open(BUS_TRACE_FILE, "w");
+            t.open = (bool)t.file;
+            if (!t.open) {
+                LOG_E("❌ Bus trace: cannot create " BUS_TRACE_FILE);
+                return;
+            }
+            BusTrace::start();
+            uint8_t hdr[BusTrace::HEADER_SIZE];
+            t.file.write(hdr, BusTrace::header(hdr));
+            t.bytes = BusTrace::HEADER_SIZE;
+            LOG_I("🎙️ Bus trace capture started");
+        }
+
+        if (!t.open) return;
+        flush(t);
+
+        if (t.stopRequested || t.bytes >= BUS_TRACE_MAX_BYTES) {
+            t.stopRequested = false;
+            BusTrace::stop();
+            flush(t);
+            t.file.close();
+            t.open = false;
+            LOG_I("🎙️ Bus trace stopped: %lu records, %lu bytes, %lu dropped",
+                          (unsigned long)BusTrace::records(), (unsigned long)t.bytes,
+                          (unsigned long)BusTrace::dropped());
+        }
+    }
+
+    static void writeJson(Print& out) {
+        State& t = s();
+        out.printf("{\"capturing\":%s,\"file\":\"%s\",\"bytes\":%lu,\"max_bytes\":%lu,"
+                   "\"records\":%lu,\"dropped\":%lu}",
+                   t.open ? "true" : "false", BUS_TRACE_FILE, (unsigned long)t.bytes,
+                   (unsigned long)BUS_TRACE_MAX_BYTES, (unsigned long)BusTrace::records(),
+                   (unsigned long)BusTrace::dropped());
+    }
+};
@@ -17,12 +17,19 @@
 // -----------------------
 #define PM_RX_PIN 32
 #define PM_TX_PIN 33
+#define PM_QUERY_TIMEOUT_MS 200 // Q&A mode: wait this long for the reply to a query
+#define PM_CAL_KAPPA 0.40       // hygroscopicity (kappa-Koehler), config.json "pm_calibration"
+#define PM_CAL_DENSITY 1.65     // dry particle density, g/cm3
 
 // -----------------------
 // AGS02MA TVOC Sensor
 // -----------------------
 #define AGS_SDA_PIN 18
 #define AGS_SCL_PIN 19
+#define AGS_I2C_HZ 25000                        // AGS02MA maximum; own controller (Wire1)
+#define AGS_CONVERSION_MS 1500                  // trigger -> fetch
+#define TVOC_WARMUP_MS 120000                   // heater warm-up after power-on (datasheet)
+#define TVOC_MAX_AGE_MS 120000                  // older cached readings report as unavailable
 
 // -----------------------
 // DHT11 Sensor
@@ -37,11 +44,17 @@
 #define OLED_SDA 21
 #define OLED_SCL 22
 #define OLED_ADDR 0x3C 
+#define OLED_I2C_HZ 400000                      // own controller (Wire), see i2c_bus.h
+#define OLED_MAX_FPS 20                         // Frame-rate cap for partial refreshes
+#define OLED_MIN_FRAME_MS (1000 / OLED_MAX_FPS)
 
 // -----------------------
 // Touch Sensor (TTP223B)
 // -----------------------
 #define TOUCH_PIN 4      // Active-low digital input
+#define TOUCH_DEBOUNCE_MS 30        // Level must be stable this long
+#define TOUCH_LONG_PRESS_MS 800     // Held => long press (toggle display power)
+#define TOUCH_DOUBLE_TAP_MS 300     // Second tap within this => double tap (upload now)
 
 // -----------------------
 // Battery Sensing (Voltage Divider: 100k + 100k)
@@ -49,3 +62,121 @@
 #define BATTERY_PIN 34
 #define VOLT_DIVIDER_RATIO 2.0  // Ratio to multiply ADC voltage by
 
+
+// -----------------------
+// Adaptive Sampling
+// -----------------------
+#define SAMPLE_MIN_INTERVAL_MS 2000    // While PM2.5/TVOC are changing
+#define SAMPLE_BASE_INTERVAL_MS 10000  // After boot
+#define SAMPLE_MAX_INTERVAL_MS 20000   // Upper bound when air is stable (peak error, see tools/adaptive_sampler_sim.cpp)
+#define AQI_CATEGORY_HYSTERESIS 5      // AQI points past a breakpoint before the category counts as changed
+#define UPLOAD_URGENT_MIN_MS 60000     // category-change uploads at most this often
+
+// -----------------------
+// Power Management (DVFS + automatic light sleep)
+// -----------------------
+#define POWER_MGMT_ENABLED 1
+#define CPU_FREQ_MAX_MHZ 240
+#define CPU_FREQ_MIN_MHZ 80
+
+// -----------------------
+// Low-Power Battery Mode (overridable via config.json)
+// -----------------------
+#define LOW_POWER_MODE 0           // 1 = duty-cycled sleep instead of always-on loop
+#define LP_WAKE_INTERVAL_S 60      // Seconds between sensor wakeups
+#define LP_FLUSH_EVERY 10          // Upload buffered samples every N timer wakeups
+#define LP_PM_WARMUP_MS 10000      // ZH07 fan spin-up before a valid reading
+#define LP_LIGHT_SLEEP_MAX_S 20    // Shorter intervals use light sleep instead of deep sleep
+#define LP_TOUCH_SHOW_MS 5000      // OLED on-time after a touch wakeup
+#define BATTERY_CAPACITY_MAH 2900  // BAK N18650CL-29
+
+// -----------------------
+// Batch uploads (config.json "batch_endpoint", see README "Batch Uploads")
+// -----------------------
+#define UPLOAD_BATCH_ENDPOINT ""           // empty: no batch route on the backend, one POST per sample
+
+// -----------------------
+// Bus Trace (record/replay of sensor bus traffic, see bus_trace.h)
+// -----------------------
+#define BUS_TRACE_RING_BYTES 8192          // RAM staging between the bus tasks and LittleFS
+#define BUS_TRACE_MAX_BYTES (512UL * 1024) // Capture stops itself at this file size
+#define BUS_TRACE_FILE "/trace.bin"
+
+// -----------------------
+// Profiling (per-scope CCOUNT histograms, see profiler.h)
+// -----------------------
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 0                // 1 = compile PROFILE_SCOPE timers in
+#endif
+
+// -----------------------
+// Logging (async ring-buffered logger, see async_log.h)
+// -----------------------
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 3                // 1 error, 2 warn, 3 info, 4 debug; higher levels compile out
+#endif
+#define LOG_RING_BYTES 4096                // queued records (format pointer + arguments)
+#define LOG_TAIL_BYTES 2048                // formatted lines kept for /api/logs
+#define LOG_MAX_STR 96                     // longest %s argument copied into a record
+
+// -----------------------
+// I2C (one controller per device, see i2c_bus.h)
+// -----------------------
+#define I2C_LOCK_TIMEOUT_MS 100            // give up waiting for a busy bus
+#define I2C_WIRE_TIMEOUT_MS 50             // controller gives up on a stuck slave
+
+// -----------------------
+// Scheduler (hierarchical timer wheel, see timer_wheel.h)
+// -----------------------
+#define SCHED_TICK_MS 10                   // wheel resolution
+#define SCHED_MAX_JOBS 8                   // jobs per wheel
+#define UI_IDLE_WAKE_MS 1000               // loop() sleeps at most this long (watchdog feed)
+#define WIFI_AP_TIMEOUT_MS (15UL * 60 * 1000) // setup AP reboots after this long
+
+// -----------------------
+// Boot (parallel init steps with per-phase budgets, see boot_sequence.h)
+// -----------------------
+#define BOOT_MAX_PHASES 12
+#define BOOT_FS_BUDGET_MS 500              // LittleFS mount (a first-boot format takes longer)
+#define BOOT_DISPLAY_BUDGET_MS 300         // panel init + render task (animation plays on)
+#define BOOT_SENSOR_BUDGET_MS 1000         // each sensor init, run concurrently
+#define BOOT_WIFI_BUDGET_MS 8000           // reset -> associated with an IP
+#define BOOT_FIRST_SAMPLE_BUDGET_MS 4000   // reset -> first valid PM sample on screen
+#define BOOT_OTA_DELAY_MS 30000            // first OTA check, after the first uploads
+#define BOOT_OTA_BUDGET_MS 15000
+
+// -----------------------
+// Streaming statistics: time-above limits per channel (see stream_stats.h)
+// -----------------------
+#define STATS_PM25_LIMIT 35.0f             // ug/m3, US EPA 24 h standard
+#define STATS_PM10_LIMIT 154.0f            // ug/m3, top of the "Moderate" band
+#define STATS_AQI_LIMIT 100.0f             // "Unhealthy for Sensitive Groups" above
+#define STATS_TVOC_LIMIT 600.0f            // ppb
+#define STATS_TEMP_LIMIT 30.0f             // C
+#define STATS_HUM_LIMIT 70.0f              // %RH, mould risk
+
+// -----------------------
+// Sensor health (fault counters, plausibility, recovery, see sensor_health.h)
+// -----------------------
+#define HEALTH_STUCK_MS (6UL * 3600 * 1000)   // same reading this long => stuck (not on the DHT11)
+#define HEALTH_HOLD_MS (5UL * 60 * 1000)   // last good value stands in this long, then "missing"
+#define HEALTH_RECOVER_AFTER 5             // bad reads in a row before the first recovery step
+#define HEALTH_BACKOFF_MAX 6               // later steps wait up to 5 << 6 bad reads
+#define HEALTH_PM_JUMP 300.0f              // ug/m3 between samples
+#define HEALTH_TVOC_JUMP 5000.0f           // ppb
+#define HEALTH_TEMP_JUMP 5.0f              // C
+#define HEALTH_HUM_JUMP 20.0f              // %RH
+
+// -----------------------
+// Fleet (UDP multicast between units, see fleet_sync.h; enabled via config.json "fleet")
+// -----------------------
+#define FLEET_GROUP 239, 255, 72, 83       // administratively scoped multicast group
+#define FLEET_PORT 4983
+#define FLEET_POLL_MS 1000                 // network task drains received frames
+#define FLEET_ANNOUNCE_MS 30000            // presence frame when no sample went out
+#define FLEET_PEER_TIMEOUT_MS 90000        // silent this long => unit dropped from the table
+#define FLEET_MAX_DEVICES 8                // table size, this unit included
+#define FLEET_BATCH_FAIL_LIMIT 3           // failed batches in a row => stop aggregating
+#define FLEET_ENDPOINT ""                  // empty: batch_endpoint; neither set => never aggregates
+#define FLEET_KEY ""                       // group secret for the frame HMAC (config.json "fleet.key"); empty => fleet off
+#define FLEET_ACK_TIMEOUT_UPLOADS 2        // own samples unacknowledged this many upload intervals => upload directly
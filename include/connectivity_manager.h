@@ -0,0 +1,219 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "wifi_manager.h"
+#include "async_log.h"
+
+// -----------------------------------
+// Connectivity Manager
+// Event-driven WiFi state machine. WiFi events only set flags (and wake
+// the owning task); all transitions and listener callbacks run from
+// loop(), which returns how long the caller may sleep. Nothing here ever
+// blocks or delays.
+// -----------------------------------
+class ConnectivityManager {
+public:
+    enum State {
+        IDLE,
+        CONNECTING,
+        CONNECTED,
+        BACKOFF,
+        AP_FALLBACK
+    };
+
+    typedef std::function<void(State)> Listener;
+
+    static const char* stateName(State s) {
+        switch (s) {
+            case IDLE:        return "IDLE";
+            case CONNECTING:  return "CONNECTING";
+            case CONNECTED:   return "CONNECTED";
+            case BACKOFF:     return "BACKOFF";
+            case AP_FALLBACK: return "AP_FALLBACK";
+        }
+        return "?";
+    }
+
+private:
+    static constexpr unsigned long BACKOFF_MIN_MS = 1000;
+    static constexpr unsigned long BACKOFF_MAX_MS = 60000;
+    static constexpr uint8_t AP_FALLBACK_ATTEMPTS = 3;  // only before first connect
+    static constexpr uint8_t MAX_LISTENERS = 4;
+
+    State state = IDLE;
+    WiFiAttempt attempt = WIFI_ATTEMPT_NONE;
+    unsigned long stateSince = 0;
+    unsigned long attemptStart = 0;
+    unsigned long backoffMs = BACKOFF_MIN_MS;
+    uint8_t failures = 0;
+    bool everConnected = false;
+
+    // Set from the WiFi event task, consumed in loop()
+    volatile bool evGotIP = false;
+    volatile bool evDisconnected = false;
+    volatile uint8_t evReason = 0;
+    TaskHandle_t wakeTask = nullptr;
+
+    Listener listeners[MAX_LISTENERS];
+    uint8_t listenerCount = 0;
+
+    void transition(State next) {
+        if (next == state) return;
+        LOG_I("📶 WiFi: %s -> %s (%lums)", stateName(state), stateName(next),
+              millis() - stateSince);
+        state = next;
+        stateSince = millis();
+        for (uint8_t i = 0; i < listenerCount; i++) listeners[i](state);
+    }
+
+    void wake() {
+        if (wakeTask) xTaskNotifyGive(wakeTask);
+    }
+
+    // ms until the current state times out; events wake the task earlier
+    uint32_t msUntilDeadline(unsigned long now) const {
+        unsigned long left;
+        switch (state) {
+            case CONNECTING: {
+                unsigned long timeout = (attempt == WIFI_ATTEMPT_FAST)
+                                        ? WIFI_FAST_TIMEOUT_MS : WIFI_FULL_TIMEOUT_MS;
+                // loop() gives up once strictly past the timeout
+                left = timeout + 1 - min(now - attemptStart, timeout + 1);
+                break;
+            }
+            case BACKOFF:
+                left = backoffMs - min(now - stateSince, backoffMs);
+                break;
+            default:
+                return UINT32_MAX;
+        }
+        return (uint32_t)left;
+    }
+
+    void startAttempt(bool allowFast) {
+        evGotIP = false;
+        evDisconnected = false;
+        attempt = startWiFiConnect(allowFast);
+        attemptStart = millis();
+
+        if (attempt == WIFI_ATTEMPT_NONE) {
+            transition(AP_FALLBACK);
+            return;
+        }
+        transition(CONNECTING);
+    }
+
+    void attemptFailed() {
+        if (attempt == WIFI_ATTEMPT_FAST) {
+            // Cached AP/lease went stale - retry straight away with a full scan
+            LOG_W("⚠️ Fast connect failed, falling back to full scan");
+            WiFi.disconnect();
+            startAttempt(false);
+            return;
+        }
+
+        WiFi.disconnect();
+        failures++;
+
+        if (!everConnected && failures >= AP_FALLBACK_ATTEMPTS) {
+            transition(AP_FALLBACK);
+            return;
+        }
+
+        // Exponential backoff: 1s, 2s, 4s ... capped at 60s
+        backoffMs = BACKOFF_MIN_MS << min<uint8_t>(failures - 1, 6);
+        if (backoffMs > BACKOFF_MAX_MS) backoffMs = BACKOFF_MAX_MS;
+        LOG_W("⏳ WiFi retry in %lums (failure %u, reason %u)",
+              backoffMs, failures, evReason);
+        transition(BACKOFF);
+    }
+
+public:
+    // Register a state-change listener (uploader, display, ...)
+    bool onStateChange(Listener fn) {
+        if (listenerCount >= MAX_LISTENERS) return false;
+        listeners[listenerCount++] = fn;
+        return true;
+    }
+
+    // Task that calls loop(); notified on WiFi events so it can sleep
+    void setWakeTask(TaskHandle_t task) {
+        wakeTask = task;
+    }
+
+    void begin() {
+        WiFi.onEvent([this](WiFiEvent_t, WiFiEventInfo_t) {
+            evGotIP = true;
+            wake();
+        }, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+
+        WiFi.onEvent([this](WiFiEvent_t, WiFiEventInfo_t info) {
+            evReason = info.wifi_sta_disconnected.reason;
+            evDisconnected = true;
+            wake();
+        }, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+
+        stateSince = millis();
+        startAttempt(true);
+    }
+
+    // Drive timeouts and event-triggered transitions. Returns the ms until
+    // the next timeout (UINT32_MAX: only an event can change the state).
+    uint32_t loop() {
+        unsigned long now = millis();
+
+        switch (state) {
+            case CONNECTING: {
+                if (evGotIP) {
+                    evGotIP = false;
+                    evDisconnected = false;
+                    LOG_I("✅ WiFi connected%s in %lums, IP: %s",
+                          attempt == WIFI_ATTEMPT_FAST ? " (fast)" : "",
+                          now - attemptStart, WiFi.localIP().toString().c_str());
+                    rememberWiFiConnection(attempt);
+                    failures = 0;
+                    backoffMs = BACKOFF_MIN_MS;
+                    everConnected = true;
+                    transition(CONNECTED);
+                    break;
+                }
+
+                unsigned long timeout = (attempt == WIFI_ATTEMPT_FAST)
+                                        ? WIFI_FAST_TIMEOUT_MS : WIFI_FULL_TIMEOUT_MS;
+                // Disconnect events during a fast attempt mean the cached AP is gone
+                bool gaveUp = evDisconnected && attempt == WIFI_ATTEMPT_FAST;
+                if (gaveUp || now - attemptStart > timeout) {
+                    evDisconnected = false;
+                    attemptFailed();
+                }
+                break;
+            }
+
+            case CONNECTED:
+                if (evDisconnected) {
+                    evDisconnected = false;
+                    LOG_W("⚠️ WiFi disconnected (reason %u), reconnecting...", evReason);
+                    startAttempt(true);
+                }
+                break;
+
+            case BACKOFF:
+                if (now - stateSince >= backoffMs) {
+                    startAttempt(true);
+                }
+                break;
+
+            case IDLE:
+            case AP_FALLBACK:
+                break;
+        }
+        return msUntilDeadline(millis());
+    }
+
+    State getState() const { return state; }
+    bool isConnected() const { return state == CONNECTED; }
+    uint8_t getFailures() const { return failures; }
+};
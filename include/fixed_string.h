@@ -0,0 +1,84 @@
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// -----------------------------------
+// Fixed String
+// Fixed-capacity, NUL-terminated string that never touches the heap -
+// the replacement for Arduino String on paths that run every cycle.
+// Appends past the capacity are cut off and flagged (truncated()), so
+// callers can refuse to send a clipped payload instead of corrupting it.
+// -----------------------------------
+template <size_t N>
+class FixedString {
+    static_assert(N > 1, "FixedString needs room for at least one char");
+
+    char buf[N];
+    size_t len = 0;
+    bool clipped = false;
+
+public:
+    FixedString() { buf[0] = '\0'; }
+    explicit FixedString(const char* s) : FixedString() { append(s); }
+
+    void clear() {
+        len = 0;
+        clipped = false;
+        buf[0] = '\0';
+    }
+
+    FixedString& append(const char* s) {
+        size_t n = strlen(s);
+        size_t room = N - 1 - len;
+        if (n > room) {
+            n = room;
+            clipped = true;
+        }
+        memcpy(buf + len, s, n);
+        len += n;
+        buf[len] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) {
+        if (len < N - 1) {
+            buf[len++] = c;
+            buf[len] = '\0';
+        } else {
+            clipped = true;
+        }
+        return *this;
+    }
+
+    FixedString& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf + len, N - len, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+            buf[len] = '\0';
+            clipped = true;
+        } else if ((size_t)n >= N - len) {
+            len = N - 1;
+            clipped = true;
+        } else {
+            len += n;
+        }
+        return *this;
+    }
+
+    FixedString& assign(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    const char* c_str() const { return buf; }
+    size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    bool truncated() const { return clipped; }
+    static constexpr size_t capacity() { return N - 1; }
+
+    bool operator==(const char* s) const { return strcmp(buf, s) == 0; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+};
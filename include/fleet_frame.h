@@ -0,0 +1,274 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "sensor_sample.h"
+#include "sample_json.h"
+#include "hmac_sha256.h"
+
+// -----------------------------------
+// Fleet Frame
+// Fixed-layout little-endian UDP payloads exchanged between units
+// (fleet_sync.h). Every frame starts with a 10-byte header:
+//   'H' 'S' version type | device id (4) | flags | priority
+// ANNOUNCE adds uptime (s) and the firmware version (8 chars, NUL
+// padded). SAMPLE adds one fused reading in the LowPowerSample encoding
+// (fixed-point, all-ones = NAN) plus the day summary. ACK lists the
+// (device id, seq) pairs of a batch the server accepted.
+// Every frame ends in the first TAG_LEN bytes of HMAC-SHA256 over the
+// rest under the group key: ANNOUNCE 30 bytes, SAMPLE 46 (against ~300
+// for the same record as JSON), ACK 19 + 8 per device.
+// -----------------------------------
+namespace FleetFrame {
+
+constexpr uint8_t VERSION = 2;
+
+enum Type : uint8_t { ANNOUNCE = 1, SAMPLE = 2, ACK = 3 };
+
+enum Flag : uint8_t {
+    CAN_AGGREGATE = 1 << 0,   // online and uploading: may batch for the group
+    URGENT = 1 << 1,          // AQI category changed: upload without waiting
+    DAY_VALID = 1 << 2,       // SAMPLE carries the day summary
+};
+
+constexpr size_t HEADER_LEN = 10;
+constexpr size_t TAG_LEN = 8;
+constexpr size_t ANNOUNCE_LEN = HEADER_LEN + 4 + 8 + TAG_LEN;
+constexpr size_t SAMPLE_LEN = HEADER_LEN + 4 + 6 + 6 + 2 + 1 + 1 + 8 + TAG_LEN;
+constexpr uint8_t ACK_MAX_ENTRIES = 16;
+constexpr size_t ACK_ENTRY_LEN = 8;
+constexpr size_t ACK_MAX_LEN = HEADER_LEN + 1 + ACK_MAX_ENTRIES * ACK_ENTRY_LEN + TAG_LEN;
+constexpr size_t MAX_LEN = ACK_MAX_LEN;
+
+struct Header {
+    Type type;
+    uint32_t id;        // unit id (MAC bytes 2-5)
+    uint8_t flags;
+    uint8_t priority;   // election priority (FleetSync::Role)
+};
+
+struct Announce {
+    uint32_t uptimeS;
+    char version[9];
+};
+
+// Samples that reached the server in one of the aggregator's batches
+struct Ack {
+    uint8_t count;
+    uint32_t id[ACK_MAX_ENTRIES];
+    uint32_t seq[ACK_MAX_ENTRIES];
+};
+
+// One reading as it goes on the wire (0.1 C, 0.1 %RH, whole ppb)
+struct Sample {
+    uint32_t seq;
+    uint16_t pm1, pm25, pm10;
+    float tvoc, temp, hum;
+    uint16_t aqi;
+    uint8_t battery;
+    Quality quality[SENSOR_COUNT];
+    SampleJson::DayStats day;
+};
+
+inline Sample fromFused(const FusedSample& s, const SampleJson::DayStats& day) {
+    Sample f;
+    f.seq = s.seq;
+    f.pm1 = s.pm.pm1_0;
+    f.pm25 = s.pm.pm2_5;
+    f.pm10 = s.pm.pm10;
+    f.tvoc = s.tvoc;
+    f.temp = s.temp;
+    f.hum = s.hum;
+    f.aqi = s.aqi < 0 ? 0 : s.aqi;
+    f.battery = s.battery < 0 ? 0 : s.battery > 255 ? 255 : s.battery;
+    memcpy(f.quality, s.quality, sizeof(f.quality));
+    f.day = day;
+    return f;
+}
+
+// Upload record for a sample received age ms ago
+inline SampleJson::Fields toFields(const Sample& f, const char* ageKey, long age) {
+    SampleJson::Fields out{f.pm1, f.pm25, f.pm10, f.tvoc, f.temp, f.hum, f.aqi, f.battery, ageKey, age};
+    out.day = f.day;
+    memcpy(out.quality, f.quality, sizeof(out.quality));
+    return out;
+}
+
+// -------- Encoding --------
+namespace detail {
+
+inline void put16(uint8_t*& p, uint16_t v) {
+    *p++ = (uint8_t)v;
+    *p++ = (uint8_t)(v >> 8);
+}
+
+inline void put32(uint8_t*& p, uint32_t v) {
+    put16(p, (uint16_t)v);
+    put16(p, (uint16_t)(v >> 16));
+}
+
+inline uint16_t get16(const uint8_t*& p) {
+    uint16_t v = p[0] | (uint16_t)p[1] << 8;
+    p += 2;
+    return v;
+}
+
+inline uint32_t get32(const uint8_t*& p) {
+    uint32_t lo = get16(p);
+    return lo | (uint32_t)get16(p) << 16;
+}
+
+// Fixed point with all-ones (or INT16_MIN) for NAN, clamped to the field
+inline uint16_t fixedU(float v, float scale) {
+    if (isnan(v)) return 0xFFFF;
+    float x = roundf(v * scale);
+    return x <= 0 ? 0 : x >= 0xFFFE ? 0xFFFE : (uint16_t)x;
+}
+
+inline int16_t fixedS(float v, float scale) {
+    if (isnan(v)) return INT16_MIN;
+    float x = roundf(v * scale);
+    return x <= -INT16_MAX ? -INT16_MAX : x >= INT16_MAX ? INT16_MAX : (int16_t)x;
+}
+
+inline float floatU(uint16_t v, float scale) { return v == 0xFFFF ? NAN : v / scale; }
+inline float floatS(int16_t v, float scale) { return v == INT16_MIN ? NAN : v / scale; }
+
+inline uint8_t* header(uint8_t* p, Type type, const Header& h) {
+    *p++ = 'H';
+    *p++ = 'S';
+    *p++ = VERSION;
+    *p++ = type;
+    put32(p, h.id);
+    *p++ = h.flags;
+    *p++ = h.priority;
+    return p;
+}
+
+// Append the tag to the body ending at p; the frame length
+inline size_t seal(uint8_t* out, uint8_t* p, const HmacSha256& key) {
+    key.tag(out, p - out, p, TAG_LEN);
+    return p - out + TAG_LEN;
+}
+
+} // namespace detail
+
+// Bytes written (ANNOUNCE_LEN), 0 if cap is too small
+inline size_t writeAnnounce(uint8_t* out, size_t cap, const Header& h, const Announce& a, const HmacSha256& key) {
+    if (cap < ANNOUNCE_LEN) return 0;
+    uint8_t* p = detail::header(out, ANNOUNCE, h);
+    detail::put32(p, a.uptimeS);
+    memset(p, 0, 8);
+    memcpy(p, a.version, strnlen(a.version, 8));
+    return detail::seal(out, p + 8, key);
+}
+
+// Bytes written (SAMPLE_LEN), 0 if cap is too small
+inline size_t writeSample(uint8_t* out, size_t cap, Header h, const Sample& s, const HmacSha256& key) {
+    using namespace detail;
+    if (cap < SAMPLE_LEN) return 0;
+    if (s.day.valid) h.flags |= DAY_VALID;
+    uint8_t* p = header(out, SAMPLE, h);
+    put32(p, s.seq);
+    put16(p, s.pm1);
+    put16(p, s.pm25);
+    put16(p, s.pm10);
+    put16(p, fixedU(s.tvoc, 1));
+    put16(p, (uint16_t)fixedS(s.temp, 10));
+    put16(p, fixedU(s.hum, 10));
+    put16(p, s.aqi);
+    *p++ = s.battery;
+    *p++ = s.quality[SENSOR_PM] | s.quality[SENSOR_TVOC] << 2 | s.quality[SENSOR_CLIMATE] << 4;
+    put16(p, fixedU(s.day.pm25Mean, 10));
+    put16(p, fixedU(s.day.pm25P95, 10));
+    put16(p, s.day.pm25OverMin < 0 ? 0 : s.day.pm25OverMin > 0xFFFF ? 0xFFFF : s.day.pm25OverMin);
+    put16(p, s.day.aqiMax < 0 ? 0 : s.day.aqiMax);
+    return seal(out, p, key);
+}
+
+// Bytes written, 0 if cap is too small or there are too many entries
+inline size_t writeAck(uint8_t* out, size_t cap, const Header& h, const Ack& a, const HmacSha256& key) {
+    using namespace detail;
+    if (a.count > ACK_MAX_ENTRIES || cap < HEADER_LEN + 1 + a.count * ACK_ENTRY_LEN + TAG_LEN) return 0;
+    uint8_t* p = header(out, ACK, h);
+    *p++ = a.count;
+    for (uint8_t i = 0; i < a.count; i++) {
+        put32(p, a.id[i]);
+        put32(p, a.seq[i]);
+    }
+    return seal(out, p, key);
+}
+
+// -------- Decoding --------
+// false: not a fleet frame of this version, or truncated. Says nothing
+// about the sender: check authentic() before trusting any field.
+inline bool readHeader(const uint8_t* in, size_t len, Header& h) {
+    if (len < HEADER_LEN || in[0] != 'H' || in[1] != 'S' || in[2] != VERSION) return false;
+    h.type = (Type)in[3];
+    const uint8_t* p = in + 4;
+    h.id = detail::get32(p);
+    h.flags = in[8];
+    h.priority = in[9];
+    switch (h.type) {
+        case ANNOUNCE: return len >= ANNOUNCE_LEN;
+        case SAMPLE:   return len >= SAMPLE_LEN;
+        case ACK:      return len > HEADER_LEN && in[HEADER_LEN] <= ACK_MAX_ENTRIES &&
+                              len >= HEADER_LEN + 1 + in[HEADER_LEN] * ACK_ENTRY_LEN + TAG_LEN;
+        default:       return false;
+    }
+}
+
+// Length of a frame readHeader() accepted, tag included
+inline size_t frameLen(const uint8_t* in, const Header& h) {
+    switch (h.type) {
+        case ANNOUNCE: return ANNOUNCE_LEN;
+        case SAMPLE:   return SAMPLE_LEN;
+        default:       return HEADER_LEN + 1 + in[HEADER_LEN] * ACK_ENTRY_LEN + TAG_LEN;
+    }
+}
+
+// Tag matches the group key (readHeader() first)
+inline bool authentic(const uint8_t* in, const Header& h, const HmacSha256& key) {
+    size_t body = frameLen(in, h) - TAG_LEN;
+    return key.check(in, body, in + body, TAG_LEN);
+}
+
+inline void readAnnounce(const uint8_t* in, Announce& a) {
+    const uint8_t* p = in + HEADER_LEN;
+    a.uptimeS = detail::get32(p);
+    memcpy(a.version, p, 8);
+    a.version[8] = '\0';
+}
+
+inline void readSample(const uint8_t* in, Sample& s) {
+    using namespace detail;
+    const uint8_t* p = in + HEADER_LEN;
+    s.seq = get32(p);
+    s.pm1 = get16(p);
+    s.pm25 = get16(p);
+    s.pm10 = get16(p);
+    s.tvoc = floatU(get16(p), 1);
+    s.temp = floatS((int16_t)get16(p), 10);
+    s.hum = floatU(get16(p), 10);
+    s.aqi = get16(p);
+    s.battery = *p++;
+    uint8_t q = *p++;
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) s.quality[i] = (Quality)(q >> (2 * i) & 3);
+    s.day.valid = in[8] & DAY_VALID;
+    s.day.pm25Mean = floatU(get16(p), 10);
+    s.day.pm25P95 = floatU(get16(p), 10);
+    s.day.pm25OverMin = get16(p);
+    s.day.aqiMax = get16(p);
+}
+
+inline void readAck(const uint8_t* in, Ack& a) {
+    using namespace detail;
+    const uint8_t* p = in + HEADER_LEN;
+    a.count = *p++;
+    for (uint8_t i = 0; i < a.count; i++) {
+        a.id[i] = get32(p);
+        a.seq[i] = get32(p);
+    }
+}
+
+} // namespace FleetFrame
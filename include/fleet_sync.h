@@ -0,0 +1,561 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <freertos/FreeRTOS.h>
+#include "config.h"
+#include "async_log.h"
+#include "fleet_frame.h"
+#include "sample_json.h"
+#include "sample_cbor.h"
+#include "batch_body.h"
+
+// -----------------------------------
+// Fleet Sync
+// Optional LAN group of units (config.json "fleet"). Every unit
+// multicasts each fused sample as a 46-byte frame (fleet_frame.h) and an
+// announce frame when it has been quiet for FLEET_ANNOUNCE_MS. Frames
+// carry an HMAC under the group key; frames without a valid tag are
+// counted and dropped before any field is used. Every unit
+// keeps the same latest-value table of the group and elects the same
+// aggregator from it: the highest role priority, then the lowest id,
+// among units that are online, have a batch route to post to and whose
+// uploads succeed. Without an endpoint a unit only ever sends its own
+// samples, so a group with no batch route behaves as if fleet were off.
+//
+// On each upload tick the aggregator sends one batch (every sample that
+// arrived since the last batch) over one TLS connection. Members skip
+// their own upload while an aggregator is alive. Members go back to
+// uploading on their own when the aggregator falls silent for
+// FLEET_PEER_TIMEOUT_MS or stops advertising CAN_AGGREGATE after
+// FLEET_BATCH_FAIL_LIMIT failed batches.
+//
+// Members do not take the aggregator's word for it: after each accepted
+// batch it multicasts an ACK of the (unit, seq) pairs in it, and a member
+// whose own samples stay unacknowledged for ackTimeoutMs uploads them
+// directly. A replayed or stuck aggregator can delay a member's data by
+// that long, never drop it.
+//
+// No HTTP in here: WebServerModule asks claimUpload() what to send and
+// posts writeBatch() bodies, so the host test drives the same code.
+// -----------------------------------
+class FleetSync {
+public:
+    // Also the election priority: an explicit aggregator beats "auto"
+    enum Role : uint8_t { ROLE_MEMBER, ROLE_AUTO, ROLE_AGGREGATOR };
+
+    enum UploadMode : uint8_t {
+        UPLOAD_SINGLE,      // fleet off, alone, or no aggregator: own record
+        UPLOAD_BATCH,       // this unit aggregates: writeBatch()
+        UPLOAD_DELEGATED,   // another unit uploads this one's samples
+    };
+
+    struct Settings {
+        bool enabled = false;
+        Role role = ROLE_AUTO;
+        uint16_t port = FLEET_PORT;
+        char endpoint[128] = FLEET_ENDPOINT;
+        char key[65] = FLEET_KEY;
+        // WebServerModule scales this to its upload interval
+        uint32_t ackTimeoutMs = FLEET_ACK_TIMEOUT_UPLOADS * 30000UL + FLEET_POLL_MS;
+    };
+
+    static constexpr size_t BATCH_MAX_LEN = BatchBody::maxLen(FLEET_MAX_DEVICES);
+
+    struct Device {
+        uint32_t id;
+        uint32_t seenMs;        // last frame of any type
+        uint32_t sampleMs;      // last SAMPLE frame
+        uint32_t frames;
+        uint32_t lost;          // gaps in the sample sequence
+        uint32_t batchedSeq;    // sample in the batch (or single POST) being uploaded
+        uint8_t flags;
+        uint8_t priority;
+        bool haveSample;
+        bool pending;           // sample not yet in an uploaded batch
+        char version[9];
+        FleetFrame::Sample sample;
+    };
+
+    struct Stats {
+        uint32_t framesSent, framesReceived, badFrames, sendErrors, tableFull;
+        uint32_t unauthenticated;   // well-formed frames with a wrong tag
+        uint32_t acksSent;          // ACK frames after accepted batches
+        uint32_t ackTimeouts;       // own samples uploaded directly: no ACK in time
+        uint32_t batches, batchFailures;
+        uint32_t samplesBatched;    // records in successful batches
+        uint32_t uploadsSaved;      // POSTs those batches replaced, minus the batch itself
+        uint32_t delegated;         // own uploads left to the aggregator
+        uint64_t batchBytes;        // batch bodies sent
+        uint64_t singleBytes;       // the single-record bodies they replaced
+    };
+
+private:
+    static_assert(FLEET_MAX_DEVICES <= 32, "batch mask is 32 bits");
+    static_assert(FLEET_MAX_DEVICES - 1 <= FleetFrame::ACK_MAX_ENTRIES, "one ACK frame per batch");
+
+    WiFiUDP udp;
+    Settings cfg;
+    HmacSha256 hmac;
+    bool running = false;
+    volatile bool online = false;
+    volatile bool rejoin = false;   // went offline: the membership may be gone
+
+    Device table[FLEET_MAX_DEVICES] = {};   // [0]: this unit
+    uint8_t count = 0;
+    uint32_t aggregatorId = 0;      // 0: none
+    uint32_t announceAtMs = 0;
+    uint8_t batchFailRun = 0;
+    bool urgent = false;
+    uint32_t unackedSinceMs = 0;    // oldest own sample no batch has acknowledged
+    uint32_t ackedEnd = 0;          // one past the newest own seq an ACK named
+
+    uint32_t batchMask = 0;         // table slots in the batch being uploaded
+    uint8_t batchCount = 0;
+    size_t batchLen = 0, batchSingleLen = 0;
+
+    Stats st = {};
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    static const char* roleName(Role r) {
+        static const char* names[] = {"member", "auto", "aggregator"};
+        return names[r];
+    }
+
+    uint8_t selfFlags() const {
+        bool can = cfg.role != ROLE_MEMBER && *cfg.endpoint && online &&
+                   batchFailRun < FLEET_BATCH_FAIL_LIMIT;
+        return can ? FleetFrame::CAN_AGGREGATE : 0;
+    }
+
+    FleetFrame::Header header(uint8_t extra = 0) const {
+        return {FleetFrame::ANNOUNCE, table[0].id, (uint8_t)(selfFlags() | extra), (uint8_t)cfg.role};
+    }
+
+    bool send(const uint8_t* frame, size_t len) {
+        bool ok = udp.beginMulticastPacket() && udp.write(frame, len) == len && udp.endPacket();
+        portENTER_CRITICAL(&mux);
+        if (ok) st.framesSent++;
+        else st.sendErrors++;
+        portEXIT_CRITICAL(&mux);
+        return ok;
+    }
+
+    void announce(uint32_t nowMs) {
+        FleetFrame::Announce a = {nowMs / 1000, FIRMWARE_VERSION};
+        uint8_t frame[FleetFrame::ANNOUNCE_LEN];
+        send(frame, FleetFrame::writeAnnounce(frame, sizeof(frame), header(), a, hmac));
+        announceAtMs = nowMs + FLEET_ANNOUNCE_MS;
+    }
+
+    bool join() {
+        udp.stop();
+        if (!udp.beginMulticast(IPAddress(FLEET_GROUP), cfg.port)) {
+            LOG_E("❌ Fleet: joining the multicast group failed");
+            return false;
+        }
+        return true;
+    }
+
+    // Slot of a unit, added if new; -1 when the table is full. Caller
+    // holds mux.
+    int slot(uint32_t id, uint32_t nowMs) {
+        for (uint8_t i = 1; i < count; i++) {
+            if (table[i].id == id) return i;
+        }
+        if (count == FLEET_MAX_DEVICES) {
+            st.tableFull++;
+            return -1;
+        }
+        Device& d = table[count];
+        d = Device();
+        d.id = id;
+        d.seenMs = nowMs;
+        return count++;
+    }
+
+    void receive(const uint8_t* frame, size_t len, uint32_t nowMs) {
+        FleetFrame::Header h;
+        if (!FleetFrame::readHeader(frame, len, h)) {
+            portENTER_CRITICAL(&mux);
+            st.badFrames++;
+            portEXIT_CRITICAL(&mux);
+            return;
+        }
+        if (!FleetFrame::authentic(frame, h, hmac)) {
+            portENTER_CRITICAL(&mux);
+            st.unauthenticated++;
+            portEXIT_CRITICAL(&mux);
+            return;
+        }
+        if (h.id == table[0].id) return;   // our own frame, looped back
+
+        FleetFrame::Sample s;
+        FleetFrame::Announce a;
+        FleetFrame::Ack ack;
+        if (h.type == FleetFrame::SAMPLE) FleetFrame::readSample(frame, s);
+        else if (h.type == FleetFrame::ANNOUNCE) FleetFrame::readAnnounce(frame, a);
+        else FleetFrame::readAck(frame, ack);
+
+        portENTER_CRITICAL(&mux);
+        st.framesReceived++;
+        if (h.type == FleetFrame::ACK) acknowledged(ack, nowMs);
+        uint8_t before = count;
+        int i = slot(h.id, nowMs);
+        if (i >= 0) {
+            Device& d = table[i];
+            d.seenMs = nowMs;
+            d.flags = h.flags;
+            d.priority = h.priority;
+            d.frames++;
+            if (h.type == FleetFrame::SAMPLE) {
+                if (d.haveSample && s.seq > d.sample.seq + 1) d.lost += s.seq - d.sample.seq - 1;
+                d.sample = s;
+                d.sampleMs = nowMs;
+                d.haveSample = true;
+                d.pending = true;
+                if (h.flags & FleetFrame::URGENT) urgent = true;
+            } else if (h.type == FleetFrame::ANNOUNCE) {
+                memcpy(d.version, a.version, sizeof(d.version));
+            }
+        }
+        portEXIT_CRITICAL(&mux);
+
+        if (count > before) {
+            LOG_I("🛰 Fleet: unit %08lx joined (%u units)", (unsigned long)h.id, count);
+        }
+    }
+
+    // An aggregator's batch reached the server: this unit's sample is
+    // uploaded once its latest seq is in it. A newer seq than any before
+    // restarts the wait for the rest; a replayed ACK does not. Caller
+    // holds mux.
+    void acknowledged(const FleetFrame::Ack& ack, uint32_t nowMs) {
+        Device& self = table[0];
+        for (uint8_t i = 0; i < ack.count; i++) {
+            if (ack.id[i] != self.id || !self.pending || ack.seq[i] < ackedEnd) continue;
+            ackedEnd = ack.seq[i] + 1;
+            if (ack.seq[i] == self.sample.seq) self.pending = false;
+            else unackedSinceMs = nowMs;
+        }
+    }
+
+    void sendAck(const FleetFrame::Ack& ack) {
+        if (!ack.count) return;
+        uint8_t frame[FleetFrame::ACK_MAX_LEN];
+        if (send(frame, FleetFrame::writeAck(frame, sizeof(frame), header(), ack, hmac))) {
+            portENTER_CRITICAL(&mux);
+            st.acksSent++;
+            portEXIT_CRITICAL(&mux);
+        }
+    }
+
+    void expire(uint32_t nowMs) {
+        for (uint8_t i = 1; i < count;) {
+            if (nowMs - table[i].seenMs <= FLEET_PEER_TIMEOUT_MS) {
+                i++;
+                continue;
+            }
+            uint32_t id = table[i].id;
+            portENTER_CRITICAL(&mux);
+            table[i] = table[--count];
+            batchMask &= ~(1UL << i);
+            portEXIT_CRITICAL(&mux);
+            LOG_W("🛰 Fleet: unit %08lx silent for %lus - dropped", (unsigned long)id,
+                  (unsigned long)(FLEET_PEER_TIMEOUT_MS / 1000));
+        }
+    }
+
+    // Highest priority, then lowest id, among units that can aggregate
+    void elect() {
+        uint32_t best = 0;
+        uint8_t bestPrio = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            const Device& d = table[i];
+            uint8_t flags = i ? d.flags : selfFlags();
+            uint8_t prio = i ? d.priority : (uint8_t)cfg.role;
+            if (!(flags & FleetFrame::CAN_AGGREGATE) || prio == ROLE_MEMBER) continue;
+            if (!best || prio > bestPrio || (prio == bestPrio && d.id < best)) {
+                best = d.id;
+                bestPrio = prio;
+            }
+        }
+        if (best == aggregatorId) return;
+        aggregatorId = best;
+        if (!best) LOG_W("🛰 Fleet: no aggregator - uploading individually");
+        else LOG_I("🛰 Fleet: aggregator %08lx%s", (unsigned long)best,
+                   best == table[0].id ? " (this unit)" : "");
+    }
+
+public:
+    // id: unique per unit and non-zero (MAC bytes 2-5 on the device)
+    bool begin(uint32_t id, const Settings& settings) {
+        cfg = settings;
+        if (!*cfg.key) {
+            LOG_E("❌ Fleet: no group key (config.json \"fleet\": {\"key\": ...}) - fleet off");
+            return false;
+        }
+        hmac.setKey((const uint8_t*)cfg.key, strlen(cfg.key));
+        for (Device& d : table) d = Device();
+        table[0].id = id;
+        table[0].priority = cfg.role;
+        snprintf(table[0].version, sizeof(table[0].version), "%s", FIRMWARE_VERSION);
+        count = 1;
+        aggregatorId = 0;
+        ackedEnd = 0;
+        running = join();
+        if (!running) return false;
+        announce(millis());
+        elect();
+        LOG_I("🛰 Fleet: unit %08lx (%s) on port %u", (unsigned long)id, roleName(cfg.role), cfg.port);
+        if (cfg.role != ROLE_MEMBER && !*cfg.endpoint) {
+            LOG_W("🛰 Fleet: no batch endpoint - this unit will not aggregate");
+        }
+        return true;
+    }
+
+    void stop() {
+        udp.stop();
+        running = false;
+    }
+
+    bool active() const { return running; }
+    uint32_t id() const { return table[0].id; }
+    uint32_t aggregator() const { return aggregatorId; }
+    bool isAggregator() const { return running && aggregatorId == table[0].id; }
+    const Settings& settings() const { return cfg; }
+
+    // ConnectivityManager state: only an online unit can aggregate
+    void setOnline(bool isOnline) {
+        if (online && !isOnline) rejoin = true;
+        online = isOnline;
+        announceAtMs = millis();   // tell the group on the next poll()
+    }
+
+    // Network task, every FLEET_POLL_MS: receive, expire, elect, announce
+    void poll() {
+        if (!running) return;
+        uint32_t now = millis();
+        if (online && rejoin) {   // re-join after a reconnect
+            rejoin = false;
+            if (!join()) return;
+        }
+
+        uint8_t frame[FleetFrame::MAX_LEN];
+        for (uint8_t n = 0; n < 4 * FLEET_MAX_DEVICES && udp.parsePacket() > 0; n++) {
+            int len = udp.read(frame, sizeof(frame));
+            if (len > 0) receive(frame, len, now);
+        }
+        expire(now);
+        elect();
+        if ((int32_t)(now - announceAtMs) >= 0) announce(now);
+    }
+
+    // Every fused sample; doubles as the presence announcement
+    void publish(const FusedSample& s, const SampleJson::DayStats& day, bool isUrgent) {
+        if (!running) return;
+        uint32_t now = millis();
+        FleetFrame::Sample f = FleetFrame::fromFused(s, day);
+
+        portENTER_CRITICAL(&mux);
+        Device& self = table[0];
+        self.seenMs = self.sampleMs = now;
+        self.sample = f;
+        if (!self.pending) unackedSinceMs = now;
+        self.haveSample = self.pending = true;
+        self.frames++;
+        portEXIT_CRITICAL(&mux);
+
+        uint8_t frame[FleetFrame::SAMPLE_LEN];
+        FleetFrame::Header h = header(isUrgent ? FleetFrame::URGENT : 0);
+        if (send(frame, FleetFrame::writeSample(frame, sizeof(frame), h, f, hmac))) {
+            announceAtMs = now + FLEET_ANNOUNCE_MS;
+        }
+    }
+
+    // A member asked for an upload now (AQI category change)
+    bool takeUrgent() {
+        portENTER_CRITICAL(&mux);
+        bool u = urgent;
+        urgent = false;
+        portEXIT_CRITICAL(&mux);
+        return u;
+    }
+
+    // At each upload tick: what this unit should send. Report the POST
+    // with uploadDone().
+    UploadMode claimUpload() {
+        if (running && aggregatorId && aggregatorId == table[0].id && count > 1) return UPLOAD_BATCH;
+
+        uint32_t now = millis();
+        portENTER_CRITICAL(&mux);
+        Device& self = table[0];
+        bool delegate = running && aggregatorId && aggregatorId != self.id;
+        bool overdue = delegate && self.pending && now - unackedSinceMs > cfg.ackTimeoutMs;
+        if (delegate && !overdue) st.delegated++;
+        if (overdue) st.ackTimeouts++;
+        self.batchedSeq = self.sample.seq;
+        portEXIT_CRITICAL(&mux);
+
+        if (overdue) {
+            LOG_W("🛰 Fleet: no ACK from %08lx for %lus - uploading directly", (unsigned long)aggregatorId,
+                  (unsigned long)((now - unackedSinceMs) / 1000));
+        }
+        return delegate && !overdue ? UPLOAD_DELEGATED : UPLOAD_SINGLE;
+    }
+
+    // Batch body with every sample not yet uploaded. Bytes written, 0 if
+    // nothing is pending or it did not fit. Report the POST with
+    // uploadDone().
+    size_t writeBatch(uint8_t* out, size_t cap, bool cbor) {
+        uint32_t now = millis();
+        uint8_t scratch[SampleJson::MAX_LEN];
+        size_t single = 0;
+
+        batchMask = 0;
+        batchCount = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (table[i].pending) {
+                batchMask |= 1UL << i;
+                batchCount++;
+            }
+        }
+        if (!batchCount) return 0;
+
+        BatchBody body(out, cap, cbor, table[0].id, batchCount);
+        for (uint8_t i = 0; i < count; i++) {
+            if (!(batchMask & 1UL << i)) continue;
+            Device& d = table[i];
+            d.batchedSeq = d.sample.seq;
+            SampleJson::Fields f = FleetFrame::toFields(d.sample, "age_ms", (long)(now - d.sampleMs));
+            SampleJson::Fields alone = FleetFrame::toFields(d.sample, nullptr, 0);
+            if (!body.add(d.id, f)) break;
+            single += cbor ? SampleCbor::write(scratch, sizeof(scratch), alone)
+                           : SampleJson::write((char*)scratch, sizeof(scratch), alone);
+        }
+        size_t len = body.finish();
+
+        if (!len) {
+            LOG_E("❌ Fleet batch too long - not sent");
+            batchMask = 0;
+            return 0;
+        }
+        batchLen = len;
+        batchSingleLen = single;
+        return len;
+    }
+
+    // Result of this unit's last POST (single or batch). An accepted batch
+    // is acknowledged to the units in it.
+    void uploadDone(bool ok) {
+        bool wasBatch = batchMask;
+        uint8_t failRun = batchFailRun;
+        FleetFrame::Ack ack;
+        ack.count = 0;
+        portENTER_CRITICAL(&mux);
+        if (ok) {
+            batchFailRun = 0;
+            if (!wasBatch && table[0].sample.seq == table[0].batchedSeq) table[0].pending = false;
+            if (wasBatch) {
+                st.batches++;
+                st.samplesBatched += batchCount;
+                st.uploadsSaved += batchCount - 1;
+                st.batchBytes += batchLen;
+                st.singleBytes += batchSingleLen;
+                for (uint8_t i = 0; i < count; i++) {
+                    Device& d = table[i];
+                    if (!(batchMask & 1UL << i)) continue;
+                    if (d.sample.seq == d.batchedSeq) d.pending = false;
+                    if (i) {
+                        ack.id[ack.count] = d.id;
+                        ack.seq[ack.count++] = d.batchedSeq;
+                    }
+                }
+            }
+        } else if (wasBatch) {
+            st.batchFailures++;
+            if (batchFailRun < UINT8_MAX) batchFailRun++;
+        }
+        batchMask = 0;
+        portEXIT_CRITICAL(&mux);
+        sendAck(ack);
+
+        // Stop advertising CAN_AGGREGATE at once so members take over
+        if (failRun < FLEET_BATCH_FAIL_LIMIT && batchFailRun >= FLEET_BATCH_FAIL_LIMIT) {
+            LOG_W("🛰 Fleet: %u batches failed - handing aggregation over", batchFailRun);
+            announce(millis());
+            elect();
+        } else if (failRun >= FLEET_BATCH_FAIL_LIMIT && !batchFailRun) {
+            announceAtMs = millis();
+        }
+    }
+
+    Stats stats() const {
+        portENTER_CRITICAL(&mux);
+        Stats s = st;
+        portEXIT_CRITICAL(&mux);
+        return s;
+    }
+
+    uint8_t units() const { return count; }
+
+    // Copy of table slot i (0: this unit); false past the last unit
+    bool unit(uint8_t i, Device& out) const {
+        portENTER_CRITICAL(&mux);
+        bool have = i < count;
+        if (have) out = table[i];
+        portEXIT_CRITICAL(&mux);
+        return have;
+    }
+
+    void printStats() const {
+        if (!running) return;
+        Stats s = stats();
+        Serial.printf("🛰 Fleet %08lx | %u units, aggregator %08lx | frames %lu out, %lu in, %lu bad, %lu unauthenticated | %lu batches (%lu failed): %lu samples, %lu POSTs saved, %lu B vs %lu B single | %lu delegated, %lu ACK timeouts\n",
+                      (unsigned long)table[0].id, count, (unsigned long)aggregatorId,
+                      (unsigned long)s.framesSent, (unsigned long)s.framesReceived,
+                      (unsigned long)s.badFrames, (unsigned long)s.unauthenticated,
+                      (unsigned long)s.batches, (unsigned long)s.batchFailures,
+                      (unsigned long)s.samplesBatched, (unsigned long)s.uploadsSaved,
+                      (unsigned long)s.batchBytes, (unsigned long)s.singleBytes,
+                      (unsigned long)s.delegated, (unsigned long)s.ackTimeouts);
+    }
+
+    // /api/fleet: the group table with each unit's latest sample
+    void writeJson(Print& out) const {
+        if (!running) {
+            out.print("{\"enabled\":false}");
+            return;
+        }
+        uint32_t now = millis();
+        Stats s = stats();
+        out.printf("{\"enabled\":true,\"self\":\"%08lx\",\"role\":\"%s\",\"aggregator\":",
+                   (unsigned long)table[0].id, roleName(cfg.role));
+        if (aggregatorId) out.printf("\"%08lx\"", (unsigned long)aggregatorId);
+        else out.print("null");
+        out.print(",\"devices\":[");
+
+        char body[SampleJson::MAX_LEN];
+        Device d;
+        for (uint8_t i = 0; unit(i, d); i++) {
+            out.printf("%s{\"id\":\"%08lx\",\"version\":\"%s\",\"seen_ms\":%lu,\"can_aggregate\":%s,\"frames\":%lu,\"lost\":%lu,\"sample\":",
+                       i ? "," : "", (unsigned long)d.id, d.version, (unsigned long)(now - d.seenMs),
+                       ((i ? d.flags : selfFlags()) & FleetFrame::CAN_AGGREGATE) ? "true" : "false",
+                       (unsigned long)d.frames, (unsigned long)d.lost);
+            SampleJson::Fields f = FleetFrame::toFields(d.sample, "age_ms", (long)(now - d.sampleMs));
+            if (d.haveSample && SampleJson::write(body, sizeof(body), f)) out.print(body);
+            else out.print("null");
+            out.print("}");
+        }
+        out.printf("],\"stats\":{\"frames_sent\":%lu,\"frames_received\":%lu,\"bad_frames\":%lu,\"unauthenticated\":%lu,\"table_full\":%lu,",
+                   (unsigned long)s.framesSent, (unsigned long)s.framesReceived,
+                   (unsigned long)s.badFrames, (unsigned long)s.unauthenticated,
+                   (unsigned long)s.tableFull);
+        out.printf("\"acks_sent\":%lu,\"ack_timeouts\":%lu,", (unsigned long)s.acksSent,
+                   (unsigned long)s.ackTimeouts);
+        out.printf("\"batches\":%lu,\"batch_failures\":%lu,\"samples_batched\":%lu,\"uploads_saved\":%lu,\"delegated\":%lu,\"batch_bytes\":%llu,\"single_bytes\":%llu}}",
+                   (unsigned long)s.batches, (unsigned long)s.batchFailures,
+                   (unsigned long)s.samplesBatched, (unsigned long)s.uploadsSaved,
+                   (unsigned long)s.delegated, (unsigned long long)s.batchBytes,
+                   (unsigned long long)s.singleBytes);
+    }
+};
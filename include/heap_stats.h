@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <esp_heap_caps.h>
+
+// -----------------------------------
+// Heap Stats
+// Free heap, its all-time low-water mark (from the allocator) and the
+// largest free block, sampled by the network task. A shrinking largest
+// block with steady free space is fragmentation - what eventually makes
+// the ~40 KB TLS handshake allocation fail after days of uptime.
+// -----------------------------------
+class HeapStats {
+private:
+    struct State {
+        uint32_t free = 0;
+        uint32_t largest = 0;
+        uint32_t minLargest = UINT32_MAX;
+        uint32_t samples = 0;
+    };
+
+    static State& s() {
+        static State st;
+        return st;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    static State snapshot() {
+        portENTER_CRITICAL(&mux());
+        State st = s();
+        portEXIT_CRITICAL(&mux());
+        return st;
+    }
+
+    // 0 = one contiguous free region, 100 = all free space in tiny pieces
+    static uint32_t fragmentationPct(const State& st) {
+        return st.free ? 100 - (uint64_t)st.largest * 100 / st.free : 0;
+    }
+
+public:
+    static void sample() {
+        uint32_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        uint32_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        State& st = s();
+        portENTER_CRITICAL(&mux());
+        st.free = free;
+        st.largest = largest;
+        if (largest < st.minLargest) st.minLargest = largest;
+        st.samples++;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void printStats() {
+        State st = snapshot();
+        if (!st.samples) return;
+        Serial.printf("🧠 Heap: free %lu B (low %lu B) | largest block %lu B (low %lu B) | frag %lu%%\n",
+                      (unsigned long)st.free,
+                      (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                      (unsigned long)st.largest, (unsigned long)st.minLargest,
+                      (unsigned long)fragmentationPct(st));
+    }
+
+    static void writeJson(Print& out) {
+        State st = snapshot();
+        out.printf("{\"free\":%lu,\"min_free\":%lu,", (unsigned long)st.free,
+                   (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+        out.printf("\"largest_block\":%lu,\"min_largest_block\":%lu,",
+                   (unsigned long)st.largest,
+                   (unsigned long)(st.samples ? st.minLargest : 0));
+        out.printf("\"fragmentation_pct\":%lu,\"samples\":%lu}",
+                   (unsigned long)fragmentationPct(st), (unsigned long)st.samples);
+    }
+};
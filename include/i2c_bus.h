@@ -0,0 +1,210 @@
+#pragma once
+#include <Arduino.h>
+#include <Wire.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+
+// -----------------------------------
+// I2C Buses
+// The OLED (400 kHz) and the AGS02MA (25 kHz, clock-stretching) sit on
+// different pins, so each gets its own controller: OLED on Wire (I2C0),
+// AGS02MA on Wire1 (I2C1). Neither reconfigures the other's clock, and a
+// slow TVOC read runs alongside a display flush instead of ahead of it.
+//
+// Each bus has one owning task that issues its transactions in order
+// (OLEDRender for OLED, AcqI2C for SENSOR). A Transaction holds the bus
+// for one access sequence; it waits at most its timeout for the bus, and
+// the controller itself gives up on a stuck slave after I2C_WIRE_TIMEOUT_MS.
+// recover() clears a bus held low by a stuck slave and restarts the
+// controller. Transactions, errors, lock timeouts, recoveries and
+// wait/hold times are counted per bus, printed hourly and served at
+// /api/i2c.
+// -----------------------------------
+class I2CBus {
+public:
+    enum Id : uint8_t { OLED, SENSOR, BUS_COUNT };
+
+    static const char* name(Id id) {
+        return id == OLED ? "oled" : "sensor";
+    }
+
+    static TwoWire& wire(Id id) {
+        return id == OLED ? Wire : Wire1;
+    }
+
+private:
+    struct Stats {
+        uint32_t transactions;  // completed (outermost) transactions
+        uint32_t errors;        // NACK / controller timeout reported by the driver
+        uint32_t lockTimeouts;  // bus still held by someone else after the timeout
+        uint32_t recoveries;    // bus clears (recover())
+        uint32_t maxWaitUs;     // longest wait for the bus
+        uint32_t maxHoldUs;     // longest transaction
+        uint64_t busyUs;        // total time held
+    };
+
+    struct Bus {
+        SemaphoreHandle_t mutex;
+        uint32_t hz;
+        uint8_t depth;          // nesting on the holding task
+        uint32_t holdStartUs;
+        uint32_t waitUs;
+        bool failed;
+        Stats stats;
+        uint8_t sda, scl;
+    };
+
+    static Bus& bus(Id id) {
+        static Bus b[BUS_COUNT] = {
+            {xSemaphoreCreateRecursiveMutex(), 0, 0, 0, 0, false, {}, 0, 0},
+            {xSemaphoreCreateRecursiveMutex(), 0, 0, 0, 0, false, {}, 0, 0},
+        };
+        return b[id];
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    static Stats snapshot(Id id) {
+        Bus& b = bus(id);
+        portENTER_CRITICAL(&mux());
+        Stats st = b.stats;
+        portEXIT_CRITICAL(&mux());
+        return st;
+    }
+
+public:
+    // Holds the bus for one access sequence; nests on the holding task
+    class Transaction {
+        Id id;
+        bool held;
+
+    public:
+        explicit Transaction(Id bus, uint32_t timeoutMs = I2C_LOCK_TIMEOUT_MS) : id(bus) {
+            Bus& b = I2CBus::bus(id);
+            uint32_t t0 = micros();
+            TickType_t wait = timeoutMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+            held = xSemaphoreTakeRecursive(b.mutex, wait) == pdTRUE;
+            if (!held) {
+                portENTER_CRITICAL(&mux());
+                b.stats.lockTimeouts++;
+                portEXIT_CRITICAL(&mux());
+                return;
+            }
+            if (b.depth++ == 0) {
+                b.holdStartUs = micros();
+                b.waitUs = b.holdStartUs - t0;
+                b.failed = false;
+            }
+        }
+
+        ~Transaction() {
+            if (!held) return;
+            Bus& b = I2CBus::bus(id);
+            if (--b.depth == 0) {
+                uint32_t holdUs = micros() - b.holdStartUs;
+                portENTER_CRITICAL(&mux());
+                b.stats.transactions++;
+                if (b.failed) b.stats.errors++;
+                if (b.waitUs > b.stats.maxWaitUs) b.stats.maxWaitUs = b.waitUs;
+                if (holdUs > b.stats.maxHoldUs) b.stats.maxHoldUs = holdUs;
+                b.stats.busyUs += holdUs;
+                portEXIT_CRITICAL(&mux());
+            }
+            xSemaphoreGiveRecursive(b.mutex);
+        }
+
+        // false: the bus stayed busy for the whole timeout - skip the access
+        bool ok() const { return held; }
+
+        // The device did not answer (counted once per transaction)
+        void fail() {
+            if (held) I2CBus::bus(id).failed = true;
+        }
+
+        TwoWire& wire() const { return I2CBus::wire(id); }
+
+        Transaction(const Transaction&) = delete;
+        Transaction& operator=(const Transaction&) = delete;
+    };
+
+    // Pins and clock are fixed per bus; call once from the bus owner
+    static bool begin(Id id, uint8_t sda, uint8_t scl, uint32_t hz) {
+        Transaction tx(id, UINT32_MAX);
+        TwoWire& w = wire(id);
+        if (!w.begin(sda, scl, hz)) return false;
+        w.setClock(hz);
+        w.setTimeOut(I2C_WIRE_TIMEOUT_MS);
+        Bus& b = bus(id);
+        b.hz = hz;
+        b.sda = sda;
+        b.scl = scl;
+        return true;
+    }
+
+    // Bus clear (I2C spec 3.1.16): a slave reset mid-byte can hold SDA low
+    // for ever. Up to nine SCL pulses let it shift the byte out, a STOP
+    // releases the bus, then the controller restarts with the same pins
+    // and clock. False if SDA is still low or the controller did not
+    // come back.
+    static bool recover(Id id) {
+        Transaction tx(id, UINT32_MAX);
+        Bus& b = bus(id);
+        uint32_t halfUs = b.hz ? 500000 / b.hz + 1 : 20;
+        wire(id).end();
+
+        pinMode(b.sda, INPUT_PULLUP);
+        pinMode(b.scl, OUTPUT_OPEN_DRAIN);
+        digitalWrite(b.scl, HIGH);
+        for (uint8_t i = 0; i < 9 && digitalRead(b.sda) == LOW; i++) {
+            digitalWrite(b.scl, LOW);
+            delayMicroseconds(halfUs);
+            digitalWrite(b.scl, HIGH);
+            delayMicroseconds(halfUs);
+        }
+        // STOP: SDA rises while SCL is high
+        pinMode(b.sda, OUTPUT_OPEN_DRAIN);
+        digitalWrite(b.sda, LOW);
+        delayMicroseconds(halfUs);
+        digitalWrite(b.sda, HIGH);
+        delayMicroseconds(halfUs);
+        pinMode(b.sda, INPUT_PULLUP);
+        bool released = digitalRead(b.sda) == HIGH;
+
+        portENTER_CRITICAL(&mux());
+        b.stats.recoveries++;
+        portEXIT_CRITICAL(&mux());
+        return begin(id, b.sda, b.scl, b.hz) && released;
+    }
+
+    static void printStats() {
+        for (uint8_t i = 0; i < BUS_COUNT; i++) {
+            Stats st = snapshot((Id)i);
+            if (!st.transactions && !st.lockTimeouts) continue;
+            Serial.printf("🔌 I2C %-6s %3lu kHz | %lu tx, %lu err, %lu lock timeouts, %lu recoveries | wait max %lu us | hold max %lu us, busy %lu ms\n",
+                          name((Id)i), (unsigned long)(bus((Id)i).hz / 1000),
+                          (unsigned long)st.transactions, (unsigned long)st.errors,
+                          (unsigned long)st.lockTimeouts, (unsigned long)st.recoveries,
+                          (unsigned long)st.maxWaitUs,
+                          (unsigned long)st.maxHoldUs, (unsigned long)(st.busyUs / 1000));
+        }
+    }
+
+    static void writeJson(Print& out) {
+        out.print("{");
+        for (uint8_t i = 0; i < BUS_COUNT; i++) {
+            Stats st = snapshot((Id)i);
+            out.printf("%s\"%s\":{\"hz\":%lu,\"transactions\":%lu,\"errors\":%lu,\"lock_timeouts\":%lu,",
+                       i ? "," : "", name((Id)i), (unsigned long)bus((Id)i).hz,
+                       (unsigned long)st.transactions, (unsigned long)st.errors,
+                       (unsigned long)st.lockTimeouts);
+            out.printf("\"recoveries\":%lu,\"max_wait_us\":%lu,\"max_hold_us\":%lu,\"busy_ms\":%lu}",
+                       (unsigned long)st.recoveries, (unsigned long)st.maxWaitUs, (unsigned long)st.maxHoldUs,
+                       (unsigned long)(st.busyUs / 1000));
+        }
+        out.print("}");
+    }
+};
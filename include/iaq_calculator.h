@@ -77,16 +77,11 @@ inline int calculateAQI_PM10(float pm10) {
 
 /**
  * Calculate overall AQI from PM2.5 and PM10
- * Includes a calibration factor (0.85) to compensate for consumer sensor bias.
+ * Expects calibrated concentrations (humidity + sensor bias, see pm_calibration.h).
  */
 inline int calculateAQI(float pm25, float pm10) {
-    // Calibration factor: 0.85 compensates for over-reading in high humidity/low air flow 
-    // common in budget PMS sensors.
-    float calibratedPM25 = pm25 * 0.85f;
-    float calibratedPM10 = pm10 * 0.85f;
-
-    int aqi25 = calculateAQI_PM25(calibratedPM25);
-    int aqi10 = calculateAQI_PM10(calibratedPM10);
+    int aqi25 = calculateAQI_PM25(pm25);
+    int aqi10 = calculateAQI_PM10(pm10);
     return max(aqi25, aqi10);
 }
 
@@ -97,14 +92,37 @@ inline int adjustAQIWithTVOC(int baseAQI, float tvocPPB) {
     return max(baseAQI, tvocAQI);
 }
 
+// Upper AQI of each category but the last (Good .. Very Unhealthy)
+constexpr int CATEGORY_BOUNDS[] = {50, 100, 150, 200, 300};
+constexpr int CATEGORY_COUNT = 6;
+
+inline int categoryIndex(int aqi) {
+    int i = 0;
+    while (i < CATEGORY_COUNT - 1 && aqi > CATEGORY_BOUNDS[i]) i++;
+    return i;
+}
+
+inline const char* categoryName(int index) {
+    static const char* names[CATEGORY_COUNT] = {"Good", "Moderate", "Unhealthy for Sensitive",
+                                                "Unhealthy", "Very Unhealthy", "Hazardous"};
+    return index >= 0 && index < CATEGORY_COUNT ? names[index] : "";
+}
+
+// Category index that leaves `current` only once the AQI is `band`
+// points past its edge, so a reading sitting on a breakpoint does not
+// flip it every sample. current < 0: none yet.
+inline int categoryWithHysteresis(int aqi, int current, int band) {
+    int raw = categoryIndex(aqi);
+    if (current < 0 || raw == current) return raw;
+    if (raw > current) {
+        return aqi > CATEGORY_BOUNDS[current] + band ? categoryIndex(aqi - band) : current;
+    }
+    return aqi <= CATEGORY_BOUNDS[current - 1] - band ? categoryIndex(aqi + band) : current;
+}
+
 // Optional: convert AQI to category string
 inline const char* getAQICategory(int aqi) {
-    if (aqi <= 50) return "Good";
-    if (aqi <= 100) return "Moderate";
-    if (aqi <= 150) return "Unhealthy for Sensitive";
-    if (aqi <= 200) return "Unhealthy";
-    if (aqi <= 300) return "Very Unhealthy";
-    return "Hazardous";
+    return categoryName(categoryIndex(aqi));
 }
 
 } // namespace IAQ
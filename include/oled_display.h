@@ -2,9 +2,19 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
 #include "pm_sensor.h"
 #include "config.h"
 #include "iaq_calculator.h"
+#include "power_locks.h"
+#include "oled_frame_diff.h"
+#include "i2c_bus.h"
+#include "trend_history.h"
+#include "profiler.h"
+#include "timer_wheel.h"
 
 class OLEDDisplay {
 public:
@@ -15,59 +25,250 @@ public:
         TEMP_SCREEN,
         HUM_SCREEN,
         TVOC_SCREEN,
-        CYCLE_ALL
+        CYCLE_ALL,
+        PM25_TREND,     // sparkline screens: last hour, or last day after a second tap
+        AQI_TREND,
+        TVOC_TREND,
+        TEMP_TREND
+    };
+
+    // Everything needed to draw one screen. The show*/set* methods update
+    // it; the render task receives a copy through a one-slot mailbox.
+    struct View {
+        enum Kind : uint8_t { SENSORS, SUMMARY, MESSAGE, BOOT, UPDATE };
+
+        Kind kind;
+        ScreenMode mode;
+        bool trendDay;    // trend screens: 24 h instead of 1 h
+        bool wifi;
+        bool power;
+        uint16_t pm25;
+        uint16_t pm10;
+        float temp;
+        float hum;
+        float tvoc;
+        int aqi;
+        int battery;
+        int progress;     // UPDATE: 0-100, -1 = waiting
+        char text[48];    // MESSAGE text, SUMMARY category, BOOT/UPDATE version
     };
 
 private:
     Adafruit_SSD1306 oled;
     uint8_t _sda, _scl, _addr;
-    ScreenMode mode = CYCLE_ALL;
-    uint8_t currentScreen = 0;
-    unsigned long lastSwitch = 0;
     const unsigned long screenInterval = 2000; // 2 sec per screen
 
-public:
-    OLEDDisplay(uint8_t sda = OLED_SDA, uint8_t scl = OLED_SCL, uint8_t addr = OLED_ADDR)
-        : oled(128, 32, &Wire, -1), _sda(sda), _scl(scl), _addr(addr) {}
+    // Caller-side model; viewLock serialises callers on different tasks
+    View view;
+    SemaphoreHandle_t viewLock = nullptr;
 
-    void begin() {
-        Wire.begin(_sda, _scl);
-        Wire.setClock(400000);
+    struct ViewGuard {
+        SemaphoreHandle_t m;
+        explicit ViewGuard(SemaphoreHandle_t mutex) : m(mutex) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+        ~ViewGuard() { if (m) xSemaphoreGive(m); }
+    };
 
-        if (!oled.begin(SSD1306_SWITCHCAPVCC, _addr)) {
-            Serial.println("OLED init failed!");
-            while (true) delay(1000);
+    // Render task + mailbox (nullptr = render inline on the caller)
+    QueueHandle_t mailbox = nullptr;
+    TaskHandle_t renderTask = nullptr;
+
+    // Render-side state
+    ScreenMode renderedMode = CYCLE_ALL;
+    uint8_t currentScreen = 0;
+    bool panelOn = true;
+    int dotPos = 0;
+    View lastView;          // redrawn by the CYCLE_ALL screen timer
+
+    // Render-side timers: CYCLE_ALL screen switch and deferred frames. Run
+    // by the render task (or service() when rendering inline).
+    TimerWheel timers{"oled"};
+    int cycleJob = -1;
+    int frameJob = -1;
+
+    // Sparkline history: recordTrend() runs on the sensor pipeline's
+    // History task, renderTrend() on the render task (or inline on the
+    // caller's task without one). trendLock, created in begin(), covers both.
+    Trend::History trends;
+    SemaphoreHandle_t trendLock = nullptr;
+
+    // Front buffer: last frame sent to the panel. The Adafruit buffer is
+    // the back buffer the renderer draws into.
+    uint8_t shadow[OLEDFrameDiff::BUFFER_SIZE];
+    bool shadowValid = false;
+    bool framePending = false;
+    OLEDFrameDiff::FrameGate frameGate{OLED_MIN_FRAME_MS};
+
+    struct RefreshStats {
+        uint32_t frames;        // flushes that sent data
+        uint32_t identical;     // skipped: nothing changed
+        uint32_t rateLimited;   // deferred by the frame-rate cap
+        uint32_t bytesSent;     // I2C payload actually sent
+        uint32_t bytesFull;     // what full refreshes would have cost
+        uint32_t views;         // views submitted
+        uint32_t coalesced;     // views replaced in the mailbox before rendering
+    } stats = {0, 0, 0, 0, 0, 0, 0};
+
+    // Send only the changed column span of each dirty page (the whole
+    // buffer when that is cheaper). False if the panel did not acknowledge
+    // a data chunk.
+    bool pushDirtyPages() {
+        uint8_t* buf = oled.getBuffer();
+
+        if (!shadowValid || OLEDFrameDiff::preferFull(buf, shadow)) {
+            oled.display();
+            memcpy(shadow, buf, sizeof(shadow));
+            shadowValid = true;
+            stats.frames++;
+            stats.bytesSent += OLEDFrameDiff::fullRefreshBytes();
+            stats.bytesFull += OLEDFrameDiff::fullRefreshBytes();
+            return true;
         }
 
-        oled.clearDisplay();
-        oled.setTextSize(1);
-        oled.setTextColor(SSD1306_WHITE);
+        TwoWire& wire = I2CBus::wire(I2CBus::OLED);
+        bool any = false;
+        bool acked = true;
+        for (uint8_t page = 0; page < OLEDFrameDiff::PAGES; page++) {
+            OLEDFrameDiff::PageRange r = OLEDFrameDiff::diffPage(buf, shadow, page);
+            if (!r.dirty) continue;
+            any = true;
+
+            oled.ssd1306_command(SSD1306_PAGEADDR);
+            oled.ssd1306_command(page);
+            oled.ssd1306_command(page);
+            oled.ssd1306_command(SSD1306_COLUMNADDR);
+            oled.ssd1306_command(r.first);
+            oled.ssd1306_command(r.last);
+
+            const uint8_t* src = buf + page * OLEDFrameDiff::WIDTH + r.first;
+            uint16_t remaining = r.last - r.first + 1;
+            while (remaining) {
+                uint16_t n = min<uint16_t>(remaining, OLEDFrameDiff::I2C_CHUNK);
+                wire.beginTransmission(_addr);
+                wire.write((uint8_t)0x40);  // Co = 0, D/C = 1: data stream
+                wire.write(src, n);
+                if (wire.endTransmission() != 0) acked = false;
+                src += n;
+                remaining -= n;
+            }
+
+            memcpy(shadow + page * OLEDFrameDiff::WIDTH + r.first,
+                   buf + page * OLEDFrameDiff::WIDTH + r.first, r.last - r.first + 1);
+            stats.bytesSent += OLEDFrameDiff::windowBytes(r);
+        }
+
+        if (any) {
+            stats.frames++;
+            stats.bytesFull += OLEDFrameDiff::fullRefreshBytes();
+        } else {
+            stats.identical++;
+        }
+        return acked;
     }
 
-    void setMode(ScreenMode newMode) {
-        mode = newMode;
-        currentScreen = 0;
-        lastSwitch = 0;
+    // Push framebuffer over I2C under an APB-frequency lock.
+    // Frames closer than OLED_MIN_FRAME_MS are deferred unless forced;
+    // flushPending() sends a deferred frame.
+    void flush(bool force = false) {
+        unsigned long now = millis();
+        if (!frameGate.due(now, force)) {
+            framePending = true;
+            stats.rateLimited++;
+            if (!timers.active(frameJob)) timers.startOnce(frameJob, frameGate.waitMs(now));
+            return;
+        }
+
+        PowerLockGuard lock(PowerLocks::OLED_REFRESH);
+        I2CBus::Transaction tx(I2CBus::OLED);
+        if (!tx.ok()) {
+            // Bus busy: keep the frame and retry on the frame timer
+            framePending = true;
+            if (!timers.active(frameJob)) timers.startOnce(frameJob, OLED_MIN_FRAME_MS);
+            return;
+        }
+        PROFILE_SCOPE(OLED_PUSH);
+        if (!pushDirtyPages()) tx.fail();
+        frameGate.sent(now);
+        framePending = false;
     }
 
-    void showMessage(const char* msg) {
+    void flushPending() {
+        if (framePending && frameGate.due(millis())) flush(true);
+    }
+
+    static void frameTimer(void* arg) {
+        ((OLEDDisplay*)arg)->flushPending();
+    }
+
+    // CYCLE_ALL: advance to the next screen and redraw the last view
+    static void cycleTimer(void* arg) {
+        OLEDDisplay* self = (OLEDDisplay*)arg;
+        self->currentScreen = (self->currentScreen + 1) % 6;
+        self->render(self->lastView);
+    }
+
+    // Hand the current view to the render task, or draw it right here
+    void submit() {
+        stats.views++;
+        if (mailbox) {
+            if (uxQueueMessagesWaiting(mailbox) > 0) stats.coalesced++;
+            xQueueOverwrite(mailbox, &view);
+        } else {
+            render(view);
+        }
+    }
+
+    void setText(const char* s) {
+        strlcpy(view.text, s ? s : "", sizeof(view.text));
+    }
+
+    // -----------------------------
+    // Rendering (render task, or the caller when no task is running)
+    // -----------------------------
+    void render(const View& v) {
+        PROFILE_SCOPE(OLED_RENDER);
+        if (v.power != panelOn) {
+            I2CBus::Transaction tx(I2CBus::OLED);
+            if (tx.ok()) {
+                oled.ssd1306_command(v.power ? SSD1306_DISPLAYON : SSD1306_DISPLAYOFF);
+                panelOn = v.power;
+            }
+        }
+        lastView = v;
+
+        // The screen timer only runs while CYCLE_ALL is on a lit panel
+        bool cycling = v.kind == View::SENSORS && v.mode == CYCLE_ALL && panelOn;
+        if (!cycling) timers.stop(cycleJob);
+        if (!panelOn) return;
+
+        switch (v.kind) {
+            case View::SENSORS: renderSensors(v); break;
+            case View::SUMMARY: renderSummary(v); break;
+            case View::MESSAGE: renderMessage(v); break;
+            case View::BOOT:    renderBoot(v);    break;
+            case View::UPDATE:  renderUpdate(v);  break;
+        }
+
+        if (cycling && !timers.active(cycleJob)) timers.startPeriodic(cycleJob, screenInterval);
+    }
+
+    void renderMessage(const View& v) {
         oled.clearDisplay();
         oled.setCursor(0, 0);
-        oled.println(msg);
-        oled.display();
+        oled.println(v.text);
+        flush(true);  // status messages often precede a reboot/blocking step
     }
 
-    void showBootAnimation(const char* version = FIRMWARE_VERSION) {
+    void renderBoot(const View& v) {
         oled.clearDisplay();
-        
+
         // Step 1: Show "HomeSense" title (moved up for spacing)
         oled.setTextSize(2);
         oled.setTextColor(SSD1306_WHITE);
         oled.setCursor(10, 2);
         oled.print("HomeSense");
-        oled.display();
+        flush();
         delay(400);
-        
+
         // Step 2: Animated loading dots (3 dots bouncing) - positioned below title
         for (int cycle = 0; cycle < 2; cycle++) {
             for (int i = 0; i < 3; i++) {
@@ -77,19 +278,19 @@ public:
                 for (int j = 0; j <= i; j++) {
                     oled.fillRect(50 + j * 10, 18, 6, 6, SSD1306_WHITE);
                 }
-                oled.display();
+                flush();
                 delay(150);
             }
         }
-        
+
         // Step 3: Show version info (positioned below dots, above progress bar)
         // OLED is 128x32, so y goes from 0-31. Text size 1 is ~8 pixels tall.
         oled.setTextSize(1);
         oled.setCursor(35, 22); // y=22 gives space above progress bar (y=30-31)
-        oled.printf("v%s", version);
-        oled.display();
+        oled.printf("v%s", v.text);
+        flush();
         delay(400);
-        
+
         // Step 4: Progress bar animation (at the very bottom: rows 30-31 of 32-pixel display)
         for (int i = 0; i <= 100; i += 4) {
             oled.fillRect(0, 30, 128, 2, SSD1306_BLACK); // Clear progress bar area at bottom (y=30-31)
@@ -98,33 +299,38 @@ public:
             if (barWidth > 0) {
                 oled.fillRect(1, 30, barWidth, 1, SSD1306_WHITE); // Fill progress at very bottom
             }
-            oled.display();
+            flush();
             delay(25);
         }
-        
+        flush(true);  // make sure the final (100%) frame isn't left deferred
+
         delay(200);
     }
 
-    void show(uint16_t pm25, uint16_t pm10, float temp, float hum, float tvoc, int aqi, int batteryPercent) {
+    void renderSensors(const View& v) {
+        if (v.mode >= PM25_TREND) {
+            renderTrend(v);
+            return;
+        }
+
         oled.clearDisplay();
-        
+
         // Draw Battery at top right
-        drawBattery(batteryPercent);
-        
+        drawBattery(v.battery);
+        drawWiFiStatus(v.wifi);
+
         oled.setCursor(0, 0);
 
-        // Handle auto-cycling
-        if (mode == CYCLE_ALL) {
-            unsigned long now = millis();
-            if ((unsigned long)(now - lastSwitch) >= screenInterval) {
-                currentScreen = (currentScreen + 1) % 6;
-                lastSwitch = now;
-            }
+        // Entering a mode restarts the cycle (render() restarts the timer)
+        if (v.mode != renderedMode) {
+            renderedMode = v.mode;
+            currentScreen = 0;
+            timers.stop(cycleJob);
         }
 
         // Display based on mode or current screen
-        int displayMode = (mode == CYCLE_ALL) ? currentScreen : mode;
-        
+        int displayMode = (v.mode == CYCLE_ALL) ? currentScreen : v.mode;
+
         // Centered vertically for Size 2 font (32px height, font is ~16px high)
         // Cursor Y = 8 puts it perfectly in middle
         oled.setTextSize(2);
@@ -134,43 +340,89 @@ public:
             case AQI_SCREEN:
                 oled.setTextSize(2);
                 oled.setCursor(0, 2);
-                oled.printf("AQI:%d", aqi);
+                oled.printf("AQI:%d", v.aqi);
                 oled.setTextSize(1);
                 oled.setCursor(0, 22);
-                oled.printf("Status:%s", IAQ::getAQICategory(aqi));
+                oled.printf("Status:%s", IAQ::getAQICategory(v.aqi));
                 break;
-                
+
             case PM25_SCREEN:
-                oled.printf("PM2.5:%d", pm25);
+                oled.printf("PM2.5:%d", v.pm25);
                 oled.setTextSize(1);
                 oled.setCursor(0, 24);
                 oled.print("ug/m3");
                 break;
-                
+
             case PM10_SCREEN:
-                oled.printf("PM10:%d", pm10);
+                oled.printf("PM10:%d", v.pm10);
                 oled.setTextSize(1);
                 oled.setCursor(0, 24);
                 oled.print("ug/m3");
                 break;
-                
+
+            // Missing readings (sensor down or held too long) show "--"
             case TEMP_SCREEN:
-                oled.printf("Temp:%.0fC", temp);
+                if (isnan(v.temp)) oled.print("Temp:--");
+                else oled.printf("Temp:%.0fC", v.temp);
                 break;
-                
+
             case HUM_SCREEN:
-                oled.printf("Hum:%.0f%%", hum);
+                if (isnan(v.hum)) oled.print("Hum:--");
+                else oled.printf("Hum:%.0f%%", v.hum);
                 break;
-                
+
             case TVOC_SCREEN:
-                oled.printf("TVOC:%.0f", tvoc);
+                if (isnan(v.tvoc)) oled.print("TVOC:--");
+                else oled.printf("TVOC:%.0f", v.tvoc);
                 oled.setTextSize(1);
                 oled.setCursor(0, 24);
                 oled.print("PPB");
                 break;
         }
 
-        oled.display();
+        flush();
+    }
+
+    // Header line + the pre-rendered sparkline columns copied straight into
+    // pages 1-3 of the framebuffer
+    void renderTrend(const View& v) {
+        Trend::Channel ch = (Trend::Channel)(v.mode - PM25_TREND);
+        const Trend::ChannelSpec& sp = Trend::spec(ch);
+
+        oled.clearDisplay();
+        oled.setTextSize(1);
+        oled.setTextColor(SSD1306_WHITE);
+        oled.setCursor(0, 0);
+
+        if (trendLock) xSemaphoreTake(trendLock, portMAX_DELAY);
+        const Trend::Ring& ring = trends.ring(ch, v.trendDay);
+        float now = ring.latest();
+        float top = ring.axisMax();
+
+        if (isnan(now)) {
+            oled.printf("%s %s --", sp.label, v.trendDay ? "24h" : "1h");
+        } else if (ch == Trend::TEMP) {
+            oled.printf("%s %s %.1f", sp.label, v.trendDay ? "24h" : "1h", now);
+        } else {
+            oled.printf("%s %s %.0f", sp.label, v.trendDay ? "24h" : "1h", now);
+        }
+
+        uint8_t* buf = oled.getBuffer();
+        for (uint8_t x = 0; x < Trend::COLUMNS; x++) {
+            uint32_t col = ring.column(x);
+            buf[1 * OLEDFrameDiff::WIDTH + x] = col & 0xFF;
+            buf[2 * OLEDFrameDiff::WIDTH + x] = (col >> 8) & 0xFF;
+            buf[3 * OLEDFrameDiff::WIDTH + x] = (col >> 16) & 0xFF;
+        }
+        if (trendLock) xSemaphoreGive(trendLock);
+
+        // Axis top, right-aligned
+        char axis[10];
+        snprintf(axis, sizeof(axis), "^%.0f", top);
+        oled.setCursor(OLEDFrameDiff::WIDTH - 6 * strlen(axis), 0);
+        oled.print(axis);
+
+        flush();
     }
 
     void drawBattery(int percent) {
@@ -178,11 +430,11 @@ public:
         oled.setTextColor(SSD1306_WHITE);
         oled.setCursor(95, 0);
         oled.printf("%d%%", percent);
-        
+
         // Simple battery outline
         oled.drawRect(118, 0, 10, 6, SSD1306_WHITE);
         oled.drawRect(128, 2, 1, 2, SSD1306_WHITE); // Battery nipple
-        
+
         // Fill based on percentage
         int fillWidth = (percent * 8) / 100;
         if (fillWidth > 0) {
@@ -190,52 +442,60 @@ public:
         }
     }
 
-    // Optional: display all sensor data at once
-    void showSensorDataFull(uint16_t pm25, float tvoc, float temp, float hum, int aqi, const char* aqiCategory = nullptr) {
+    void drawWiFiStatus(bool connected) {
+        // 3-bar signal glyph left of the battery percentage; hollow when offline
+        for (int i = 0; i < 3; i++) {
+            int h = 2 + i * 2;
+            if (connected) {
+                oled.fillRect(86 + i * 2, 6 - h, 1, h, SSD1306_WHITE);
+            } else {
+                oled.drawFastHLine(86 + i * 2, 5, 1, SSD1306_WHITE);
+            }
+        }
+    }
+
+    void renderSummary(const View& v) {
         oled.clearDisplay();
         oled.setCursor(0, 0);
-        oled.printf("PM2.5 : %d\n", pm25);
-        oled.printf("TVOC  : %.1f\n", tvoc);
-        oled.printf("Temp  : %.1f C\n", temp);
-        oled.printf("Hum   : %.0f %%\n", hum);
-        oled.printf("IAQ   : %d\n", aqi);
-        if (aqiCategory) oled.printf("%s\n", aqiCategory);
-        oled.display();
+        oled.printf("PM2.5 : %d\n", v.pm25);
+        oled.printf("TVOC  : %.1f\n", v.tvoc);
+        oled.printf("Temp  : %.1f C\n", v.temp);
+        oled.printf("Hum   : %.0f %%\n", v.hum);
+        oled.printf("IAQ   : %d\n", v.aqi);
+        if (v.text[0]) oled.printf("%s\n", v.text);
+        flush();
     }
 
-    // Firmware update animation
-    void showUpdateAnimation(const char* newVersion = nullptr, int progress = -1) {
+    void renderUpdate(const View& v) {
         oled.clearDisplay();
-        
+
         // Title
         oled.setTextSize(1);
         oled.setTextColor(SSD1306_WHITE);
         oled.setCursor(20, 0);
         oled.print("FIRMWARE UPDATE");
-        oled.display();
-        
+
         // Version info if provided
-        if (newVersion) {
+        if (v.text[0]) {
             oled.setCursor(25, 10);
             oled.setTextSize(1);
-            oled.printf("v%s", newVersion);
+            oled.printf("v%s", v.text);
         }
-        
+
         // Progress bar (if progress >= 0)
-        if (progress >= 0 && progress <= 100) {
+        if (v.progress >= 0 && v.progress <= 100) {
             oled.drawRect(10, 20, 108, 8, SSD1306_WHITE);
-            int barWidth = (progress * 106) / 100; // 106 to account for border
+            int barWidth = (v.progress * 106) / 100; // 106 to account for border
             if (barWidth > 0) {
                 oled.fillRect(11, 21, barWidth, 6, SSD1306_WHITE);
             }
             // Show percentage
             oled.setCursor(50, 22);
             oled.setTextColor(SSD1306_BLACK, SSD1306_WHITE); // Inverted text
-            oled.printf("%d%%", progress);
+            oled.printf("%d%%", v.progress);
             oled.setTextColor(SSD1306_WHITE); // Reset
         } else {
             // Animated dots while waiting
-            static int dotPos = 0;
             oled.setCursor(45, 22);
             for (int i = 0; i < 3; i++) {
                 if (i == dotPos) {
@@ -246,7 +506,165 @@ public:
             }
             dotPos = (dotPos + 1) % 3;
         }
-        
-        oled.display();
+
+        // Per-chunk progress views are capped by the frame rate; always show 100%
+        flush(v.progress == 100);
+    }
+
+    // Render task: block until a new view arrives or the next timer job
+    // (CYCLE_ALL screen switch, frame deferred by the frame-rate cap)
+    static void renderTaskMain(void* arg) {
+        OLEDDisplay* self = (OLEDDisplay*)arg;
+        View v;
+
+        for (;;) {
+            uint32_t waitMs = self->timers.run();
+            TickType_t wait = waitMs == TimerWheel::NEVER ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+            if (xQueueReceive(self->mailbox, &v, wait) == pdTRUE) self->render(v);
+        }
+    }
+
+public:
+    OLEDDisplay(uint8_t sda = OLED_SDA, uint8_t scl = OLED_SCL, uint8_t addr = OLED_ADDR)
+        : oled(128, 32, &I2CBus::wire(I2CBus::OLED), -1, OLED_I2C_HZ, OLED_I2C_HZ),
+          _sda(sda), _scl(scl), _addr(addr) {
+        memset(&view, 0, sizeof(view));
+        view.kind = View::MESSAGE;
+        view.mode = CYCLE_ALL;
+        view.power = true;
+        lastView = view;
+        trends.begin();
+        cycleJob = timers.add("cycle", cycleTimer, this);
+        frameJob = timers.add("frame", frameTimer, this);
+    }
+
+    void begin() {
+        // Own controller, so nothing else changes its clock; the library
+        // restores OLED_I2C_HZ after each transfer (clkAfter above)
+        I2CBus::begin(I2CBus::OLED, _sda, _scl, OLED_I2C_HZ);
+        I2CBus::Transaction tx(I2CBus::OLED, UINT32_MAX);
+
+        if (!oled.begin(SSD1306_SWITCHCAPVCC, _addr, true, false)) {  // bus already up
+            Serial.println("OLED init failed!");
+            while (true) delay(1000);
+        }
+
+        oled.clearDisplay();
+        oled.setTextSize(1);
+        oled.setTextColor(SSD1306_WHITE);
+        shadowValid = false;  // panel RAM contents unknown until the first full push
+        frameGate.reset();
+        if (!trendLock) trendLock = xSemaphoreCreateMutex();
+    }
+
+    // Move rendering and I2C flushes onto a dedicated task. Until this is
+    // called (and in the low-power cycle) every call renders synchronously.
+    bool startRenderTask(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY) {
+        if (renderTask) return true;
+        mailbox = xQueueCreate(1, sizeof(View));
+        if (!mailbox) return false;
+        if (!viewLock) viewLock = xSemaphoreCreateMutex();
+
+        if (xTaskCreatePinnedToCore(renderTaskMain, "OLEDRender", 4096, this,
+                                    priority, &renderTask, core) != pdPASS) {
+            Serial.println("❌ Failed to create OLED render task");
+            vQueueDelete(mailbox);
+            mailbox = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void setMode(ScreenMode newMode, bool trendDay = false) {
+        ViewGuard guard(viewLock);
+        view.mode = newMode;
+        view.trendDay = trendDay;
+    }
+
+    // Feed the sparkline history (one call per sensor reading; NAN = no data)
+    void recordTrend(float pm25, int aqi, float tvoc, float temp) {
+        if (trendLock) xSemaphoreTake(trendLock, portMAX_DELAY);
+        trends.add(millis(), pm25, (float)aqi, tvoc, temp);
+        if (trendLock) xSemaphoreGive(trendLock);
+    }
+
+    // Set by ConnectivityManager; drawn as a small link marker in the status area
+    void setWiFiConnected(bool connected) {
+        ViewGuard guard(viewLock);
+        view.wifi = connected;
+    }
+
+    // Panel on/off (charge pump off draws ~10 uA instead of ~10 mA)
+    void setPower(bool on) {
+        ViewGuard guard(viewLock);
+        view.power = on;
+        submit();
+    }
+
+    // Run the display timers when rendering inline (call from loop; no-op
+    // once the render task is running since it does this itself). Returns
+    // the ms until the next one is due.
+    uint32_t service() {
+        return renderTask ? TimerWheel::NEVER : timers.run();
+    }
+
+    void printStats() {
+        Serial.printf("📺 OLED: %lu views (%lu coalesced) | %lu frames | %lu identical | %lu rate-limited | %lu B sent vs %lu B full (%.0f%%)\n",
+                      (unsigned long)stats.views, (unsigned long)stats.coalesced,
+                      (unsigned long)stats.frames, (unsigned long)stats.identical,
+                      (unsigned long)stats.rateLimited, (unsigned long)stats.bytesSent,
+                      (unsigned long)stats.bytesFull,
+                      stats.bytesFull ? 100.0f * stats.bytesSent / stats.bytesFull : 0.0f);
+    }
+
+    void showMessage(const char* msg) {
+        ViewGuard guard(viewLock);
+        view.kind = View::MESSAGE;
+        setText(msg);
+        submit();
+    }
+
+    // Returns immediately once the render task runs, so the animation
+    // plays while sensors and WiFi start up
+    void showBootAnimation(const char* version = FIRMWARE_VERSION) {
+        ViewGuard guard(viewLock);
+        view.kind = View::BOOT;
+        setText(version);
+        submit();
+    }
+
+    void show(uint16_t pm25, uint16_t pm10, float temp, float hum, float tvoc, int aqi, int batteryPercent) {
+        ViewGuard guard(viewLock);
+        view.kind = View::SENSORS;
+        view.pm25 = pm25;
+        view.pm10 = pm10;
+        view.temp = temp;
+        view.hum = hum;
+        view.tvoc = tvoc;
+        view.aqi = aqi;
+        view.battery = batteryPercent;
+        submit();
+    }
+
+    // Optional: display all sensor data at once
+    void showSensorDataFull(uint16_t pm25, float tvoc, float temp, float hum, int aqi, const char* aqiCategory = nullptr) {
+        ViewGuard guard(viewLock);
+        view.kind = View::SUMMARY;
+        view.pm25 = pm25;
+        view.tvoc = tvoc;
+        view.temp = temp;
+        view.hum = hum;
+        view.aqi = aqi;
+        setText(aqiCategory);
+        submit();
+    }
+
+    // Firmware update animation
+    void showUpdateAnimation(const char* newVersion = nullptr, int progress = -1) {
+        ViewGuard guard(viewLock);
+        view.kind = View::UPDATE;
+        view.progress = progress;
+        setText(newVersion);
+        submit();
     }
 };
@@ -0,0 +1,111 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// -----------------------------------
+// SSD1306 Frame Diff
+// Compares the framebuffer against the copy last sent to the panel and
+// reports, per 8-pixel page, the column range that changed, plus the
+// frame-rate cap deciding when a frame may go out. Plain C++ (no Arduino
+// dependencies) so tools/oled_refresh_bench.cpp can check both on the host.
+// -----------------------------------
+namespace OLEDFrameDiff {
+
+constexpr uint8_t WIDTH = 128;
+constexpr uint8_t PAGES = 4;                // 32 px / 8
+constexpr uint16_t BUFFER_SIZE = WIDTH * PAGES;
+
+#if defined(I2C_BUFFER_LENGTH)
+constexpr uint16_t I2C_CHUNK = I2C_BUFFER_LENGTH - 1;   // minus the 0x40 control byte
+#else
+constexpr uint16_t I2C_CHUNK = 31;                      // classic 32-byte Wire buffer
+#endif
+
+struct PageRange {
+    uint8_t first;
+    uint8_t last;
+    bool dirty;
+};
+
+// Changed column span of one page (dirty == false when identical)
+inline PageRange diffPage(const uint8_t* cur, const uint8_t* prev, uint8_t page) {
+    const uint8_t* a = cur + page * WIDTH;
+    const uint8_t* b = prev + page * WIDTH;
+
+    PageRange r = {0, 0, false};
+    int first = 0;
+    while (first < WIDTH && a[first] == b[first]) first++;
+    if (first == WIDTH) return r;
+
+    int last = WIDTH - 1;
+    while (last > first && a[last] == b[last]) last--;
+
+    r.first = (uint8_t)first;
+    r.last = (uint8_t)last;
+    r.dirty = true;
+    return r;
+}
+
+// I2C payload bytes for n data bytes (each chunk carries a control byte)
+inline uint32_t dataBytes(uint32_t n) {
+    return n + (n + I2C_CHUNK - 1) / I2C_CHUNK;
+}
+
+// Adafruit_SSD1306::display(): one 6-byte command list + the whole buffer
+inline uint32_t fullRefreshBytes() {
+    return (1 + 6) + dataBytes(BUFFER_SIZE);
+}
+
+// Partial window: PAGEADDR/COLUMNADDR (3 commands, 2 bytes each) + data
+inline uint32_t windowBytes(const PageRange& r) {
+    return 6 * 2 + dataBytes(r.last - r.first + 1);
+}
+
+// Total bytes a dirty-tracked flush of cur would send
+inline uint32_t partialRefreshBytes(const uint8_t* cur, const uint8_t* prev) {
+    uint32_t total = 0;
+    for (uint8_t p = 0; p < PAGES; p++) {
+        PageRange r = diffPage(cur, prev, p);
+        if (r.dirty) total += windowBytes(r);
+    }
+    return total;
+}
+
+// With most columns dirty, four page windows (12 command bytes each)
+// cost more than one full refresh
+inline bool preferFull(const uint8_t* cur, const uint8_t* prev) {
+    return partialRefreshBytes(cur, prev) >= fullRefreshBytes();
+}
+
+// What a flush of cur actually sends: the cheaper of the two
+inline uint32_t refreshBytes(const uint8_t* cur, const uint8_t* prev) {
+    return preferFull(cur, prev) ? fullRefreshBytes() : partialRefreshBytes(cur, prev);
+}
+
+// -------- Frame-rate cap --------
+// A frame closer than minMs to the previous one is deferred unless
+// forced; the first frame after reset() always goes out.
+class FrameGate {
+    uint32_t minMs;
+    uint32_t lastMs = 0;
+    bool started = false;
+
+public:
+    explicit FrameGate(uint32_t minFrameMs) : minMs(minFrameMs) {}
+
+    bool due(uint32_t now, bool force = false) const {
+        return force || !started || now - lastMs >= minMs;
+    }
+
+    // ms until an unforced frame may go out
+    uint32_t waitMs(uint32_t now) const { return due(now) ? 0 : minMs - (now - lastMs); }
+
+    void sent(uint32_t now) {
+        lastMs = now;
+        started = true;
+    }
+
+    void reset() { started = false; }
+};
+
+} // namespace OLEDFrameDiff
@@ -0,0 +1,120 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "spsc_queue.h"
+
+// -----------------------------------
+// Pipeline Stats
+// Per-stage latency and queue high-water marks for SensorPipeline.
+//   acq_*   : bus read time
+//   fusion  : trigger -> fused sample (waits for the slowest bus)
+//   sink_*  : fused -> sink done (queue wait + processing)
+// Kept separate from the pipeline so web_server.h can serve it.
+// -----------------------------------
+class PipelineStats {
+public:
+    enum Stage {
+        ACQ_UART,
+        ACQ_I2C,
+        ACQ_DHT,
+        FUSION,
+        SINK_DISPLAY,
+        SINK_HTTP,
+        SINK_LOG,
+        SINK_HISTORY,
+        STAGE_COUNT
+    };
+
+    static constexpr uint8_t MAX_QUEUES = 8;
+
+private:
+    struct StageStat {
+        const char* name;
+        uint32_t count;
+        uint32_t lastUs;
+        uint32_t maxUs;
+        uint64_t totalUs;
+    };
+
+    static StageStat* stages() {
+        static StageStat s[STAGE_COUNT] = {
+            {"acq_uart", 0, 0, 0, 0},
+            {"acq_i2c", 0, 0, 0, 0},
+            {"acq_dht", 0, 0, 0, 0},
+            {"fusion", 0, 0, 0, 0},
+            {"sink_display", 0, 0, 0, 0},
+            {"sink_http", 0, 0, 0, 0},
+            {"sink_log", 0, 0, 0, 0},
+            {"sink_history", 0, 0, 0, 0},
+        };
+        return s;
+    }
+
+    struct Queues {
+        const SpscQueueBase* q[MAX_QUEUES];
+        uint8_t count;
+    };
+
+    static Queues& queues() {
+        static Queues q = {{nullptr}, 0};
+        return q;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+public:
+    static void addQueue(const SpscQueueBase* q) {
+        Queues& qs = queues();
+        if (qs.count < MAX_QUEUES) qs.q[qs.count++] = q;
+    }
+
+    static void record(Stage stage, uint32_t us) {
+        StageStat& s = stages()[stage];
+        portENTER_CRITICAL(&mux());
+        s.count++;
+        s.lastUs = us;
+        s.totalUs += us;
+        if (us > s.maxUs) s.maxUs = us;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void printStats() {
+        Serial.println("🧵 Pipeline:");
+        StageStat* s = stages();
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            Serial.printf("   %-12s n:%7lu avg:%7luus max:%7luus last:%7luus\n", s[i].name,
+                          (unsigned long)s[i].count,
+                          (unsigned long)(s[i].count ? s[i].totalUs / s[i].count : 0),
+                          (unsigned long)s[i].maxUs, (unsigned long)s[i].lastUs);
+        }
+        Queues& qs = queues();
+        for (uint8_t i = 0; i < qs.count; i++) {
+            Serial.printf("   q:%-10s hwm:%2lu/%u dropped:%lu\n", qs.q[i]->name,
+                          (unsigned long)qs.q[i]->highWaterMark(), qs.q[i]->capacity,
+                          (unsigned long)qs.q[i]->droppedCount());
+        }
+    }
+
+    static void writeJson(Print& out) {
+        out.print("{\"stages\":{");
+        StageStat* s = stages();
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            out.printf("%s\"%s\":{\"count\":%lu,\"avg_us\":%lu,\"max_us\":%lu,\"last_us\":%lu}",
+                       i ? "," : "", s[i].name, (unsigned long)s[i].count,
+                       (unsigned long)(s[i].count ? s[i].totalUs / s[i].count : 0),
+                       (unsigned long)s[i].maxUs, (unsigned long)s[i].lastUs);
+        }
+        out.print("},\"queues\":{");
+        Queues& qs = queues();
+        for (uint8_t i = 0; i < qs.count; i++) {
+            out.printf("%s\"%s\":{\"capacity\":%u,\"high_water\":%lu,\"dropped\":%lu}",
+                       i ? "," : "", qs.q[i]->name, qs.q[i]->capacity,
+                       (unsigned long)qs.q[i]->highWaterMark(),
+                       (unsigned long)qs.q[i]->droppedCount());
+        }
+        out.print("}}");
+    }
+};
@@ -0,0 +1,198 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+#include "config.h"
+#include "pm_sensor.h"
+
+// -----------------------------------
+// PM Calibration
+// Optical PM sensors count water along with the particle: at high
+// humidity they over-read. Each raw reading is first dried with a
+// kappa-Koehler mass growth factor (Crilley et al. 2018)
+//     C(RH) = 1 + (kappa / density) / (100 / RH - 1)
+// and then mapped through a per-device curve (linear, or piecewise
+// linear through raw -> reference points) from config.json.
+//
+// Both steps are baked into a humidity x PM table of corrected values
+// when the settings change. apply() is a bilinear lookup. The host test
+// (test/test_pm_calibration) checks the table against direct() and
+// against reference pairs.
+// -----------------------------------
+class PMCalibration {
+public:
+    enum Channel : uint8_t { PM25, PM10, CHANNELS };   // PM1.0 uses the PM2.5 curve
+
+    static constexpr uint8_t MAX_POINTS = 8;
+
+    // Device curve: n = 0 identity, otherwise piecewise linear through
+    // (raw, ref) points sorted by raw, extended by the end segments.
+    struct Curve {
+        uint8_t n;
+        float raw[MAX_POINTS];
+        float ref[MAX_POINTS];
+
+        static Curve linear(float slope, float offset) {
+            Curve c = {};
+            c.n = 2;
+            c.raw[0] = 0;    c.ref[0] = offset;
+            c.raw[1] = 1000; c.ref[1] = offset + slope * 1000;
+            return c;
+        }
+    };
+
+    struct Settings {
+        float kappa = PM_CAL_KAPPA;
+        float density = PM_CAL_DENSITY;
+        Curve curve[CHANNELS] = {};
+    };
+
+    // Table axes. RH beyond the last row is clamped: C(RH) diverges at 100 %.
+    static constexpr float RH_STEP = 2.5f;
+    static constexpr uint8_t RH_ROWS = 39;                  // 0 .. 95 %
+    static constexpr float RH_MAX = RH_STEP * (RH_ROWS - 1);
+    static constexpr uint8_t PM_COLS = 16;
+    static constexpr float PM_KNOTS[PM_COLS] = {0, 2, 5, 10, 15, 25, 35, 50,
+                                                75, 100, 150, 200, 300, 500, 750, 1000};
+
+private:
+    struct State {
+        Settings settings;
+        int16_t table[CHANNELS][RH_ROWS][PM_COLS];    // corrected, 0.1 ug/m3
+        float invSpan[PM_COLS];                       // 1 / (knot[i] - knot[i-1])
+    };
+
+    static State initial() {
+        State st;
+        build(st);
+        return st;
+    }
+
+    // Built with the defaults on first use
+    static State& state() {
+        static State st = initial();
+        return st;
+    }
+
+    static float evalCurve(const Curve& c, float x) {
+        if (c.n < 2) return x;
+        uint8_t i = 1;
+        while (i < c.n - 1 && x > c.raw[i]) i++;
+        float dx = c.raw[i] - c.raw[i - 1];
+        if (dx <= 0) return c.ref[i];
+        return c.ref[i - 1] + (x - c.raw[i - 1]) * (c.ref[i] - c.ref[i - 1]) / dx;
+    }
+
+    static void build(State& st) {
+        for (uint8_t p = 1; p < PM_COLS; p++) st.invSpan[p] = 1 / (PM_KNOTS[p] - PM_KNOTS[p - 1]);
+        for (uint8_t ch = 0; ch < CHANNELS; ch++) {
+            for (uint8_t r = 0; r < RH_ROWS; r++) {
+                for (uint8_t p = 0; p < PM_COLS; p++) {
+                    // Unclamped, so a negative offset has no kink to interpolate across
+                    float v = dried(st.settings, (Channel)ch, PM_KNOTS[p], r * RH_STEP);
+                    st.table[ch][r][p] = (int16_t)lroundf(constrainf(v * 10, -32768, 32767));
+                }
+            }
+        }
+    }
+
+    static float constrainf(float v, float lo, float hi) {
+        return v < lo ? lo : (v > hi ? hi : v);
+    }
+
+    // Drying + device curve, before clamping at zero
+    static float dried(const Settings& s, Channel ch, float pm, float rh) {
+        if (!isnan(rh) && rh > 0) {
+            if (rh > RH_MAX) rh = RH_MAX;
+            pm /= 1 + (s.kappa / s.density) / (100 / rh - 1);
+        }
+        return evalCurve(s.curve[ch], pm);
+    }
+
+public:
+    // Reference implementation (what apply() approximates)
+    static float direct(const Settings& s, Channel ch, float pm, float rh) {
+        if (isnan(pm) || pm <= 0) return 0;
+        float v = dried(s, ch, pm, rh);
+        return v > 0 ? v : 0;
+    }
+
+    static void configure(const Settings& s) {
+        State& st = state();
+        st.settings = s;
+        build(st);
+    }
+
+    static const Settings& settings() { return state().settings; }
+
+    // Corrected concentration. rh NAN (no humidity yet): curve only.
+    static float apply(Channel ch, float pm, float rh) {
+        if (isnan(pm) || pm <= 0) return 0;
+        if (isnan(rh) || rh < 0) rh = 0;
+        if (rh > RH_MAX) rh = RH_MAX;
+        if (pm > PM_KNOTS[PM_COLS - 1]) pm = PM_KNOTS[PM_COLS - 1];
+
+        float fr = rh * (1 / RH_STEP);
+        uint8_t r = (uint8_t)fr;
+        if (r >= RH_ROWS - 1) r = RH_ROWS - 2;
+        float tr = fr - r;
+
+        // First knot >= pm (binary search over the 16 knots)
+        uint8_t p = 1;
+        for (uint8_t step = PM_COLS / 2; step; step >>= 1) {
+            if (p + step < PM_COLS && pm > PM_KNOTS[p + step - 1]) p += step;
+        }
+
+        const State& st = state();
+        float tp = (pm - PM_KNOTS[p - 1]) * st.invSpan[p];
+        const int16_t (*t)[PM_COLS] = st.table[ch];
+        float lo = t[r][p - 1] + (t[r][p] - t[r][p - 1]) * tp;
+        float hi = t[r + 1][p - 1] + (t[r + 1][p] - t[r + 1][p - 1]) * tp;
+        float v = (lo + (hi - lo) * tr) * 0.1f;
+        return v > 0 ? v : 0;
+    }
+
+    static PMData apply(const PMData& raw, float rh) {
+        PMData out;
+        out.pm1_0 = (uint16_t)lroundf(apply(PM25, raw.pm1_0, rh));
+        out.pm2_5 = (uint16_t)lroundf(apply(PM25, raw.pm2_5, rh));
+        out.pm10  = (uint16_t)lroundf(apply(PM10, raw.pm10, rh));
+        return out;
+    }
+
+    // "pm_calibration" object from config.json (any ArduinoJson variant):
+    //   {"kappa": 0.4, "density": 1.65,
+    //    "pm25": {"slope": 0.9, "offset": 1.0},
+    //    "pm10": {"points": [[0, 0], [50, 40], [200, 180]]}}
+    // Missing keys keep their defaults.
+    template <typename Json>
+    static Settings fromJson(const Json& cfg) {
+        Settings s;
+        s.kappa = cfg["kappa"] | s.kappa;
+        s.density = cfg["density"] | s.density;
+        if (s.density <= 0) s.density = PM_CAL_DENSITY;
+        static const char* keys[CHANNELS] = {"pm25", "pm10"};
+        for (uint8_t ch = 0; ch < CHANNELS; ch++) {
+            auto c = cfg[keys[ch]];
+            if (c.isNull()) continue;
+            auto points = c["points"];
+            if (!points.isNull()) {
+                Curve& k = s.curve[ch];
+                k.n = 0;
+                for (uint8_t i = 0; i < MAX_POINTS; i++) {
+                    auto pt = points[i];
+                    if (pt.isNull()) break;
+                    float raw = pt[0] | NAN, ref = pt[1] | NAN;
+                    if (isnan(raw) || isnan(ref) || (k.n && raw <= k.raw[k.n - 1])) continue;
+                    k.raw[k.n] = raw;
+                    k.ref[k.n] = ref;
+                    k.n++;
+                }
+                if (k.n < 2) k.n = 0;   // one point is not a curve
+            } else {
+                s.curve[ch] = Curve::linear(c["slope"] | 1.0f, c["offset"] | 0.0f);
+            }
+        }
+        return s;
+    }
+};
@@ -1,6 +1,10 @@
 #pragma once
 #include <Arduino.h>
 #include <HardwareSerial.h>
+#include "power_locks.h"
+#include "bus_trace.h"
+#include "sensor_health.h"
+#include "config.h"
 
 // -----------------------------------
 // PM Data Structure
@@ -13,63 +17,144 @@ struct PMData {
 
 // -----------------------------------
 // PM Sensor Class (Winsen ZH07)
+// Runs in Q&A mode: each read() sends a query and takes the 9-byte reply
+// (FF 86 | PM2.5 | PM10 | PM1.0 | checksum, big-endian ug/m3). The UART
+// only carries traffic inside read() and the mode commands, so UART_RX
+// blocks auto light sleep for those few ms and not between samples.
 // -----------------------------------
 class PMSensor {
 private:
+    static constexpr size_t REPLY_LEN = 9;
+
     HardwareSerial &serial;
+    int rxPin = -1, txPin = -1;
+    uint32_t baud = 9600;
+    SensorHealth::Fault fault = SensorHealth::FAULT_NONE;
+
+    // Commands are FF 01 cmd arg 00 00 00 00 checksum
+    void command(const uint8_t (&cmd)[9]) {
+        PowerLockGuard rx(PowerLocks::UART_RX);
+        serial.write(cmd, sizeof(cmd));
+        serial.flush();
+    }
+
+    // Q&A mode (FF 01 78 41 ... 46): replies only when asked
+    void queryMode() {
+        static const uint8_t cmd[9] = {0xFF, 0x01, 0x78, 0x41, 0x00, 0x00, 0x00, 0x00, 0x46};
+        command(cmd);
+    }
+
+    // Every consumed byte goes to the bus trace (no-op unless capturing)
+    int rx() {
+        int b = serial.read();
+        if (b >= 0) BusTrace::uart((uint8_t)b);
+        return b;
+    }
+
+    // Consume up to and including the next FF 86; false if none
+    bool header() {
+        while (serial.available()) {
+            if (rx() == 0xFF && serial.peek() == 0x86) {
+                rx();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void drain() {
+        while (serial.available()) serial.read();
+    }
 
 public:
     // Constructor expects a HardwareSerial object (e.g., Serial2)
     PMSensor(HardwareSerial &ser) : serial(ser) {}
 
     // Begin UART communication with ZH07
-    void begin(int rxPin, int txPin, uint32_t baud = 9600) {
+    void begin(int rx, int tx, uint32_t bps = 9600) {
+        rxPin = rx;
+        txPin = tx;
+        baud = bps;
         // ✅ Correct: use rxPin & txPin provided from user
         serial.begin(baud, SERIAL_8N1, rxPin, txPin);
         delay(300);
 
-        // Clear junk bytes
-        while (serial.available()) serial.read();
+        // It powers up streaming: switch to Q&A, then clear what it sent
+        queryMode();
+        delay(100);
+        drain();
     }
 
-    // Read PM values into the PMData struct
-    bool read(PMData &data) {
-        if (!serial.available()) return false;
+    // Recovery: tear the UART down and bring it back on the same pins
+    void restartUart() {
+        serial.end();
+        begin(rxPin, txPin, baud);
+    }
 
-        // Wait for header 0x42 0x4D
-        while (serial.available()) {
-            if (serial.read() == 0x42) {
-                if (serial.peek() == 0x4D) {
-                    serial.read(); // consume 0x4D
-                    break;
-                }
-            }
-        }
+    // Recovery: wake the ZH07 in case it dropped into dormancy and put it
+    // back into Q&A mode
+    void reinit() {
+        wake();
+        delay(100);
+        drain();
+    }
+
+    // Why the last read() returned false (FAULT_NONE after a good reply)
+    SensorHealth::Fault lastFault() const { return fault; }
+
+    // Put the ZH07 into dormancy (fan + laser off) - FF 01 A7 01 ... 57
+    void sleep() {
+        static const uint8_t cmd[9] = {0xFF, 0x01, 0xA7, 0x01, 0x00, 0x00, 0x00, 0x00, 0x57};
+        command(cmd);
+    }
 
-        // Need 30 more bytes
+    // Wake the ZH07 from dormancy - FF 01 A7 00 ... 58 - in Q&A mode
+    void wake() {
+        static const uint8_t cmd[9] = {0xFF, 0x01, 0xA7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x58};
+        command(cmd);
+        queryMode();
+    }
+
+    // Query the ZH07 (FF 01 86 ... 79) and wait up to PM_QUERY_TIMEOUT_MS
+    // for the reply. Leftovers (a reply that came too late last time) are
+    // dropped first; noise ahead of the reply is skipped.
+    bool read(PMData &data) {
+        static const uint8_t query[9] = {0xFF, 0x01, 0x86, 0x00, 0x00, 0x00, 0x00, 0x00, 0x79};
+        PowerLockGuard hold(PowerLocks::UART_RX);
+        fault = SensorHealth::FAULT_TIMEOUT;
+        bool got = false;
+
+        drain();
+        serial.write(query, sizeof(query));
+        serial.flush();
         unsigned long start = millis();
-        while (serial.available() < 30 && millis() - start < 1000) {
+        while (serial.available() < (int)REPLY_LEN && millis() - start < PM_QUERY_TIMEOUT_MS) {
             delay(5);
         }
 
-        if (serial.available() < 30) return false;
+        while (serial.available() >= (int)REPLY_LEN - 2 && header()) {
+            if (serial.available() < (int)REPLY_LEN - 2) break;
 
-        uint8_t buffer[30];
-        serial.readBytes(buffer, 30);
+            uint8_t buffer[REPLY_LEN - 2];
+            serial.readBytes(buffer, sizeof(buffer));
+            BusTrace::uart(buffer, sizeof(buffer));
 
-        // Validate checksum
-        uint16_t sum = 0x42 + 0x4D;
-        for (int i = 0; i < 28; i++) sum += buffer[i];
-
-        uint16_t checksum = (buffer[28] << 8) | buffer[29];
-
-        if (checksum != sum) return false;
+            // Validate checksum: two's complement of bytes 1-7
+            uint8_t sum = 0x86;
+            for (size_t i = 0; i < 6; i++) sum += buffer[i];
+            if ((uint8_t)(~sum + 1) != buffer[6]) {
+                if (!got) fault = SensorHealth::FAULT_CHECKSUM;
+                continue;
+            }
+            fault = SensorHealth::FAULT_NONE;
+            got = true;
 
-        // Extract values
-        data.pm1_0 = (buffer[4] << 8) | buffer[5];
-        data.pm2_5 = (buffer[6] << 8) | buffer[7];
-        data.pm10  = (buffer[8] << 8) | buffer[9];
+            // Extract values
+            data.pm2_5 = (buffer[0] << 8) | buffer[1];
+            data.pm10  = (buffer[2] << 8) | buffer[3];
+            data.pm1_0 = (buffer[4] << 8) | buffer[5];
+        }
 
-        return true;
+        return got;
     }
 };
@@ -0,0 +1,236 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_pm.h>
+#include <esp_timer.h>
+#include <esp_wifi.h>
+#include "config.h"
+
+// -----------------------------------
+// Power-Management Locks
+// DVFS between CPU_FREQ_MIN_MHZ and CPU_FREQ_MAX_MHZ with automatic light
+// sleep. Subsystems hold a lock only while they need full speed / no
+// sleep. If the ESP-IDF build lacks CONFIG_PM_ENABLE (stock Arduino
+// libs), locks fall back to switching the CPU clock directly.
+// -----------------------------------
+class PowerLocks {
+public:
+    enum Id {
+        UART_RX,       // ZH07 query / command in flight (no light sleep)
+        TLS,           // TLS handshake / HTTPS request (full CPU)
+        OTA_FLASH,     // Firmware download + flash write
+        OLED_REFRESH,  // I2C framebuffer push (APB clock)
+        LOCK_COUNT
+    };
+
+private:
+    struct Lock {
+        const char* name;
+        esp_pm_lock_type_t type;
+        esp_pm_lock_handle_t handle;
+        uint8_t depth;
+        uint32_t holds;
+        uint64_t totalUs;
+        uint32_t maxUs;
+        int64_t since;
+    };
+
+    // Typical ESP32 draw (mA) used for the estimate
+    static constexpr float I_CPU_MAX   = 50.0f;  // 240 MHz, modem sleep
+    static constexpr float I_CPU_MIN   = 22.0f;  // 80 MHz, modem sleep
+    static constexpr float I_AUTO_IDLE = 3.0f;   // auto light sleep between ticks
+
+    static Lock* locks() {
+        static Lock l[LOCK_COUNT] = {
+            {"uart_rx", ESP_PM_NO_LIGHT_SLEEP, nullptr, 0, 0, 0, 0, 0},
+            {"tls",     ESP_PM_CPU_FREQ_MAX,   nullptr, 0, 0, 0, 0, 0},
+            {"ota",     ESP_PM_CPU_FREQ_MAX,   nullptr, 0, 0, 0, 0, 0},
+            {"oled",    ESP_PM_APB_FREQ_MAX,   nullptr, 0, 0, 0, 0, 0},
+        };
+        return l;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    struct State {
+        bool idfPm;           // esp_pm_configure() succeeded
+        bool started;
+        uint8_t cpuMaxHolders;
+        int64_t startUs;
+        int64_t cpuMaxSince;
+        uint64_t cpuMaxUs;    // total time with a full-speed lock held
+    };
+
+    static State& state() {
+        static State s = {false, false, 0, 0, 0, 0};
+        return s;
+    }
+
+    static bool needsFullCpu(const Lock& l) {
+        return l.type == ESP_PM_CPU_FREQ_MAX;
+    }
+
+public:
+    static void begin() {
+        State& st = state();
+        st.startUs = esp_timer_get_time();
+        st.started = true;
+
+#if POWER_MGMT_ENABLED
+        esp_pm_config_esp32_t cfg;
+        cfg.max_freq_mhz = CPU_FREQ_MAX_MHZ;
+        cfg.min_freq_mhz = CPU_FREQ_MIN_MHZ;
+        cfg.light_sleep_enable = true;
+
+        esp_err_t err = esp_pm_configure(&cfg);
+        st.idfPm = (err == ESP_OK);
+
+        if (st.idfPm) {
+            Lock* l = locks();
+            for (int i = 0; i < LOCK_COUNT; i++) {
+                esp_pm_lock_create(l[i].type, 0, l[i].name, &l[i].handle);
+            }
+            Serial.printf("⚡ Power management: DVFS %d-%d MHz + auto light sleep\n",
+                          CPU_FREQ_MIN_MHZ, CPU_FREQ_MAX_MHZ);
+        } else {
+            // Stock Arduino core is built without CONFIG_PM_ENABLE
+            setCpuFrequencyMhz(CPU_FREQ_MIN_MHZ);
+            Serial.printf("⚡ esp_pm unavailable (%s) - manual DVFS %d/%d MHz\n",
+                          esp_err_to_name(err), CPU_FREQ_MIN_MHZ, CPU_FREQ_MAX_MHZ);
+        }
+#endif
+    }
+
+    // Modem sleep: radio wakes for every DTIM beacon only
+    static void enableModemSleep() {
+#if POWER_MGMT_ENABLED
+        WiFi.setSleep(WIFI_PS_MIN_MODEM);
+#endif
+    }
+
+    static void acquire(Id id) {
+        State& st = state();
+        if (!st.started) return;
+
+        Lock& l = locks()[id];
+        int64_t now = esp_timer_get_time();
+        bool raiseCpu = false;
+
+        portENTER_CRITICAL(&mux());
+        if (l.depth++ == 0) {
+            l.since = now;
+            l.holds++;
+            if (needsFullCpu(l) && st.cpuMaxHolders++ == 0) {
+                st.cpuMaxSince = now;
+                raiseCpu = true;
+            }
+        }
+        portEXIT_CRITICAL(&mux());
+
+        if (st.idfPm) {
+            esp_pm_lock_acquire(l.handle);
+        } else if (raiseCpu) {
+            setCpuFrequencyMhz(CPU_FREQ_MAX_MHZ);
+        }
+    }
+
+    static void release(Id id) {
+        State& st = state();
+        if (!st.started) return;
+
+        Lock& l = locks()[id];
+        int64_t now = esp_timer_get_time();
+        bool lowerCpu = false;
+
+        portENTER_CRITICAL(&mux());
+        if (l.depth > 0 && --l.depth == 0) {
+            uint32_t held = (uint32_t)(now - l.since);
+            l.totalUs += held;
+            if (held > l.maxUs) l.maxUs = held;
+            if (needsFullCpu(l) && st.cpuMaxHolders > 0 && --st.cpuMaxHolders == 0) {
+                st.cpuMaxUs += now - st.cpuMaxSince;
+                lowerCpu = true;
+            }
+        }
+        portEXIT_CRITICAL(&mux());
+
+        if (st.idfPm) {
+            esp_pm_lock_release(l.handle);
+        } else if (lowerCpu) {
+            setCpuFrequencyMhz(CPU_FREQ_MIN_MHZ);
+        }
+    }
+
+    // Fraction of uptime spent at full CPU speed
+    static float cpuMaxDuty() {
+        State& st = state();
+        int64_t now = esp_timer_get_time();
+        int64_t elapsed = now - st.startUs;
+        if (elapsed <= 0) return 0;
+        uint64_t busy = st.cpuMaxUs + (st.cpuMaxHolders ? now - st.cpuMaxSince : 0);
+        return (float)busy / (float)elapsed;
+    }
+
+    // Fraction of uptime with auto light sleep blocked (UART_RX held)
+    static float noSleepDuty() {
+        State& st = state();
+        const Lock& l = locks()[UART_RX];
+        int64_t now = esp_timer_get_time();
+        int64_t elapsed = now - st.startUs;
+        if (elapsed <= 0) return 0;
+        portENTER_CRITICAL(&mux());
+        uint64_t held = l.totalUs + (l.depth ? now - l.since : 0);
+        portEXIT_CRITICAL(&mux());
+        return min(1.0f, (float)held / (float)elapsed);
+    }
+
+    // Estimated average ESP32 draw (mA), excluding sensors and radio TX
+    static float estimatedCurrentMa() {
+        float duty = cpuMaxDuty();
+        float idle = I_CPU_MIN;
+        if (state().idfPm) {
+            float awake = noSleepDuty();
+            idle = awake * I_CPU_MIN + (1.0f - awake) * I_AUTO_IDLE;
+        }
+        return duty * I_CPU_MAX + (1.0f - duty) * idle;
+    }
+
+    static void printStats() {
+        Serial.printf("⚡ Power: %.1f mA est | full-speed duty %.2f%% | %s\n",
+                      estimatedCurrentMa(), cpuMaxDuty() * 100.0f,
+                      state().idfPm ? "esp_pm" : "manual DVFS");
+        Lock* l = locks();
+        for (int i = 0; i < LOCK_COUNT; i++) {
+            Serial.printf("   %-8s holds:%6lu total:%8lums max:%6lums\n", l[i].name,
+                          (unsigned long)l[i].holds, (unsigned long)(l[i].totalUs / 1000),
+                          (unsigned long)(l[i].maxUs / 1000));
+        }
+    }
+
+    static void writeJson(Print& out) {
+        out.printf("{\"mode\":\"%s\",\"est_current_ma\":%.2f,\"cpu_max_duty\":%.4f,\"locks\":{",
+                   state().idfPm ? "esp_pm" : "manual", estimatedCurrentMa(), cpuMaxDuty());
+        Lock* l = locks();
+        for (int i = 0; i < LOCK_COUNT; i++) {
+            out.printf("%s\"%s\":{\"holds\":%lu,\"total_ms\":%lu,\"max_ms\":%lu}",
+                       i ? "," : "", l[i].name, (unsigned long)l[i].holds,
+                       (unsigned long)(l[i].totalUs / 1000), (unsigned long)(l[i].maxUs / 1000));
+        }
+        out.print("}}");
+    }
+};
+
+// Scoped lock: PowerLockGuard guard(PowerLocks::TLS);
+class PowerLockGuard {
+private:
+    PowerLocks::Id id;
+
+public:
+    explicit PowerLockGuard(PowerLocks::Id lockId) : id(lockId) { PowerLocks::acquire(id); }
+    ~PowerLockGuard() { PowerLocks::release(id); }
+    PowerLockGuard(const PowerLockGuard&) = delete;
+    PowerLockGuard& operator=(const PowerLockGuard&) = delete;
+};
@@ -0,0 +1,280 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <esp_sleep.h>
+#include <esp_private/esp_clk.h>
+#include "config.h"
+
+// -----------------------------------
+// Compact sample kept in RTC slow memory (16 bytes)
+// -----------------------------------
+struct LowPowerSample {
+    uint32_t clockS;     // device-relative seconds (see PowerManager::clockS)
+    uint16_t pm1_0;
+    uint16_t pm2_5;
+    uint16_t pm10;
+    uint16_t tvoc;       // ppb, 0xFFFF = not available
+    int16_t  temp_x10;   // °C * 10, INT16_MIN = not available
+    uint8_t  hum;        // %RH, 0xFF = not available
+    uint8_t  battery;    // %
+};
+
+// -----------------------------------
+// Power Budget Model
+// Rough average-current estimate per configuration. Currents are typical
+// datasheet values for this board; measured awake time replaces the
+// estimate once a cycle has run.
+// -----------------------------------
+namespace PowerBudget {
+
+// Typical currents (mA)
+constexpr float I_CPU_ACTIVE  = 45.0f;   // ESP32 @ 240 MHz, radio off
+constexpr float I_WIFI_ACTIVE = 120.0f;  // association + TLS upload (average)
+constexpr float I_PM_FAN      = 90.0f;   // ZH07 fan + laser running
+constexpr float I_PM_SLEEP    = 0.02f;   // ZH07 dormant
+constexpr float I_TVOC        = 33.0f;   // AGS02MA heater (always powered)
+constexpr float I_OLED_ON     = 10.0f;
+constexpr float I_DEEP_SLEEP  = 0.15f;   // ESP32 RTC + regulator quiescent
+constexpr float I_LIGHT_SLEEP = 0.9f;
+
+struct Config {
+    uint32_t wakeIntervalS;  // 0 = always-on (no duty cycling)
+    uint8_t  flushEvery;     // wakeups per WiFi upload batch
+    uint32_t awakeMs;        // sensor warm-up + read per wakeup
+    uint32_t wifiMs;         // connect + upload per flush
+    bool     lightSleep;
+    bool     oledOn;
+};
+
+// Average draw in mAh per hour (== average mA)
+inline float mAhPerHour(const Config& c) {
+    if (c.wakeIntervalS == 0) {
+        // Current firmware behaviour: everything on, WiFi associated
+        return I_CPU_ACTIVE + I_PM_FAN + I_TVOC + I_OLED_ON + 0.3f * I_WIFI_ACTIVE;
+    }
+
+    float periodMs = c.wakeIntervalS * 1000.0f;
+    float awakeMs  = min((float)c.awakeMs, periodMs);
+    float wifiMs   = c.flushEvery ? (float)c.wifiMs / c.flushEvery : 0.0f;
+    float sleepMs  = max(0.0f, periodMs - awakeMs - wifiMs);
+    float iSleep   = c.lightSleep ? I_LIGHT_SLEEP : I_DEEP_SLEEP;
+
+    float charge = awakeMs * (I_CPU_ACTIVE + I_PM_FAN)
+                 + wifiMs  * (I_CPU_ACTIVE + I_WIFI_ACTIVE)
+                 + sleepMs * (iSleep + I_PM_SLEEP);
+    float avg = charge / periodMs + I_TVOC + (c.oledOn ? I_OLED_ON : 0.0f);
+    return avg;
+}
+
+inline float batteryLifeHours(const Config& c, float capacityMah = BATTERY_CAPACITY_MAH) {
+    float draw = mAhPerHour(c);
+    return draw > 0 ? capacityMah / draw : 0;
+}
+
+// Print a comparison table, highlighting the active configuration
+inline void printTable(const Config& active) {
+    static const uint32_t intervals[] = {0, 30, 60, 300, 900};
+    static const uint8_t flushes[] = {1, 10};
+
+    Serial.println("🔋 Power budget (mAh/h | est. life):");
+    for (uint32_t interval : intervals) {
+        for (uint8_t flush : flushes) {
+            if (interval == 0 && flush != 1) continue;
+            Config c = active;
+            c.wakeIntervalS = interval;
+            c.flushEvery = flush;
+            c.oledOn = (interval == 0);
+            bool isActive = (interval == active.wakeIntervalS && flush == active.flushEvery);
+            Serial.printf("   %s %4lus x%-2u : %6.2f mAh/h | %6.1f h\n",
+                          isActive ? ">" : " ", (unsigned long)interval, flush,
+                          mAhPerHour(c), batteryLifeHours(c));
+        }
+    }
+}
+
+} // namespace PowerBudget
+
+// -----------------------------------
+// Power Manager
+// Duty-cycled battery mode: wake on timer (or touch), sample into an RTC
+// buffer, flush over WiFi every N samples, then sleep again. Times come
+// from the RTC clock, which keeps counting through both sleep modes: a
+// touch that ends a sleep early neither moves the device clock ahead nor
+// delays the next sample.
+// -----------------------------------
+class PowerManager {
+public:
+    static constexpr uint8_t BUFFER_CAPACITY = 64;   // 1 KB of RTC slow memory
+
+    struct Settings {
+        bool     enabled        = LOW_POWER_MODE;
+        uint32_t wakeIntervalS  = LP_WAKE_INTERVAL_S;
+        uint8_t  flushEvery     = LP_FLUSH_EVERY;
+        uint32_t pmWarmupMs     = LP_PM_WARMUP_MS;
+    };
+
+private:
+    struct RtcState {
+        uint32_t magic;
+        uint64_t originUs;        // RTC clock when the buffer was created
+        uint64_t nextSampleUs;    // RTC clock of the next timer wakeup
+        uint32_t wakeCount;       // sampling wakeups (touch wakes not counted)
+        uint32_t lastAwakeMs;     // wake-to-sleep time of the previous sampling cycle
+        uint32_t lastWifiMs;      // connect + upload time of the last flush
+        uint8_t  count;
+        uint8_t  dropped;
+        LowPowerSample samples[BUFFER_CAPACITY];
+    };
+
+    static constexpr uint32_t RTC_MAGIC = 0x4C505332;  // "LPS2"
+
+    static RtcState& rtc() {
+        RTC_DATA_ATTR static RtcState state;
+        return state;
+    }
+
+    static unsigned long& wakeMillis() {
+        static unsigned long t = 0;
+        return t;
+    }
+
+    // This wakeup took a sample (touch-only wakeups do not)
+    static bool& sampling() {
+        static bool b = false;
+        return b;
+    }
+
+    // Counts through resets and sleep; only power-on restarts it
+    static uint64_t rtcUs() { return esp_clk_rtc_time(); }
+
+public:
+    static Settings& settings() {
+        static Settings s;
+        return s;
+    }
+
+    // Load overrides from /config.json (keys: low_power, lp_wake_interval_s, lp_flush_every)
+    static void loadConfig() {
+        if (!LittleFS.exists("/config.json")) return;
+        File file = LittleFS.open("/config.json", "r");
+        if (!file) return;
+
+        StaticJsonDocument<1024> doc;
+        DeserializationError err = deserializeJson(doc, file);
+        file.close();
+        if (err) return;
+
+        Settings& s = settings();
+        s.enabled       = doc["low_power"] | s.enabled;
+        s.wakeIntervalS = doc["lp_wake_interval_s"] | s.wakeIntervalS;
+        s.flushEvery    = doc["lp_flush_every"] | s.flushEvery;
+        if (s.flushEvery == 0) s.flushEvery = 1;
+    }
+
+    // Call first thing after wake/boot
+    static void begin() {
+        wakeMillis() = millis();
+        sampling() = false;
+        RtcState& st = rtc();
+        if (st.magic != RTC_MAGIC || esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+            memset(&st, 0, sizeof(st));
+            st.magic = RTC_MAGIC;
+            st.originUs = rtcUs();
+            st.nextSampleUs = st.originUs;
+        }
+    }
+
+    // A sampling wakeup starts: counts toward flushEvery, and the next
+    // one is due a full interval after this one
+    static void beginSample() {
+        RtcState& st = rtc();
+        st.wakeCount++;
+        st.nextSampleUs = rtcUs() + settings().wakeIntervalS * 1000000ULL;
+        sampling() = true;
+    }
+
+    static bool enabled() { return settings().enabled; }
+    static bool wokeByTouch() { return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0; }
+    static bool useLightSleep() { return settings().wakeIntervalS < LP_LIGHT_SLEEP_MAX_S; }
+
+    // Device-relative clock (seconds since the buffer was created)
+    static uint32_t clockS() {
+        return (uint32_t)((rtcUs() - rtc().originUs) / 1000000);
+    }
+
+    static bool flushDue() {
+        return (rtc().wakeCount % settings().flushEvery) == 0 || rtc().count >= BUFFER_CAPACITY;
+    }
+
+    static void store(const LowPowerSample& sample) {
+        RtcState& st = rtc();
+        if (st.count >= BUFFER_CAPACITY) {
+            // Full (WiFi unreachable for a while) - drop the oldest
+            memmove(&st.samples[0], &st.samples[1], sizeof(LowPowerSample) * (BUFFER_CAPACITY - 1));
+            st.count--;
+            st.dropped++;
+        }
+        st.samples[st.count++] = sample;
+    }
+
+    static const LowPowerSample* samples() { return rtc().samples; }
+    static uint8_t sampleCount() { return rtc().count; }
+    static const LowPowerSample* latest() { return rtc().count ? &rtc().samples[rtc().count - 1] : nullptr; }
+
+    // Drop the first n samples after a (partial) flush
+    static void consumeSamples(uint8_t n) {
+        RtcState& st = rtc();
+        if (n >= st.count) {
+            st.count = 0;
+            st.dropped = 0;
+            return;
+        }
+        memmove(&st.samples[0], &st.samples[n], sizeof(LowPowerSample) * (st.count - n));
+        st.count -= n;
+    }
+
+    static void recordWifiTime(uint32_t ms) { rtc().lastWifiMs = ms; }
+
+    static PowerBudget::Config budgetConfig() {
+        const Settings& s = settings();
+        PowerBudget::Config c;
+        c.wakeIntervalS = s.enabled ? s.wakeIntervalS : 0;
+        c.flushEvery    = s.flushEvery;
+        c.awakeMs       = rtc().lastAwakeMs ? rtc().lastAwakeMs : s.pmWarmupMs + 500;
+        c.wifiMs        = rtc().lastWifiMs ? rtc().lastWifiMs : 3000;
+        c.lightSleep    = useLightSleep();
+        c.oledOn        = !s.enabled;
+        return c;
+    }
+
+    // Log wake-to-sleep time, arm wake sources and sleep until the next
+    // sample is due. Deep sleep does not return; light sleep returns on
+    // the next wakeup.
+    static void sleep() {
+        RtcState& st = rtc();
+        uint32_t awakeMs = millis() - wakeMillis();
+        if (sampling()) st.lastAwakeMs = awakeMs;
+
+        Serial.printf("⏱️  Cycle #%lu%s: awake %lums | buffered %u | dropped %u | est %.2f mAh/h\n",
+                      (unsigned long)st.wakeCount, sampling() ? "" : " (touch)",
+                      (unsigned long)awakeMs, st.count, st.dropped,
+                      PowerBudget::mAhPerHour(budgetConfig()));
+        Serial.flush();
+
+        // Overran the interval (slow flush): sample again shortly
+        uint64_t now = rtcUs();
+        uint64_t sleepUs = st.nextSampleUs > now + 1000000ULL ? st.nextSampleUs - now : 1000000ULL;
+
+        esp_sleep_enable_timer_wakeup(sleepUs);
+        esp_sleep_enable_ext0_wakeup((gpio_num_t)TOUCH_PIN, 1);  // TTP223B drives high on touch
+
+        if (useLightSleep()) {
+            esp_light_sleep_start();
+            wakeMillis() = millis();
+            sampling() = false;
+            return;
+        }
+        esp_deep_sleep_start();
+    }
+};
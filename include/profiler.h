@@ -0,0 +1,198 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+#include "config.h"
+
+// -----------------------------------
+// Scope Profiler
+// PROFILE_SCOPE(ID) times the rest of the enclosing block in CPU cycles
+// (Xtensa CCOUNT) into a fixed 32-bucket log2 histogram per scope - no
+// allocation, one spinlock per sample. Compiled out entirely unless
+// PROFILING_ENABLED is 1 (config.h or -D PROFILING_ENABLED=1).
+//
+// CCOUNT is per core and runs at the current CPU clock (DVFS): a sample
+// whose task migrated cores mid-scope is discarded (counted as
+// "migrated"), and times in us are approximate; cycles are what the
+// histogram stores. Dumped hourly with the other stats and at
+// /api/profile (?reset=1 clears).
+// -----------------------------------
+#if PROFILING_ENABLED
+
+class Profiler {
+public:
+    enum Id {
+        PM_READ,        // ZH07 frame wait + parse
+        TVOC_READ,      // AGS02MA I2C read
+        DHT_READ,       // DHT bit-banged read (temperature + humidity)
+        BATTERY,        // multi-sample ADC + EMA
+        AQI,            // SampleFusion::fuse
+        LOG_PRINTF,     // sample log line over Serial
+        OLED_RENDER,    // draw one view (includes the push)
+        OLED_PUSH,      // dirty pages over I2C
+        WEB_LOOP,       // WebServerModule::loop
+        HTTP_POST,      // cloud upload (TLS + request)
+        TREND,          // trend history update
+        STREAM_STATS,   // StreamStats::add
+        ID_COUNT
+    };
+
+    static constexpr int BUCKETS = 32;   // bucket b: [2^b, 2^(b+1)) cycles
+
+private:
+    struct Scope {
+        uint32_t count;
+        uint32_t maxCycles;
+        uint64_t totalCycles;
+        uint32_t hist[BUCKETS];
+    };
+
+    static Scope* scopes() {
+        static Scope s[ID_COUNT];
+        return s;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+    static volatile uint32_t& migrated() {
+        static volatile uint32_t n = 0;
+        return n;
+    }
+
+    // Upper bound (cycles) of the bucket holding the p-th percentile,
+    // capped at the observed max
+    static uint32_t percentile(const Scope& s, uint32_t pct) {
+        if (!s.count) return 0;
+        uint32_t want = (uint64_t)s.count * pct / 100, seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += s.hist[b];
+            if (seen > want) return min(b >= 31 ? 0xFFFFFFFFu : (2u << b) - 1, s.maxCycles);
+        }
+        return s.maxCycles;
+    }
+
+    static uint32_t toUs(uint64_t cycles, uint32_t mhz) {
+        return (uint32_t)(cycles / (mhz ? mhz : 1));
+    }
+
+public:
+    static const char* name(Id id) {
+        static const char* names[ID_COUNT] = {
+            "pm_read", "tvoc_read", "dht_read", "battery", "aqi", "log_printf",
+            "oled_render", "oled_push", "web_loop", "http_post", "trend",
+            "stream_stats",
+        };
+        return names[id];
+    }
+
+    static inline uint32_t IRAM_ATTR cycles() {
+#if defined(__XTENSA__)
+        uint32_t c;
+        __asm__ __volatile__("rsr %0, ccount" : "=a"(c));
+        return c;
+#else
+        return (uint32_t)(micros() * CPU_FREQ_MAX_MHZ);   // host build: virtual clock
+#endif
+    }
+
+    static void record(Id id, uint32_t c) {
+        int b = 31 - __builtin_clz(c | 1);
+        Scope& s = scopes()[id];
+        portENTER_CRITICAL(&mux());
+        s.count++;
+        s.totalCycles += c;
+        if (c > s.maxCycles) s.maxCycles = c;
+        s.hist[b]++;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void reset() {
+        portENTER_CRITICAL(&mux());
+        memset(scopes(), 0, sizeof(Scope) * ID_COUNT);
+        migrated() = 0;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    class Timer {
+        Id id;
+        BaseType_t core;
+        uint32_t start;
+    public:
+        explicit Timer(Id i) : id(i), core(xPortGetCoreID()), start(cycles()) {}
+        ~Timer() {
+            uint32_t c = cycles() - start;
+            if (xPortGetCoreID() == core) record(id, c);
+            else migrated()++;
+        }
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+    static void printStats() {
+        uint32_t mhz = getCpuFrequencyMhz();
+        Serial.printf("⏱️ Profile (cycles; us at %lu MHz):\n", (unsigned long)mhz);
+        Serial.println("   scope              n      avg      p50      p99      max   avg_us   max_us");
+        for (int i = 0; i < ID_COUNT; i++) {
+            Scope s;
+            portENTER_CRITICAL(&mux());
+            s = scopes()[i];
+            portEXIT_CRITICAL(&mux());
+            if (!s.count) continue;
+            uint32_t avg = s.totalCycles / s.count;
+            Serial.printf("   %-12s %7lu %8lu %8lu %8lu %8lu %8lu %8lu\n", name((Id)i),
+                          (unsigned long)s.count, (unsigned long)avg,
+                          (unsigned long)percentile(s, 50), (unsigned long)percentile(s, 99),
+                          (unsigned long)s.maxCycles, (unsigned long)toUs(avg, mhz),
+                          (unsigned long)toUs(s.maxCycles, mhz));
+        }
+        if (migrated()) Serial.printf("   (%lu samples discarded: core migration)\n", (unsigned long)migrated());
+    }
+
+    // hist: non-empty buckets as [log2_lower_bound, count]
+    static void writeJson(Print& out) {
+        uint32_t mhz = getCpuFrequencyMhz();
+        out.printf("{\"enabled\":true,\"cpu_mhz\":%lu,\"migrated\":%lu,\"scopes\":{",
+                   (unsigned long)mhz, (unsigned long)migrated());
+        for (int i = 0; i < ID_COUNT; i++) {
+            Scope s;
+            portENTER_CRITICAL(&mux());
+            s = scopes()[i];
+            portEXIT_CRITICAL(&mux());
+            out.printf("%s\"%s\":{\"count\":%lu,\"avg_cycles\":%lu,\"p50_cycles\":%lu,"
+                       "\"p99_cycles\":%lu,\"max_cycles\":%lu,\"avg_us\":%lu,\"hist\":[",
+                       i ? "," : "", name((Id)i), (unsigned long)s.count,
+                       (unsigned long)(s.count ? s.totalCycles / s.count : 0),
+                       (unsigned long)percentile(s, 50), (unsigned long)percentile(s, 99),
+                       (unsigned long)s.maxCycles,
+                       (unsigned long)toUs(s.count ? s.totalCycles / s.count : 0, mhz));
+            bool first = true;
+            for (int b = 0; b < BUCKETS; b++) {
+                if (!s.hist[b]) continue;
+                out.printf("%s[%d,%lu]", first ? "" : ",", b, (unsigned long)s.hist[b]);
+                first = false;
+            }
+            out.print("]}");
+        }
+        out.print("}}");
+    }
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(id) Profiler::Timer PROFILE_CONCAT(profScope_, __LINE__)(Profiler::id)
+
+#else  // !PROFILING_ENABLED
+
+class Profiler {
+public:
+    static void reset() {}
+    static void printStats() {}
+    static void writeJson(Print& out) { out.print("{\"enabled\":false}"); }
+};
+
+#define PROFILE_SCOPE(id) do { } while (0)
+
+#endif
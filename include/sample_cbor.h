@@ -0,0 +1,136 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "sample_json.h"
+
+// -----------------------------------
+// Sample CBOR (RFC 8949)
+// The SampleJson record as a CBOR map with the same keys: integers in
+// their shortest form, floats as float32, NAN as null. About half the
+// size of the JSON body and cheaper to produce (no decimal formatting).
+// Served by /sensor_data for "Accept: application/cbor" and used for
+// uploads when config.json sets "upload_format": "cbor".
+// -----------------------------------
+namespace SampleCbor {
+
+using Fields = SampleJson::Fields;
+
+constexpr size_t MAX_LEN = 272;   // worst case ~262: longest category, age field, day stats and quality
+constexpr const char* CONTENT_TYPE = "application/cbor";
+
+class Writer {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok = true;
+
+    enum Major : uint8_t { UINT = 0 << 5, NINT = 1 << 5, TEXT = 3 << 5, ARRAY = 4 << 5, MAP = 5 << 5 };
+
+    // Major type + argument, shortest encoding, big-endian
+    void head(uint8_t major, uint64_t v) {
+        uint8_t info, extra;
+        if (v < 24)               { info = (uint8_t)v; extra = 0; }
+        else if (v <= 0xFF)       { info = 24; extra = 1; }
+        else if (v <= 0xFFFF)     { info = 25; extra = 2; }
+        else if (v <= 0xFFFFFFFF) { info = 26; extra = 4; }
+        else                      { info = 27; extra = 8; }
+        uint8_t buf[9];
+        buf[0] = major | info;
+        for (uint8_t i = 0; i < extra; i++) buf[extra - i] = (uint8_t)(v >> (8 * i));
+        raw(buf, 1 + extra);
+    }
+
+public:
+    Writer(uint8_t* out, size_t cap) : p(out), end(out + cap) {}
+
+    void raw(const uint8_t* s, size_t n) {
+        if (!ok || (size_t)(end - p) < n) {
+            ok = false;
+            return;
+        }
+        memcpy(p, s, n);
+        p += n;
+    }
+
+    void map(uint8_t entries) { head(MAP, entries); }
+
+    void array(uint8_t items) { head(ARRAY, items); }
+
+    void text(const char* s) {
+        size_t n = strlen(s);
+        head(TEXT, n);
+        raw((const uint8_t*)s, n);
+    }
+
+    // Key literal: head byte and length known at compile time
+    template <size_t N>
+    void key(const char (&s)[N]) {
+        static_assert(N - 1 < 24, "CBOR key needs a one-byte head");
+        uint8_t h = TEXT | (uint8_t)(N - 1);
+        raw(&h, 1);
+        raw((const uint8_t*)s, N - 1);
+    }
+
+    void null() {
+        static const uint8_t n = 0xF6;
+        raw(&n, 1);
+    }
+
+    void integer(long long v) {
+        if (v < 0) head(NINT, (uint64_t)(-1 - v));
+        else head(UINT, (uint64_t)v);
+    }
+
+    void real(float v) {
+        if (isnan(v)) {
+            null();
+            return;
+        }
+        uint32_t bits;
+        memcpy(&bits, &v, 4);
+        uint8_t buf[5] = {0xFA, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+                          (uint8_t)(bits >> 8), (uint8_t)bits};
+        raw(buf, 5);
+    }
+
+    size_t finish(const uint8_t* start) const { return ok ? p - start : 0; }
+};
+
+// Bytes written, 0 if the record did not fit
+inline size_t write(uint8_t* out, size_t cap, const Fields& f) {
+    Writer w(out, cap);
+    bool pm = f.quality[SENSOR_PM] != QUALITY_MISSING;
+    bool good = SampleJson::allGood(f);
+    w.map(9 + (f.ageKey ? 1 : 0) + (f.day.valid ? 1 : 0) + (good ? 0 : 1));
+    w.key("pm1_0");        if (pm) w.integer(f.pm1); else w.null();
+    w.key("pm2_5");        if (pm) w.integer(f.pm25); else w.null();
+    w.key("pm10");         if (pm) w.integer(f.pm10); else w.null();
+    w.key("tvoc");         w.real(f.tvoc);
+    w.key("temperature");  w.real(f.temp);
+    w.key("humidity");     w.real(f.hum);
+    w.key("aqi");          if (pm) w.integer(f.aqi); else w.null();
+    w.key("aqi_category"); if (pm) w.text(IAQ::getAQICategory(f.aqi)); else w.null();
+    w.key("battery");      w.integer(f.battery);
+    if (f.ageKey) {
+        w.text(f.ageKey);
+        w.integer(f.age);
+    }
+    if (f.day.valid) {
+        w.key("stats_day");      w.map(4);
+        w.key("pm2_5_mean");     w.real(f.day.pm25Mean);
+        w.key("pm2_5_p95");      w.real(f.day.pm25P95);
+        w.key("pm2_5_over_min"); w.integer(f.day.pm25OverMin);
+        w.key("aqi_max");        w.integer(f.day.aqiMax);
+    }
+    if (!good) {
+        w.key("quality");
+        w.map(SENSOR_COUNT);
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            w.text(SensorHealth::sensorName((SensorId)i));
+            w.text(SensorHealth::qualityName(f.quality[i]));
+        }
+    }
+    return w.finish(out);
+}
+
+} // namespace SampleCbor
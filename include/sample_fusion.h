@@ -0,0 +1,179 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+#include "sensor_sample.h"
+#include "iaq_calculator.h"
+#include "pm_calibration.h"
+#include "adaptive_sampler.h"
+#include "sensor_health.h"
+#include "async_log.h"
+
+// -----------------------------------
+// Sample Fusion
+// Turns one cycle of raw bus readings into a FusedSample: plausibility
+// screening with a last-good fallback and a quality per sensor,
+// humidity-corrected PM, AQI + category, adaptive interval. Shared by
+// SensorPipeline (fusion task) and the native simulator, so it does no
+// I/O itself.
+//
+// A failed, out-of-range or jumping reading is replaced by the sensor's
+// last good value (QUALITY_HELD) for up to HEALTH_HOLD_MS; after that
+// the value is NAN - or, for PM, flagged QUALITY_MISSING - instead of
+// being repeated for ever.
+// -----------------------------------
+class SampleFusion {
+public:
+    struct Input {
+        bool havePM;        // UART answered this cycle
+        bool pmOk;          // ...with a valid frame
+        PMData pm;
+        bool haveTVOC;      // I2C answered (value may still be NAN)
+        bool tvocFresh;     // ...with a new reading, not the sensor's cache
+        float tvoc;
+        bool haveClimate;   // DHT answered
+        float temp;
+        float hum;
+        int battery;
+    };
+
+private:
+    // Last accepted value of a channel and when it was read
+    struct Held {
+        float v = NAN;
+        uint32_t ms = 0;
+
+        void set(float x, uint32_t tMs) {
+            v = x;
+            ms = tMs;
+        }
+
+        float at(uint32_t tMs) const {
+            return tMs - ms <= HEALTH_HOLD_MS ? v : NAN;
+        }
+    };
+
+    AdaptiveSampler &sampler;
+    ChannelScreen screen[SensorHealth::CHANNELS] = {
+        ChannelScreen(SensorHealth::limits(SensorHealth::CH_PM25)),
+        ChannelScreen(SensorHealth::limits(SensorHealth::CH_PM10)),
+        ChannelScreen(SensorHealth::limits(SensorHealth::CH_TVOC)),
+        ChannelScreen(SensorHealth::limits(SensorHealth::CH_TEMP)),
+        ChannelScreen(SensorHealth::limits(SensorHealth::CH_HUM)),
+    };
+    PMData lastValidPM = {0, 0, 0};
+    Held pmHeld;          // PM2.5 of lastValidPM
+    Held tvoc, temp, hum;
+    int alertCategory = -1;   // category as announced (with hysteresis)
+
+    // One reading through its channel screen; counts rejections
+    ChannelScreen::Verdict screenValue(SensorHealth::Channel ch, SensorId id, float v, uint32_t tMs) {
+        ChannelScreen::Verdict verdict = screen[ch].check(v, tMs);
+        if (!ChannelScreen::usable(verdict)) SensorHealth::recordRejected(id, verdict);
+        return verdict;
+    }
+
+    // Quality of a channel that was not refreshed this cycle
+    static Quality heldQuality(const Held& h, uint32_t tMs) {
+        return isnan(h.at(tMs)) ? QUALITY_MISSING : QUALITY_HELD;
+    }
+
+    Quality fusePM(const Input& in, uint32_t tMs, FusedSample& s) {
+        Quality q = QUALITY_HELD;
+        s.pmValid = false;
+        if (in.havePM && in.pmOk) {
+            ChannelScreen::Verdict a = screenValue(SensorHealth::CH_PM25, SENSOR_PM, in.pm.pm2_5, tMs);
+            ChannelScreen::Verdict b = screenValue(SensorHealth::CH_PM10, SENSOR_PM, in.pm.pm10, tMs);
+            bool stuck = a == ChannelScreen::STUCK && b == ChannelScreen::STUCK;
+            SensorHealth::setStuck(SENSOR_PM, stuck);
+            if (ChannelScreen::usable(a) && ChannelScreen::usable(b)) {
+                screen[SensorHealth::CH_PM25].accept(in.pm.pm2_5);
+                screen[SensorHealth::CH_PM10].accept(in.pm.pm10);
+                lastValidPM = in.pm;
+                pmHeld.set(in.pm.pm2_5, tMs);
+                s.pmValid = true;
+                q = stuck ? QUALITY_SUSPECT : QUALITY_GOOD;
+            }
+        }
+        s.pmRaw = lastValidPM;
+        return q == QUALITY_HELD ? heldQuality(pmHeld, tMs) : q;
+    }
+
+    Quality fuseTVOC(const Input& in, uint32_t tMs, FusedSample& s) {
+        Quality q = QUALITY_HELD;
+        if (in.haveTVOC && in.tvocFresh && !isnan(in.tvoc)) {
+            ChannelScreen::Verdict v = screenValue(SensorHealth::CH_TVOC, SENSOR_TVOC, in.tvoc, tMs);
+            SensorHealth::setStuck(SENSOR_TVOC, v == ChannelScreen::STUCK);
+            if (ChannelScreen::usable(v)) {
+                screen[SensorHealth::CH_TVOC].accept(in.tvoc);
+                tvoc.set(in.tvoc, tMs);
+                q = v == ChannelScreen::STUCK ? QUALITY_SUSPECT : QUALITY_GOOD;
+            }
+        } else if (in.haveTVOC && isnan(in.tvoc)) {
+            tvoc.set(NAN, tMs);   // warming up or cache expired: nothing to hold
+        }
+        s.tvoc = tvoc.at(tMs);
+        return q == QUALITY_HELD ? heldQuality(tvoc, tMs) : q;
+    }
+
+    Quality fuseClimate(const Input& in, uint32_t tMs, FusedSample& s) {
+        Quality q = QUALITY_HELD;
+        if (in.haveClimate && !isnan(in.temp) && !isnan(in.hum)) {
+            ChannelScreen::Verdict a = screenValue(SensorHealth::CH_TEMP, SENSOR_CLIMATE, in.temp, tMs);
+            ChannelScreen::Verdict b = screenValue(SensorHealth::CH_HUM, SENSOR_CLIMATE, in.hum, tMs);
+            bool stuck = a == ChannelScreen::STUCK && b == ChannelScreen::STUCK;
+            SensorHealth::setStuck(SENSOR_CLIMATE, stuck);
+            if (ChannelScreen::usable(a)) {
+                screen[SensorHealth::CH_TEMP].accept(in.temp);
+                temp.set(in.temp, tMs);
+            }
+            if (ChannelScreen::usable(b)) {
+                screen[SensorHealth::CH_HUM].accept(in.hum);
+                hum.set(in.hum, tMs);
+            }
+            if (ChannelScreen::usable(a) && ChannelScreen::usable(b)) {
+                q = stuck ? QUALITY_SUSPECT : QUALITY_GOOD;
+            }
+        }
+        s.temp = temp.at(tMs);
+        s.hum = hum.at(tMs);
+        if (q != QUALITY_HELD) return q;
+        Quality qt = heldQuality(temp, tMs), qh = heldQuality(hum, tMs);
+        return qt > qh ? qt : qh;
+    }
+
+public:
+    explicit SampleFusion(AdaptiveSampler &adaptive) : sampler(adaptive) {}
+
+    // categoryChanged: the AQI moved AQI_CATEGORY_HYSTERESIS points past
+    // the edge of the last announced category
+    FusedSample fuse(uint32_t seq, uint32_t tMs, const Input& in, bool& categoryChanged) {
+        FusedSample s;
+        memset(&s, 0, sizeof(s));
+        s.seq = seq;
+        s.tMs = tMs;
+
+        s.quality[SENSOR_PM] = fusePM(in, tMs, s);
+        s.quality[SENSOR_TVOC] = fuseTVOC(in, tMs, s);
+        s.quality[SENSOR_CLIMATE] = fuseClimate(in, tMs, s);
+
+        // Same-tick humidity dries the PM reading before the AQI
+        s.pm = PMCalibration::apply(s.pmRaw, s.hum);
+
+        s.aqi = IAQ::calculateAQI(s.pm.pm2_5, s.pm.pm10);
+        s.aqi = IAQ::adjustAQIWithTVOC(s.aqi, s.tvoc);
+        s.category = IAQ::getAQICategory(s.aqi);
+        s.battery = in.battery;
+
+        // Next interval from rate of change
+        s.nextIntervalMs = sampler.update(tMs, s.pm.pm2_5, s.tvoc);
+        int category = IAQ::categoryWithHysteresis(s.aqi, alertCategory, AQI_CATEGORY_HYSTERESIS);
+        categoryChanged = alertCategory >= 0 && category != alertCategory;
+        if (categoryChanged) {
+            LOG_I("🚨 AQI category %s -> %s", IAQ::categoryName(alertCategory),
+                  IAQ::categoryName(category));
+        }
+        alertCategory = category;
+        return s;
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "iaq_calculator.h"
+#include "sensor_health.h"
+
+// -----------------------------------
+// Sample JSON
+// Serializes one reading straight into a caller buffer in a single pass:
+// precomputed key fragments, digit-by-digit integers and fixed-point
+// floats (round-half-even, same digits as printf "%.Nf"). Builds the
+// cloud upload body and the /sensor_data response - no DOM, no String,
+// no Print::printf (which mallocs past 64 chars on the ESP32 core).
+// NAN becomes null, as ArduinoJson wrote it. sample_cbor.h encodes the
+// same record in CBOR.
+// -----------------------------------
+namespace SampleJson {
+
+constexpr size_t MAX_LEN = 384;   // longest body ~340, with the age field, day stats and quality
+
+// Running day summary (stream_stats.h) sent with uploads
+struct DayStats {
+    bool valid = false;
+    float pm25Mean = NAN;
+    float pm25P95 = NAN;
+    long pm25OverMin = 0;   // minutes above STATS_PM25_LIMIT
+    int aqiMax = 0;
+};
+
+struct Fields {
+    int pm1;
+    int pm25;
+    int pm10;
+    float tvoc;
+    float temp;
+    float hum;
+    int aqi;
+    int battery;
+    const char* ageKey = nullptr;   // "sample_age_s" / "age_ms"; nullptr = omit
+    long age = 0;
+    DayStats day = {};              // !valid = omit
+    Quality quality[SENSOR_COUNT] = {};   // all good = omit; PM missing = null PM fields
+};
+
+inline bool allGood(const Fields& f) {
+    for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+        if (f.quality[i] != QUALITY_GOOD) return false;
+    }
+    return true;
+}
+
+class Writer {
+    char* p;
+    char* end;   // last usable byte (room for the NUL)
+    bool ok = true;
+
+public:
+    Writer(char* out, size_t cap) : p(out), end(out + (cap ? cap - 1 : 0)) {
+        if (!cap) ok = false;
+    }
+
+    template <size_t N>
+    void frag(const char (&s)[N]) { raw(s, N - 1); }
+
+    void raw(const char* s, size_t n) {
+        if (!ok || (size_t)(end - p) < n) {
+            ok = false;
+            return;
+        }
+        memcpy(p, s, n);
+        p += n;
+    }
+
+    void str(const char* s) {
+        // Keys and AQI categories are static ASCII without quotes/escapes
+        raw(s, strlen(s));
+    }
+
+    void unsignedInt(unsigned long long v) {
+        char tmp[20];
+        int n = 0;
+        do {
+            tmp[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        if (!ok || end - p < n) {
+            ok = false;
+            return;
+        }
+        while (n) *p++ = tmp[--n];
+    }
+
+    void integer(long long v) {
+        if (v < 0) {
+            raw("-", 1);
+            unsignedInt(0ULL - (unsigned long long)v);
+        } else {
+            unsignedInt(v);
+        }
+    }
+
+    void fixed(float v, int decimals) {
+        if (isnan(v) || isinf(v)) {
+            frag("null");
+            return;
+        }
+        static const double scale[] = {1, 10, 100, 1000};
+        double d = v;
+        if (fabs(d) >= 1e15 || decimals < 0 || decimals > 3) {
+            // Outside the fixed-point range (never a sensor value)
+            char tmp[48];
+            int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, d);
+            raw(tmp, n > 0 ? n : 0);
+            return;
+        }
+        long long q = llrint(d * scale[decimals]);
+        if (q < 0 || (q == 0 && signbit(d))) raw("-", 1);   // printf keeps "-0.0"
+        unsigned long long a = q < 0 ? 0ULL - (unsigned long long)q : q;
+        unsigned long long s = (unsigned long long)scale[decimals];
+        unsignedInt(a / s);
+        if (!decimals) return;
+        char frac[4];
+        unsigned long long f = a % s;
+        for (int i = decimals - 1; i >= 0; i--) {
+            frac[i] = '0' + f % 10;
+            f /= 10;
+        }
+        raw(".", 1);
+        raw(frac, decimals);
+    }
+
+    // Bytes written (excluding the NUL), 0 if it did not fit
+    size_t finish(char* start) {
+        if (!ok) return 0;
+        *p = '\0';
+        return p - start;
+    }
+};
+
+// Bytes written (excluding the NUL), 0 if the body did not fit
+inline size_t write(char* out, size_t cap, const Fields& f) {
+    Writer w(out, cap);
+    if (f.quality[SENSOR_PM] == QUALITY_MISSING) {
+        w.frag("{\"pm1_0\":null,\"pm2_5\":null,\"pm10\":null");
+    } else {
+        w.frag("{\"pm1_0\":");      w.integer(f.pm1);
+        w.frag(",\"pm2_5\":");      w.integer(f.pm25);
+        w.frag(",\"pm10\":");       w.integer(f.pm10);
+    }
+    w.frag(",\"tvoc\":");           w.fixed(f.tvoc, 2);
+    w.frag(",\"temperature\":");    w.fixed(f.temp, 1);
+    w.frag(",\"humidity\":");       w.fixed(f.hum, 1);
+    if (f.quality[SENSOR_PM] == QUALITY_MISSING) {
+        w.frag(",\"aqi\":null,\"aqi_category\":null");
+    } else {
+        w.frag(",\"aqi\":");            w.integer(f.aqi);
+        w.frag(",\"aqi_category\":\""); w.str(IAQ::getAQICategory(f.aqi));
+        w.frag("\"");
+    }
+    w.frag(",\"battery\":");        w.integer(f.battery);
+    if (f.ageKey) {
+        w.frag(",\"");
+        w.str(f.ageKey);
+        w.frag("\":");
+        w.integer(f.age);
+    }
+    if (f.day.valid) {
+        w.frag(",\"stats_day\":{\"pm2_5_mean\":"); w.fixed(f.day.pm25Mean, 1);
+        w.frag(",\"pm2_5_p95\":");                  w.fixed(f.day.pm25P95, 1);
+        w.frag(",\"pm2_5_over_min\":");             w.integer(f.day.pm25OverMin);
+        w.frag(",\"aqi_max\":");                    w.integer(f.day.aqiMax);
+        w.frag("}");
+    }
+    if (!allGood(f)) {
+        w.frag(",\"quality\":{");
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            if (i) w.frag(",");
+            w.frag("\"");
+            w.str(SensorHealth::sensorName((SensorId)i));
+            w.frag("\":\"");
+            w.str(SensorHealth::qualityName(f.quality[i]));
+            w.frag("\"");
+        }
+        w.frag("}");
+    }
+    w.frag("}");
+    return w.finish(out);
+}
+
+} // namespace SampleJson
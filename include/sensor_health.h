@@ -0,0 +1,277 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <freertos/FreeRTOS.h>
+#include <DHT.h>
+#include "config.h"
+#include "async_log.h"
+
+// Sensors with their own bus and acquisition task
+enum SensorId : uint8_t { SENSOR_PM, SENSOR_TVOC, SENSOR_CLIMATE, SENSOR_COUNT };
+
+// Per-sensor data quality of a FusedSample, worst last
+enum Quality : uint8_t {
+    QUALITY_GOOD,      // fresh reading that passed the checks
+    QUALITY_SUSPECT,   // fresh reading used, but stuck on one value
+    QUALITY_HELD,      // read failed or was rejected: last good value repeated
+    QUALITY_MISSING,   // nothing usable (warming up, or held past HEALTH_HOLD_MS)
+};
+
+// -----------------------------------
+// Channel Screen
+// Plausibility checks for one channel, O(1) per reading:
+//   out of the sensor's range          -> rejected
+//   jump from both the previous reading and the last accepted value
+//                                      -> rejected (a one-sample spike is
+//                                         dropped, a real step is accepted
+//                                         one sample late)
+//   the same reading above the floor for the channel's stuckMs
+//                                      -> stuck (zero variance; still used)
+// Stuck is timed, not counted: at the 20 s max interval a whole-unit
+// sensor repeats a value dozens of times in a steady room.
+// -----------------------------------
+class ChannelScreen {
+public:
+    enum Verdict : uint8_t { PASS, STUCK, JUMP, OUT_OF_RANGE };
+
+    struct Limits {
+        float lo, hi;        // sensor range
+        float maxJump;       // largest plausible change between samples
+        float stuckFloor;    // readings at or below never count as stuck
+        uint32_t stuckMs;    // unchanged this long => stuck; 0: never
+    };
+
+private:
+    Limits lim;
+    float prevRaw = NAN;     // last in-range reading
+    float accepted = NAN;    // last value the caller used
+    uint32_t sinceMs = 0;    // prevRaw first read at
+
+public:
+    explicit ChannelScreen(const Limits& l) : lim(l) {}
+
+    Verdict check(float v, uint32_t tMs) {
+        if (v < lim.lo || v > lim.hi) return OUT_OF_RANGE;
+        if (v != prevRaw) sinceMs = tMs;
+        bool jump = !isnan(prevRaw) && fabsf(v - prevRaw) > lim.maxJump &&
+                    !isnan(accepted) && fabsf(v - accepted) > lim.maxJump;
+        prevRaw = v;
+        if (jump) return JUMP;
+        if (lim.stuckMs && v > lim.stuckFloor && tMs - sinceMs >= lim.stuckMs) return STUCK;
+        return PASS;
+    }
+
+    static bool usable(Verdict v) { return v <= STUCK; }
+
+    void accept(float v) { accepted = v; }
+};
+
+// -----------------------------------
+// Sensor Health
+// Per-sensor fault counters and tiered recovery. Acquisition tasks report
+// every read with its fault (checksum, timeout, NACK, busy bus, NAN);
+// fusion reports rejected readings and stuck sensors. A run of
+// HEALTH_RECOVER_AFTER bad reads asks the acquisition task for a recovery
+// step, alternating
+//   RECOVER_BUS     re-init the UART / clear and restart the I2C bus /
+//                   re-arm the DHT line
+//   RECOVER_SENSOR  re-send the sensor's init / wake sequence
+// with the run needed for the next step doubling up to
+// HEALTH_BACKOFF_MAX, so a dead sensor is retried for ever without
+// rebooting. Printed hourly and served at /api/health.
+// -----------------------------------
+class SensorHealth {
+public:
+    enum Fault : uint8_t { FAULT_NONE, FAULT_TIMEOUT, FAULT_CHECKSUM, FAULT_NACK, FAULT_BUSY, FAULT_NAN, FAULT_COUNT };
+    enum Recovery : uint8_t { RECOVER_NONE, RECOVER_BUS, RECOVER_SENSOR, RECOVERY_COUNT };
+    enum State : uint8_t { STATE_OK, STATE_DEGRADED, STATE_FAILED };
+
+    enum Channel : uint8_t { CH_PM25, CH_PM10, CH_TVOC, CH_TEMP, CH_HUM, CHANNELS };
+
+    static const char* sensorName(SensorId id) {
+        static const char* names[SENSOR_COUNT] = {"pm", "tvoc", "climate"};
+        return names[id];
+    }
+
+    static const char* qualityName(Quality q) {
+        static const char* names[] = {"good", "suspect", "held", "missing"};
+        return names[q];
+    }
+
+    static const char* faultName(Fault f) {
+        static const char* names[FAULT_COUNT] = {"none", "timeout", "checksum", "nack", "busy", "nan"};
+        return names[f];
+    }
+
+    static const char* stateName(State s) {
+        static const char* names[] = {"ok", "degraded", "failed"};
+        return names[s];
+    }
+
+    // Datasheet ranges: ZH07 0-1000 ug/m3, AGS02MA 0-64000 ppb, DHT11
+    // 0-50 C / 20-90 %RH (DHT22 -40-80 C / 0-100 %RH). The DHT11 reports
+    // whole C and %RH, which a steady room holds for a day: no stuck
+    // check on it.
+    static ChannelScreen::Limits limits(Channel c) {
+#if DHT_TYPE == DHT11
+        static constexpr ChannelScreen::Limits temp = {0, 50, HEALTH_TEMP_JUMP, -INFINITY, 0};
+        static constexpr ChannelScreen::Limits hum = {20, 90, HEALTH_HUM_JUMP, -INFINITY, 0};
+#else
+        static constexpr ChannelScreen::Limits temp = {-40, 80, HEALTH_TEMP_JUMP, -INFINITY, HEALTH_STUCK_MS};
+        static constexpr ChannelScreen::Limits hum = {0, 100, HEALTH_HUM_JUMP, -INFINITY, HEALTH_STUCK_MS};
+#endif
+        static const ChannelScreen::Limits l[CHANNELS] = {
+            {0, 1000, HEALTH_PM_JUMP, 5, HEALTH_STUCK_MS},
+            {0, 1000, HEALTH_PM_JUMP, 5, HEALTH_STUCK_MS},
+            {0, 64000, HEALTH_TVOC_JUMP, 10, HEALTH_STUCK_MS},
+            temp,
+            hum,
+        };
+        return l[c];
+    }
+
+    struct Counters {
+        uint32_t reads;
+        uint32_t faults[FAULT_COUNT];       // [FAULT_NONE]: good reads
+        uint32_t outOfRange;                // readings rejected by fusion
+        uint32_t jumps;
+        uint32_t stuck;                     // samples flagged stuck
+        uint32_t recoveries[RECOVERY_COUNT];
+        uint32_t recovered;                 // recovery runs that ended in a good read
+        uint16_t consecutive;               // bad reads since the last good one / step
+        uint8_t attempt;                    // recovery steps in this run
+        bool stuckNow;
+        State state;
+    };
+
+private:
+    static Counters* sensors() {
+        static Counters c[SENSOR_COUNT] = {};
+        return c;
+    }
+
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE m = portMUX_INITIALIZER_UNLOCKED;
+        return m;
+    }
+
+public:
+    static Counters snapshot(SensorId id) {
+        portENTER_CRITICAL(&mux());
+        Counters c = sensors()[id];
+        portEXIT_CRITICAL(&mux());
+        return c;
+    }
+
+    // Acquisition task, after every read attempt. A read while the sensor
+    // is flagged stuck counts as bad. Returns the recovery step to run now.
+    static Recovery recordRead(SensorId id, Fault fault) {
+        Counters& c = sensors()[id];
+        Recovery step = RECOVER_NONE;
+        uint8_t recoveredAfter = 0;
+        uint16_t run = 0;
+        bool stuck;
+
+        portENTER_CRITICAL(&mux());
+        stuck = c.stuckNow;
+        c.reads++;
+        c.faults[fault]++;
+        if (fault == FAULT_NONE && !stuck) {
+            if (c.attempt) {
+                c.recovered++;
+                recoveredAfter = c.attempt;
+            }
+            c.consecutive = 0;
+            c.attempt = 0;
+            c.state = STATE_OK;
+        } else {
+            if (c.consecutive < UINT16_MAX) c.consecutive++;
+            if (c.state == STATE_OK) c.state = STATE_DEGRADED;
+            uint8_t backoff = c.attempt < HEALTH_BACKOFF_MAX ? c.attempt : HEALTH_BACKOFF_MAX;
+            if (c.consecutive >= (uint32_t)HEALTH_RECOVER_AFTER << backoff) {
+                step = c.attempt % 2 ? RECOVER_SENSOR : RECOVER_BUS;
+                c.recoveries[step]++;
+                run = c.consecutive;
+                c.consecutive = 0;
+                if (c.attempt < UINT8_MAX) c.attempt++;
+                if (c.attempt >= 2) c.state = STATE_FAILED;
+            }
+        }
+        portEXIT_CRITICAL(&mux());
+
+        if (recoveredAfter) {
+            LOG_I("🩺 %s sensor recovered after %u recovery step(s)", sensorName(id), recoveredAfter);
+        }
+        if (step != RECOVER_NONE) {
+            LOG_W("🩺 %s sensor: %u bad reads (last: %s%s) - %s", sensorName(id), run,
+                  faultName(fault), stuck ? ", stuck" : "",
+                  step == RECOVER_BUS ? "restarting its bus" : "re-initialising it");
+        }
+        return step;
+    }
+
+    // Fusion: readings dropped by the channel screen
+    static void recordRejected(SensorId id, ChannelScreen::Verdict v) {
+        Counters& c = sensors()[id];
+        portENTER_CRITICAL(&mux());
+        if (v == ChannelScreen::JUMP) c.jumps++;
+        else if (v == ChannelScreen::OUT_OF_RANGE) c.outOfRange++;
+        portEXIT_CRITICAL(&mux());
+    }
+
+    // Fusion, once per fresh reading: every channel of the sensor stuck
+    static void setStuck(SensorId id, bool stuck) {
+        Counters& c = sensors()[id];
+        bool started;
+        portENTER_CRITICAL(&mux());
+        started = stuck && !c.stuckNow;
+        c.stuckNow = stuck;
+        if (stuck) c.stuck++;
+        portEXIT_CRITICAL(&mux());
+        if (started) {
+            LOG_W("🩺 %s sensor stuck: same reading for %lu h", sensorName(id),
+                  (unsigned long)(HEALTH_STUCK_MS / 3600000UL));
+        }
+    }
+
+    static void reset() {
+        portENTER_CRITICAL(&mux());
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) sensors()[i] = Counters();
+        portEXIT_CRITICAL(&mux());
+    }
+
+    static void printStats() {
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            Counters c = snapshot((SensorId)i);
+            if (!c.reads) continue;
+            Serial.printf("🩺 %-7s %-8s | %lu reads: %lu timeout, %lu checksum, %lu nack, %lu busy, %lu nan | rejected %lu jump, %lu range | stuck %lu | recoveries %lu bus, %lu sensor (%lu ok)\n",
+                          sensorName((SensorId)i), stateName(c.state), (unsigned long)c.reads,
+                          (unsigned long)c.faults[FAULT_TIMEOUT], (unsigned long)c.faults[FAULT_CHECKSUM],
+                          (unsigned long)c.faults[FAULT_NACK], (unsigned long)c.faults[FAULT_BUSY],
+                          (unsigned long)c.faults[FAULT_NAN], (unsigned long)c.jumps,
+                          (unsigned long)c.outOfRange, (unsigned long)c.stuck,
+                          (unsigned long)c.recoveries[RECOVER_BUS],
+                          (unsigned long)c.recoveries[RECOVER_SENSOR], (unsigned long)c.recovered);
+        }
+    }
+
+    static void writeJson(Print& out) {
+        out.print("{");
+        for (uint8_t i = 0; i < SENSOR_COUNT; i++) {
+            Counters c = snapshot((SensorId)i);
+            out.printf("%s\"%s\":{\"state\":\"%s\",\"reads\":%lu,\"faults\":{", i ? "," : "",
+                       sensorName((SensorId)i), stateName(c.state), (unsigned long)c.reads);
+            for (uint8_t f = FAULT_NONE + 1; f < FAULT_COUNT; f++) {
+                out.printf("%s\"%s\":%lu", f > 1 ? "," : "", faultName((Fault)f),
+                           (unsigned long)c.faults[f]);
+            }
+            out.printf("},\"rejected_jump\":%lu,\"rejected_range\":%lu,\"stuck_samples\":%lu,\"stuck\":%s,",
+                       (unsigned long)c.jumps, (unsigned long)c.outOfRange, (unsigned long)c.stuck,
+                       c.stuckNow ? "true" : "false");
+            out.printf("\"bad_run\":%u,\"recoveries\":{\"bus\":%lu,\"sensor\":%lu,\"succeeded\":%lu}}",
+                       c.consecutive, (unsigned long)c.recoveries[RECOVER_BUS],
+                       (unsigned long)c.recoveries[RECOVER_SENSOR], (unsigned long)c.recovered);
+        }
+        out.print("}");
+    }
+};
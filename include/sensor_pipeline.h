@@ -0,0 +1,444 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "pm_sensor.h"
+#include "tvoc_sensor.h"
+#include "temp_humidity_sensor.h"
+#include "battery_monitor.h"
+#include "iaq_calculator.h"
+#include "adaptive_sampler.h"
+#include "oled_display.h"
+#include "web_server.h"
+#include "web_updater.h"
+#include "connectivity_manager.h"
+#include "power_locks.h"
+#include "spsc_queue.h"
+#include "sensor_sample.h"
+#include "sample_fusion.h"
+#include "pipeline_stats.h"
+#include "bus_trace_store.h"
+#include "profiler.h"
+#include "async_log.h"
+#include "heap_stats.h"
+#include "timer_wheel.h"
+#include "stream_stats.h"
+#include "sensor_health.h"
+
+// -----------------------------------
+// Sensor Pipeline
+//
+//   APP_CPU  AcqUART ─┐
+//            AcqI2C  ─┼─> Fusion ─┬─> display (loop task)
+//            AcqDHT  ─┘           ├─> History
+//                                 └─> Log
+//   PRO_CPU                       └─> Net (uploads, WiFi state, OTA)
+//
+// Every arrow is a lock-free SPSC ring; the consumer is woken with a task
+// notification. Fusion owns the schedule (AdaptiveSampler): it triggers
+// all acquisition tasks, waits for their readings (or ACQ_TIMEOUT_MS),
+// computes AQI and fans the fused sample out to the sinks.
+//
+// The network task's periodic work (uploads, OTA, stats) runs as jobs on
+// its timer wheel (scheduler()); between jobs it sleeps until the next
+// one, a WiFi event or a sample.
+// -----------------------------------
+class SensorPipeline {
+public:
+    static constexpr uint32_t ACQ_TIMEOUT_MS = 1500;   // ZH07 frame wait is up to 1 s
+    static constexpr uint32_t OTA_INTERVAL_MS = 3600000;
+    static constexpr uint32_t STATS_INTERVAL_MS = 3600000;
+    static constexpr uint32_t HOURLY_SLACK_MS = 60000;  // lets the hourly jobs share a wakeup
+
+private:
+    enum Bus : uint8_t { BUS_UART, BUS_I2C, BUS_DHT, BUS_COUNT };
+
+    struct BusReading {
+        uint32_t seq;
+        bool ok;
+        PMData pm;      // UART
+        float a;        // I2C: TVOC  | DHT: temperature
+        float b;        //            | DHT: humidity
+        bool fresh;     // I2C: a is a new reading, not the sensor's cache
+    };
+
+    PMSensor &pm_sensor;
+    TVOCSensor &tvoc_sensor;
+    TempHumiditySensor &temp_hum_sensor;
+    AdaptiveSampler &sampler;
+    WebServerModule &web;
+    OLEDDisplay &display;
+    ConnectivityManager &connectivity;
+
+    // Acquisition -> fusion
+    SpscQueue<BusReading, 4> busQ[BUS_COUNT] = {
+        SpscQueue<BusReading, 4>("uart"),
+        SpscQueue<BusReading, 4>("i2c"),
+        SpscQueue<BusReading, 4>("dht"),
+    };
+
+    // Fusion -> sinks
+    SpscQueue<FusedSample, 4> displayQ{"display"};
+    SpscQueue<FusedSample, 4> httpQ{"http"};
+    SpscQueue<FusedSample, 8> logQ{"log"};
+    SpscQueue<FusedSample, 4> historyQ{"history"};
+
+    TaskHandle_t acqTask[BUS_COUNT] = {nullptr, nullptr, nullptr};
+    TaskHandle_t fusionTask = nullptr;
+    TaskHandle_t netTask = nullptr;
+    TaskHandle_t logTask = nullptr;
+    TaskHandle_t historyTask = nullptr;
+    TaskHandle_t displayListener = nullptr;
+
+    // Jobs on the network task
+    TimerWheel netTimers{"net"};
+
+    // Shared with acquisition tasks (written by fusion before the trigger)
+    volatile uint32_t cycleSeq = 0;
+    volatile bool sampleRequested = false;
+
+    struct AcqArgs {
+        SensorPipeline* self;
+        Bus bus;
+    } acqArgs[BUS_COUNT];
+
+    // -----------------------------
+    // Acquisition (one task per bus)
+    // -----------------------------
+    BusReading readBus(Bus bus) {
+        BusReading r = {cycleSeq, false, {0, 0, 0}, NAN, NAN, false};
+        switch (bus) {
+            case BUS_UART: {
+                PROFILE_SCOPE(PM_READ);
+                r.ok = pm_sensor.read(r.pm);
+                break;
+            }
+            case BUS_I2C: {
+                PROFILE_SCOPE(TVOC_READ);
+                r.a = tvoc_sensor.readTVOC();
+                r.ok = !isnan(r.a);
+                r.fresh = tvoc_sensor.fresh();
+                break;
+            }
+            case BUS_DHT: {
+                PROFILE_SCOPE(DHT_READ);
+                r.a = temp_hum_sensor.readTemperature();
+                r.b = temp_hum_sensor.readHumidity();
+                r.ok = !isnan(r.a) || !isnan(r.b);
+                break;
+            }
+            default:
+                break;
+        }
+        return r;
+    }
+
+    // Report the read to SensorHealth and run the recovery step it asks
+    // for. After the reading is queued, so recovery never delays a sample.
+    void checkHealth(Bus bus, const BusReading& r) {
+        static const SensorId sensor[BUS_COUNT] = {SENSOR_PM, SENSOR_TVOC, SENSOR_CLIMATE};
+        SensorHealth::Fault fault;
+        switch (bus) {
+            case BUS_UART:
+                fault = pm_sensor.lastFault();
+                break;
+            case BUS_I2C:
+                if (!tvoc_sensor.lastPolled()) return;   // warming up / conversion running
+                fault = tvoc_sensor.lastFault();
+                break;
+            default:
+                fault = isnan(r.a) || isnan(r.b) ? SensorHealth::FAULT_NAN : SensorHealth::FAULT_NONE;
+                break;
+        }
+
+        SensorHealth::Recovery step = SensorHealth::recordRead(sensor[bus], fault);
+        if (step == SensorHealth::RECOVER_NONE) return;
+        switch (bus) {
+            case BUS_UART:
+                if (step == SensorHealth::RECOVER_BUS) pm_sensor.restartUart();
+                else pm_sensor.reinit();
+                break;
+            case BUS_I2C:
+                if (step == SensorHealth::RECOVER_BUS) I2CBus::recover(I2CBus::SENSOR);
+                else tvoc_sensor.reinit();
+                break;
+            default:
+                temp_hum_sensor.reset();
+                break;
+        }
+    }
+
+    static void acqMain(void* arg) {
+        AcqArgs* a = (AcqArgs*)arg;
+        SensorPipeline* self = a->self;
+        static const PipelineStats::Stage stage[BUS_COUNT] = {
+            PipelineStats::ACQ_UART, PipelineStats::ACQ_I2C, PipelineStats::ACQ_DHT
+        };
+
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            uint32_t t0 = micros();
+            BusReading r = self->readBus(a->bus);
+            PipelineStats::record(stage[a->bus], micros() - t0);
+
+            self->busQ[a->bus].push(r);
+            xTaskNotifyGive(self->fusionTask);
+            self->checkHealth(a->bus, r);
+        }
+    }
+
+    // -----------------------------
+    // Fusion / AQI
+    // -----------------------------
+    SampleFusion fusion;
+
+    FusedSample fuse(uint32_t seq, uint32_t tMs, uint32_t t0Us, const BusReading* got, uint8_t mask) {
+        SampleFusion::Input in;
+        in.havePM = mask & (1 << BUS_UART);
+        in.pmOk = in.havePM && got[BUS_UART].ok;
+        in.pm = got[BUS_UART].pm;
+        in.haveTVOC = mask & (1 << BUS_I2C);
+        in.tvocFresh = in.haveTVOC && got[BUS_I2C].fresh;
+        in.tvoc = got[BUS_I2C].a;
+        in.haveClimate = mask & (1 << BUS_DHT);
+        in.temp = got[BUS_DHT].a;
+        in.hum = got[BUS_DHT].b;
+        {
+            PROFILE_SCOPE(BATTERY);
+            in.battery = BatteryMonitor::getPercentage();
+        }
+
+        bool categoryChanged = false;
+        FusedSample s;
+        {
+            PROFILE_SCOPE(AQI);
+            s = fusion.fuse(seq, tMs, in, categoryChanged);
+        }
+        s.t0Us = t0Us;
+        if (categoryChanged) web.requestUpload();  // upload at once on a category change
+        return s;
+    }
+
+    void publish(const FusedSample& s) {
+        if (displayQ.push(s) && displayListener) xTaskNotifyGive(displayListener);
+        if (httpQ.push(s)) xTaskNotifyGive(netTask);
+        if (logQ.push(s)) xTaskNotifyGive(logTask);
+        if (historyQ.push(s)) xTaskNotifyGive(historyTask);
+    }
+
+    static void fusionMain(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        BusReading got[BUS_COUNT] = {};
+        uint8_t mask = 0;
+        bool cycleOpen = false;
+        uint32_t seq = 0;
+        uint32_t cycleMs = 0, cycleUs = 0;
+        uint32_t lastTrigger = millis() - self->sampler.nextIntervalMs();
+
+        for (;;) {
+            uint32_t now = millis();
+
+            // Trigger a cycle when due (or on request)
+            if (!cycleOpen && (self->sampleRequested ||
+                               now - lastTrigger >= self->sampler.nextIntervalMs())) {
+                self->sampleRequested = false;
+                self->cycleSeq = ++seq;
+                cycleOpen = true;
+                mask = 0;
+                cycleMs = lastTrigger = now;
+                cycleUs = micros();
+                BusTrace::cycle(seq);
+                for (int b = 0; b < BUS_COUNT; b++) xTaskNotifyGive(self->acqTask[b]);
+            }
+
+            uint32_t waitMs;
+            if (cycleOpen) {
+                uint32_t elapsed = now - cycleMs;
+                waitMs = elapsed >= ACQ_TIMEOUT_MS ? 0 : ACQ_TIMEOUT_MS - elapsed;
+            } else {
+                uint32_t elapsed = now - lastTrigger;
+                uint32_t interval = self->sampler.nextIntervalMs();
+                waitMs = elapsed >= interval ? 0 : interval - elapsed;
+            }
+            if (waitMs) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
+
+            // Collect readings; late ones from an earlier cycle are dropped
+            for (int b = 0; b < BUS_COUNT; b++) {
+                BusReading r;
+                while (self->busQ[b].pop(r)) {
+                    if (cycleOpen && r.seq == seq) {
+                        got[b] = r;
+                        mask |= 1 << b;
+                    }
+                }
+            }
+
+            if (cycleOpen && (mask == (1 << BUS_COUNT) - 1 ||
+                              millis() - cycleMs >= ACQ_TIMEOUT_MS)) {
+                cycleOpen = false;
+                FusedSample s = self->fuse(seq, cycleMs, cycleUs, got, mask);
+                s.fusedUs = micros();
+                PipelineStats::record(PipelineStats::FUSION, s.fusedUs - cycleUs);
+                self->publish(s);
+            }
+        }
+    }
+
+    // -----------------------------
+    // Sinks
+    // -----------------------------
+    static uint32_t sinceFused(const FusedSample& s) {
+        return micros() - s.fusedUs;
+    }
+
+    static void otaJob(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        WebUpdater::checkAndApplyUpdate(&self->display);
+    }
+
+    static void statsJob(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        PowerLocks::printStats();
+        self->display.printStats();
+        I2CBus::printStats();
+        PipelineStats::printStats();
+        SensorHealth::printStats();
+        StreamStats::printStats();
+        self->web.printStats();
+        Profiler::printStats();
+        HeapStats::printStats();
+        TimerWheel::printAll();
+    }
+
+    // PRO_CPU: WiFi state machine, uploads, hourly OTA check. Sleeps until
+    // the next job or WiFi timeout unless a sample or WiFi event wakes it.
+    static void netMain(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        self->connectivity.setWakeTask(xTaskGetCurrentTaskHandle());
+
+        for (;;) {
+            // Connectivity first: its listeners may schedule jobs
+            uint32_t waitMs = self->connectivity.loop();
+            waitMs = min(waitMs, self->netTimers.run());
+
+            FusedSample s;
+            while (self->httpQ.pop(s)) {
+                {
+                    PROFILE_SCOPE(WEB_LOOP);
+                    self->web.loop(s);
+                }
+                PipelineStats::record(PipelineStats::SINK_HTTP, sinceFused(s));
+                HeapStats::sample();   // once per cycle: walks the heap
+            }
+
+            ulTaskNotifyTake(pdTRUE, waitMs == TimerWheel::NEVER ? portMAX_DELAY
+                                                                  : pdMS_TO_TICKS(waitMs));
+        }
+    }
+
+    // Also the bus-trace writer: wakes at least once a second to flush it
+    static void logMain(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+            BusTraceStore::service();
+            FusedSample s;
+            while (self->logQ.pop(s)) {
+                PROFILE_SCOPE(LOG_PRINTF);
+                LOG_I(
+                    "📊 PM2.5:%3u | PM10:%3u | TVOC:%6.2f | Temp:%4.1f°C | Hum:%4.1f%% | AQI:%3d (%s) | Batt:%d%% | Next:%lus",
+                    s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum, s.aqi, s.category, s.battery,
+                    (unsigned long)(s.nextIntervalMs / 1000)
+                );
+                PipelineStats::record(PipelineStats::SINK_LOG, sinceFused(s));
+            }
+        }
+    }
+
+    static void historyMain(void* arg) {
+        SensorPipeline* self = (SensorPipeline*)arg;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            FusedSample s;
+            while (self->historyQ.pop(s)) {
+                {
+                    PROFILE_SCOPE(TREND);
+                    self->display.recordTrend(s.pm.pm2_5, s.aqi, s.tvoc, s.temp);
+                }
+                {
+                    PROFILE_SCOPE(STREAM_STATS);
+                    StreamStats::add(s);
+                }
+                PipelineStats::record(PipelineStats::SINK_HISTORY, sinceFused(s));
+            }
+        }
+    }
+
+    bool spawn(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+               UBaseType_t prio, TaskHandle_t* handle, BaseType_t core) {
+        if (xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, core) == pdPASS) return true;
+        LOG_E("❌ Failed to create %s task", name);
+        return false;
+    }
+
+public:
+    SensorPipeline(PMSensor &pm, TVOCSensor &tvoc, TempHumiditySensor &th,
+                   AdaptiveSampler &adaptive, WebServerModule &webModule,
+                   OLEDDisplay &oled, ConnectivityManager &conn)
+        : pm_sensor(pm), tvoc_sensor(tvoc), temp_hum_sensor(th), sampler(adaptive),
+          web(webModule), display(oled), connectivity(conn), fusion(adaptive) {}
+
+    // Sensors, display and connectivity must already be initialised
+    bool begin() {
+        for (int b = 0; b < BUS_COUNT; b++) PipelineStats::addQueue(&busQ[b]);
+        PipelineStats::addQueue(&displayQ);
+        PipelineStats::addQueue(&httpQ);
+        PipelineStats::addQueue(&logQ);
+        PipelineStats::addQueue(&historyQ);
+
+        // Uploads run on the network task itself
+        web.setAsyncPost(false);
+
+        // Network task jobs (registered before the task runs the wheel)
+        netTimers.every("ota", OTA_INTERVAL_MS, otaJob, this, HOURLY_SLACK_MS);
+        netTimers.every("stats", STATS_INTERVAL_MS, statsJob, this, HOURLY_SLACK_MS);
+        web.schedule(netTimers);
+
+        // Sinks first so fusion never notifies a missing task
+        bool ok = spawn(netMain, "Net", 8192, this, 2, &netTask, PRO_CPU_NUM) &&
+                  spawn(logMain, "Log", 4096, this, 1, &logTask, PRO_CPU_NUM) &&
+                  spawn(historyMain, "History", 2048, this, 1, &historyTask, APP_CPU_NUM);
+
+        static const char* names[BUS_COUNT] = {"AcqUART", "AcqI2C", "AcqDHT"};
+        for (int b = 0; ok && b < BUS_COUNT; b++) {
+            acqArgs[b] = {this, (Bus)b};
+            ok = spawn(acqMain, names[b], 3072, &acqArgs[b], 3, &acqTask[b], APP_CPU_NUM);
+        }
+
+        ok = ok && spawn(fusionMain, "Fusion", 4096, this, 2, &fusionTask, APP_CPU_NUM);
+        if (ok) LOG_I("🧵 Sensor pipeline started (acquisition: APP_CPU, network: PRO_CPU)");
+        return ok;
+    }
+
+    // Take a reading now instead of waiting for the adaptive interval
+    void requestSample() {
+        sampleRequested = true;
+        if (fusionTask) xTaskNotifyGive(fusionTask);
+    }
+
+    // Jobs here run on the network task. Register from that task (e.g. a
+    // connectivity listener) or before begin().
+    TimerWheel& scheduler() { return netTimers; }
+
+    // Task notified when a sample is queued for the display
+    void setDisplayListener(TaskHandle_t task) {
+        displayListener = task;
+    }
+
+    // Display sink, drained by the UI (Arduino loop) task
+    bool pollDisplay(FusedSample& s) {
+        if (!displayQ.pop(s)) return false;
+        PipelineStats::record(PipelineStats::SINK_DISPLAY, sinceFused(s));
+        return true;
+    }
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+#include "pm_sensor.h"
+#include "sensor_health.h"
+
+// -----------------------------------
+// Fused Sample
+// One acquisition cycle after fusion: all buses, AQI and battery.
+// Produced by SensorPipeline and handed to every sink by value.
+// -----------------------------------
+struct FusedSample {
+    uint32_t seq;            // acquisition cycle number
+    uint32_t tMs;            // millis() when the cycle was triggered
+    uint32_t t0Us;           // micros() at trigger, for latency stats
+    uint32_t fusedUs;        // micros() when fusion finished
+    PMData pm;               // calibrated (pm_calibration.h)
+    PMData pmRaw;            // as read from the sensor
+    bool pmValid;            // false: pm holds the last valid reading
+    float tvoc;              // NAN while warming up / unavailable
+    float temp;              // NAN once held past HEALTH_HOLD_MS
+    float hum;
+    Quality quality[SENSOR_COUNT];   // per sensor (sensor_health.h)
+    int aqi;
+    const char* category;    // static string from IAQ::getAQICategory
+    int battery;
+    uint32_t nextIntervalMs; // adaptive sampler decision
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// -----------------------------------
+// Lock-free Single-Producer / Single-Consumer Ring
+// One task pushes, one task pops; no locks, no allocation. The producer
+// owns `head`, the consumer owns `tail`. Full rings drop the new item
+// (counted) rather than block the producer.
+// Plain C++ (no Arduino dependencies).
+// -----------------------------------
+
+// Type-independent part, so stats can list queues of any element type
+class SpscQueueBase {
+protected:
+    std::atomic<uint32_t> head{0};   // next slot to write (producer)
+    std::atomic<uint32_t> tail{0};   // next slot to read (consumer)
+    uint32_t highWater = 0;          // written by the producer only
+    uint32_t dropped = 0;
+
+public:
+    const char* const name;
+    const uint16_t capacity;
+
+    SpscQueueBase(const char* queueName, uint16_t cap) : name(queueName), capacity(cap) {}
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    uint32_t highWaterMark() const { return highWater; }
+    uint32_t droppedCount() const { return dropped; }
+};
+
+template <typename T, uint16_t N>
+class SpscQueue : public SpscQueueBase {
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+    T slots[N];
+
+public:
+    explicit SpscQueue(const char* queueName) : SpscQueueBase(queueName, N) {}
+
+    // Producer side
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (h - t >= N) {
+            dropped++;
+            return false;
+        }
+        slots[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        if (h + 1 - t > highWater) highWater = h + 1 - t;
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) return false;
+        item = slots[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,373 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "sensor_sample.h"
+#include "sample_json.h"
+
+// -----------------------------------
+// P² Quantile (Jain & Chlamtac 1985)
+// Five markers track the min, p/2, p, (1+p)/2 quantiles and the max;
+// each sample moves marker positions by one and adjusts heights with a
+// parabolic (else linear) fit. Constant memory, O(1) per sample. Exact
+// until the fifth sample.
+// -----------------------------------
+class P2Quantile {
+    float q[5];      // marker heights
+    float np[5];     // desired positions
+    int32_t n[5];    // actual positions
+    float p;
+    uint32_t count;
+
+    float parabolic(int i, int d) const {
+        return q[i] + (float)d / (n[i + 1] - n[i - 1]) *
+               ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+    }
+
+    float linear(int i, int d) const {
+        return q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i]);
+    }
+
+public:
+    void begin(float quantile) {
+        p = quantile;
+        count = 0;
+    }
+
+    void add(float x) {
+        if (count < 5) {
+            // Insertion sort into the first five samples
+            int i = count++;
+            while (i > 0 && q[i - 1] > x) {
+                q[i] = q[i - 1];
+                i--;
+            }
+            q[i] = x;
+            if (count == 5) {
+                for (int j = 0; j < 5; j++) n[j] = j;
+                np[0] = 0;
+                np[1] = 2 * p;
+                np[2] = 4 * p;
+                np[3] = 2 + 2 * p;
+                np[4] = 4;
+            }
+            return;
+        }
+        count++;
+
+        int k;
+        if (x < q[0]) {
+            q[0] = x;
+            k = 0;
+        } else if (x >= q[4]) {
+            q[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while (x >= q[k + 1]) k++;
+        }
+        for (int i = k + 1; i < 5; i++) n[i]++;
+        np[1] += p / 2;
+        np[2] += p;
+        np[3] += (1 + p) / 2;
+        np[4] += 1;
+
+        for (int i = 1; i <= 3; i++) {
+            float d = np[i] - n[i];
+            if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1)) {
+                int s = d > 0 ? 1 : -1;
+                float h = parabolic(i, s);
+                q[i] = (q[i - 1] < h && h < q[i + 1]) ? h : linear(i, s);
+                n[i] += s;
+            }
+        }
+    }
+
+    // NAN until the first sample
+    float value() const {
+        if (!count) return NAN;
+        if (count < 5) {
+            // Nearest rank on the sorted samples
+            uint32_t r = (uint32_t)ceilf(p * count);
+            return q[r ? r - 1 : 0];
+        }
+        return q[2];
+    }
+
+    uint32_t samples() const { return count; }
+};
+
+// -----------------------------------
+// Stream Stats
+// Constant-memory summaries of every sensor channel over hour, day and
+// week windows: Welford mean/variance, min/max, P² p50/p95/p99 and time
+// above a per-channel limit (each sample holds until the next). Fed one
+// FusedSample at a time by the history task; O(1) per sample.
+//
+// Windows tumble on uptime: the current one is in progress, the previous
+// one is kept as a finished summary. Served at /api/stats, logged
+// hourly, and the PM2.5/AQI day figures ride along with each upload.
+// -----------------------------------
+class StreamStats {
+public:
+    enum Channel : uint8_t { PM25, PM10, AQI, TVOC, TEMP, HUM, CHANNELS };
+    enum Window : uint8_t { HOUR, DAY, WEEK, WINDOWS };
+
+    struct Summary {
+        uint32_t count;
+        uint32_t spanS;      // time covered by the samples
+        uint32_t overS;      // time above the channel limit
+        float min, max, mean, stddev;
+        float p50, p95, p99;
+    };
+
+    static const char* channelName(Channel c) {
+        static const char* names[CHANNELS] = {"pm2_5", "pm10", "aqi", "tvoc", "temperature", "humidity"};
+        return names[c];
+    }
+
+    static const char* windowName(Window w) {
+        static const char* names[WINDOWS] = {"hour", "day", "week"};
+        return names[w];
+    }
+
+    static float limit(Channel c) {
+        static const float limits[CHANNELS] = {STATS_PM25_LIMIT, STATS_PM10_LIMIT, STATS_AQI_LIMIT,
+                                               STATS_TVOC_LIMIT, STATS_TEMP_LIMIT, STATS_HUM_LIMIT};
+        return limits[c];
+    }
+
+    static uint32_t windowMs(Window w) {
+        static const uint32_t ms[WINDOWS] = {3600UL * 1000, 24UL * 3600 * 1000, 7UL * 24 * 3600 * 1000};
+        return ms[w];
+    }
+
+    // One channel over one window
+    class Accumulator {
+        uint32_t count;
+        double mean, m2;        // Welford
+        float lo, hi;
+        uint32_t spanMs, overMs;
+        uint32_t lastMs;
+        float last;             // NAN: no previous sample to hold
+        P2Quantile p50, p95, p99;
+
+    public:
+        void reset() {
+            count = 0;
+            mean = m2 = 0;
+            lo = INFINITY;
+            hi = -INFINITY;
+            spanMs = overMs = 0;
+            last = NAN;
+            lastMs = 0;
+            p50.begin(0.50f);
+            p95.begin(0.95f);
+            p99.begin(0.99f);
+        }
+
+        // Credit the held value with the time up to tMs
+        void hold(uint32_t tMs, float limit) {
+            if (!isnan(last)) {
+                uint32_t dt = tMs - lastMs;
+                spanMs += dt;
+                if (last > limit) overMs += dt;
+            }
+            lastMs = tMs;
+        }
+
+        // Value held at the end of a window, carried into the next
+        float held() const { return last; }
+        void carry(float x, uint32_t tMs) {
+            last = x;
+            lastMs = tMs;
+        }
+
+        // NAN is a gap: nothing recorded, and the previous value stops holding
+        void add(float x, uint32_t tMs, float limit) {
+            hold(tMs, limit);
+            last = x;
+            if (isnan(x)) return;
+
+            count++;
+            double d = x - mean;
+            mean += d / count;
+            m2 += d * (x - mean);
+            if (x < lo) lo = x;
+            if (x > hi) hi = x;
+            p50.add(x);
+            p95.add(x);
+            p99.add(x);
+        }
+
+        Summary summary() const {
+            Summary s;
+            s.count = count;
+            s.spanS = spanMs / 1000;
+            s.overS = overMs / 1000;
+            s.min = count ? lo : NAN;
+            s.max = count ? hi : NAN;
+            s.mean = count ? (float)mean : NAN;
+            s.stddev = count > 1 ? (float)sqrt(m2 / (count - 1)) : NAN;
+            s.p50 = p50.value();
+            s.p95 = p95.value();
+            s.p99 = p99.value();
+            return s;
+        }
+    };
+
+private:
+    struct State {
+        SemaphoreHandle_t lock;
+        bool started;
+        uint32_t windowStart[WINDOWS];
+        Accumulator current[WINDOWS][CHANNELS];
+        Summary previous[WINDOWS][CHANNELS];
+        bool havePrevious[WINDOWS];
+    };
+
+    static State& s() {
+        static State st = {xSemaphoreCreateMutex(), false, {}, {}, {}, {}};
+        return st;
+    }
+
+    struct Lock {
+        Lock() { xSemaphoreTake(s().lock, portMAX_DELAY); }
+        ~Lock() { xSemaphoreGive(s().lock); }
+    };
+
+    static float value(const FusedSample& x, Channel c) {
+        switch (c) {
+            case PM25: return x.pmValid ? x.pm.pm2_5 : NAN;
+            case PM10: return x.pmValid ? x.pm.pm10 : NAN;
+            case AQI:  return x.pmValid ? x.aqi : NAN;
+            // Held values would flatten the spread: count fresh readings only
+            case TVOC: return x.quality[SENSOR_TVOC] <= QUALITY_SUSPECT ? x.tvoc : NAN;
+            case TEMP: return x.quality[SENSOR_CLIMATE] <= QUALITY_SUSPECT ? x.temp : NAN;
+            case HUM:  return x.quality[SENSOR_CLIMATE] <= QUALITY_SUSPECT ? x.hum : NAN;
+            default:   return NAN;
+        }
+    }
+
+    static void writeSummary(Print& out, const Summary& m, float lim) {
+        out.printf("{\"n\":%lu,\"span_s\":%lu,\"min\":", (unsigned long)m.count, (unsigned long)m.spanS);
+        writeFloat(out, m.min);
+        out.print(",\"max\":");    writeFloat(out, m.max);
+        out.print(",\"mean\":");   writeFloat(out, m.mean);
+        out.print(",\"stddev\":"); writeFloat(out, m.stddev);
+        out.print(",\"p50\":");    writeFloat(out, m.p50);
+        out.print(",\"p95\":");    writeFloat(out, m.p95);
+        out.print(",\"p99\":");    writeFloat(out, m.p99);
+        out.printf(",\"limit\":%g,\"over_s\":%lu}", lim, (unsigned long)m.overS);
+    }
+
+    static void writeFloat(Print& out, float v) {
+        if (isnan(v)) out.print("null");
+        else out.printf("%.2f", v);
+    }
+
+public:
+    static void reset() {
+        Lock l;
+        State& st = s();
+        st.started = false;
+        for (uint8_t w = 0; w < WINDOWS; w++) {
+            st.havePrevious[w] = false;
+            for (uint8_t c = 0; c < CHANNELS; c++) st.current[w][c].reset();
+        }
+    }
+
+    // History task, once per fused sample
+    static void add(const FusedSample& x) {
+        Lock l;
+        State& st = s();
+        if (!st.started) {
+            st.started = true;
+            for (uint8_t w = 0; w < WINDOWS; w++) {
+                st.windowStart[w] = x.tMs;
+                for (uint8_t c = 0; c < CHANNELS; c++) st.current[w][c].reset();
+            }
+        }
+        for (uint8_t w = 0; w < WINDOWS; w++) {
+            uint32_t len = windowMs((Window)w);
+            if (x.tMs - st.windowStart[w] >= len) {
+                // Window over: close it on its end, keep its summary and carry
+                // the held values into the window x falls in (any whole
+                // windows skipped by a stall are not counted)
+                uint32_t end = st.windowStart[w] + len;
+                st.windowStart[w] += (x.tMs - st.windowStart[w]) / len * len;
+                for (uint8_t c = 0; c < CHANNELS; c++) {
+                    Accumulator& a = st.current[w][c];
+                    a.hold(end, limit((Channel)c));
+                    st.previous[w][c] = a.summary();
+                    float last = a.held();
+                    a.reset();
+                    a.carry(last, st.windowStart[w]);
+                }
+                st.havePrevious[w] = true;
+            }
+            for (uint8_t c = 0; c < CHANNELS; c++) {
+                st.current[w][c].add(value(x, (Channel)c), x.tMs, limit((Channel)c));
+            }
+        }
+    }
+
+    // Current (in-progress) or previous (finished) window; false if none yet
+    static bool summary(Window w, Channel c, Summary& out, bool previous = false) {
+        Lock l;
+        State& st = s();
+        if (previous ? !st.havePrevious[w] : !st.started) return false;
+        out = previous ? st.previous[w][c] : st.current[w][c].summary();
+        return true;
+    }
+
+    // PM2.5 and AQI figures for the running day, for the upload body
+    static SampleJson::DayStats dayStats() {
+        SampleJson::DayStats d;
+        Summary pm, aqi;
+        if (!summary(DAY, PM25, pm) || !summary(DAY, AQI, aqi) || !pm.count) return d;
+        d.valid = true;
+        d.pm25Mean = pm.mean;
+        d.pm25P95 = pm.p95;
+        d.pm25OverMin = pm.overS / 60;
+        d.aqiMax = aqi.count ? (int)aqi.max : 0;
+        return d;
+    }
+
+    static void printStats() {
+        for (uint8_t c = 0; c < CHANNELS; c++) {
+            Summary m;
+            if (!summary(DAY, (Channel)c, m) || !m.count) continue;
+            Serial.printf("📈 %-11s day: n %lu | min %.1f mean %.1f max %.1f | p50 %.1f p95 %.1f p99 %.1f | >%g for %lu min\n",
+                          channelName((Channel)c), (unsigned long)m.count, m.min, m.mean, m.max,
+                          m.p50, m.p95, m.p99, limit((Channel)c), (unsigned long)(m.overS / 60));
+        }
+    }
+
+    static void writeJson(Print& out) {
+        out.print("{");
+        for (uint8_t pass = 0; pass < 2; pass++) {
+            out.print(pass ? ",\"previous\":{" : "\"current\":{");
+            bool firstWindow = true;
+            for (uint8_t w = 0; w < WINDOWS; w++) {
+                Summary m[CHANNELS];
+                bool have = true;
+                for (uint8_t c = 0; have && c < CHANNELS; c++) have = summary((Window)w, (Channel)c, m[c], pass);
+                if (!have) continue;
+                out.printf("%s\"%s\":{", firstWindow ? "" : ",", windowName((Window)w));
+                firstWindow = false;
+                for (uint8_t c = 0; c < CHANNELS; c++) {
+                    out.printf("%s\"%s\":", c ? "," : "", channelName((Channel)c));
+                    writeSummary(out, m[c], limit((Channel)c));
+                }
+                out.print("}");
+            }
+            out.print("}");
+        }
+        out.print("}");
+    }
+};
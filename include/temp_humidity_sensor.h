@@ -1,6 +1,7 @@
 #pragma once
 #include <DHT.h>
 #include "config.h"
+#include "bus_trace.h"
 
 class TempHumiditySensor {
 private:
@@ -15,15 +16,23 @@ public:
         dht.begin();
     }
 
+    // Recovery: release the data line (pull-up) and force a full start
+    // sequence on the next read. The DHT has no reset or power pin.
+    void reset() {
+        dht.begin();
+    }
+
     // Read temperature in Celsius
     float readTemperature() {
         float temp = dht.readTemperature();
+        BusTrace::dht(BusTrace::DHT_TEMP, temp);
         return isnan(temp) ? NAN : temp;
     }
 
     // Read humidity in %
     float readHumidity() {
         float hum = dht.readHumidity();
+        BusTrace::dht(BusTrace::DHT_HUM, hum);
         return isnan(hum) ? NAN : hum;
     }
 };
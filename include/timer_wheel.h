@@ -0,0 +1,428 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <string.h>
+#include "config.h"
+
+// -----------------------------------
+// Timer Wheel
+// Cooperative scheduler for one task: periodic and one-shot jobs on a
+// hierarchical wheel (4 levels x 64 slots of SCHED_TICK_MS; level L slot
+// = 64^L ticks, ~46 h reach, longer delays re-cascade). Insert, stop and
+// expiry are O(1); run() returns how long the owner may block, so tasks
+// sleep until the next job instead of polling.
+//
+// Deadlines: a job may run up to slackMs after it is due. The wheel
+// rounds each expiry to the "roundest" tick in [due, due + slack], so
+// jobs with slack land on the same tick and share one wakeup.
+// Periodic jobs stay on their original phase (no drift); periods missed
+// entirely are skipped and counted.
+//
+// Not thread-safe: add/start/stop/run belong to the owning task (or run
+// before it starts). Stats are read unsynchronised by printStats/JSON.
+// -----------------------------------
+class TimerWheel {
+public:
+    typedef void (*Callback)(void* arg);
+
+    static constexpr uint32_t TICK_MS = SCHED_TICK_MS;
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int MAX_JOBS = SCHED_MAX_JOBS;
+    static constexpr uint32_t NEVER = UINT32_MAX;
+    static constexpr uint32_t RANGE_TICKS = 1UL << (SLOT_BITS * LEVELS);
+    static constexpr int MAX_WHEELS = 4;
+
+private:
+    struct Job {
+        const char* name;
+        Callback cb;
+        void* arg;
+        uint32_t periodMs;      // 0 = one-shot
+        uint32_t slackMs;
+        uint64_t dueMs;         // nominal due time
+        uint32_t fireTick;      // coalesced expiry
+        int8_t next, prev;      // slot list (-1 = end)
+        int8_t level, slot;     // -1 while not queued
+        bool used;
+        bool active;
+
+        uint32_t runs;
+        uint32_t late;          // ran after due + slack (+1 tick)
+        uint32_t skipped;       // whole periods missed
+        uint32_t maxJitterMs;   // run time - due time
+        uint64_t totalJitterMs;
+        uint32_t maxRunUs;
+    };
+
+    const char* wheelName;
+    Job jobs[MAX_JOBS];
+    int8_t head[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS];
+    uint32_t curTick = 0;
+    bool started = false;
+    uint32_t wakeups = 0;       // run() calls that fired something
+    uint32_t fired = 0;
+
+    static TimerWheel** registry() {
+        static TimerWheel* wheels[MAX_WHEELS] = {nullptr};
+        return wheels;
+    }
+
+    static uint32_t toTick(uint64_t ms) { return (uint32_t)(ms / TICK_MS); }
+
+    bool empty() const {
+        for (int l = 0; l < LEVELS; l++) if (occupied[l]) return false;
+        return true;
+    }
+
+    // An idle wheel may fall behind the clock; nothing to process, so catch up
+    void sync(uint64_t now) {
+        if (started && !empty()) return;
+        curTick = toTick(now);
+        started = true;
+    }
+
+    // -------- Slot lists --------
+    void link(int8_t id, int level, int slot) {
+        Job& j = jobs[id];
+        j.level = level;
+        j.slot = slot;
+        j.prev = -1;
+        j.next = head[level][slot];
+        if (j.next >= 0) jobs[j.next].prev = id;
+        head[level][slot] = id;
+        occupied[level] |= 1ULL << slot;
+    }
+
+    void unlink(int8_t id) {
+        Job& j = jobs[id];
+        if (j.level < 0) return;
+        if (j.prev >= 0) jobs[j.prev].next = j.next;
+        else head[j.level][j.slot] = j.next;
+        if (j.next >= 0) jobs[j.next].prev = j.prev;
+        if (head[j.level][j.slot] < 0) occupied[j.level] &= ~(1ULL << j.slot);
+        j.level = j.slot = -1;
+    }
+
+    // base: earliest tick still to be expired (curTick while cascading
+    // into it, curTick + 1 once its slot has been taken)
+    void insert(int8_t id, uint32_t base) {
+        Job& j = jobs[id];
+        if ((int32_t)(j.fireTick - base) < 0) j.fireTick = base;
+
+        uint32_t delta = j.fireTick - curTick;
+        uint32_t at = j.fireTick;
+        if (delta >= RANGE_TICKS) at = curTick + RANGE_TICKS - 1;   // re-cascades later
+
+        int level = 0;
+        while (level < LEVELS - 1 && (at - curTick) >= (1UL << (SLOT_BITS * (level + 1)))) level++;
+        link(id, level, (at >> (SLOT_BITS * level)) & (SLOTS - 1));
+    }
+
+    // Expiry tick in [due, due + slack] with the most trailing zero bits
+    static uint32_t coalesce(uint64_t dueMs, uint32_t slackMs) {
+        uint32_t lo = toTick(dueMs + TICK_MS - 1);
+        uint32_t hi = toTick(dueMs + slackMs);
+        if ((int32_t)(hi - lo) <= 0) return lo;
+        uint32_t bit = 31 - __builtin_clz(lo ^ hi);
+        return hi & ~((1UL << bit) - 1);
+    }
+
+    void arm(int8_t id, uint64_t dueMs) {
+        Job& j = jobs[id];
+        unlink(id);
+        j.dueMs = dueMs;
+        j.fireTick = coalesce(dueMs, j.slackMs);
+        j.active = true;
+        insert(id, curTick + 1);
+    }
+
+    // Tick at which level L next visits a non-empty slot (false: none)
+    bool nextVisit(int level, uint32_t& tick) const {
+        uint64_t bm = occupied[level];
+        if (!bm) return false;
+        uint32_t shift = SLOT_BITS * level;
+        uint32_t idx = (curTick >> shift) & (SLOTS - 1);
+        uint32_t r = (idx + 1) & (SLOTS - 1);
+        uint64_t rot = r ? (bm >> r) | (bm << (SLOTS - r)) : bm;
+        uint32_t off = __builtin_ctzll(rot) + 1;
+        tick = ((curTick >> shift) + off) << shift;
+        return true;
+    }
+
+    // Earliest tick anything happens (expiry or cascade)
+    bool nextEvent(uint32_t& tick) const {
+        bool any = false;
+        for (int l = 0; l < LEVELS; l++) {
+            uint32_t t;
+            if (nextVisit(l, t) && (!any || (int32_t)(t - tick) < 0)) {
+                tick = t;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    // Earliest expiry: each level's minimum is in its next visited slot
+    bool nextFire(uint32_t& tick) const {
+        bool any = false;
+        for (int l = 0; l < LEVELS; l++) {
+            uint32_t t;
+            if (!nextVisit(l, t)) continue;
+            if (l > 0) {
+                // Jobs fire inside their slot's span, except ones beyond
+                // the wheel range: those only need the cascade at visit
+                uint32_t span = 1UL << (SLOT_BITS * l);
+                int slot = (t >> (SLOT_BITS * l)) & (SLOTS - 1);
+                uint32_t visit = t;
+                t = visit + span;
+                for (int8_t id = head[l][slot]; id >= 0; id = jobs[id].next) {
+                    uint32_t f = jobs[id].fireTick;
+                    if (f - visit >= span) f = visit;
+                    if ((int32_t)(f - t) < 0) t = f;
+                }
+            }
+            if (!any || (int32_t)(t - tick) < 0) {
+                tick = t;
+                any = true;
+            }
+        }
+        return any;
+    }
+
+    void cascade(int level, uint32_t tick) {
+        int slot = (tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+        int8_t id = head[level][slot];
+        head[level][slot] = -1;
+        occupied[level] &= ~(1ULL << slot);
+        while (id >= 0) {
+            int8_t next = jobs[id].next;
+            jobs[id].level = jobs[id].slot = -1;
+            insert(id, curTick);
+            id = next;
+        }
+    }
+
+    uint32_t expire(uint32_t tick, uint64_t now) {
+        int slot = tick & (SLOTS - 1);
+        int8_t due[MAX_JOBS];
+        int n = 0;
+        for (int8_t id = head[0][slot]; id >= 0; id = jobs[id].next) due[n++] = id;
+        head[0][slot] = -1;
+        occupied[0] &= ~(1ULL << slot);
+        for (int i = 0; i < n; i++) jobs[due[i]].level = jobs[due[i]].slot = -1;
+
+        uint32_t ran = 0;
+        for (int i = 0; i < n; i++) {
+            Job& j = jobs[due[i]];
+            // Stopped or re-armed by an earlier callback in this batch
+            if (!j.active || j.level >= 0) continue;
+
+            uint32_t jitter = now > j.dueMs ? (uint32_t)(now - j.dueMs) : 0;
+            j.runs++;
+            j.totalJitterMs += jitter;
+            if (jitter > j.maxJitterMs) j.maxJitterMs = jitter;
+            if (jitter > j.slackMs + TICK_MS) j.late++;
+
+            // Re-arm first so the callback may stop or restart its own job
+            if (j.periodMs) {
+                uint64_t next = j.dueMs + j.periodMs;
+                if (next <= now) {
+                    uint64_t missed = (now - next) / j.periodMs + 1;
+                    j.skipped += missed;
+                    next += missed * j.periodMs;
+                }
+                arm(due[i], next);
+            } else {
+                j.active = false;
+            }
+
+            uint32_t t0 = micros();
+            j.cb(j.arg);
+            uint32_t us = micros() - t0;
+            if (us > j.maxRunUs) j.maxRunUs = us;
+            ran++;
+        }
+        return ran;
+    }
+
+    void resetJob(int8_t id) {
+        Job& j = jobs[id];
+        memset(&j, 0, sizeof(j));
+        j.next = j.prev = j.level = j.slot = -1;
+    }
+
+public:
+    explicit TimerWheel(const char* name) : wheelName(name) {
+        for (int8_t i = 0; i < MAX_JOBS; i++) resetJob(i);
+        memset(head, -1, sizeof(head));
+        memset(occupied, 0, sizeof(occupied));
+        TimerWheel** r = registry();
+        for (int i = 0; i < MAX_WHEELS; i++) {
+            if (!r[i]) {
+                r[i] = this;
+                break;
+            }
+        }
+    }
+
+    ~TimerWheel() {
+        TimerWheel** r = registry();
+        for (int i = 0; i < MAX_WHEELS; i++) if (r[i] == this) r[i] = nullptr;
+    }
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    static uint64_t clockMs() { return (uint64_t)esp_timer_get_time() / 1000; }
+
+    // Register a stopped job; -1 when the wheel is full
+    int add(const char* name, Callback cb, void* arg = nullptr, uint32_t slackMs = 0) {
+        for (int8_t i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].used) continue;
+            resetJob(i);
+            Job& j = jobs[i];
+            j.used = true;
+            j.name = name;
+            j.cb = cb;
+            j.arg = arg;
+            j.slackMs = slackMs;
+            return i;
+        }
+        return -1;
+    }
+
+    // First run after firstMs (default: one period), then every periodMs
+    void startPeriodic(int id, uint32_t periodMs, uint32_t firstMs = NEVER, uint64_t now = clockMs()) {
+        if (id < 0 || id >= MAX_JOBS || !jobs[id].used || !periodMs) return;
+        sync(now);
+        jobs[id].periodMs = periodMs;
+        arm(id, now + (firstMs == NEVER ? periodMs : firstMs));
+    }
+
+    void startOnce(int id, uint32_t delayMs, uint64_t now = clockMs()) {
+        if (id < 0 || id >= MAX_JOBS || !jobs[id].used) return;
+        sync(now);
+        jobs[id].periodMs = 0;
+        arm(id, now + delayMs);
+    }
+
+    void stop(int id) {
+        if (id < 0 || id >= MAX_JOBS) return;
+        unlink(id);
+        jobs[id].active = false;
+    }
+
+    bool active(int id) const { return id >= 0 && id < MAX_JOBS && jobs[id].active; }
+
+    // Change the period of a periodic job, keeping its phase from now
+    void setPeriod(int id, uint32_t periodMs, uint64_t now = clockMs()) {
+        if (!active(id) || !jobs[id].periodMs || !periodMs) return;
+        startPeriodic(id, periodMs, periodMs, now);
+    }
+
+    int every(const char* name, uint32_t periodMs, Callback cb, void* arg = nullptr,
+              uint32_t slackMs = 0, uint64_t now = clockMs()) {
+        int id = add(name, cb, arg, slackMs);
+        startPeriodic(id, periodMs, NEVER, now);
+        return id;
+    }
+
+    int after(const char* name, uint32_t delayMs, Callback cb, void* arg = nullptr,
+              uint32_t slackMs = 0, uint64_t now = clockMs()) {
+        int id = add(name, cb, arg, slackMs);
+        startOnce(id, delayMs, now);
+        return id;
+    }
+
+    // Run everything due by now; returns ms until the next job (NEVER: none)
+    uint32_t run(uint64_t now = clockMs()) {
+        sync(now);
+        uint32_t target = toTick(now);
+        uint32_t ran = 0;
+        uint32_t t = 0;
+        // Jump straight to ticks where something happens
+        while (nextEvent(t) && (int32_t)(t - target) <= 0) {
+            curTick = t;
+            if (!(t & (SLOTS - 1))) {
+                for (int l = LEVELS - 1; l > 0; l--) {
+                    if (!(t & ((1UL << (SLOT_BITS * l)) - 1))) cascade(l, t);
+                }
+            }
+            ran += expire(t, now);
+        }
+        if ((int32_t)(target - curTick) > 0) curTick = target;
+        if (ran) {
+            wakeups++;
+            fired += ran;
+        }
+        return msUntilNext(now);
+    }
+
+    uint32_t msUntilNext(uint64_t now = clockMs()) const {
+        uint32_t t = 0;
+        if (!nextFire(t)) return NEVER;
+        int32_t ticks = (int32_t)(t - toTick(now));
+        if (ticks <= 0) return 0;
+        if ((uint32_t)ticks >= (NEVER - TICK_MS) / TICK_MS) return NEVER - 1;
+        return (uint32_t)ticks * TICK_MS - (uint32_t)(now % TICK_MS);
+    }
+
+    const char* name() const { return wheelName; }
+
+    // -------- Stats --------
+    void printStats() const {
+        Serial.printf("⏲️ Timers %s: %lu wakeups, %lu jobs run\n", wheelName,
+                      (unsigned long)wakeups, (unsigned long)fired);
+        for (int i = 0; i < MAX_JOBS; i++) {
+            const Job& j = jobs[i];
+            if (!j.used) continue;
+            Serial.printf("   %-10s n:%6lu jitter avg:%5lums max:%6lums late:%lu skipped:%lu run max:%7luus\n",
+                          j.name, (unsigned long)j.runs,
+                          (unsigned long)(j.runs ? j.totalJitterMs / j.runs : 0),
+                          (unsigned long)j.maxJitterMs, (unsigned long)j.late,
+                          (unsigned long)j.skipped, (unsigned long)j.maxRunUs);
+        }
+    }
+
+    void writeJson(Print& out) const {
+        out.printf("{\"wakeups\":%lu,\"fired\":%lu,\"jobs\":{", (unsigned long)wakeups,
+                   (unsigned long)fired);
+        bool first = true;
+        for (int i = 0; i < MAX_JOBS; i++) {
+            const Job& j = jobs[i];
+            if (!j.used) continue;
+            out.printf("%s\"%s\":{\"active\":%s,\"period_ms\":%lu,\"slack_ms\":%lu,",
+                       first ? "" : ",", j.name, j.active ? "true" : "false",
+                       (unsigned long)j.periodMs, (unsigned long)j.slackMs);
+            out.printf("\"runs\":%lu,\"jitter_avg_ms\":%lu,\"jitter_max_ms\":%lu,",
+                       (unsigned long)j.runs,
+                       (unsigned long)(j.runs ? j.totalJitterMs / j.runs : 0),
+                       (unsigned long)j.maxJitterMs);
+            out.printf("\"late\":%lu,\"skipped\":%lu,\"run_max_us\":%lu}", (unsigned long)j.late,
+                       (unsigned long)j.skipped, (unsigned long)j.maxRunUs);
+            first = false;
+        }
+        out.print("}}");
+    }
+
+    static void printAll() {
+        TimerWheel** r = registry();
+        for (int i = 0; i < MAX_WHEELS; i++) if (r[i]) r[i]->printStats();
+    }
+
+    static void writeJsonAll(Print& out) {
+        TimerWheel** r = registry();
+        out.print("{");
+        bool first = true;
+        for (int i = 0; i < MAX_WHEELS; i++) {
+            if (!r[i]) continue;
+            out.printf("%s\"%s\":", first ? "" : ",", r[i]->wheelName);
+            r[i]->writeJson(out);
+            first = false;
+        }
+        out.print("}");
+    }
+};
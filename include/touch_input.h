@@ -0,0 +1,166 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "config.h"
+
+// -----------------------------------
+// Touch Input (TTP223B, HIGH while touched)
+// A CHANGE interrupt wakes a small task that debounces the pin with a
+// timeout, decodes tap / double tap / long press and queues gestures.
+// loop() drains the queue with poll(), which never blocks; setListener()
+// names a task to notify when a gesture is queued.
+//
+// A single tap is reported TOUCH_DOUBLE_TAP_MS after release, once it is
+// clear no second tap follows.
+// -----------------------------------
+class TouchInput {
+public:
+    enum Gesture : uint8_t {
+        TAP,
+        DOUBLE_TAP,
+        LONG_PRESS
+    };
+
+private:
+    struct State {
+        TaskHandle_t task;
+        TaskHandle_t listener;  // notified per queued gesture
+        QueueHandle_t events;
+        uint8_t pin;
+        bool pressed;           // debounced level
+        bool longFired;         // current press already reported as long press
+        uint32_t debounceAt;    // deadlines in millis(), 0 = not armed
+        uint32_t longAt;
+        uint32_t tapAt;
+        uint32_t dropped;       // gestures lost to a full queue
+    };
+
+    static State& state() {
+        static State s = {nullptr, nullptr, nullptr, TOUCH_PIN, false, false, 0, 0, 0, 0};
+        return s;
+    }
+
+    static void IRAM_ATTR onEdge() {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(state().task, &woken);
+        if (woken) portYIELD_FROM_ISR();
+    }
+
+    static void emit(Gesture g) {
+        if (xQueueSend(state().events, &g, 0) != pdTRUE) state().dropped++;
+        else if (state().listener) xTaskNotifyGive(state().listener);
+    }
+
+    static uint32_t arm(uint32_t now, uint32_t ms) {
+        uint32_t at = now + ms;
+        return at ? at : 1;  // 0 means "not armed"
+    }
+
+    static bool due(uint32_t at, uint32_t now) {
+        return at && (int32_t)(now - at) >= 0;
+    }
+
+    // Debounced level change
+    static void onLevel(bool pressed, uint32_t now) {
+        State& s = state();
+        s.pressed = pressed;
+
+        if (pressed) {
+            s.longFired = false;
+            s.longAt = arm(now, TOUCH_LONG_PRESS_MS);
+            return;
+        }
+
+        s.longAt = 0;
+        if (s.longFired) return;  // release after a long press
+
+        if (s.tapAt) {
+            s.tapAt = 0;
+            emit(DOUBLE_TAP);
+        } else {
+            s.tapAt = arm(now, TOUCH_DOUBLE_TAP_MS);
+        }
+    }
+
+    static TickType_t nextWait(uint32_t now) {
+        State& s = state();
+        uint32_t wait = UINT32_MAX;
+        const uint32_t deadlines[3] = {s.debounceAt, s.longAt, s.tapAt};
+        for (uint32_t at : deadlines) {
+            if (!at) continue;
+            int32_t left = (int32_t)(at - now);
+            uint32_t ms = left > 0 ? (uint32_t)left : 0;
+            if (ms < wait) wait = ms;
+        }
+        return wait == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(wait);
+    }
+
+    static void taskMain(void*) {
+        State& s = state();
+        for (;;) {
+            bool edge = ulTaskNotifyTake(pdTRUE, nextWait(millis())) > 0;
+            uint32_t now = millis();
+
+            // Every edge restarts the debounce window
+            if (edge) s.debounceAt = arm(now, TOUCH_DEBOUNCE_MS);
+
+            if (due(s.debounceAt, now)) {
+                s.debounceAt = 0;
+                bool level = digitalRead(s.pin) == HIGH;
+                if (level != s.pressed) onLevel(level, now);
+            }
+            if (due(s.longAt, now)) {
+                s.longAt = 0;
+                s.longFired = true;
+                emit(LONG_PRESS);
+            }
+            if (due(s.tapAt, now)) {
+                s.tapAt = 0;
+                emit(TAP);
+            }
+        }
+    }
+
+public:
+    static bool begin(uint8_t pin = TOUCH_PIN) {
+        State& s = state();
+        if (s.task) return true;
+
+        s.pin = pin;
+        s.events = xQueueCreate(8, sizeof(Gesture));
+        if (!s.events) return false;
+
+        pinMode(pin, INPUT);
+        s.pressed = digitalRead(pin) == HIGH;
+
+        if (xTaskCreatePinnedToCore(taskMain, "Touch", 2048, nullptr, 2, &s.task,
+                                    tskNO_AFFINITY) != pdPASS) {
+            Serial.println("❌ Failed to create touch task");
+            return false;
+        }
+        attachInterrupt(digitalPinToInterrupt(pin), onEdge, CHANGE);
+        return true;
+    }
+
+    static void setListener(TaskHandle_t task) {
+        state().listener = task;
+    }
+
+    // Next queued gesture; false when there is none
+    static bool poll(Gesture& g) {
+        return state().events && xQueueReceive(state().events, &g, 0) == pdTRUE;
+    }
+
+    static const char* name(Gesture g) {
+        switch (g) {
+            case TAP:        return "tap";
+            case DOUBLE_TAP: return "double tap";
+            case LONG_PRESS: return "long press";
+        }
+        return "?";
+    }
+
+    static uint32_t dropped() { return state().dropped; }
+};
@@ -0,0 +1,200 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// -----------------------------------
+// Trend History
+// One min/max slot per OLED pixel column for the last hour and the last
+// day, plus the pre-rendered 24 px bitmap of every column. A sample only
+// updates (or opens) the newest column and re-renders that one column;
+// drawing the sparkline copies the ring oldest -> newest.
+// Plain C++ (no Arduino dependencies) so it can be exercised on the host.
+// -----------------------------------
+namespace Trend {
+
+constexpr uint8_t COLUMNS = 128;
+constexpr uint8_t PLOT_H = 24;              // OLED rows 8-31 (pages 1-3)
+constexpr int16_t EMPTY = INT16_MIN;
+
+constexpr uint32_t HOUR_COLUMN_MS = 3600000UL / COLUMNS;   // 28.1 s
+constexpr uint32_t DAY_COLUMN_MS  = 86400000UL / COLUMNS;  // 11.25 min
+
+enum Channel : uint8_t { PM25, AQI, TVOC, TEMP, CHANNEL_COUNT };
+
+struct ChannelSpec {
+    const char* label;
+    float unit;              // stored value = reading / unit
+    bool zeroBased;          // axis starts at 0 (else at the window minimum)
+    int16_t rungs[6];        // axis spans to pick from, in stored units
+};
+
+inline const ChannelSpec& spec(Channel c) {
+    static const ChannelSpec specs[CHANNEL_COUNT] = {
+        {"PM2.5", 1.0f, true,  {25, 50, 100, 250, 500, 1000}},
+        {"AQI",   1.0f, true,  {50, 100, 200, 300, 400, 500}},
+        {"TVOC",  1.0f, true,  {250, 500, 1000, 2500, 5000, 10000}},
+        {"Temp",  0.1f, false, {20, 50, 100, 200, 400, 800}},      // 2-80 C
+    };
+    return specs[c];
+}
+
+class Ring {
+    int16_t minV[COLUMNS];
+    int16_t maxV[COLUMNS];
+    uint32_t bits[COLUMNS];     // bit r = plot row r (0 = top)
+
+    const ChannelSpec* sp = nullptr;
+    uint32_t periodMs = HOUR_COLUMN_MS;
+    uint32_t columnStart = 0;
+    uint8_t head = 0;           // newest (open) column
+    bool started = false;
+    int16_t last = EMPTY;       // held across columns with no sample
+    int16_t lo = 0, hi = 1;
+
+    uint8_t row(int16_t v) const {
+        int32_t r = (PLOT_H - 1) - (int32_t)(v - lo) * (PLOT_H - 1) / (hi - lo);
+        if (r < 0) r = 0;
+        if (r > PLOT_H - 1) r = PLOT_H - 1;
+        return (uint8_t)r;
+    }
+
+    void renderColumn(uint8_t i) {
+        if (minV[i] == EMPTY) {
+            bits[i] = 0;
+            return;
+        }
+        uint8_t top = row(maxV[i]);
+        uint8_t bottom = row(minV[i]);
+        bits[i] = ((1UL << (bottom - top + 1)) - 1) << top;
+    }
+
+    // Axis from the rung ladder; true (and all columns re-rendered) if it moved
+    bool rescale() {
+        int16_t wmin = INT16_MAX, wmax = INT16_MIN + 1;
+        for (uint8_t i = 0; i < COLUMNS; i++) {
+            if (minV[i] == EMPTY) continue;
+            if (minV[i] < wmin) wmin = minV[i];
+            if (maxV[i] > wmax) wmax = maxV[i];
+        }
+        if (wmin > wmax) return false;
+
+        int16_t step = sp->rungs[0];
+        int32_t newLo = 0;
+        if (!sp->zeroBased || wmin < 0) {
+            newLo = (wmin >= 0) ? (wmin / step) * step : -((-wmin + step - 1) / step) * step;
+        }
+        int32_t span = sp->rungs[5];
+        for (uint8_t r = 0; r < 6; r++) {
+            if (newLo + sp->rungs[r] >= wmax) { span = sp->rungs[r]; break; }
+        }
+        while (newLo + span < wmax && span < INT16_MAX / 2) span *= 2;
+
+        int32_t newHi = newLo + span;
+        if (newHi > INT16_MAX) newHi = INT16_MAX;
+        if (newLo == lo && newHi == hi) return false;
+
+        lo = (int16_t)newLo;
+        hi = (int16_t)newHi;
+        for (uint8_t i = 0; i < COLUMNS; i++) renderColumn(i);
+        return true;
+    }
+
+    // Close finished columns; gaps hold the last value so the line stays joined
+    void advance(uint32_t nowMs) {
+        uint32_t steps = (nowMs - columnStart) / periodMs;
+        if (steps == 0) return;
+        columnStart += steps * periodMs;
+        if (steps > COLUMNS) steps = COLUMNS;
+
+        for (uint32_t s = 0; s < steps; s++) {
+            head = (head + 1) % COLUMNS;
+            minV[head] = maxV[head] = last;
+            renderColumn(head);
+        }
+        // A column left the window: the axis may shrink (once per column period)
+        rescale();
+    }
+
+public:
+    void begin(const ChannelSpec& channelSpec, uint32_t columnMs) {
+        sp = &channelSpec;
+        periodMs = columnMs;
+        started = false;
+        last = EMPTY;
+        head = 0;
+        lo = 0;
+        hi = channelSpec.rungs[0];
+        for (uint8_t i = 0; i < COLUMNS; i++) {
+            minV[i] = maxV[i] = EMPTY;
+            bits[i] = 0;
+        }
+    }
+
+    // Constant time unless the value leaves the current axis range
+    void add(uint32_t nowMs, float value) {
+        if (!started) {
+            started = true;
+            columnStart = nowMs;
+        } else {
+            advance(nowMs);
+        }
+
+        if (isnan(value)) {
+            last = EMPTY;   // don't bridge sensor dropouts
+            return;
+        }
+
+        float q = roundf(value / sp->unit);
+        if (q < INT16_MIN + 1) q = INT16_MIN + 1;
+        if (q > INT16_MAX) q = INT16_MAX;
+        int16_t v = (int16_t)q;
+
+        if (minV[head] == EMPTY) {
+            minV[head] = maxV[head] = v;
+        } else {
+            if (v < minV[head]) minV[head] = v;
+            if (v > maxV[head]) maxV[head] = v;
+        }
+        last = v;
+
+        if (v < lo || v > hi) {
+            if (rescale()) return;
+        }
+        renderColumn(head);
+    }
+
+    // Pre-rendered column x (0 = oldest, COLUMNS-1 = newest)
+    uint32_t column(uint8_t x) const {
+        return bits[(head + 1 + x) % COLUMNS];
+    }
+
+    float latest() const { return last == EMPTY ? NAN : last * sp->unit; }
+    float axisMin() const { return lo * sp->unit; }
+    float axisMax() const { return hi * sp->unit; }
+};
+
+struct History {
+    Ring hour[CHANNEL_COUNT];
+    Ring day[CHANNEL_COUNT];
+
+    void begin() {
+        for (uint8_t c = 0; c < CHANNEL_COUNT; c++) {
+            hour[c].begin(spec((Channel)c), HOUR_COLUMN_MS);
+            day[c].begin(spec((Channel)c), DAY_COLUMN_MS);
+        }
+    }
+
+    void add(uint32_t nowMs, float pm25, float aqi, float tvoc, float temp) {
+        const float v[CHANNEL_COUNT] = {pm25, aqi, tvoc, temp};
+        for (uint8_t c = 0; c < CHANNEL_COUNT; c++) {
+            hour[c].add(nowMs, v[c]);
+            day[c].add(nowMs, v[c]);
+        }
+    }
+
+    const Ring& ring(Channel c, bool lastDay) const {
+        return lastDay ? day[c] : hour[c];
+    }
+};
+
+} // namespace Trend
@@ -1,40 +1,199 @@
 #pragma once
 #include <Wire.h>
 #include <Adafruit_AGS02MA.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_private/esp_clk.h>
 #include "config.h"
+#include "i2c_bus.h"
+#include "bus_trace.h"
+#include "async_log.h"
+#include "sensor_health.h"
 
+// -----------------------------------
+// TVOC Sensor (AGS02MA)
+// Reads are split in two: trigger() selects the TVOC register and starts
+// a conversion, fetch() collects it AGS_CONVERSION_MS later into a cache.
+// Neither waits on the sensor, so a 25 kHz read costs two short
+// transfers instead of holding the bus through the conversion.
+//
+// The heater stays powered through software/watchdog resets and sleep,
+// so the warm-up start and the last good reading are kept in RTC memory
+// on the RTC clock, which keeps counting through all of them. Only a
+// power-on or brownout reset starts the 120 s warm-up again.
+// -----------------------------------
 class TVOCSensor {
+public:
+    static constexpr uint8_t ADDR = 0x1A;
+
 private:
+    static constexpr uint8_t REG_TVOC = 0x00;         // status + 24-bit ppb + CRC
+    static constexpr uint8_t STATUS_PREHEAT = 0x01;   // RDY bit: heater not stable yet
+    static constexpr uint32_t RTC_MAGIC = 0x54564F31; // "TVO1"
+
+    struct RtcState {
+        uint32_t magic;
+        uint64_t warmupStartUs;   // RTC clock
+        uint64_t lastGoodUs;      // 0 = no reading yet
+        float lastPpb;
+    };
+
+    static RtcState& rtc() {
+        RTC_NOINIT_ATTR static RtcState st;
+        return st;
+    }
+
+    // Counts through resets and sleep; only power-on restarts it
+    static uint64_t rtcUs() { return esp_clk_rtc_time(); }
+
+    // CRC-8, polynomial 0x31, init 0xFF (AGS02MA datasheet)
+    static uint8_t crc8(const uint8_t* p, uint8_t n) {
+        uint8_t crc = 0xFF;
+        while (n--) {
+            crc ^= *p++;
+            for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+        return crc;
+    }
+
     Adafruit_AGS02MA sensor;
-    unsigned long warmupStart = 0;
-    const unsigned long warmupTime = 120000; // 120 sec (per AGS02MA datasheet)
+    uint32_t triggeredMs = 0;
+    bool pending = false;       // conversion started, not fetched
+    bool preheating = false;    // sensor still reports RDY = preheat
+    bool polled = false;        // last readTVOC() talked to the sensor
+    bool fetched = false;       // ...and collected a new reading
+    SensorHealth::Fault fault = SensorHealth::FAULT_NONE;
 
 public:
     TVOCSensor() {}
 
     bool begin(uint8_t sda = AGS_SDA_PIN, uint8_t scl = AGS_SCL_PIN) {
-        Wire.begin(sda, scl);
-        Wire.setClock(25000L); // recommended for AGS02MA
+        // Own controller: the 25 kHz clock never touches the OLED bus
+        if (!I2CBus::begin(I2CBus::SENSOR, sda, scl, AGS_I2C_HZ)) return false;
+
+        {
+            I2CBus::Transaction tx(I2CBus::SENSOR);
+            bool ok = tx.ok() && sensor.begin(&tx.wire());
+            if (!ok) {
+                tx.fail();
+                return false;
+            }
+        }
+        pending = false;
 
-        bool ok = sensor.begin();
-        if (ok) warmupStart = millis();   // start warm-up timer
-        return ok;
+        RtcState& st = rtc();
+        esp_reset_reason_t why = esp_reset_reason();
+        if (st.magic != RTC_MAGIC || why == ESP_RST_POWERON || why == ESP_RST_BROWNOUT) {
+            st = {RTC_MAGIC, rtcUs(), 0, NAN};   // heater was off: start warm-up
+        } else {
+            LOG_I("☁️  TVOC heater warm for %lus - warm-up carried over",
+                  (unsigned long)((rtcUs() - st.warmupStartUs) / 1000000));
+        }
+        return true;
     }
 
-    bool isWarmingUp() {
-        return (millis() - warmupStart) < warmupTime;
+    bool isWarmingUp() const {
+        return rtcUs() - rtc().warmupStartUs < (uint64_t)TVOC_WARMUP_MS * 1000 || preheating;
     }
 
-    float readTVOC() {
-        if (isWarmingUp()) {
-            return NAN;  // do not read until stable
+    // Start a conversion. False while warming up or if the sensor did not answer.
+    bool trigger() {
+        if (rtcUs() - rtc().warmupStartUs < (uint64_t)TVOC_WARMUP_MS * 1000) return false;
+        I2CBus::Transaction tx(I2CBus::SENSOR);
+        if (!tx.ok()) {
+            fault = SensorHealth::FAULT_BUSY;
+            return false;
         }
+        TwoWire& w = tx.wire();
+        w.beginTransmission(ADDR);
+        w.write(REG_TVOC);
+        if (w.endTransmission() != 0) {
+            tx.fail();
+            fault = SensorHealth::FAULT_NACK;
+            return false;
+        }
+        triggeredMs = millis();
+        pending = true;
+        return true;
+    }
 
-        float value = sensor.getTVOC();
+    // A triggered conversion has had time to finish
+    bool ready() const {
+        return pending && millis() - triggeredMs >= AGS_CONVERSION_MS;
+    }
+
+    // Collect a finished conversion into the cache. False if none is ready
+    // or the read failed (NACK, bad CRC).
+    bool fetch() {
+        if (!ready()) return false;
+
+        uint8_t buf[5];
+        bool ok;
+        {
+            I2CBus::Transaction tx(I2CBus::SENSOR);
+            if (!tx.ok()) {
+                fault = SensorHealth::FAULT_BUSY;
+                return false;   // retried on the next call
+            }
+            pending = false;
+            TwoWire& w = tx.wire();
+            ok = w.requestFrom(ADDR, (uint8_t)sizeof(buf)) == sizeof(buf);
+            for (uint8_t i = 0; i < sizeof(buf); i++) buf[i] = ok ? (uint8_t)w.read() : 0;
+            fault = !ok ? SensorHealth::FAULT_NACK
+                        : crc8(buf, 4) != buf[4] ? SensorHealth::FAULT_CHECKSUM : SensorHealth::FAULT_NONE;
+            ok = fault == SensorHealth::FAULT_NONE;
+            if (!ok) tx.fail();
+        }
+
+        float ppb = ok ? (float)(((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3]) : -1;
+        BusTrace::tvoc(ppb);   // negative = failed read
+        if (!ok) return false;
+
+        preheating = buf[0] & STATUS_PREHEAT;
+        if (!preheating) {
+            RtcState& st = rtc();
+            st.lastPpb = ppb;
+            st.lastGoodUs = rtcUs();
+        }
+        return true;
+    }
+
+    // ms since the cached reading was taken (UINT32_MAX: none yet)
+    uint32_t ageMs() const {
+        const RtcState& st = rtc();
+        if (!st.lastGoodUs) return UINT32_MAX;
+        uint64_t age = (rtcUs() - st.lastGoodUs) / 1000;
+        return age > UINT32_MAX ? UINT32_MAX : (uint32_t)age;
+    }
+
+    // Cached reading; NAN while warming up or once older than maxAgeMs
+    float cached(uint32_t maxAgeMs = TVOC_MAX_AGE_MS) const {
+        if (isWarmingUp() || ageMs() > maxAgeMs) return NAN;
+        return rtc().lastPpb;
+    }
+
+    // One acquisition step: collect the previous conversion, start the
+    // next one, return the cache. Never waits for the sensor.
+    float readTVOC() {
+        fault = SensorHealth::FAULT_NONE;
+        polled = ready();
+        fetched = fetch();
+        if (!pending && !trigger() && fault != SensorHealth::FAULT_NONE) polled = true;
+        return cached();
+    }
 
-        // library returns negative on failure
-        if (value < 0) return NAN;
+    // Last readTVOC(): whether it reached the sensor, why it failed, and
+    // whether the value it returned is a new reading
+    bool lastPolled() const { return polled; }
+    SensorHealth::Fault lastFault() const { return fault; }
+    bool fresh() const { return fetched && !preheating; }
 
-        return value;
+    // Recovery: re-run the driver's init (the warm-up state is kept)
+    bool reinit() {
+        I2CBus::Transaction tx(I2CBus::SENSOR);
+        pending = false;
+        if (tx.ok() && sensor.begin(&tx.wire())) return true;
+        tx.fail();
+        return false;
     }
 };
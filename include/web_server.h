@@ -5,115 +5,254 @@
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <esp_task_wdt.h>
 
-#include "pm_sensor.h"
-#include "tvoc_sensor.h"
-#include "temp_humidity_sensor.h"
+#include "sensor_sample.h"
 #include "iaq_calculator.h"
-#include "battery_monitor.h"
+#include "power_manager.h"
+#include "power_locks.h"
+#include "pipeline_stats.h"
+#include "bus_trace_store.h"
+#include "profiler.h"
+#include "async_log.h"
+#include "sample_json.h"
+#include "sample_cbor.h"
+#include "batch_body.h"
+#include "heap_stats.h"
+#include "timer_wheel.h"
+#include "boot_sequence.h"
+#include "i2c_bus.h"
+#include "stream_stats.h"
+#include "fleet_sync.h"
 
 class WebServerModule {
 private:
     AsyncWebServer &server;
-    PMSensor &pm_sensor;
-    TVOCSensor &tvoc_sensor;
-    TempHumiditySensor &temp_hum_sensor;
+
+    static constexpr uint32_t UPLOAD_SLACK_MS = 1000;  // may share a wakeup with other jobs
 
     unsigned long uploadIntervalMs = 30000;  // Default 30 seconds
-    unsigned long lastUploadTime = 0;
-    String apiEndpoint = "https://home-sense.vercel.app/api/aqi";  // Default endpoint
+    char apiEndpoint[128] = "https://home-sense.vercel.app/api/aqi";  // Default endpoint
+    char batchEndpoint[128] = UPLOAD_BATCH_ENDPOINT;   // empty: no batch route, one POST per sample
+    bool uploadCbor = false;  // "upload_format": "cbor" in config.json
 
     bool asyncPost = true;
+    volatile bool online = false;
+    volatile bool uploadRequested = false;
+    uint32_t urgentAtMs = 0;         // last automatic (category-change) request
+    bool urgentSent = false;
+    volatile bool urgentDeferred = false;   // one came inside UPLOAD_URGENT_MIN_MS
+
+    // Periodic "upload" job on the caller's timer wheel; marks the next
+    // sample for upload
+    TimerWheel* timers = nullptr;
+    int uploadJob = -1;
+    bool uploadDue = true;  // first sample after going online
+
+    // Latest fused sample for /sensor_data (sensors belong to the pipeline)
+    FusedSample latest;
+    bool haveLatest = false;
+    portMUX_TYPE latestMux = portMUX_INITIALIZER_UNLOCKED;
+
+    // Async uploads: one persistent task fed from a single slot, instead
+    // of a new task (8 KB stack) and a heap-allocated copy per upload
+    TaskHandle_t uploadTask = nullptr;
+    SampleJson::Fields pendingUpload;
+    volatile bool uploadBusy = false;
+    volatile int asyncResult = 0;   // HTTP code of the last async upload, for the fleet
+
+    // LAN fleet (config.json "fleet"): batches for the group when this
+    // unit is the aggregator, leaves uploads to it otherwise
+    FleetSync fleet;
+    FleetSync::Settings fleetSettings;
+
+    // Batch bodies: the fleet batch, or buffered low-power samples (a
+    // full LP_FLUSH_EVERY flush fits one)
+    static constexpr size_t BATCH_RECORDS = FLEET_MAX_DEVICES > LP_FLUSH_EVERY ? FLEET_MAX_DEVICES : LP_FLUSH_EVERY;
+    uint8_t batchBody[BatchBody::maxLen(BATCH_RECORDS)];
+
+    // Copy a URL from config.json; false (and the default stays) if too long
+    static bool loadUrl(const char* value, char* dst, size_t cap, const char* key) {
+        if (strlen(value) >= cap) {
+            LOG_W("⚠️ %s longer than %u chars - keeping default", key, (unsigned)(cap - 1));
+            return false;
+        }
+        if (!*value) return false;
+        strlcpy(dst, value, cap);
+        return true;
+    }
 
     // Load configuration from LittleFS
     void loadConfig() {
         if (!LittleFS.exists("/config.json")) {
-            Serial.println("⚠️ config.json not found, using defaults");
+            LOG_W("⚠️ config.json not found, using defaults");
             return;
         }
 
         File file = LittleFS.open("/config.json", "r");
         if (!file) {
-            Serial.println("⚠️ Failed to open config.json");
+            LOG_W("⚠️ Failed to open config.json");
             return;
         }
 
-        StaticJsonDocument<512> doc;
+        StaticJsonDocument<1024> doc;
         DeserializationError err = deserializeJson(doc, file);
         file.close();
 
         if (err) {
-            Serial.println("❌ Config JSON parse failed");
+            LOG_E("❌ Config JSON parse failed");
             return;
         }
 
         // Load upload interval
         if (doc.containsKey("upload_interval_ms")) {
             uploadIntervalMs = doc["upload_interval_ms"].as<unsigned long>();
-            Serial.printf("✅ Upload interval: %lu ms\n", uploadIntervalMs);
+            LOG_I("✅ Upload interval: %lu ms", uploadIntervalMs);
+            if (timers) timers->setPeriod(uploadJob, uploadIntervalMs);
         }
 
         // Load API endpoint
-        if (doc.containsKey("api_endpoint")) {
-            apiEndpoint = doc["api_endpoint"].as<String>();
-            Serial.printf("✅ API endpoint: %s\n", apiEndpoint.c_str());
+        if (loadUrl(doc["api_endpoint"] | "", apiEndpoint, sizeof(apiEndpoint), "api_endpoint")) {
+            LOG_I("✅ API endpoint: %s", apiEndpoint);
+        }
+
+        // Batch route (README "Batch Uploads"), for low-power flushes
+        if (loadUrl(doc["batch_endpoint"] | "", batchEndpoint, sizeof(batchEndpoint), "batch_endpoint")) {
+            LOG_I("✅ Batch endpoint: %s", batchEndpoint);
+        }
+
+        // Upload body encoding (the endpoint must accept application/cbor)
+        if (doc.containsKey("upload_format")) {
+            const char* format = doc["upload_format"] | "json";
+            uploadCbor = strcmp(format, "cbor") == 0;
+            LOG_I("✅ Upload format: %s", uploadCbor ? "cbor" : "json");
+        }
+
+        // LAN fleet: {"enabled": true, "role": "auto" | "aggregator" | "member",
+        //             "port": 4983, "endpoint": "https://...", "key": "<group secret>"}
+        // endpoint defaults to batch_endpoint (startFleet())
+        if (doc.containsKey("fleet")) {
+            JsonVariant cfg = doc["fleet"];
+            fleetSettings.enabled = cfg["enabled"] | false;
+            const char* role = cfg["role"] | "auto";
+            fleetSettings.role = strcmp(role, "aggregator") == 0 ? FleetSync::ROLE_AGGREGATOR
+                               : strcmp(role, "member") == 0     ? FleetSync::ROLE_MEMBER
+                                                                 : FleetSync::ROLE_AUTO;
+            fleetSettings.port = cfg["port"] | FLEET_PORT;
+            loadUrl(cfg["endpoint"] | "", fleetSettings.endpoint, sizeof(fleetSettings.endpoint),
+                    "fleet endpoint");
+            const char* key = cfg["key"] | "";
+            if (strlen(key) >= sizeof(fleetSettings.key)) {
+                LOG_W("⚠️ fleet key longer than %u chars - fleet off", (unsigned)(sizeof(fleetSettings.key) - 1));
+            } else {
+                strlcpy(fleetSettings.key, key, sizeof(fleetSettings.key));
+            }
+            LOG_I("✅ Fleet: %s (role %s)", fleetSettings.enabled ? "on" : "off", role);
         }
     }
 
-    struct UploadParams {
-        WebServerModule* self;
-        int pm1;
-        int pm25;
-        int pm10;
-        float tvoc;
-        float temp;
-        float hum;
-        int aqi;
-        int battery;
-    };
+    static void uploadTimer(void* arg) {
+        ((WebServerModule*)arg)->uploadDue = true;
+    }
+
+    static void uploadMain(void* arg) {
+        WebServerModule* self = (WebServerModule*)arg;
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->asyncResult = self->sendToVercelAPI(self->pendingUpload);
+            self->uploadBusy = false;
+        }
+    }
 
     // -----------------------------
     // Cloud Upload
     // -----------------------------
-    void sendToVercelAPI(int pm1, int pm25, int pm10,
-                         float tvoc, float temp, float hum, int aqi, int battery)
+    // fields.ageKey = "sample_age_s" for buffered (low-power) samples
+    int sendToVercelAPI(const SampleJson::Fields& fields)
     {
+        uint8_t body[SampleJson::MAX_LEN];
+        size_t len = uploadCbor ? SampleCbor::write(body, sizeof(body), fields)
+                                : SampleJson::write((char*)body, sizeof(body), fields);
+        if (!len) {
+            LOG_E("❌ Upload body too long - not sent");
+            return -1;
+        }
+        return post(apiEndpoint, body, len);
+    }
+
+    // One POST, one TLS connection. accepted: a batch route's
+    // {"accepted": n} (records kept, from the front); left as is when the
+    // response does not say.
+    int post(const char* url, uint8_t* body, size_t len, long* accepted = nullptr) {
+        // TLS handshake + request at full CPU speed
+        PowerLockGuard lock(PowerLocks::TLS);
+        PROFILE_SCOPE(HTTP_POST);
+
         HTTPClient http;
-        http.begin(apiEndpoint.c_str());  // Use configurable endpoint
-        http.addHeader("Content-Type", "application/json");
-
-        StaticJsonDocument<512> doc;
-        doc["pm1_0"] = pm1;
-        doc["pm2_5"] = pm25;
-        doc["pm10"]  = pm10;
-        doc["tvoc"]  = tvoc;
-        doc["temperature"] = temp;
-        doc["humidity"]    = hum;
-        doc["aqi"] = aqi;
-        doc["aqi_category"] = IAQ::getAQICategory(aqi);
-        doc["battery"] = battery;
-
-        String jsonString;
-        serializeJson(doc, jsonString);
-
-        int httpCode = http.POST(jsonString);
-        Serial.printf("Cloud Upload: %d\n", httpCode);
+        http.begin(url);  // Use configurable endpoint
+        http.addHeader("Content-Type", uploadCbor ? SampleCbor::CONTENT_TYPE : "application/json");
+
+        int httpCode = http.POST(body, len);
+        LOG_I("Cloud Upload: %d", httpCode);
+        // A flush can chain several POSTs; feed the watchdog between them
+        // when this task is watched (the low-power cycle)
+        if (esp_task_wdt_status(NULL) == ESP_OK) esp_task_wdt_reset();
+
+        if (accepted && httpCode >= 200 && httpCode < 300) {
+            StaticJsonDocument<64> doc;
+            if (!deserializeJson(doc, http.getStream())) *accepted = doc["accepted"] | *accepted;
+        }
 
         http.end();
+        return httpCode;
+    }
+
+    // -----------------------------
+    // Fleet
+    // -----------------------------
+    // The group's pending samples in one POST. Always on the calling task
+    // (the body lives in batchBody).
+    void uploadFleetBatch() {
+        size_t len = fleet.writeBatch(batchBody, sizeof(batchBody), uploadCbor);
+        if (!len) return;
+        LOG_I("📤 Uploading fleet batch (%u B)...", (unsigned)len);
+        int code = post(fleetSettings.endpoint, batchBody, len);
+        fleet.uploadDone(code >= 200 && code < 300);
+    }
+
+    // Network task, every FLEET_POLL_MS
+    static void fleetTimer(void* arg) {
+        WebServerModule* self = (WebServerModule*)arg;
+        if (self->asyncResult) {
+            self->fleet.uploadDone(self->asyncResult >= 200 && self->asyncResult < 300);
+            self->asyncResult = 0;
+        }
+        self->fleet.poll();
+
+        // A member's AQI category changed: batch now, not at the next tick
+        if (self->fleet.takeUrgent() && self->online && self->fleet.isAggregator()) {
+            self->uploadFleetBatch();
+        }
+    }
+
+    // MAC bytes 2-5: unique per unit (bytes 0-2 are the vendor prefix)
+    static uint32_t unitId() {
+        return (uint32_t)(ESP.getEfuseMac() >> 16);
+    }
+
+    void startFleet() {
+        if (!*fleetSettings.endpoint) {
+            snprintf(fleetSettings.endpoint, sizeof(fleetSettings.endpoint), "%s", batchEndpoint);
+        }
+        fleetSettings.ackTimeoutMs = FLEET_ACK_TIMEOUT_UPLOADS * uploadIntervalMs + FLEET_POLL_MS;
+        if (!fleet.begin(unitId(), fleetSettings)) return;
+        fleet.setOnline(online);
+        if (timers) timers->every("fleet", FLEET_POLL_MS, fleetTimer, this, FLEET_POLL_MS / 2);
     }
 
 public:
-    WebServerModule(
-        AsyncWebServer &srv,
-        PMSensor &pm,
-        TVOCSensor &tvoc,
-        TempHumiditySensor &th,
-        bool async = true
-    )
+    WebServerModule(AsyncWebServer &srv, bool async = true)
     : server(srv),
-      pm_sensor(pm),
-      tvoc_sensor(tvoc),
-      temp_hum_sensor(th),
       asyncPost(async)
     {}
 
@@ -122,7 +261,7 @@ public:
     // -----------------------------
     void begin(const char* ssid, const char* password) {
 
-        Serial.println("🌐 Starting Web Server...");
+        LOG_I("🌐 Starting Web Server...");
         
         // Load configuration
         loadConfig();
@@ -130,30 +269,133 @@ public:
         // -------- REST API --------
         server.on("/sensor_data", HTTP_GET, [this](AsyncWebServerRequest *request) {
 
-            PMData pm;
-            pm_sensor.read(pm);
-
-            float tvoc = tvoc_sensor.readTVOC();
-            float temp = temp_hum_sensor.readTemperature();
-            float hum  = temp_hum_sensor.readHumidity();
-
-            int aqi = IAQ::calculateAQI(pm.pm2_5, pm.pm10);
-            aqi = IAQ::adjustAQIWithTVOC(aqi, tvoc);
-
-            StaticJsonDocument<512> json;
-            json["pm1_0"] = pm.pm1_0;
-            json["pm2_5"] = pm.pm2_5;
-            json["pm10"]  = pm.pm10;
-            json["tvoc"]  = tvoc;
-            json["temperature"] = temp;
-            json["humidity"]    = hum;
-            json["aqi"] = aqi;
-            json["aqi_category"] = IAQ::getAQICategory(aqi);
-            json["battery"] = BatteryMonitor::getPercentage();
-
-            String out;
-            serializeJson(json, out);
-            request->send(200, "application/json", out);
+            FusedSample s;
+            portENTER_CRITICAL(&latestMux);
+            bool have = haveLatest;
+            s = latest;
+            portEXIT_CRITICAL(&latestMux);
+
+            if (!have) {
+                request->send(503, "application/json", "{\"error\":\"no sample yet\"}");
+                return;
+            }
+
+            SampleJson::Fields f{s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum,
+                                 s.aqi, s.battery, "age_ms", (long)(millis() - s.tMs)};
+            memcpy(f.quality, s.quality, sizeof(f.quality));
+
+            // CBOR when the client asks for it (Accept: application/cbor)
+            if (request->hasHeader("Accept") &&
+                request->getHeader("Accept")->value().indexOf(SampleCbor::CONTENT_TYPE) >= 0) {
+                uint8_t cbor[SampleCbor::MAX_LEN];
+                size_t len = SampleCbor::write(cbor, sizeof(cbor), f);
+                AsyncResponseStream* response = request->beginResponseStream(SampleCbor::CONTENT_TYPE);
+                response->write(cbor, len);
+                request->send(response);
+                return;
+            }
+
+            char body[SampleJson::MAX_LEN];
+            if (!SampleJson::write(body, sizeof(body), f)) {
+                request->send(500, "application/json", "{\"error\":\"sample too long\"}");
+                return;
+            }
+            request->send(200, "application/json", body);
+        });
+
+        // -------- Power-management stats --------
+        server.on("/api/power", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            PowerLocks::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Pipeline latency / queue stats --------
+        server.on("/api/pipeline", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            PipelineStats::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Scope profile (PROFILING_ENABLED builds) --------
+        server.on("/api/profile", HTTP_GET, [](AsyncWebServerRequest *request) {
+            if (request->hasParam("reset")) Profiler::reset();
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            Profiler::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Recent log lines (RAM tail of the async logger) --------
+        server.on("/api/logs", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("text/plain");
+            Log::writeTail(*response);
+            request->send(response);
+        });
+
+        // -------- Heap free space / fragmentation --------
+        server.on("/api/heap", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            HeapStats::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Timer-wheel jobs (jitter, late runs, skipped periods) --------
+        server.on("/api/sched", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            TimerWheel::writeJsonAll(*response);
+            request->send(response);
+        });
+
+        // -------- I2C buses (transactions, errors, lock timeouts) --------
+        server.on("/api/i2c", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            I2CBus::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Boot phase timings (this boot and the one before) --------
+        server.on("/api/boot", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            BootSequence::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Streaming statistics (hour/day/week, current and previous) --------
+        server.on("/api/stats", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            StreamStats::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Sensor health (fault counters, rejections, recoveries) --------
+        server.on("/api/health", HTTP_GET, [](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            SensorHealth::writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- LAN fleet (units, aggregator, latest sample of each) --------
+        server.on("/api/fleet", HTTP_GET, [this](AsyncWebServerRequest *request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            fleet.writeJson(*response);
+            request->send(response);
+        });
+
+        // -------- Bus trace capture (?action=start|stop) --------
+        // The trace is downloadable from BUS_TRACE_FILE once stopped
+        server.on("/api/trace", HTTP_GET, [](AsyncWebServerRequest *request) {
+            if (request->hasParam("action")) {
+                const String& action = request->getParam("action")->value();
+                if (action == "start") BusTraceStore::requestStart();
+                else if (action == "stop") BusTraceStore::requestStop();
+                else {
+                    request->send(400, "application/json", "{\"error\":\"action must be start or stop\"}");
+                    return;
+                }
+            }
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            BusTraceStore::writeJson(*response);
+            request->send(response);
         });
 
         // -------- Dashboard (HTML) --------
@@ -161,87 +403,205 @@ public:
               .setDefaultFile("index.html");
 
         server.begin();
-        Serial.println("✅ Web Server Ready!");
+        LOG_I("✅ Web Server Ready!");
+
+        if (fleetSettings.enabled) startFleet();
     }
 
+private:
     // -----------------------------
-    // Cloud Upload Loop
+    // Low-power batch flush (WiFi already connected, no web server)
     // -----------------------------
-    void loop(const PMData& pm, float tvoc, float temp, float hum, int aqi, int battery) {
-        static unsigned long lastWiFiCheck = 0;
-        static bool wasConnected = true;
-
-        // Check WiFi status every 5 seconds
-        unsigned long now = millis();
-        if (now - lastWiFiCheck > 5000) {
-            lastWiFiCheck = now;
-            
-            if (WiFi.status() != WL_CONNECTED) {
-                if (wasConnected) {
-                    Serial.println("⚠️ WiFi disconnected! Attempting reconnect...");
-                    wasConnected = false;
-                }
-                
-                // Attempt reconnection
-                WiFi.reconnect();
-                delay(100);
-                
-                if (WiFi.status() == WL_CONNECTED) {
-                    Serial.printf("✅ WiFi reconnected! IP: %s\n", WiFi.localIP().toString().c_str());
-                    wasConnected = true;
-                }
-                return;  // Skip upload this cycle
-            } else {
-                if (!wasConnected) {
-                    Serial.printf("✅ WiFi restored! IP: %s\n", WiFi.localIP().toString().c_str());
-                    wasConnected = true;
-                }
+    static SampleJson::Fields lowPowerFields(const LowPowerSample& s, uint32_t nowS) {
+        float tvoc = (s.tvoc == 0xFFFF) ? NAN : s.tvoc;
+        float temp = (s.temp_x10 == INT16_MIN) ? NAN : s.temp_x10 / 10.0f;
+        float hum  = (s.hum == 0xFF) ? NAN : s.hum;
+
+        int aqi = IAQ::calculateAQI(s.pm2_5, s.pm10);
+        aqi = IAQ::adjustAQIWithTVOC(aqi, tvoc);
+        return {s.pm1_0, s.pm2_5, s.pm10, tvoc, temp, hum, aqi, s.battery,
+                "sample_age_s", (long)(nowS - s.clockS)};
+    }
+
+    // Samples from the front that fit one batch body. At least one: a
+    // sample too long on its own fails in BatchBody and ends the flush,
+    // rather than looping on empty bodies.
+    uint8_t batchFit(const LowPowerSample* samples, uint8_t count, uint32_t nowS) const {
+        uint8_t scratch[SampleJson::MAX_LEN];
+        size_t total = BatchBody::HEAD_LEN;
+        uint8_t n = 0;
+        for (; n < count; n++) {
+            SampleJson::Fields f = lowPowerFields(samples[n], nowS);
+            total += BatchBody::ENTRY_OVERHEAD +
+                     (uploadCbor ? SampleCbor::write(scratch, sizeof(scratch), f)
+                                 : SampleJson::write((char*)scratch, sizeof(scratch), f));
+            if (total > sizeof(batchBody)) break;
+        }
+        return n ? n : 1;
+    }
+
+    // One POST per sample, for a backend without the batch route
+    int uploadEach(const LowPowerSample* samples, uint8_t count, uint32_t nowS) {
+        int sent = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            int code = sendToVercelAPI(lowPowerFields(samples[i], nowS));
+            if (code < 200 || code >= 300) break;  // keep the rest for the next flush
+            sent++;
+        }
+        return sent;
+    }
+
+public:
+    // Buffered samples in batch bodies (a 10-sample flush is one POST) to
+    // batch_endpoint; without one, a POST per sample. Returns the number
+    // of samples the server acknowledged, in order from the first: the
+    // caller drops those and keeps the rest for the next flush.
+    int uploadBatch(const LowPowerSample* samples, uint8_t count, uint32_t nowS) {
+        static bool configLoaded = false;
+        if (!configLoaded) {
+            loadConfig();
+            configLoaded = true;
+        }
+        if (!*batchEndpoint) return uploadEach(samples, count, nowS);
+
+        uint32_t id = unitId();
+        int sent = 0;
+        while (sent < count) {
+            uint8_t n = batchFit(samples + sent, count - sent, nowS);
+            BatchBody body(batchBody, sizeof(batchBody), uploadCbor, id, n);
+            for (uint8_t i = 0; i < n; i++) body.add(id, lowPowerFields(samples[sent + i], nowS));
+            size_t len = body.finish();
+            if (!len) {
+                LOG_E("❌ Batch body too long - not sent");
+                break;
+            }
+
+            LOG_I("📤 Uploading %u buffered samples (%u B)...", n, (unsigned)len);
+            long accepted = n;
+            int code = post(batchEndpoint, batchBody, len, &accepted);
+            if (code == 404 || code == 405) {
+                LOG_W("⚠️ No batch route at %s - uploading samples one by one", batchEndpoint);
+                return sent + uploadEach(samples + sent, count - sent, nowS);
+            }
+            if (code < 200 || code >= 300) break;
+            if (accepted < 0 || accepted > n) accepted = n;
+            sent += accepted;
+            if (accepted < n) break;   // the server kept the rest back: next flush
+        }
+        return sent;
+    }
+
+    // Register the upload interval as a job on the wheel of the task that
+    // calls loop()
+    void schedule(TimerWheel& wheel) {
+        timers = &wheel;
+        uploadJob = wheel.every("upload", uploadIntervalMs, uploadTimer, this, UPLOAD_SLACK_MS);
+    }
+
+    // Upload on the next loop() regardless of the interval. Automatic
+    // requests (AQI category change) go through at most every
+    // UPLOAD_URGENT_MIN_MS; one inside that floor is held back until it
+    // ends, not dropped. User ones (double tap) always go through.
+    void requestUpload(bool user = false) {
+        uint32_t now = millis();
+        if (!user) {
+            if (urgentSent && now - urgentAtMs < UPLOAD_URGENT_MIN_MS) {
+                urgentDeferred = true;
+                return;
             }
+            urgentAtMs = now;
+            urgentSent = true;
         }
+        uploadRequested = true;
+    }
 
-        // Skip if not connected
-        if (WiFi.status() != WL_CONNECTED)
+    // false: upload on the calling task (the pipeline's network task)
+    void setAsyncPost(bool async) {
+        asyncPost = async;
+    }
+
+    // Called by ConnectivityManager on state changes
+    void setOnline(bool isOnline) {
+        online = isOnline;
+        fleet.setOnline(isOnline);
+    }
+
+    // Hourly stats (network task)
+    void printStats() {
+        fleet.printStats();
+    }
+
+    // -----------------------------
+    // Cloud Upload Loop
+    // -----------------------------
+    void loop(const FusedSample& sample) {
+        portENTER_CRITICAL(&latestMux);
+        latest = sample;
+        haveLatest = true;
+        portEXIT_CRITICAL(&latestMux);
+
+        // A held-back category change, now that the floor has passed
+        if (urgentDeferred && millis() - urgentAtMs >= UPLOAD_URGENT_MIN_MS) {
+            urgentDeferred = false;
+            urgentAtMs = millis();
+            uploadRequested = true;
+        }
+
+        // Fleet frame even while offline: the aggregator may still be up
+        if (fleet.active()) fleet.publish(sample, StreamStats::dayStats(), uploadRequested);
+
+        // Connectivity is tracked by ConnectivityManager (see setOnline)
+        if (!online)
             return;
 
-        // Check upload interval
-        if (now - lastUploadTime < uploadIntervalMs)
+        const PMData& pm = sample.pm;
+        float tvoc = sample.tvoc, temp = sample.temp, hum = sample.hum;
+        int aqi = sample.aqi, battery = sample.battery;
+
+        // Without a wheel every sample is uploaded; threshold crossings
+        // skip the wait
+        if (timers && !uploadRequested && !uploadDue)
             return;
 
-        lastUploadTime = now;
+        uploadDue = false;
+        uploadRequested = false;
+        urgentDeferred = false;   // this upload carries the newer category
+
+        switch (fleet.claimUpload()) {
+            case FleetSync::UPLOAD_DELEGATED:
+                return;   // in the aggregator's next batch
+            case FleetSync::UPLOAD_BATCH:
+                uploadFleetBatch();
+                return;
+            default:
+                break;
+        }
 
         // Data is now passed in as parameters to avoid redundant/failed sensor reads
-        Serial.printf("📤 Uploading data (AQI: %d)...\n", aqi);
+        LOG_I("📤 Uploading data (AQI: %d)...", aqi);
+
+        SampleJson::Fields fields{pm.pm1_0, pm.pm2_5, pm.pm10, tvoc, temp, hum, aqi, battery};
+        fields.day = StreamStats::dayStats();
+        memcpy(fields.quality, sample.quality, sizeof(fields.quality));
 
         if (asyncPost) {
-            UploadParams* p = new UploadParams{
-                this, (int)pm.pm1_0, (int)pm.pm2_5, (int)pm.pm10, tvoc, temp, hum, aqi, battery
-            };
-
-            BaseType_t taskCreated = xTaskCreate(
-                [](void* data) {
-                    UploadParams* p = (UploadParams*)data;
-                    p->self->sendToVercelAPI(
-                        p->pm1, p->pm25, p->pm10,
-                        p->tvoc, p->temp, p->hum, p->aqi, p->battery
-                    );
-                    delete p;
-                    vTaskDelete(NULL);
-                },
-                "CloudUploadTask",
-                8192,
-                p,
-                1,
-                NULL
-            );
-            
-            // Handle task creation failure
-            if (taskCreated != pdPASS) {
-                Serial.println("❌ Failed to create upload task - cleaning up");
-                delete p;  // Prevent memory leak
+            if (!uploadTask &&
+                xTaskCreate(uploadMain, "CloudUploadTask", 8192, this, 1, &uploadTask) != pdPASS) {
+                LOG_E("❌ Failed to create upload task");
+                uploadTask = nullptr;
+                return;
+            }
+            if (uploadBusy) {
+                LOG_W("⚠️ Previous upload still running - skipping");
+                return;
             }
+            pendingUpload = fields;
+            uploadBusy = true;
+            xTaskNotifyGive(uploadTask);
         }
         else {
-            sendToVercelAPI(pm.pm1_0, pm.pm2_5, pm.pm10, tvoc, temp, hum, aqi, battery);
+            int code = sendToVercelAPI(fields);
+            if (fleet.active()) fleet.uploadDone(code >= 200 && code < 300);
         }
     }
 };
@@ -5,9 +5,13 @@
 #include <HTTPClient.h>
 #include <WiFiClientSecure.h>
 #include <Update.h>
+#include <esp_task_wdt.h>
 #include <ArduinoJson.h>
 #include "oled_display.h"
 #include "config.h"
+#include "power_locks.h"
+#include "async_log.h"
+#include "fixed_string.h"
 
 /**
  * WebUpdater: A reusable GitHub-based OTA updater.
@@ -23,7 +27,7 @@ public:
 
     static void checkAndApplyUpdate(OLEDDisplay* display = nullptr) {
         if (WiFi.status() != WL_CONNECTED) {
-            Serial.println("⚠️ WiFi not connected - skipping OTA check");
+            LOG_W("⚠️ WiFi not connected - skipping OTA check");
             if (display) {
                 display->showMessage("WiFi Off\nNo Update");
             }
@@ -31,12 +35,16 @@ public:
         }
 
         // Construct version URL (Standard GitHub Raw format)
-        String versionUrl = String("https://raw.githubusercontent.com/") + GH_USER + "/" + GH_REPO + "/main/version.json";
+        FixedString<160> versionUrl;
+        versionUrl.appendf("https://raw.githubusercontent.com/%s/%s/main/version.json", GH_USER, GH_REPO);
 
-        Serial.println("🔍 Checking GitHub for updates...");
-        Serial.printf("📡 Current device version: %s\n", VERSION);
-        Serial.printf("🔗 Checking: %s\n", versionUrl.c_str());
+        LOG_I("🔍 Checking GitHub for updates...");
+        LOG_I("📡 Current device version: %s", VERSION);
+        LOG_I("🔗 Checking: %s", versionUrl.c_str());
         
+        // TLS handshake + version check at full CPU speed
+        PowerLockGuard lock(PowerLocks::TLS);
+
         WiFiClientSecure client;
         client.setInsecure(); 
 
@@ -44,20 +52,29 @@ public:
         http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
         http.setTimeout(10000); // 10 second timeout
         
-        if (http.begin(client, versionUrl)) {
+        if (http.begin(client, versionUrl.c_str())) {
             int httpCode = http.GET();
-            Serial.printf("📥 HTTP Response Code: %d\n", httpCode);
+            LOG_I("📥 HTTP Response Code: %d", httpCode);
             
             if (httpCode == HTTP_CODE_OK) {
-                String payload = http.getString();
-                Serial.printf("📦 Received payload: %s\n", payload.c_str());
+                // version.json is tiny; read it into a fixed buffer
+                char payload[512];
+                int size = http.getSize();
+                if (size <= 0 || size >= (int)sizeof(payload)) {
+                    LOG_E("❌ Unexpected version.json size: %d", size);
+                    http.end();
+                    return;
+                }
+                size_t got = http.getStream().readBytes(payload, size);
+                payload[got] = '\0';
+                LOG_D("📦 Received payload: %s", payload);
                 
                 StaticJsonDocument<512> doc;
-                DeserializationError error = deserializeJson(doc, payload);
+                DeserializationError error = deserializeJson(doc, (const char*)payload, got);
 
                 if (error) {
-                    Serial.printf("❌ JSON Parse Failed: %s\n", error.c_str());
-                    Serial.printf("❌ Payload was: %s\n", payload.c_str());
+                    LOG_E("❌ JSON Parse Failed: %s", error.c_str());
+                    LOG_D("❌ Payload was: %s", payload);
                     http.end();
                     return;
                 }
@@ -65,14 +82,14 @@ public:
                 const char* latestVersion = doc["version"] | "";
                 const char* description = doc["description"] | "No description.";
 
-                Serial.printf("📡 Version Comparison:\n");
-                Serial.printf("   Device: [%s]\n", VERSION);
-                Serial.printf("   GitHub: [%s]\n", latestVersion);
-                Serial.printf("   Match: %s\n", (String(latestVersion) == VERSION) ? "YES" : "NO");
+                LOG_D("📡 Version Comparison:");
+                LOG_D("   Device: [%s]", VERSION);
+                LOG_D("   GitHub: [%s]", latestVersion);
+                LOG_D("   Match: %s", strcmp(latestVersion, VERSION) == 0 ? "YES" : "NO");
 
-                if (String(latestVersion) != VERSION && String(latestVersion).length() > 0) {
-                    Serial.println("🚀 New version found!");
-                    Serial.printf("📝 Changes: %s\n", description);
+                if (strcmp(latestVersion, VERSION) != 0 && latestVersion[0] != '\0') {
+                    LOG_I("🚀 New version found!");
+                    LOG_I("📝 Changes: %s", description);
                     
                     // Show update animation on display
                     if (display) {
@@ -80,37 +97,42 @@ public:
                     }
                     
                     // Construct binary URL using the new version tag (e.g., v1.0.1)
-                    String tag = String("v") + latestVersion;
-                    String firmwareUrl = String("https://github.com/") + GH_USER + "/" + GH_REPO + "/releases/download/" + tag + "/" + GH_BIN;
-                    Serial.printf("🔗 Firmware URL: %s\n", firmwareUrl.c_str());
+                    FixedString<192> firmwareUrl;
+                    firmwareUrl.appendf("https://github.com/%s/%s/releases/download/v%s/%s",
+                                        GH_USER, GH_REPO, latestVersion, GH_BIN);
+                    if (firmwareUrl.truncated()) {
+                        LOG_E("❌ Firmware URL too long");
+                        http.end();
+                        return;
+                    }
+                    LOG_I("🔗 Firmware URL: %s", firmwareUrl.c_str());
                     
-                    performGitHubUpdate(client, firmwareUrl, display);
+                    performGitHubUpdate(client, firmwareUrl.c_str(), display);
                 } else {
-                    if (String(latestVersion).length() == 0) {
-                        Serial.println("⚠️ Empty version string from GitHub");
+                    if (latestVersion[0] == '\0') {
+                        LOG_W("⚠️ Empty version string from GitHub");
                     } else {
-                        Serial.println("✅ Firmware is already latest.");
+                        LOG_I("✅ Firmware is already latest.");
                     }
                 }
             } else {
-                Serial.printf("❌ Failed to fetch version.json (HTTP %d)\n", httpCode);
-                String errorPayload = http.getString();
-                if (errorPayload.length() > 0) {
-                    Serial.printf("❌ Error response: %s\n", errorPayload.c_str());
-                }
+                LOG_E("❌ Failed to fetch version.json (HTTP %d)", httpCode);
+                LOG_D("❌ Error response: %d bytes", http.getSize());
             }
             http.end();
         } else {
-            Serial.println("❌ Failed to begin HTTP connection");
+            LOG_E("❌ Failed to begin HTTP connection");
         }
     }
 
 private:
-    static void performGitHubUpdate(WiFiClientSecure &client, String url, OLEDDisplay* display = nullptr) {
+    static void performGitHubUpdate(WiFiClientSecure &client, const char* url, OLEDDisplay* display = nullptr) {
+        PowerLockGuard lock(PowerLocks::OTA_FLASH);
+
         HTTPClient http;
         http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
         
-        Serial.println("📥 Downloading firmware binary...");
+        LOG_I("📥 Downloading firmware binary...");
         if (display) {
             display->showUpdateAnimation(nullptr, 0); // Show 0% progress
         }
@@ -121,11 +143,11 @@ private:
             if (httpCode == HTTP_CODE_OK) {
                 int contentLength = http.getSize();
                 if (contentLength > 0) {
-                    Serial.printf("📦 Size: %d bytes. Flashing...\n", contentLength);
+                    LOG_I("📦 Size: %d bytes. Flashing...", contentLength);
                     
                     // Set partition to OTA_0 (app partition for OTA updates)
                     if (Update.begin(contentLength, U_FLASH)) {
-                        Serial.println("📝 Starting firmware flash...");
+                        LOG_I("📝 Starting firmware flash...");
                         
                         // Stream with progress updates
                         WiFiClient* stream = http.getStreamPtr();
@@ -141,7 +163,7 @@ private:
                                 size_t writtenThisChunk = Update.write(buffer, read);
                                 
                                 if (writtenThisChunk != read) {
-                                    Serial.printf("⚠️ Write mismatch: read %d, wrote %d\n", read, writtenThisChunk);
+                                    LOG_W("⚠️ Write mismatch: read %d, wrote %d", (int)read, (int)writtenThisChunk);
                                 }
                                 
                                 written += writtenThisChunk;
@@ -154,15 +176,17 @@ private:
                                 
                                 // Periodic progress to Serial
                                 if (written % 10000 == 0 || written == contentLength) {
-                                    Serial.printf("📊 Progress: %d/%d bytes (%.1f%%)\n", 
-                                                  written, contentLength, (written * 100.0f) / contentLength);
+                                    LOG_I("📊 Progress: %d/%d bytes (%.1f%%)",
+                                          (int)written, contentLength, (written * 100.0f) / contentLength);
                                 }
                             }
+                            // Feed the watchdog when the calling task is subscribed to it
+                            if (esp_task_wdt_status(NULL) == ESP_OK) esp_task_wdt_reset();
                             delay(1);
                         }
                         
                         if (written == contentLength) {
-                            Serial.println("✅ All bytes written, finalizing update...");
+                            LOG_I("✅ All bytes written, finalizing update...");
                             if (display) {
                                 display->showUpdateAnimation(nullptr, 100); // Show 100%
                                 delay(500);
@@ -170,49 +194,49 @@ private:
                             
                             // Commit the update (true = even if validation fails, commit it)
                             if (Update.end(true)) {
-                                Serial.println("🏁 Update SUCCESS! Firmware committed.");
-                                Serial.println("🔄 Rebooting in 2 seconds...");
+                                LOG_I("🏁 Update SUCCESS! Firmware committed.");
+                                LOG_I("🔄 Rebooting in 2 seconds...");
                                 if (display) {
                                     display->showMessage("Update OK!\nRebooting...");
                                 }
                                 delay(2000);
                                 ESP.restart();
                             } else {
-                                Serial.printf("❌ Flash End Error: %s\n", Update.errorString());
-                                Serial.printf("❌ Error code: %u\n", Update.getError());
+                                LOG_E("❌ Flash End Error: %s", Update.errorString());
+                                LOG_E("❌ Error code: %u", Update.getError());
                                 if (display) {
                                     display->showMessage("Commit Failed!");
                                 }
                                 Update.abort();
                             }
                         } else {
-                            Serial.printf("❌ Write Error: Only %d/%d bytes written\n", written, contentLength);
+                            LOG_E("❌ Write Error: Only %d/%d bytes written", (int)written, contentLength);
                             if (display) {
                                 display->showMessage("Write Error!");
                             }
                             Update.abort();
                         }
                     } else {
-                        Serial.println("❌ Update Begin Error: Not enough space");
+                        LOG_E("❌ Update Begin Error: Not enough space");
                         if (display) {
                             display->showMessage("No Space!");
                         }
                     }
                 } else {
-                    Serial.println("❌ Invalid firmware size");
+                    LOG_E("❌ Invalid firmware size");
                     if (display) {
                         display->showMessage("Invalid Size!");
                     }
                 }
             } else {
-                Serial.printf("❌ Download Failed (HTTP %d)\n", httpCode);
+                LOG_E("❌ Download Failed (HTTP %d)", httpCode);
                 if (display) {
                     display->showMessage("Download Failed!");
                 }
             }
             http.end();
         } else {
-            Serial.println("❌ Failed to connect for download");
+            LOG_E("❌ Failed to connect for download");
             if (display) {
                 display->showMessage("Connect Failed!");
             }
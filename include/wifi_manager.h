@@ -1,45 +1,143 @@
 #pragma once
 #include <stdlib.h>
+#include <ctype.h>
 #include <WiFi.h>
 #include <LittleFS.h>
 #include <secrets.h>
 #include <ArduinoJson.h>
 #include <ESPAsyncWebServer.h>
+#include <Preferences.h>
+#include <esp_private/esp_clk.h>
+#include "wifi_scan_cache.h"
+#include "async_log.h"
+#include "fixed_string.h"
 
 struct WiFiConfig {
-    String ssid;
-    String pass;
+    FixedString<33> ssid;    // 802.11 limits: 32-byte SSID, 64-char passphrase
+    FixedString<65> pass;
 };
 
+//
+// Fast-connect cache: last AP + DHCP lease
+// Kept in RTC memory (survives soft resets / deep sleep) and mirrored to
+// NVS (survives power loss). Lets connectWiFi() skip the scan and DHCP.
+// The lease is only reused as a static address for WIFI_LEASE_REUSE_S
+// after DHCP handed it out and for WIFI_LEASE_REUSE_CONNECTS connects;
+// then a full attempt asks DHCP again, so a reassigned address is noticed.
+//
+struct WiFiFastCache {
+    uint32_t magic;
+    char     ssid[33];
+    char     pass[65];
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint64_t leaseAtUs;   // RTC clock when DHCP granted the lease; UINT64_MAX: unknown
+};
+
+static constexpr uint32_t WIFI_CACHE_MAGIC = 0x57464332;  // "WFC2"
+static constexpr unsigned long WIFI_FAST_TIMEOUT_MS = 1500;
+static constexpr unsigned long WIFI_FULL_TIMEOUT_MS = 8000;
+// Half of the usual 24 h home-router lease: where a DHCP client would
+// start renewing (T1)
+static constexpr uint32_t WIFI_LEASE_REUSE_S = 12UL * 3600;
+static constexpr uint8_t WIFI_LEASE_REUSE_CONNECTS = 16;
+
+RTC_DATA_ATTR static WiFiFastCache rtcWiFiCache;
+// Fast connects on the current lease; RTC only, so it costs no NVS writes
+// (a cache loaded from NVS has no usable lease, see loadWiFiCache())
+RTC_DATA_ATTR static uint8_t rtcLeaseReuses;
+
+// Counts through resets and sleep; only power-on restarts it
+static uint64_t wifiRtcUs() { return esp_clk_rtc_time(); }
+
+// The cached lease may still be used as a static address
+static bool wifiLeaseFresh(const WiFiFastCache& cache) {
+    if (cache.ip == 0 || cache.channel == 0) return false;
+    if (rtcLeaseReuses >= WIFI_LEASE_REUSE_CONNECTS) return false;
+    uint64_t now = wifiRtcUs();
+    // Clock behind the lease (or lease time unknown): age unknown
+    if (now < cache.leaseAtUs) return false;
+    return now - cache.leaseAtUs < (uint64_t)WIFI_LEASE_REUSE_S * 1000000;
+}
+
+// Load cache from RTC, falling back to NVS on cold boot. leaseAtUs is an
+// RTC clock reading and only means something in the boot that took it:
+// after a power loss the clock starts over, so a stored lease from early
+// in an earlier boot can look younger than it is. The NVS copy keeps the
+// AP but not the lease, and the first connect asks DHCP.
+bool loadWiFiCache(WiFiFastCache& out) {
+    if (rtcWiFiCache.magic == WIFI_CACHE_MAGIC) {
+        out = rtcWiFiCache;
+        return true;
+    }
+
+    Preferences prefs;
+    if (!prefs.begin("wifi", true)) return false;
+    size_t len = prefs.getBytes("fast", &out, sizeof(out));
+    prefs.end();
+
+    if (len != sizeof(out) || out.magic != WIFI_CACHE_MAGIC) return false;
+
+    out.leaseAtUs = UINT64_MAX;
+    rtcLeaseReuses = 0;
+    rtcWiFiCache = out;
+    return true;
+}
+
+// Store cache in RTC, and in NVS only if it changed (limits flash wear)
+void saveWiFiCache(const WiFiFastCache& cache) {
+    bool changed = memcmp(&rtcWiFiCache, &cache, sizeof(cache)) != 0;
+    rtcWiFiCache = cache;
+    if (!changed) return;
+
+    Preferences prefs;
+    if (prefs.begin("wifi", false)) {
+        prefs.putBytes("fast", &cache, sizeof(cache));
+        prefs.end();
+    }
+}
+
+void clearWiFiCache() {
+    memset(&rtcWiFiCache, 0, sizeof(rtcWiFiCache));
+    Preferences prefs;
+    if (prefs.begin("wifi", false)) {
+        prefs.remove("fast");
+        prefs.end();
+    }
+}
+
 //
 // URL decode helper function
 //
-String urlDecode(String str) {
-    String decoded = "";
-    char temp[] = "0x00";
-    unsigned int len = str.length();
-    unsigned int i = 0;
+// Decodes into out; false if it did not fit
+template <size_t N>
+bool urlDecode(const char* str, FixedString<N>& out) {
+    out.clear();
     
-    while (i < len) {
+    while (*str) {
         char decodedChar;
-        char encodedChar = str.charAt(i++);
+        char encodedChar = *str++;
         
         if (encodedChar == '+') {
             decodedChar = ' ';
         }
-        else if (encodedChar == '%') {
-            temp[2] = str.charAt(i++);
-            temp[3] = str.charAt(i++);
-            decodedChar = strtol(temp, 0, 16);
+        else if (encodedChar == '%' && isxdigit((unsigned char)str[0]) && isxdigit((unsigned char)str[1])) {
+            char hex[3] = {str[0], str[1], '\0'};
+            decodedChar = (char)strtol(hex, 0, 16);
+            str += 2;
         }
         else {
             decodedChar = encodedChar;
         }
         
-        decoded += decodedChar;
+        out.append(decodedChar);
     }
     
-    return decoded;
+    return !out.truncated();
 }
 
 //
@@ -49,17 +147,17 @@ WiFiConfig loadWiFiConfig() {
     WiFiConfig cfg;
 
     if (!LittleFS.exists("/wifi.json")) {
-        Serial.println("⚠️ wifi.json missing, using HARDCODED defaults");
-        cfg.ssid = WIFI_SSID;
-        cfg.pass = WIFI_PASS;
+        LOG_W("⚠️ wifi.json missing, using HARDCODED defaults");
+        cfg.ssid.assign(WIFI_SSID);
+        cfg.pass.assign(WIFI_PASS);
         return cfg;
     }
 
     File file = LittleFS.open("/wifi.json", "r");
     if (!file) {
-        Serial.println("⚠️ Failed to open wifi.json, using HARDCODED defaults");
-        cfg.ssid = WIFI_SSID;
-        cfg.pass = WIFI_PASS;
+        LOG_W("⚠️ Failed to open wifi.json, using HARDCODED defaults");
+        cfg.ssid.assign(WIFI_SSID);
+        cfg.pass.assign(WIFI_PASS);
         return cfg;
     }
 
@@ -68,14 +166,14 @@ WiFiConfig loadWiFiConfig() {
     file.close();
 
     if (err) {
-        Serial.println("❌ JSON parse failed, using HARDCODED defaults");
-        cfg.ssid = WIFI_SSID;
-        cfg.pass = WIFI_PASS;
+        LOG_E("❌ JSON parse failed, using HARDCODED defaults");
+        cfg.ssid.assign(WIFI_SSID);
+        cfg.pass.assign(WIFI_PASS);
         return cfg;
     }
 
-    cfg.ssid = doc["ssid"].as<String>();
-    cfg.pass = doc["password"].as<String>();
+    cfg.ssid.assign(doc["ssid"] | "");
+    cfg.pass.assign(doc["password"] | "");
 
     return cfg;
 }
@@ -83,53 +181,119 @@ WiFiConfig loadWiFiConfig() {
 //
 // Save new WiFi credentials
 //
-bool saveWiFiConfig(const String& ssid, const String& pass) {
+bool saveWiFiConfig(const char* ssid, const char* pass) {
     StaticJsonDocument<200> doc;
     doc["ssid"] = ssid;
     doc["password"] = pass;
 
     File file = LittleFS.open("/wifi.json", "w");
     if (!file) {
-        Serial.println("❌ Failed to open wifi.json for writing");
+        LOG_E("❌ Failed to open wifi.json for writing");
         return false;
     }
 
     serializeJson(doc, file);
     file.close();
+
+    // New credentials: the cached AP/lease no longer applies
+    clearWiFiCache();
     
-    Serial.printf("✅ WiFi config saved: SSID=%s\n", ssid.c_str());
+    LOG_I("✅ WiFi config saved: SSID=%s", ssid);
     return true;
 }
 
 //
-// Connect to WiFi using stored credentials
+// Connect attempt kinds (driven by ConnectivityManager)
 //
-bool connectWiFi() {
-    WiFiConfig cfg = loadWiFiConfig();
+enum WiFiAttempt {
+    WIFI_ATTEMPT_NONE,   // no credentials configured
+    WIFI_ATTEMPT_FAST,   // direct connect from cache (no scan, static lease while fresh)
+    WIFI_ATTEMPT_FULL    // scan-and-associate + DHCP
+};
 
-    if (cfg.ssid.length() == 0) {
-        Serial.println("❌ No WiFi config, skipping connect.");
-        return false;
+static WiFiConfig activeWiFiConfig;
+static bool activeWiFiConfigLoaded = false;
+
+//
+// Start a non-blocking connect attempt using stored credentials.
+// A fast attempt uses the cached BSSID/channel/lease; completion is
+// reported through WiFi events.
+//
+WiFiAttempt startWiFiConnect(bool allowFast) {
+    unsigned long tStart = millis();
+
+    WiFiFastCache cache;
+    bool haveCache = loadWiFiCache(cache);
+
+    if (!activeWiFiConfigLoaded) {
+        if (haveCache) {
+            // Credentials are part of the cache - skip LittleFS + JSON parse
+            activeWiFiConfig.ssid.assign(cache.ssid);
+            activeWiFiConfig.pass.assign(cache.pass);
+        } else {
+            activeWiFiConfig = loadWiFiConfig();
+        }
+        activeWiFiConfigLoaded = true;
+        LOG_I("⏱️  WiFi config loaded in %lums", millis() - tStart);
+    }
+
+    const WiFiConfig& cfg = activeWiFiConfig;
+    if (cfg.ssid.empty()) {
+        LOG_E("❌ No WiFi config, skipping connect.");
+        return WIFI_ATTEMPT_NONE;
     }
 
-    Serial.printf("📡 Connecting to %s...\n", cfg.ssid.c_str());
+    WiFi.persistent(false);        // We manage our own cache; avoid extra flash writes
+    WiFi.setAutoReconnect(false);  // Retries are owned by ConnectivityManager
     WiFi.mode(WIFI_STA);
-    WiFi.begin(cfg.ssid.c_str(), cfg.pass.c_str());
 
-    unsigned long start = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - start < 8000) {
-        delay(500);
-        Serial.print(".");
+    if (allowFast && haveCache && wifiLeaseFresh(cache)) {
+        LOG_I("⚡ Fast connect to %s (ch %u)...", cfg.ssid.c_str(), cache.channel);
+        WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway),
+                    IPAddress(cache.subnet), IPAddress(cache.dns));
+        WiFi.begin(cfg.ssid.c_str(), cfg.pass.c_str(), cache.channel, cache.bssid);
+        return WIFI_ATTEMPT_FAST;
     }
 
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.printf("\n✅ Connected! IP: %s\n",
-                    WiFi.localIP().toString().c_str());
-        return true;
+    if (allowFast && haveCache && cache.ip != 0) {
+        LOG_I("📡 Cached lease due for revalidation, asking DHCP");
     }
+    LOG_I("📡 Connecting to %s...", cfg.ssid.c_str());
+    // Back to DHCP in case a fast attempt configured a static lease
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+    WiFi.begin(cfg.ssid.c_str(), cfg.pass.c_str());
+    return WIFI_ATTEMPT_FULL;
+}
 
-    Serial.println("\n❌ WiFi connect failed.");
-    return false;
+//
+// Refresh the fast-connect cache with the AP and lease we actually got.
+// A fast attempt ran on the cached static address: that is no new lease,
+// so it keeps the DHCP time and counts one more reuse.
+//
+void rememberWiFiConnection(WiFiAttempt attempt) {
+    WiFiFastCache old;
+    bool haveOld = loadWiFiCache(old);
+
+    WiFiFastCache fresh;
+    memset(&fresh, 0, sizeof(fresh));
+    fresh.magic = WIFI_CACHE_MAGIC;
+    strlcpy(fresh.ssid, activeWiFiConfig.ssid.c_str(), sizeof(fresh.ssid));
+    strlcpy(fresh.pass, activeWiFiConfig.pass.c_str(), sizeof(fresh.pass));
+    uint8_t* bssid = WiFi.BSSID();
+    if (bssid) memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+    fresh.channel = WiFi.channel();
+    fresh.ip      = (uint32_t)WiFi.localIP();
+    fresh.gateway = (uint32_t)WiFi.gatewayIP();
+    fresh.subnet  = (uint32_t)WiFi.subnetMask();
+    fresh.dns     = (uint32_t)WiFi.dnsIP();
+    if (attempt == WIFI_ATTEMPT_FAST && haveOld) {
+        fresh.leaseAtUs = old.leaseAtUs;
+        rtcLeaseReuses++;
+    } else {
+        fresh.leaseAtUs = wifiRtcUs();
+        rtcLeaseReuses = 0;
+    }
+    saveWiFiCache(fresh);
 }
 
 //
@@ -141,7 +305,7 @@ static AsyncWebServer* apServer = nullptr;
 // Start fallback AP mode with AsyncWebServer
 //
 void startAPForConfig(OLEDDisplay* display = nullptr) {
-    Serial.println("📶 Starting Access Point for WiFi setup...");
+    LOG_I("📶 Starting Access Point for WiFi setup...");
     
     // Generate random 8-digit password for security
     char apPassword[9];
@@ -159,8 +323,8 @@ void startAPForConfig(OLEDDisplay* display = nullptr) {
     
     WiFi.softAP("HomeSense-Setup", apPassword);
 
-    Serial.printf("AP IP: %s\n", WiFi.softAPIP().toString().c_str());
-    Serial.printf("AP Password: %s\n", apPassword);
+    LOG_I("AP IP: %s", WiFi.softAPIP().toString().c_str());
+    LOG_I("AP Password: %s", apPassword);
     
     // Display password on OLED if available
     if (display != nullptr) {
@@ -174,34 +338,12 @@ void startAPForConfig(OLEDDisplay* display = nullptr) {
         apServer = new AsyncWebServer(80);
     }
 
-    // Store AP start time for timeout
-    static unsigned long apStartTime = millis();
-    const unsigned long AP_TIMEOUT_MS = 15 * 60 * 1000;  // 15 minutes
-
     // ==============================
     // API: WiFi Scan
     // ==============================
     apServer->on("/api/scan", HTTP_GET, [](AsyncWebServerRequest *request) {
-        Serial.println("📡 WiFi scan requested");
-        
-        int n = WiFi.scanNetworks();
-        
-        StaticJsonDocument<2048> doc;
-        JsonArray networks = doc.createNestedArray("networks");
-        
-        for (int i = 0; i < n; i++) {
-            JsonObject network = networks.createNestedObject();
-            network["ssid"] = WiFi.SSID(i);
-            network["rssi"] = WiFi.RSSI(i);
-            network["encryption"] = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "open" : "secured";
-        }
-        
-        String response;
-        serializeJson(doc, response);
-        
-        request->send(200, "application/json", response);
-        
-        Serial.printf("✅ Scan complete: %d networks found\n", n);
+        // Never blocks: served from the async scan cache
+        WiFiScanCache::handleRequest(request);
     });
 
     // ==============================
@@ -213,28 +355,31 @@ void startAPForConfig(OLEDDisplay* display = nullptr) {
             return;
         }
 
-        String ssid = urlDecode(request->getParam("ssid")->value());
-        String password = "";
+        // Over-long values do not fit the buffers and are rejected
+        FixedString<33> ssid;
+        FixedString<65> password;
+        bool ssidOk = urlDecode(request->getParam("ssid")->value().c_str(), ssid);
+        bool passOk = true;
         
         if (request->hasParam("password")) {
-            password = urlDecode(request->getParam("password")->value());
+            passOk = urlDecode(request->getParam("password")->value().c_str(), password);
         }
 
-        Serial.printf("🔐 Connect request: SSID='%s'\n", ssid.c_str());
+        LOG_I("🔐 Connect request: SSID='%s'", ssid.c_str());
 
         // Validate inputs
-        if (ssid.length() == 0 || ssid.length() > 32) {
+        if (ssid.empty() || !ssidOk) {
             request->send(400, "text/plain", "Invalid SSID length");
             return;
         }
 
-        if (password.length() > 64) {
+        if (!passOk) {
             request->send(400, "text/plain", "Invalid password length");
             return;
         }
 
         // Save credentials
-        if (!saveWiFiConfig(ssid, password)) {
+        if (!saveWiFiConfig(ssid.c_str(), password.c_str())) {
             request->send(500, "text/plain", "Failed to save config");
             return;
         }
@@ -243,7 +388,7 @@ void startAPForConfig(OLEDDisplay* display = nullptr) {
         request->send(200, "text/plain", "OK");
 
         // Schedule restart
-        Serial.println("✅ Config saved. Rebooting in 2 seconds...");
+        LOG_I("✅ Config saved. Rebooting in 2 seconds...");
         delay(2000);
         ESP.restart();
     });
@@ -258,18 +403,15 @@ void startAPForConfig(OLEDDisplay* display = nullptr) {
     // Serve other static files
     apServer->serveStatic("/", LittleFS, "/");
 
+    // Warm the scan cache so the portal's first /api/scan is instant
+    WiFiScanCache::startScan();
+
     // Start server
     apServer->begin();
-    Serial.println("✅ AP Web Server started!");
-    Serial.println("📱 Connect to 'HomeSense-Setup' and visit http://192.168.4.1");
-    Serial.printf("⏱️  AP will timeout after 15 minutes\n");
-    
-    // Non-blocking timeout check (call in loop)
-    // Note: In production, implement this in main loop
-    // if (millis() - apStartTime > AP_TIMEOUT_MS) {
-    //     Serial.println("⚠️ AP timeout - rebooting...");
-    //     ESP.restart();
-    // }
+    LOG_I("✅ AP Web Server started!");
+    LOG_I("📱 Connect to 'HomeSense-Setup' and visit http://192.168.4.1");
+    // The reboot itself is a one-shot job on the network task's timer wheel
+    LOG_I("⏱️  AP will timeout after %lu minutes", (unsigned long)(WIFI_AP_TIMEOUT_MS / 60000));
 }
 
 //
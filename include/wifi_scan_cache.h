@@ -0,0 +1,151 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+#include <algorithm>
+#include "async_log.h"
+
+// -----------------------------------
+// WiFi Scan Cache (setup portal)
+// Runs scanNetworks(true) in the background and keeps de-duplicated,
+// RSSI-sorted results with a freshness TTL. The cached list is only
+// touched from the AsyncTCP task (request handlers), so it needs no lock.
+// startScan() is also called once from the network task, in
+// startAPForConfig() before the portal server starts; it only talks to
+// the driver, never the cache.
+// -----------------------------------
+class WiFiScanCache {
+public:
+    struct Network {
+        char ssid[33];
+        int8_t rssi;
+        bool open;
+    };
+
+    static constexpr unsigned long TTL_MS = 30000;  // results considered fresh for 30 s
+
+private:
+    static std::vector<Network>& networks() {
+        static std::vector<Network> list;
+        return list;
+    }
+    static unsigned long& lastScanTime() {
+        static unsigned long t = 0;
+        return t;
+    }
+    static bool& haveResults() {
+        static bool have = false;
+        return have;
+    }
+
+    // Copy finished scan results out of the driver (strongest AP per SSID)
+    static void harvest(int n) {
+        std::vector<Network>& list = networks();
+        list.clear();
+        list.reserve(n);
+
+        for (int i = 0; i < n; i++) {
+            String ssid = WiFi.SSID(i);
+            if (ssid.length() == 0) continue;  // hidden network
+
+            int8_t rssi = (int8_t)WiFi.RSSI(i);
+            bool open = (WiFi.encryptionType(i) == WIFI_AUTH_OPEN);
+            bool dup = false;
+            for (Network& existing : list) {
+                if (strcmp(existing.ssid, ssid.c_str()) == 0) {
+                    // The entry describes the BSSID it shows the signal of
+                    if (rssi > existing.rssi) {
+                        existing.rssi = rssi;
+                        existing.open = open;
+                    }
+                    dup = true;
+                    break;
+                }
+            }
+            if (dup) continue;
+
+            Network net;
+            strlcpy(net.ssid, ssid.c_str(), sizeof(net.ssid));
+            net.rssi = rssi;
+            net.open = open;
+            list.push_back(net);
+        }
+
+        std::sort(list.begin(), list.end(), [](const Network& a, const Network& b) {
+            return a.rssi > b.rssi;
+        });
+
+        WiFi.scanDelete();
+        lastScanTime() = millis();
+        haveResults() = true;
+        LOG_I("✅ Scan complete: %d APs, %u unique networks", n, (unsigned)list.size());
+    }
+
+    static void writeJsonString(Print& out, const char* s) {
+        out.print('"');
+        for (; *s; s++) {
+            char c = *s;
+            if (c == '"' || c == '\\') {
+                out.print('\\');
+                out.print(c);
+            } else if ((uint8_t)c < 0x20) {
+                out.printf("\\u%04x", c);
+            } else {
+                out.print(c);
+            }
+        }
+        out.print('"');
+    }
+
+public:
+    // Start a background scan unless one is already running
+    static void startScan() {
+        if (WiFi.scanComplete() == WIFI_SCAN_RUNNING) return;
+        LOG_I("📡 Starting background WiFi scan");
+        if (WiFi.scanNetworks(true) == WIFI_SCAN_FAILED) {
+            LOG_W("⚠️ WiFi scan could not be started");
+        }
+    }
+
+    // Pick up finished results; refresh in the background when stale.
+    // Returns true while no results are available yet.
+    static bool update() {
+        int16_t n = WiFi.scanComplete();
+        if (n >= 0) harvest(n);
+
+        bool stale = !haveResults() || millis() - lastScanTime() > TTL_MS;
+        if (stale && n != WIFI_SCAN_RUNNING) startScan();
+
+        return !haveResults();
+    }
+
+    // Serve /api/scan: cached results immediately, 202 while the first
+    // scan is in flight (all concurrent callers share that one scan)
+    static void handleRequest(AsyncWebServerRequest* request) {
+        bool pending = update();
+
+        AsyncResponseStream* response = request->beginResponseStream("application/json");
+        if (pending) {
+            response->setCode(202);
+            response->print("{\"scanning\":true,\"networks\":[]}");
+            request->send(response);
+            return;
+        }
+
+        // Stream straight into the response - no fixed-size document
+        const std::vector<Network>& list = networks();
+        response->printf("{\"scanning\":%s,\"age_ms\":%lu,\"networks\":[",
+                         WiFi.scanComplete() == WIFI_SCAN_RUNNING ? "true" : "false",
+                         millis() - lastScanTime());
+        for (size_t i = 0; i < list.size(); i++) {
+            if (i) response->print(',');
+            response->print("{\"ssid\":");
+            writeJsonString(*response, list[i].ssid);
+            response->printf(",\"rssi\":%d,\"encryption\":\"%s\"}",
+                             list[i].rssi, list[i].open ? "open" : "secured");
+        }
+        response->print("]}");
+        request->send(response);
+    }
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include "Wire.h"
+
+// -----------------------------------
+// AGS02MA driver shim: only begin() is used; TVOC reads go through the
+// register model in Wire.h
+// -----------------------------------
+class Adafruit_AGS02MA {
+public:
+    bool begin(TwoWire* = &Wire, uint8_t = 0x1A) { return true; }
+};
@@ -0,0 +1,101 @@
+#pragma once
+// -----------------------------------
+// Arduino API subset for the native build (see sim_hal.h)
+// Only what the portable firmware headers use.
+// -----------------------------------
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "sim_hal.h"
+#include "freertos/FreeRTOS.h"   // the ESP32 core includes it from Arduino.h too
+
+typedef uint8_t byte;
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define OUTPUT_OPEN_DRAIN 0x13
+#define CHANGE 3
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+
+using std::min;
+using std::max;
+
+// -------- Time (virtual) --------
+inline unsigned long millis() { return SimHAL::nowMs(); }
+inline unsigned long micros() { return (unsigned long)SimHAL::nowUs(); }
+inline void delay(unsigned long ms) { SimHAL::advanceUs((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { SimHAL::advanceUs(us); }
+
+// -------- GPIO / ADC --------
+inline void pinMode(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t pin) {
+    auto& f = SimHAL::state().digitalLevel;
+    return f ? f(pin, SimHAL::nowMs()) : LOW;
+}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline uint16_t analogRead(uint8_t pin) {
+    auto& f = SimHAL::state().analogRaw;
+    return f ? (uint16_t)f(pin, SimHAL::nowMs()) : 0;
+}
+
+// -------- CPU --------
+inline bool setCpuFrequencyMhz(uint32_t) { return true; }
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+inline const char* esp_err_to_name(esp_err_t) { return "ESP_ERR"; }
+
+// -------- Print / Serial (stdout) --------
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        for (size_t i = 0; i < n; i++) write(buf[i]);
+        return n;
+    }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(const char* s = "") { return print(s) + print("\n"); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+    }
+};
+
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    void flush() { fflush(stdout); }
+    int available() { return 0; }
+    int read() { return -1; }
+    size_t write(uint8_t c) override {
+        if (SimHAL::state().logEnabled) fputc(c, stdout);
+        return 1;
+    }
+    using Print::write;
+};
+
+inline HostSerial Serial;
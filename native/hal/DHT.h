@@ -0,0 +1,25 @@
+#pragma once
+#include "Arduino.h"
+
+// -----------------------------------
+// DHT driver shim: values from the simulated model (SimHAL dhtTemp/dhtHum)
+// -----------------------------------
+#define DHT11 11
+#define DHT22 22
+
+class DHT {
+public:
+    DHT(uint8_t, uint8_t, uint8_t = 6) {}
+    void begin(uint8_t = 55) {}
+
+    float readTemperature(bool = false, bool = false) {
+        auto& f = SimHAL::state().dhtTemp;
+        SimHAL::advanceUs(5000);   // ~5 ms bit-banged transfer
+        return f ? f(SimHAL::nowMs()) : NAN;
+    }
+
+    float readHumidity(bool = false) {
+        auto& f = SimHAL::state().dhtHum;
+        return f ? f(SimHAL::nowMs()) : NAN;
+    }
+};
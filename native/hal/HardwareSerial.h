@@ -0,0 +1,44 @@
+#pragma once
+#include "Arduino.h"
+
+// -----------------------------------
+// UART shim: RX bytes come from the simulated ZH07 (SimHAL uartPump),
+// TX bytes (queries, mode and sleep/wake commands) go to SimHAL uartTx.
+// -----------------------------------
+#define SERIAL_8N1 0x800001c
+
+class HardwareSerial : public Print {
+public:
+    explicit HardwareSerial(int = 2) {}
+
+    void begin(unsigned long, uint32_t = SERIAL_8N1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+
+    // Before begin(), as on the ESP32 core; drops anything buffered
+    size_t setRxBufferSize(size_t n) {
+        SimHAL::State& s = SimHAL::state();
+        s.uartSize = n < SimHAL::State::UART_RX_MAX ? n : SimHAL::State::UART_RX_MAX;
+        s.uartHead = s.uartCount = 0;
+        return s.uartSize;
+    }
+
+    int available() {
+        if (SimHAL::state().uartPump) SimHAL::state().uartPump(SimHAL::nowMs());
+        return (int)SimHAL::state().uartCount;
+    }
+    int peek() { return SimHAL::uartPeek(); }
+    int read() { return SimHAL::uartRead(); }
+
+    size_t readBytes(uint8_t* buf, size_t n) {
+        size_t got = 0;
+        while (got < n && SimHAL::state().uartCount) buf[got++] = (uint8_t)SimHAL::uartRead();
+        return got;
+    }
+
+    size_t write(uint8_t b) override {
+        if (SimHAL::state().uartTx) SimHAL::state().uartTx(b);
+        return 1;
+    }
+    using Print::write;
+    void flush() {}
+};
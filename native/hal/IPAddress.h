@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+// -----------------------------------
+// IPv4 address as the Arduino core stores it (first octet in the low byte)
+// -----------------------------------
+class IPAddress {
+    uint8_t b[4] = {};
+
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t c, uint8_t d, uint8_t e) : b{a, c, d, e} {}
+    explicit IPAddress(uint32_t v) : b{(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)} {}
+
+    operator uint32_t() const { return b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24; }
+    uint8_t operator[](int i) const { return b[i]; }
+    bool operator==(const IPAddress& o) const { return (uint32_t)*this == (uint32_t)o; }
+};
@@ -0,0 +1,21 @@
+#pragma once
+#include "Arduino.h"
+#include "esp_wifi.h"
+
+// -----------------------------------
+// WiFi shim: always disconnected on the host
+// -----------------------------------
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class HostWiFi {
+public:
+    wl_status_t status() { return WL_DISCONNECTED; }
+    bool setSleep(wifi_ps_type_t) { return true; }
+    bool disconnect(bool = false) { return true; }
+};
+
+inline HostWiFi WiFi;
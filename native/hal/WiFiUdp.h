@@ -0,0 +1,115 @@
+#pragma once
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// -----------------------------------
+// UDP shim: real sockets, with multicast bound to the loopback
+// interface. Every WiFiUDP that joins the same group and port in any
+// process on the host receives every packet (the sender's own included,
+// as on the ESP32), so several simulated units can run side by side.
+// Non-blocking: parsePacket() returns 0 when nothing is queued.
+// -----------------------------------
+class WiFiUDP {
+    int fd = -1;
+    sockaddr_in group = {};
+    uint8_t tx[1472];
+    size_t txLen = 0;
+    bool txOpen = false;
+    uint8_t rx[1472];
+    size_t rxLen = 0, rxPos = 0;
+    IPAddress from;
+
+    static sockaddr_in addr(IPAddress ip, uint16_t port) {
+        sockaddr_in a = {};
+        a.sin_family = AF_INET;
+        a.sin_port = htons(port);
+        a.sin_addr.s_addr = (uint32_t)ip;   // both in network byte order
+        return a;
+    }
+
+public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t beginMulticast(IPAddress ip, uint16_t port) {
+        stop();
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return 0;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#ifdef SO_REUSEPORT
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+        sockaddr_in any = addr(IPAddress(0, 0, 0, 0), port);
+        ip_mreq join = {};
+        join.imr_multiaddr.s_addr = (uint32_t)ip;
+        join.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+        in_addr lo = {};
+        lo.s_addr = htonl(INADDR_LOOPBACK);
+        unsigned char loop = 1;
+        if (bind(fd, (sockaddr*)&any, sizeof(any)) < 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &join, sizeof(join)) < 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo)) < 0 ||
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+            stop();
+            return 0;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        group = addr(ip, port);
+        return 1;
+    }
+
+    void stop() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        txOpen = false;
+        rxLen = rxPos = 0;
+    }
+
+    int beginMulticastPacket() {
+        if (fd < 0) return 0;
+        txLen = 0;
+        txOpen = true;
+        return 1;
+    }
+
+    size_t write(const uint8_t* p, size_t n) {
+        if (!txOpen || n > sizeof(tx) - txLen) return 0;
+        memcpy(tx + txLen, p, n);
+        txLen += n;
+        return n;
+    }
+
+    int endPacket() {
+        if (!txOpen) return 0;
+        txOpen = false;
+        return sendto(fd, tx, txLen, 0, (sockaddr*)&group, sizeof(group)) == (ssize_t)txLen;
+    }
+
+    int parsePacket() {
+        if (fd < 0) return 0;
+        sockaddr_in src = {};
+        socklen_t srcLen = sizeof(src);
+        ssize_t n = recvfrom(fd, rx, sizeof(rx), 0, (sockaddr*)&src, &srcLen);
+        rxLen = n > 0 ? n : 0;
+        rxPos = 0;
+        from = IPAddress(src.sin_addr.s_addr);
+        return rxLen;
+    }
+
+    int available() { return rxLen - rxPos; }
+
+    int read(uint8_t* p, size_t n) {
+        if (n > rxLen - rxPos) n = rxLen - rxPos;
+        memcpy(p, rx + rxPos, n);
+        rxPos += n;
+        return n;
+    }
+
+    IPAddress remoteIP() { return from; }
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include "Arduino.h"
+
+// -----------------------------------
+// I2C shim: bus calls succeed and do nothing, except for the AGS02MA
+// TVOC register (address 0x1A), which answers from the simulated model
+// (SimHAL tvocPpb) with the datasheet frame: status, 24-bit ppb, CRC-8.
+// A NAN or negative model value NACKs the read.
+// -----------------------------------
+#define I2C_BUFFER_LENGTH 128
+
+class TwoWire {
+    static constexpr uint8_t AGS_ADDR = 0x1A;
+
+    uint8_t rx[5] = {};
+    uint8_t rxLen = 0, rxPos = 0;
+
+    static uint8_t crc8(const uint8_t* p, uint8_t n) {
+        uint8_t crc = 0xFF;
+        while (n--) {
+            crc ^= *p++;
+            for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+        }
+        return crc;
+    }
+
+public:
+    bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+    bool end() { return true; }
+    void setClock(uint32_t) {}
+    void setTimeOut(uint16_t) {}
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 0; }
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t*, size_t n) { return n; }
+
+    uint8_t requestFrom(uint8_t addr, uint8_t n) {
+        rxLen = rxPos = 0;
+        if (addr != AGS_ADDR || n != sizeof(rx)) return n;
+        auto& f = SimHAL::state().tvocPpb;
+        SimHAL::advanceUs(n * 9 * 40);  // 9 bits per byte at 25 kHz
+        float v = f ? f(SimHAL::nowMs()) : NAN;
+        if (isnan(v) || v < 0) return 0;
+        uint32_t ppb = (uint32_t)lroundf(v);
+        rx[0] = 0;  // RDY: heater stable
+        rx[1] = ppb >> 16;
+        rx[2] = ppb >> 8;
+        rx[3] = ppb;
+        rx[4] = crc8(rx, 4);
+        rxLen = n;
+        return n;
+    }
+
+    int available() { return rxLen - rxPos; }
+    int read() { return rxPos < rxLen ? rx[rxPos++] : -1; }
+};
+
+inline TwoWire Wire;
+inline TwoWire Wire1;
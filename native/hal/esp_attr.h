@@ -0,0 +1,4 @@
+#pragma once
+
+// Every host run is a power-on: RTC memory is plain zeroed RAM
+#define RTC_NOINIT_ATTR
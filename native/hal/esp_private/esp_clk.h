@@ -0,0 +1,5 @@
+#pragma once
+#include "sim_hal.h"
+
+// RTC clock: on the host there are no resets, so it is the virtual clock
+inline uint64_t esp_clk_rtc_time() { return SimHAL::nowUs(); }
@@ -0,0 +1,4 @@
+#pragma once
+#include "sim_hal.h"
+
+inline int64_t esp_timer_get_time() { return (int64_t)SimHAL::nowUs(); }
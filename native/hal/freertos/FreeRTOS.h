@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+
+// -----------------------------------
+// FreeRTOS shim: the native simulation is single-threaded, so critical
+// sections and mutexes are no-ops
+// -----------------------------------
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* SemaphoreHandle_t;
+
+typedef struct { uint32_t owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(m) (void)(m)
+#define portEXIT_CRITICAL(m) (void)(m)
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define pdMS_TO_TICKS(ms) (ms)
+
+inline BaseType_t xPortGetCoreID() { return 0; }
@@ -0,0 +1,18 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// -----------------------------------
+// Task shim: the simulation has no scheduler, so task creation fails and
+// callers take their inline (no-task) path
+// -----------------------------------
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define tskNO_AFFINITY 0x7fffffff
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*,
+                                          UBaseType_t, TaskHandle_t*, BaseType_t) {
+    return pdFALSE;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdTRUE; }
@@ -0,0 +1,84 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+// -----------------------------------
+// Native HAL core
+// Virtual clock + the hooks the Arduino-compatible shims in this
+// directory call into. Nothing here sleeps: delay() just advances the
+// clock, so simulations run as fast as the CPU allows.
+// Device models (native/sim) install the hooks.
+// -----------------------------------
+namespace SimHAL {
+
+struct State {
+    uint64_t nowUs = 0;
+    bool logEnabled = true;
+
+    // UART RX (ZH07). Bytes are produced by uartPump as time passes.
+    static constexpr size_t UART_RX_MAX = 4096;
+    uint8_t uartRx[UART_RX_MAX];
+    size_t uartSize = 256;                          // ESP32 Arduino default RX buffer
+    size_t uartHead = 0;                            // next byte to read
+    size_t uartCount = 0;
+    uint32_t uartOverflow = 0;                      // bytes lost to a full buffer
+    std::function<void(uint32_t nowMs)> uartPump;
+    std::function<void(uint8_t b)> uartTx;          // TX bytes (ZH07 commands)
+
+    // Sensors / pins (return NAN for a failed read)
+    std::function<float(uint32_t nowMs)> tvocPpb;
+    std::function<float(uint32_t nowMs)> dhtTemp;
+    std::function<float(uint32_t nowMs)> dhtHum;
+    std::function<int(uint8_t pin, uint32_t nowMs)> analogRaw;
+    std::function<int(uint8_t pin, uint32_t nowMs)> digitalLevel;
+};
+
+inline State& state() {
+    static State s;
+    return s;
+}
+
+inline uint64_t nowUs() { return state().nowUs; }
+inline uint32_t nowMs() { return (uint32_t)(state().nowUs / 1000); }
+
+inline void advanceUs(uint64_t us) {
+    state().nowUs += us;
+    if (state().uartPump) state().uartPump(nowMs());
+}
+
+inline void advanceToMs(uint32_t ms) {
+    uint64_t target = (uint64_t)ms * 1000;
+    if (target > state().nowUs) advanceUs(target - state().nowUs);
+}
+
+// Called by the device model: one byte arrives on the UART
+inline void uartReceive(uint8_t b) {
+    State& s = state();
+    if (s.uartCount == s.uartSize) {
+        s.uartOverflow++;  // hardware FIFO full: new byte lost
+        return;
+    }
+    s.uartRx[(s.uartHead + s.uartCount) % s.uartSize] = b;
+    s.uartCount++;
+}
+
+inline int uartPeek() {
+    State& s = state();
+    return s.uartCount ? s.uartRx[s.uartHead] : -1;
+}
+
+inline int uartRead() {
+    State& s = state();
+    if (!s.uartCount) return -1;
+    uint8_t b = s.uartRx[s.uartHead];
+    s.uartHead = (s.uartHead + 1) % s.uartSize;
+    s.uartCount--;
+    return b;
+}
+
+inline void reset() {
+    state() = State();
+}
+
+} // namespace SimHAL
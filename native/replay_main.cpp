@@ -0,0 +1,254 @@
+// -----------------------------------
+// Bus Trace Replay
+//
+// Feeds a BusTrace capture (device /trace.bin, or sim_main --trace) back
+// through PMSensor, TVOCSensor and TempHumiditySensor on the virtual
+// clock, then through SampleFusion - the same code paths the device ran.
+//   UART bytes arrive at their recorded time, in recorded order, so
+//   framing slips and checksum failures reproduce byte for byte.
+//   TVOC / DHT results are handed to the read of the cycle they were
+//   recorded in (reads without a record fail, as they did on the device).
+//
+// Build:  pio run -e native_replay
+// Run:    .pio/build/native_replay/program trace.bin [--csv] [--log] [--repeat N]
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "sim_hal.h"
+
+#include "config.h"
+#include "pm_sensor.h"
+#include "tvoc_sensor.h"
+#include "temp_humidity_sensor.h"
+#include "adaptive_sampler.h"
+#include "sample_fusion.h"
+#include "bus_trace.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    const char* path = nullptr;
+    bool csv = false;
+    bool log = false;
+    int repeat = 1;
+};
+
+struct UartChunk {
+    uint32_t tMs;
+    const uint8_t* data;
+    uint8_t len;
+};
+
+struct Cycle {
+    uint32_t seq;
+    uint32_t tMs;
+    float tvoc = NAN;        // fetched ppb; NAN = no read recorded
+    float temp = NAN;
+    float hum = NAN;
+};
+
+struct Trace {
+    std::vector<uint8_t> bytes;
+    std::vector<UartChunk> uart;
+    std::vector<Cycle> cycles;
+    uint32_t startMs = 0;
+    uint32_t endMs = 0;
+    uint32_t gaps = 0;          // GAP records
+    uint32_t lost = 0;          // records lost in them
+    bool error = false;
+};
+
+struct Result {
+    uint32_t pmOk = 0, tvocFail = 0, dhtFail = 0, categoryChanges = 0;
+    double pmNs = 0, tvocNs = 0, dhtNs = 0, fuseNs = 0;
+};
+
+static bool loadTrace(const char* path, Trace& tr) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) tr.bytes.insert(tr.bytes.end(), chunk, chunk + n);
+    fclose(f);
+
+    BusTrace::Reader rd(tr.bytes.data(), tr.bytes.size());
+    if (!rd.begin()) {
+        fprintf(stderr, "%s: not a bus trace (bad header or version)\n", path);
+        return false;
+    }
+    tr.startMs = tr.endMs = rd.startMs;
+
+    BusTrace::Record r;
+    while (rd.next(r)) {
+        tr.endMs = r.tMs;
+        Cycle* cur = tr.cycles.empty() ? nullptr : &tr.cycles.back();
+        switch (r.tag) {
+            case BusTrace::UART:
+                tr.uart.push_back({r.tMs, r.data, r.len});
+                break;
+            case BusTrace::CYCLE:
+                tr.cycles.push_back(Cycle{(uint32_t)r.value, r.tMs});
+                break;
+            case BusTrace::TVOC:
+                if (cur) cur->tvoc = r.value;
+                break;
+            case BusTrace::DHT_TEMP:
+                if (cur) cur->temp = r.value;
+                break;
+            case BusTrace::DHT_HUM:
+                if (cur) cur->hum = r.value;
+                break;
+            case BusTrace::GAP:
+                tr.gaps++;
+                tr.lost += (uint32_t)r.value;
+                break;
+        }
+    }
+    tr.error = rd.error;
+    return true;
+}
+
+static double ns(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::nano>(b - a).count();
+}
+
+// One pass over the trace with fresh drivers; emit = print CSV rows
+static Result replay(const Trace& tr, const Options& opt, bool emit) {
+    SimHAL::reset();
+    SimHAL::state().logEnabled = opt.log;
+
+    HardwareSerial uart(2);
+    PMSensor pm_sensor(uart);
+    TVOCSensor tvoc_sensor;
+    TempHumiditySensor temp_hum_sensor(DHT_PIN, DHT_TYPE);
+
+    pm_sensor.begin(PM_RX_PIN, PM_TX_PIN);
+    tvoc_sensor.begin(AGS_SDA_PIN, AGS_SCL_PIN);
+    temp_hum_sensor.begin();
+
+    AdaptiveSampler sampler;
+    AdaptiveSampler::Settings settings;
+    settings.minIntervalMs = SAMPLE_MIN_INTERVAL_MS;
+    settings.baseIntervalMs = SAMPLE_BASE_INTERVAL_MS;
+    settings.maxIntervalMs = SAMPLE_MAX_INTERVAL_MS;
+    sampler.begin(settings);
+    SampleFusion fusion(sampler);
+
+    // Hooks installed after begin() so its junk drain cannot eat trace bytes
+    size_t nextChunk = 0;
+    const Cycle* cur = nullptr;
+    SimHAL::State& hal = SimHAL::state();
+    hal.uartPump = [&](uint32_t nowMs) {
+        while (nextChunk < tr.uart.size() && tr.uart[nextChunk].tMs <= nowMs) {
+            const UartChunk& c = tr.uart[nextChunk++];
+            for (uint8_t i = 0; i < c.len; i++) SimHAL::uartReceive(c.data[i]);
+        }
+    };
+    hal.tvocPpb = [&](uint32_t) { return cur ? cur->tvoc : NAN; };
+    hal.dhtTemp = [&](uint32_t) { return cur ? cur->temp : NAN; };
+    hal.dhtHum = [&](uint32_t) { return cur ? cur->hum : NAN; };
+
+    Result res;
+    for (const Cycle& c : tr.cycles) {
+        SimHAL::advanceToMs(c.tMs);
+        cur = &c;
+
+        SampleFusion::Input in;
+        auto t0 = Clock::now();
+        in.havePM = true;
+        in.pmOk = pm_sensor.read(in.pm);
+        auto t1 = Clock::now();
+        in.haveTVOC = true;
+        in.tvoc = tvoc_sensor.readTVOC();
+        in.tvocFresh = tvoc_sensor.fresh();
+        auto t2 = Clock::now();
+        in.haveClimate = true;
+        in.temp = temp_hum_sensor.readTemperature();
+        in.hum = temp_hum_sensor.readHumidity();
+        auto t3 = Clock::now();
+        in.battery = 0;   // not traced
+
+        bool changed = false;
+        FusedSample s = fusion.fuse(c.seq, c.tMs, in, changed);
+        auto t4 = Clock::now();
+
+        res.pmNs += ns(t0, t1);
+        res.tvocNs += ns(t1, t2);
+        res.dhtNs += ns(t2, t3);
+        res.fuseNs += ns(t3, t4);
+        if (in.pmOk) res.pmOk++;
+        if (isnan(in.tvoc) && !tvoc_sensor.isWarmingUp()) res.tvocFail++;
+        if (isnan(in.temp) || isnan(in.hum)) res.dhtFail++;
+        if (changed) res.categoryChanges++;
+
+        if (emit && opt.csv) {
+            printf("%lu,%u,%u,%u,%.0f,%.1f,%.1f,%d,%lu\n", (unsigned long)c.tMs,
+                   s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum, s.aqi,
+                   (unsigned long)s.nextIntervalMs);
+        }
+    }
+    return res;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--csv")) opt.csv = true;
+        else if (!strcmp(argv[i], "--log")) opt.log = true;
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) opt.repeat = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !opt.path) opt.path = argv[i];
+        else opt.repeat = 0;   // unknown option: print usage
+    }
+    if (!opt.path || opt.repeat < 1) {
+        fprintf(stderr, "usage: %s trace.bin [--csv] [--log] [--repeat N]\n", argv[0]);
+        return 2;
+    }
+
+    static Trace tr;
+    if (!loadTrace(opt.path, tr)) return 1;
+    if (tr.error) fprintf(stderr, "⚠️ Trace ends in a bad record (truncated capture?)\n");
+    if (tr.gaps) {
+        fprintf(stderr, "⚠️ %lu gaps, %lu records lost on the device\n",
+                (unsigned long)tr.gaps, (unsigned long)tr.lost);
+    }
+
+    if (opt.csv) printf("t_ms,pm1_0,pm2_5,pm10,tvoc,temp,hum,aqi,next_ms\n");
+
+    Result res;
+    auto wall0 = Clock::now();
+    for (int pass = 0; pass < opt.repeat; pass++) {
+        Result r = replay(tr, opt, pass == 0);
+        if (pass == 0) res = r;
+        else {
+            res.pmNs += r.pmNs;
+            res.tvocNs += r.tvocNs;
+            res.dhtNs += r.dhtNs;
+            res.fuseNs += r.fuseNs;
+        }
+    }
+    double wallS = ns(wall0, Clock::now()) / 1e9;
+
+    size_t cycles = tr.cycles.size();
+    double calls = (double)cycles * opt.repeat;
+    double spanS = (tr.endMs - tr.startMs) / 1000.0;
+
+    fprintf(stderr, "Trace %s: %.1f h, %zu cycles, %zu UART chunks (%zu bytes)\n", opt.path,
+            spanS / 3600.0, cycles, tr.uart.size(), tr.bytes.size());
+    fprintf(stderr, "PM frames ok: %lu/%zu | TVOC failed: %lu | DHT failed: %lu | AQI category changes: %lu\n",
+            (unsigned long)res.pmOk, cycles, (unsigned long)res.tvocFail,
+            (unsigned long)res.dhtFail, (unsigned long)res.categoryChanges);
+    if (calls > 0) {
+        fprintf(stderr, "Host ns/cycle: PM %.0f | TVOC %.0f | DHT %.0f | fusion %.0f\n",
+                res.pmNs / calls, res.tvocNs / calls, res.dhtNs / calls, res.fuseNs / calls);
+    }
+    fprintf(stderr, "Replayed x%d in %.3f s (%.0fx real time)\n", opt.repeat, wallS,
+            wallS > 0 ? spanS * opt.repeat / wallS : 0.0);
+    return 0;
+}
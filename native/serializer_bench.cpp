@@ -0,0 +1,242 @@
+// -----------------------------------
+// Telemetry Serializer Benchmark
+//
+// Encodes the same varied sample records with:
+//   json      SampleJson::write (one pass, fixed-point floats)
+//   snprintf  the previous snprintf-based body (reference output)
+//   cbor      SampleCbor::write
+//   arduino   StaticJsonDocument<512> + serializeJson (when ArduinoJson is
+//             on the include path - pio run -e native_bench pulls it in)
+// and checks json against the reference byte for byte and cbor by
+// decoding it back.
+//
+// Build:  pio run -e native_bench
+// Run:    .pio/build/native_bench/program [--records N] [--repeat R]
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "sample_json.h"
+#include "sample_cbor.h"
+
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#define HAVE_ARDUINOJSON 1
+#else
+#define HAVE_ARDUINOJSON 0
+#endif
+
+using Clock = std::chrono::steady_clock;
+using Fields = SampleJson::Fields;
+
+// Deterministic spread of values, including NAN (sensor unavailable),
+// negative temperatures and ties on the last printed digit
+static std::vector<Fields> makeRecords(size_t n) {
+    std::vector<Fields> out;
+    uint32_t x = 12345;
+    auto rnd = [&]() { return (x = x * 1664525u + 1013904223u) >> 8; };
+    for (size_t i = 0; i < n; i++) {
+        Fields f;
+        f.pm1 = rnd() % 300;
+        f.pm25 = rnd() % 500;
+        f.pm10 = rnd() % 600;
+        f.tvoc = (i % 17 == 0) ? NAN : (rnd() % 100000) / 1000.0f;
+        f.temp = (i % 23 == 0) ? NAN : (int)(rnd() % 6000) / 100.0f - 15.0f;
+        f.hum = (i % 29 == 0) ? NAN : (rnd() % 10000) / 100.0f;
+        if (i % 31 == 0) f.tvoc = 0.125f;   // exact binary tie
+        f.aqi = rnd() % 501;
+        f.battery = rnd() % 101;
+        if (i % 2) {
+            f.ageKey = (i % 4 == 1) ? "age_ms" : "sample_age_s";
+            f.age = rnd();
+        }
+        out.push_back(f);
+    }
+    return out;
+}
+
+// The body as built before the one-pass writer
+static size_t writeSnprintf(char* out, size_t cap, const Fields& f) {
+    auto num = [](char* tmp, size_t c, float v, int d) -> const char* {
+        if (isnan(v) || isinf(v)) return "null";
+        snprintf(tmp, c, "%.*f", d, v);
+        return tmp;
+    };
+    char tvoc[16], temp[16], hum[16];
+    int n = snprintf(out, cap,
+                     "{\"pm1_0\":%d,\"pm2_5\":%d,\"pm10\":%d,\"tvoc\":%s,\"temperature\":%s,"
+                     "\"humidity\":%s,\"aqi\":%d,\"aqi_category\":\"%s\",\"battery\":%d",
+                     f.pm1, f.pm25, f.pm10, num(tvoc, sizeof(tvoc), f.tvoc, 2),
+                     num(temp, sizeof(temp), f.temp, 1), num(hum, sizeof(hum), f.hum, 1),
+                     f.aqi, IAQ::getAQICategory(f.aqi), f.battery);
+    if (n < 0 || (size_t)n >= cap) return 0;
+    int m = f.ageKey ? snprintf(out + n, cap - n, ",\"%s\":%ld}", f.ageKey, f.age)
+                     : snprintf(out + n, cap - n, "}");
+    if (m < 0 || (size_t)(n + m) >= cap) return 0;
+    return n + m;
+}
+
+#if HAVE_ARDUINOJSON
+static size_t writeArduinoJson(char* out, size_t cap, const Fields& f) {
+    StaticJsonDocument<512> doc;
+    doc["pm1_0"] = f.pm1;
+    doc["pm2_5"] = f.pm25;
+    doc["pm10"] = f.pm10;
+    doc["tvoc"] = f.tvoc;
+    doc["temperature"] = f.temp;
+    doc["humidity"] = f.hum;
+    doc["aqi"] = f.aqi;
+    doc["aqi_category"] = IAQ::getAQICategory(f.aqi);
+    doc["battery"] = f.battery;
+    if (f.ageKey) doc[f.ageKey] = f.age;
+    return serializeJson(doc, out, cap);
+}
+#endif
+
+// -------- Minimal CBOR reader for the round-trip check --------
+struct CborReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t arg(uint8_t info) {
+        if (info < 24) return info;
+        int n = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : -1;
+        if (n < 0 || end - p < n) {
+            ok = false;
+            return 0;
+        }
+        uint64_t v = 0;
+        while (n--) v = (v << 8) | *p++;
+        return v;
+    }
+
+    bool head(uint8_t& major, uint64_t& v) {
+        if (p >= end) return ok = false;
+        uint8_t b = *p++;
+        major = b >> 5;
+        v = arg(b & 31);
+        if (major == 7) v = b & 31;
+        return ok;
+    }
+};
+
+static bool checkCbor(const uint8_t* buf, size_t len, const Fields& f) {
+    CborReader r{buf, buf + len};
+    uint8_t major;
+    uint64_t n;
+    if (!r.head(major, n) || major != 5 || n != (f.ageKey ? 10u : 9u)) return false;
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t klen;
+        if (!r.head(major, klen) || major != 3 || (uint64_t)(r.end - r.p) < klen) return false;
+        char key[32] = {0};
+        memcpy(key, r.p, klen < 31 ? klen : 31);
+        r.p += klen;
+
+        const uint8_t* at = r.p;
+        uint64_t v;
+        if (!r.head(major, v)) return false;
+        long long iv = major == 0 ? (long long)v : major == 1 ? -1 - (long long)v : 0;
+        float fv = NAN;
+        if (major == 7 && v == 26) {
+            r.p = at + 1;
+            uint32_t bits = (uint32_t)r.arg(26);
+            memcpy(&fv, &bits, 4);
+        } else if (major == 7 && v != 22) {
+            return false;   // only float32 and null are expected
+        }
+        auto same = [](float a, float b) { return (isnan(a) && isnan(b)) || a == b; };
+
+        if (!strcmp(key, "pm1_0") && iv != f.pm1) return false;
+        if (!strcmp(key, "pm2_5") && iv != f.pm25) return false;
+        if (!strcmp(key, "pm10") && iv != f.pm10) return false;
+        if (!strcmp(key, "tvoc") && !same(fv, f.tvoc)) return false;
+        if (!strcmp(key, "temperature") && !same(fv, f.temp)) return false;
+        if (!strcmp(key, "humidity") && !same(fv, f.hum)) return false;
+        if (!strcmp(key, "aqi") && iv != f.aqi) return false;
+        if (!strcmp(key, "battery") && iv != f.battery) return false;
+        if (f.ageKey && !strcmp(key, f.ageKey) && iv != f.age) return false;
+        if (!strcmp(key, "aqi_category")) {
+            const char* cat = IAQ::getAQICategory(f.aqi);
+            if (major != 3 || v != strlen(cat) || memcmp(r.p, cat, v)) return false;
+            r.p += v;
+        }
+    }
+    return r.ok && r.p == r.end;
+}
+
+template <typename Fn>
+static double timeIt(const std::vector<Fields>& recs, int repeat, size_t& bytes, Fn fn) {
+    uint8_t buf[512];
+    bytes = 0;
+    auto t0 = Clock::now();
+    for (int r = 0; r < repeat; r++) {
+        for (const Fields& f : recs) {
+            size_t n = fn(buf, sizeof(buf), f);
+            if (r == 0) bytes += n;
+            __asm__ __volatile__("" : : "r"(buf) : "memory");   // keep the output live
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+    return ns / ((double)recs.size() * repeat);
+}
+
+int main(int argc, char** argv) {
+    size_t records = 10000;
+    int repeat = 50;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--records") && i + 1 < argc) records = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--records N] [--repeat R]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!records || repeat < 1) return 2;
+
+    std::vector<Fields> recs = makeRecords(records);
+
+    // -------- Correctness --------
+    size_t jsonDiff = 0, cborBad = 0;
+    for (const Fields& f : recs) {
+        char a[SampleJson::MAX_LEN], b[SampleJson::MAX_LEN];
+        uint8_t c[SampleCbor::MAX_LEN];
+        size_t na = SampleJson::write(a, sizeof(a), f);
+        size_t nb = writeSnprintf(b, sizeof(b), f);
+        if (na != nb || memcmp(a, b, na)) {
+            if (jsonDiff++ < 3) fprintf(stderr, "json mismatch:\n  %s\n  %s\n", a, b);
+        }
+        size_t nc = SampleCbor::write(c, sizeof(c), f);
+        if (!nc || !checkCbor(c, nc, f)) cborBad++;
+    }
+    printf("Checked %zu records: json vs snprintf mismatches %zu | cbor round-trip failures %zu\n",
+           records, jsonDiff, cborBad);
+
+    // -------- Speed --------
+    size_t bytes;
+    printf("%-10s %10s %10s\n", "encoder", "ns/record", "avg bytes");
+    double ns = timeIt(recs, repeat, bytes, [](uint8_t* o, size_t c, const Fields& f) {
+        return SampleJson::write((char*)o, c, f);
+    });
+    printf("%-10s %10.0f %10.1f\n", "json", ns, bytes / (double)records);
+    ns = timeIt(recs, repeat, bytes, [](uint8_t* o, size_t c, const Fields& f) {
+        return writeSnprintf((char*)o, c, f);
+    });
+    printf("%-10s %10.0f %10.1f\n", "snprintf", ns, bytes / (double)records);
+    ns = timeIt(recs, repeat, bytes, [](uint8_t* o, size_t c, const Fields& f) {
+        return SampleCbor::write(o, c, f);
+    });
+    printf("%-10s %10.0f %10.1f\n", "cbor", ns, bytes / (double)records);
+#if HAVE_ARDUINOJSON
+    ns = timeIt(recs, repeat, bytes, [](uint8_t* o, size_t c, const Fields& f) {
+        return writeArduinoJson((char*)o, c, f);
+    });
+    printf("%-10s %10.0f %10.1f\n", "arduino", ns, bytes / (double)records);
+#else
+    printf("%-10s %10s   (ArduinoJson not on the include path)\n", "arduino", "-");
+#endif
+    return (jsonDiff || cborBad) ? 1 : 0;
+}
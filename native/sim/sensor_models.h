@@ -0,0 +1,256 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include "sim_hal.h"
+#include "DHT.h"
+#include "config.h"
+
+// -----------------------------------
+// Simulated Sensors (native build)
+// A deterministic indoor "day" (baseline + cooking/incense events) and
+// the three device models that observe it:
+//   ZH07Model  - streams 32-byte 0x42 0x4D frames at 1 Hz until told to
+//                switch to Q&A mode, then answers each query with a 9-byte
+//                reply; optional byte corruption / drops
+//   TVOCModel  - AGS02MA-like ppb reading (1 ppb steps, jitter)
+//   DHTModel   - DHT_TYPE readings with occasional failures: DHT11 whole
+//                units at most once per 1 s, DHT22 0.1 C / 0.1 % per 2 s
+// Everything is driven by one seed, so a run is repeatable bit for bit.
+// -----------------------------------
+namespace Sim {
+
+// xorshift32: tiny, deterministic across platforms
+struct Rng {
+    uint32_t s;
+    explicit Rng(uint32_t seed) : s(seed ? seed : 0x9E3779B9u) {}
+    uint32_t next() {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }           // [0,1)
+    float jitter(float amp) { return (uniform() * 2.0f - 1.0f) * amp; }          // [-amp,amp)
+};
+
+// Ground truth at time t
+class Environment {
+public:
+    struct Event {
+        uint32_t startS;
+        float peakPm25;
+        float peakTvoc;
+        float riseS;
+        float decayS;
+    };
+
+private:
+    static constexpr int MAX_EVENTS = 8;
+    Event events[MAX_EVENTS];
+    int eventCount = 0;
+
+    float shape(const Event& e, float tS) const {
+        if (tS < e.startS) return 0;
+        float dt = tS - e.startS;
+        return (dt < e.riseS) ? dt / e.riseS : expf(-(dt - e.riseS) / e.decayS);
+    }
+
+public:
+    // Default day, same profile as tools/adaptive_sampler_sim.cpp
+    Environment() {
+        addEvent({8 * 3600, 140, 400, 300, 900});     // breakfast
+        addEvent({13 * 3600, 60, 900, 120, 1800});    // incense
+        addEvent({19 * 3600, 220, 600, 600, 1200});   // dinner
+    }
+
+    void clearEvents() { eventCount = 0; }
+    void addEvent(const Event& e) {
+        if (eventCount < MAX_EVENTS) events[eventCount++] = e;
+    }
+
+    float pm25(uint32_t ms) const {
+        float t = fmodf(ms / 1000.0f, 86400.0f);
+        float v = 12.0f + 3.0f * sinf(t / 7200.0f);
+        for (int i = 0; i < eventCount; i++) v += events[i].peakPm25 * shape(events[i], t);
+        return v;
+    }
+
+    float tvoc(uint32_t ms) const {
+        float t = fmodf(ms / 1000.0f, 86400.0f);
+        float v = 120.0f;
+        for (int i = 0; i < eventCount; i++) v += events[i].peakTvoc * shape(events[i], t);
+        return v;
+    }
+
+    // Diurnal temperature, humidity moving opposite
+    float temperature(uint32_t ms) const {
+        float t = fmodf(ms / 1000.0f, 86400.0f);
+        return 24.0f + 2.5f * sinf((t - 9 * 3600) * 2.0f * (float)M_PI / 86400.0f);
+    }
+
+    float humidity(uint32_t ms) const {
+        return 55.0f - 2.0f * (temperature(ms) - 24.0f);
+    }
+
+    // Battery slowly discharging from 4.15 V
+    float batteryVolts(uint32_t ms) const {
+        float v = 4.15f - (ms / 3600000.0f) * 0.01f;
+        return v < 3.0f ? 3.0f : v;
+    }
+};
+
+class ZH07Model {
+    const Environment& env;
+    Rng rng;
+    uint32_t nextFrameMs = 0;
+    float corruptRate;   // per frame / reply: flip one byte (checksum fails)
+    float dropRate;      // per frame / reply: lose a few bytes (framing slips)
+
+    bool queryMode = false;    // powers up streaming (initiative upload)
+    bool dormant = false;
+    uint8_t cmd[9];
+    uint8_t cmdLen = 0;
+    uint32_t replyAtMs = 0;
+    bool replyDue = false;
+
+    struct Reading {
+        uint16_t pm1, pm25, pm10;
+    };
+
+    Reading measure(uint32_t ms) {
+        float pm25 = env.pm25(ms) + rng.jitter(1.0f);
+        if (pm25 < 0) pm25 = 0;
+        return {(uint16_t)lroundf(pm25 * 0.7f), (uint16_t)lroundf(pm25), (uint16_t)lroundf(pm25 * 1.35f)};
+    }
+
+    void emit(uint8_t* f, int len, int from) {
+        if (rng.uniform() < corruptRate) f[from + rng.next() % (len - from)] ^= 0x5A;
+        int skip = (rng.uniform() < dropRate) ? 1 + rng.next() % 4 : 0;
+        for (int i = skip; i < len; i++) SimHAL::uartReceive(f[i]);
+    }
+
+    // Initiative upload: 0x42 0x4D, length, then the fields at PMS offsets
+    void emitFrame(uint32_t ms) {
+        Reading r = measure(ms);
+        uint8_t f[32] = {0x42, 0x4D, 0x00, 0x1C};
+        f[6] = r.pm1 >> 8;   f[7] = r.pm1 & 0xFF;     // PM1.0
+        f[8] = r.pm25 >> 8;  f[9] = r.pm25 & 0xFF;    // PM2.5
+        f[10] = r.pm10 >> 8; f[11] = r.pm10 & 0xFF;   // PM10
+
+        uint16_t sum = 0;
+        for (int i = 0; i < 30; i++) sum += f[i];
+        f[30] = sum >> 8;
+        f[31] = sum & 0xFF;
+        emit(f, 32, 2);
+    }
+
+    // Q&A reply: FF 86 PM2.5 PM10 PM1.0, two's complement checksum
+    void emitReply(uint32_t ms) {
+        Reading r = measure(ms);
+        uint8_t f[9] = {0xFF, 0x86, (uint8_t)(r.pm25 >> 8), (uint8_t)r.pm25, (uint8_t)(r.pm10 >> 8),
+                        (uint8_t)r.pm10, (uint8_t)(r.pm1 >> 8), (uint8_t)r.pm1, 0};
+        uint8_t sum = 0;
+        for (int i = 1; i < 8; i++) sum += f[i];
+        f[8] = (uint8_t)(~sum + 1);
+        emit(f, 9, 2);
+    }
+
+    void command(uint32_t ms) {
+        switch (cmd[2]) {
+            case 0x78: queryMode = cmd[3] == 0x41; break;
+            case 0xA7: dormant = cmd[3] == 0x01; break;
+            case 0x86:
+                if (queryMode && !dormant) {
+                    replyAtMs = ms + 20;   // ~10 ms on the wire plus processing
+                    replyDue = true;
+                }
+                break;
+        }
+        nextFrameMs = ms + 1000;
+    }
+
+public:
+    ZH07Model(const Environment& e, uint32_t seed, float corrupt = 0.01f, float drop = 0.005f)
+        : env(e), rng(seed), corruptRate(corrupt), dropRate(drop) {}
+
+    // Host TX: 9-byte commands starting with FF 01
+    void receive(uint8_t b) {
+        if (cmdLen == 0 && b != 0xFF) return;
+        cmd[cmdLen++] = b;
+        if (cmdLen == 2 && b != 0x01) cmdLen = 0;
+        if (cmdLen == sizeof(cmd)) {
+            cmdLen = 0;
+            command(SimHAL::nowMs());
+        }
+    }
+
+    // Emit the reply or every stream frame due by nowMs. After a long jump
+    // only the frames that still fit the RX buffer matter, so older ones
+    // are skipped.
+    void pump(uint32_t nowMs) {
+        if (replyDue && nowMs >= replyAtMs) {
+            replyDue = false;
+            emitReply(replyAtMs);
+        }
+        if (queryMode || dormant) return;
+        const uint32_t keep = SimHAL::state().uartSize / 32 + 1;
+        if (nowMs > nextFrameMs + keep * 1000) {
+            nextFrameMs = nowMs - keep * 1000;
+        }
+        while (nextFrameMs <= nowMs) {
+            emitFrame(nextFrameMs);
+            nextFrameMs += 1000;
+        }
+    }
+};
+
+class TVOCModel {
+    const Environment& env;
+    Rng rng;
+
+public:
+    TVOCModel(const Environment& e, uint32_t seed) : env(e), rng(seed) {}
+
+    float read(uint32_t ms) {
+        float v = env.tvoc(ms) + rng.jitter(5.0f);
+        return v < 0 ? 0 : roundf(v);
+    }
+};
+
+class DHTModel {
+#if DHT_TYPE == DHT11
+    static constexpr uint32_t MIN_INTERVAL_MS = 1000;
+    static constexpr float STEPS_PER_UNIT = 1.0f;
+#else
+    static constexpr uint32_t MIN_INTERVAL_MS = 2000;
+    static constexpr float STEPS_PER_UNIT = 10.0f;
+#endif
+    const Environment& env;
+    Rng rng;
+    float failRate;
+    uint32_t lastMs = 0;
+    float temp = NAN, hum = NAN;
+    bool have = false;
+
+    void sample(uint32_t ms) {
+        // At most one conversion per MIN_INTERVAL_MS, otherwise the cached value
+        if (have && ms - lastMs < MIN_INTERVAL_MS) return;
+        have = true;
+        lastMs = ms;
+        if (rng.uniform() < failRate) {
+            temp = hum = NAN;
+            return;
+        }
+        temp = roundf((env.temperature(ms) + rng.jitter(0.2f)) * STEPS_PER_UNIT) / STEPS_PER_UNIT;
+        hum = roundf((env.humidity(ms) + rng.jitter(1.0f)) * STEPS_PER_UNIT) / STEPS_PER_UNIT;
+    }
+
+public:
+    DHTModel(const Environment& e, uint32_t seed, float fail = 0.02f)
+        : env(e), rng(seed), failRate(fail) {}
+
+    float readTemperature(uint32_t ms) { sample(ms); return temp; }
+    float readHumidity(uint32_t ms) { sample(ms); return hum; }
+};
+
+} // namespace Sim
@@ -0,0 +1,267 @@
+// -----------------------------------
+// Native Sampling Simulation
+//
+// Runs the firmware's sampling path - PMSensor frame parsing, TVOC/DHT
+// drivers, battery ADC, SampleFusion (AQI), AdaptiveSampler and the
+// trend history and stream statistics - against the simulated sensors on
+// a virtual clock, far faster than real time. Same seed, same output.
+//
+// Build:  pio run -e native            (or: g++ -std=gnu++17 -O2 -Inative/hal
+//                                         -Inative/sim -Iinclude native/sim_main.cpp)
+// Run:    .pio/build/native/program [--hours H] [--seed S] [--csv] [--log]
+//                                   [--trace out.bin]   (BusTrace capture,
+//                                    replayable with native/replay_main.cpp)
+//                                   [--soak]   (heap soak: a simulated week
+//                                    unless --hours is given; fails if the
+//                                    sampling path allocates after warm-up)
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <cstddef>
+#include <new>
+
+#include "sim_hal.h"
+#include "sensor_models.h"
+
+#include "config.h"
+#include "pm_sensor.h"
+#include "tvoc_sensor.h"
+#include "temp_humidity_sensor.h"
+#include "battery_monitor.h"
+#include "adaptive_sampler.h"
+#include "sample_fusion.h"
+#include "trend_history.h"
+#include "bus_trace.h"
+#include "sample_json.h"
+#include "sample_cbor.h"
+#include "stream_stats.h"
+
+// -------- Heap accounting (operator new/delete) --------
+// Every C++ allocation in the process goes through here. Allocations after
+// the warm-up hour are "steady state"; the soak requires there are none.
+namespace HeapTrack {
+struct Counters {
+    uint64_t allocs = 0;
+    uint64_t steadyAllocs = 0;
+    size_t live = 0;
+    size_t peak = 0;
+    bool steady = false;
+};
+static Counters c;
+static constexpr size_t HDR = alignof(std::max_align_t);
+
+static void* alloc(size_t n) {
+    uint8_t* p = (uint8_t*)malloc(n + HDR);
+    if (!p) throw std::bad_alloc();
+    *(size_t*)p = n;
+    c.allocs++;
+    if (c.steady) c.steadyAllocs++;
+    c.live += n;
+    if (c.live > c.peak) c.peak = c.live;
+    return p + HDR;
+}
+
+static void release(void* ptr) {
+    if (!ptr) return;
+    uint8_t* p = (uint8_t*)ptr - HDR;
+    c.live -= *(size_t*)p;
+    free(p);
+}
+} // namespace HeapTrack
+
+void* operator new(size_t n) { return HeapTrack::alloc(n); }
+void* operator new[](size_t n) { return HeapTrack::alloc(n); }
+void operator delete(void* p) noexcept { HeapTrack::release(p); }
+void operator delete[](void* p) noexcept { HeapTrack::release(p); }
+void operator delete(void* p, size_t) noexcept { HeapTrack::release(p); }
+void operator delete[](void* p, size_t) noexcept { HeapTrack::release(p); }
+
+struct Options {
+    float hours = 24;
+    uint32_t seed = 42;
+    bool csv = false;
+    bool log = false;
+    const char* trace = nullptr;
+    bool soak = false;
+};
+
+static Options parseArgs(int argc, char** argv) {
+    Options o;
+    bool hoursGiven = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--hours") && i + 1 < argc) {
+            o.hours = strtof(argv[++i], nullptr);
+            hoursGiven = true;
+        }
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) o.seed = strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--csv")) o.csv = true;
+        else if (!strcmp(argv[i], "--log")) o.log = true;
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) o.trace = argv[++i];
+        else if (!strcmp(argv[i], "--soak")) o.soak = true;
+        else {
+            fprintf(stderr, "usage: %s [--hours H] [--seed S] [--csv] [--log] [--trace out.bin] [--soak]\n",
+                    argv[0]);
+            exit(2);
+        }
+    }
+    if (o.soak && !hoursGiven) o.hours = 7 * 24;
+    return o;
+}
+
+int main(int argc, char** argv) {
+    Options opt = parseArgs(argc, argv);
+
+    // -------- Simulated world --------
+    SimHAL::reset();
+    SimHAL::state().logEnabled = opt.log;
+
+    Sim::Environment env;
+    Sim::ZH07Model zh07(env, opt.seed);
+    Sim::TVOCModel tvocModel(env, opt.seed * 3 + 1);
+    Sim::DHTModel dhtModel(env, opt.seed * 7 + 2);
+
+    SimHAL::State& hal = SimHAL::state();
+    hal.uartPump = [&](uint32_t ms) { zh07.pump(ms); };
+    hal.uartTx = [&](uint8_t b) { zh07.receive(b); };
+    hal.tvocPpb = [&](uint32_t ms) { return tvocModel.read(ms); };
+    hal.dhtTemp = [&](uint32_t ms) { return dhtModel.readTemperature(ms); };
+    hal.dhtHum = [&](uint32_t ms) { return dhtModel.readHumidity(ms); };
+    hal.analogRaw = [&](uint8_t, uint32_t ms) {
+        // Divider + calibration inverse of BatteryMonitor::readVoltage()
+        float pin = env.batteryVolts(ms) / VOLT_DIVIDER_RATIO / 1.102f;
+        return (int)(pin / 3.3f * 4095.0f);
+    };
+
+    // -------- Firmware under test --------
+    HardwareSerial uart(2);
+    PMSensor pm_sensor(uart);
+    TVOCSensor tvoc_sensor;
+    TempHumiditySensor temp_hum_sensor(DHT_PIN, DHT_TYPE);
+
+    pm_sensor.begin(PM_RX_PIN, PM_TX_PIN);
+    tvoc_sensor.begin(AGS_SDA_PIN, AGS_SCL_PIN);
+    temp_hum_sensor.begin();
+
+    AdaptiveSampler sampler;
+    AdaptiveSampler::Settings settings;
+    settings.minIntervalMs = SAMPLE_MIN_INTERVAL_MS;
+    settings.baseIntervalMs = SAMPLE_BASE_INTERVAL_MS;
+    settings.maxIntervalMs = SAMPLE_MAX_INTERVAL_MS;
+    sampler.begin(settings);
+
+    SampleFusion fusion(sampler);
+    static Trend::History trends;
+    trends.begin();
+
+    // -------- Bus trace (same capture path as the device) --------
+    FILE* traceFile = nullptr;
+    if (opt.trace) {
+        traceFile = fopen(opt.trace, "wb");
+        if (!traceFile) {
+            perror(opt.trace);
+            return 1;
+        }
+        BusTrace::start();
+        uint8_t hdr[BusTrace::HEADER_SIZE];
+        fwrite(hdr, 1, BusTrace::header(hdr), traceFile);
+    }
+    auto drainTrace = [&]() {
+        uint8_t chunk[512];
+        size_t n;
+        while (traceFile && (n = BusTrace::drain(chunk, sizeof(chunk))) > 0) fwrite(chunk, 1, n, traceFile);
+    };
+
+    // -------- Run --------
+    const uint32_t endMs = (uint32_t)(opt.hours * 3600000.0f);
+    uint32_t seq = 0, pmOk = 0, categoryChanges = 0, jsonFailed = 0;
+    size_t warmLive = 0;
+    uint64_t intervalSum = 0;
+
+    if (opt.csv) printf("t_ms,pm1_0,pm2_5,pm10,tvoc,temp,hum,aqi,battery,next_ms\n");
+
+    auto wall0 = std::chrono::steady_clock::now();
+    uint32_t nextDue = millis();
+
+    while (millis() < endMs) {
+        SimHAL::advanceToMs(nextDue);
+        uint32_t tMs = millis();
+        if (!HeapTrack::c.steady && tMs >= 3600000UL) {
+            HeapTrack::c.steady = true;   // warm-up hour over
+            warmLive = HeapTrack::c.live;
+        }
+        BusTrace::cycle(seq + 1);
+
+        // Acquisition (sequential here; concurrent per bus on the device)
+        SampleFusion::Input in;
+        in.havePM = true;
+        in.pmOk = pm_sensor.read(in.pm);
+        in.haveTVOC = true;
+        in.tvoc = tvoc_sensor.readTVOC();
+        in.tvocFresh = tvoc_sensor.fresh();
+        in.haveClimate = true;
+        in.temp = temp_hum_sensor.readTemperature();
+        in.hum = temp_hum_sensor.readHumidity();
+        in.battery = BatteryMonitor::getPercentage();
+
+        bool changed = false;
+        FusedSample s = fusion.fuse(++seq, tMs, in, changed);
+        trends.add(tMs, s.pm.pm2_5, (float)s.aqi, s.tvoc, s.temp);
+        StreamStats::add(s);
+
+        // Upload bodies, as WebServerModule builds them
+        char body[SampleJson::MAX_LEN];
+        SampleJson::Fields f{s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum,
+                             s.aqi, s.battery, "sample_age_s", 0, StreamStats::dayStats()};
+        if (!SampleJson::write(body, sizeof(body), f)) jsonFailed++;
+        uint8_t cbor[SampleCbor::MAX_LEN];
+        if (!SampleCbor::write(cbor, sizeof(cbor), f)) jsonFailed++;
+
+        if (in.pmOk) pmOk++;
+        if (changed) categoryChanges++;
+        intervalSum += s.nextIntervalMs;
+
+        if (opt.csv) {
+            printf("%lu,%u,%u,%u,%.0f,%.1f,%.1f,%d,%d,%lu\n", (unsigned long)tMs,
+                   s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum, s.aqi,
+                   s.battery, (unsigned long)s.nextIntervalMs);
+        }
+        nextDue = tMs + s.nextIntervalMs;
+        drainTrace();
+    }
+
+    if (traceFile) {
+        BusTrace::stop();
+        drainTrace();
+        fprintf(stderr, "Trace: %lu records -> %s (%ld bytes, %lu dropped)\n",
+                (unsigned long)BusTrace::records(), opt.trace, ftell(traceFile),
+                (unsigned long)BusTrace::dropped());
+        fclose(traceFile);
+    }
+
+    double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+    double simS = millis() / 1000.0;
+
+    fprintf(stderr, "Simulated %.1f h (seed %lu): %lu samples, avg interval %.1f s\n",
+            simS / 3600.0, (unsigned long)opt.seed, (unsigned long)seq,
+            seq ? intervalSum / (double)seq / 1000.0 : 0.0);
+    fprintf(stderr, "PM frames ok: %lu/%lu | AQI category changes: %lu | UART overflow: %lu B\n",
+            (unsigned long)pmOk, (unsigned long)seq, (unsigned long)categoryChanges,
+            (unsigned long)hal.uartOverflow);
+    fprintf(stderr, "PM2.5 1h axis: %.0f-%.0f | wall %.3f s (%.0fx real time)\n",
+            trends.ring(Trend::PM25, false).axisMin(), trends.ring(Trend::PM25, false).axisMax(),
+            wallS, wallS > 0 ? simS / wallS : 0.0);
+    fprintf(stderr, "Heap: %llu allocs (%llu after warm-up) | live %zu B (%zu B after warm-up) | peak %zu B\n",
+            (unsigned long long)HeapTrack::c.allocs, (unsigned long long)HeapTrack::c.steadyAllocs,
+            HeapTrack::c.live, warmLive, HeapTrack::c.peak);
+    if (jsonFailed) fprintf(stderr, "⚠️ %lu upload bodies did not fit\n", (unsigned long)jsonFailed);
+
+    if (opt.soak) {
+        bool ok = HeapTrack::c.steady && HeapTrack::c.steadyAllocs == 0 &&
+                  HeapTrack::c.live <= warmLive && jsonFailed == 0;
+        fprintf(stderr, "%s Heap soak (%.0f h)\n", ok ? "✅" : "❌", simS / 3600.0);
+        return ok ? 0 : 1;
+    }
+    return 0;
+}
@@ -7,37 +7,347 @@
 #include "oled_display.h"
 #include "pm_sensor.h"
 #include "tvoc_sensor.h"
+#include "touch_input.h"
 #include "temp_humidity_sensor.h"
 #include "web_server.h"
 #include "iaq_calculator.h"
 #include "wifi_manager.h"
+#include "connectivity_manager.h"
 #include "web_updater.h"
 #include "battery_monitor.h"
+#include "power_manager.h"
+#include "power_locks.h"
+#include "adaptive_sampler.h"
+#include "sensor_pipeline.h"
+#include "async_log.h"
+#include "boot_sequence.h"
+#include "pm_calibration.h"
 
 // -----------------------------
 // Module Instances
 // -----------------------------
 PMSensor pm_sensor(Serial2);
-PMData pm;
 
 TVOCSensor tvoc_sensor;
 TempHumiditySensor temp_hum_sensor(DHT_PIN, DHT_TYPE);
 OLEDDisplay display(OLED_SDA, OLED_SCL, OLED_ADDR);
 
 AsyncWebServer server(80);
-WebServerModule web(server, pm_sensor, tvoc_sensor, temp_hum_sensor);
+WebServerModule web(server);
+ConnectivityManager connectivity;
+AdaptiveSampler sampler;
+SensorPipeline pipeline(pm_sensor, tvoc_sensor, temp_hum_sensor, sampler, web, display, connectivity);
 
 OLEDDisplay::ScreenMode currentMode = OLEDDisplay::CYCLE_ALL;
+bool trendDay = false;  // trend screens: second tap switches 1 h -> 24 h
+esp_reset_reason_t bootResetReason = ESP_RST_UNKNOWN;
+
+// Boot phases that complete after setup() (see boot_sequence.h)
+static int wifiPhase = -1;
+static int firstSamplePhase = -1;
+static int otaPhase = -1;
+
+// ======================================================================
+// CONNECTIVITY EVENTS (run on the pipeline network task from connectivity.loop())
+// ======================================================================
+static void onAPTimeout(void*) {
+    LOG_W("⚠️ AP timeout - rebooting...");
+    Log::flush();
+    ESP.restart();
+}
+
+// Deferred OTA check (network task): the first uploads go out before a
+// possibly long download
+static void onBootOTA(void*) {
+    LOG_I("🔍 Starting OTA check...");
+    WebUpdater::checkAndApplyUpdate(&display);
+    LOG_I("✅ Remote OTA Check Complete");
+    BootSequence::close(otaPhase, true);
+}
+
+void onConnectivityChange(ConnectivityManager::State state) {
+    static bool webStarted = false;
+    bool online = (state == ConnectivityManager::CONNECTED);
+
+    web.setOnline(online);
+    display.setWiFiConnected(online);
+    if (online) PowerLocks::enableModemSleep();
+
+    if (online && !webStarted) {
+        webStarted = true;
+        display.showMessage("WiFi OK!");
+
+        // Start web server with current WiFi credentials
+        LOG_I("🌐 Starting Web Server...");
+        web.begin(WiFi.SSID().c_str(), WiFi.psk().c_str());
+        LOG_I("✅ Web Server Started");
+
+        // Initialize OTA Updater (GitHub Check), deferred off the boot path
+        // Skip OTA check if we just had a software reset (might be in restart loop)
+        if (bootResetReason == ESP_RST_SW || bootResetReason == ESP_RST_PANIC) {
+            LOG_W("⚠️ Skipping OTA check (software reset detected - possible restart loop)");
+        } else {
+            otaPhase = BootSequence::open("ota", BOOT_OTA_DELAY_MS + BOOT_OTA_BUDGET_MS);
+            pipeline.scheduler().after("boot_ota", BOOT_OTA_DELAY_MS, onBootOTA);
+        }
+    }
+
+    // Boot report: first association (or giving up on it)
+    if (online) BootSequence::close(wifiPhase, true);
+
+    if (state == ConnectivityManager::AP_FALLBACK) {
+        BootSequence::close(wifiPhase, false);
+        LOG_W("⚠️  WiFi connection failed - Starting AP mode");
+        display.showMessage("WiFi Failed\nAP Mode");
+        startAPForConfig(&display);  // Pass display pointer for password display
+
+        // Nobody configured WiFi in time: reboot and try the saved network again
+        static int apTimeoutJob = -1;
+        if (apTimeoutJob < 0) {
+            apTimeoutJob = pipeline.scheduler().after("ap_timeout", WIFI_AP_TIMEOUT_MS, onAPTimeout);
+        }
+
+        LOG_W("⚠️ In AP mode - web server not started for sensor data");
+        LOG_I("📱 Connect to 'HomeSense-Setup' to configure WiFi");
+    }
+}
+
+// ======================================================================
+// CALIBRATION (per-device PM coefficients, see pm_calibration.h)
+// ======================================================================
+static void loadCalibration() {
+    File file = LittleFS.open("/config.json", "r");
+    if (!file) return;
+
+    StaticJsonDocument<1024> doc;
+    DeserializationError err = deserializeJson(doc, file);
+    file.close();
+    if (err || doc["pm_calibration"].isNull()) return;
+
+    JsonVariantConst cfg = doc["pm_calibration"];
+    PMCalibration::configure(PMCalibration::fromJson(cfg));
+    const PMCalibration::Settings& s = PMCalibration::settings();
+    LOG_I("✅ PM calibration: kappa %.2f, curve points PM2.5 %u / PM10 %u", s.kappa,
+          s.curve[PMCalibration::PM25].n, s.curve[PMCalibration::PM10].n);
+}
+
+// ======================================================================
+// LOW-POWER CYCLE (battery mode - never returns)
+// ======================================================================
+static bool waitForWiFi(unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED && millis() - start < timeoutMs) {
+        delay(10);
+        esp_task_wdt_reset();
+    }
+    return WiFi.status() == WL_CONNECTED;
+}
+
+static void flushLowPowerBuffer() {
+    unsigned long t0 = millis();
+
+    // Fast connect from the RTC cache, full scan only as fallback
+    WiFiAttempt attempt = startWiFiConnect(true);
+    bool connected = false;
+    if (attempt == WIFI_ATTEMPT_FAST) {
+        connected = waitForWiFi(WIFI_FAST_TIMEOUT_MS);
+        if (!connected) {
+            WiFi.disconnect();
+            attempt = startWiFiConnect(false);
+        }
+    }
+    if (!connected && attempt == WIFI_ATTEMPT_FULL) {
+        connected = waitForWiFi(WIFI_FULL_TIMEOUT_MS);
+    }
+
+    if (connected) {
+        rememberWiFiConnection(attempt);
+        int sent = web.uploadBatch(PowerManager::samples(), PowerManager::sampleCount(),
+                                   PowerManager::clockS());
+        PowerManager::consumeSamples(sent);
+        LOG_I("📤 Flushed %d buffered samples", sent);
+    } else {
+        LOG_W("⚠️ WiFi unavailable - keeping samples buffered");
+    }
+
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    PowerManager::recordWifiTime(millis() - t0);
+}
+
+static void takeLowPowerSample() {
+    // ZH07 sleeps between wakeups; give the fan time to stabilise. The
+    // TVOC conversion runs meanwhile (heater warm-up carries over sleeps).
+    pm_sensor.wake();
+    tvoc_sensor.trigger();
+    delay(PowerManager::settings().pmWarmupMs);
+    esp_task_wdt_reset();
+
+    PMData reading = {0, 0, 0};
+    bool pmOk = false;
+    unsigned long start = millis();
+    while (!pmOk && millis() - start < 3000) {
+        pmOk = pm_sensor.read(reading);
+        if (!pmOk) delay(50);
+    }
+    esp_task_wdt_reset();
+    pm_sensor.sleep();
+
+    float tvoc = tvoc_sensor.readTVOC();
+    float temp = temp_hum_sensor.readTemperature();
+    float hum  = temp_hum_sensor.readHumidity();
+
+    PMData pm = PMCalibration::apply(reading, hum);
+
+    LowPowerSample sample;
+    sample.clockS   = PowerManager::clockS();
+    sample.pm1_0    = pm.pm1_0;
+    sample.pm2_5    = pm.pm2_5;
+    sample.pm10     = pm.pm10;
+    sample.tvoc     = isnan(tvoc) ? 0xFFFF : (uint16_t)tvoc;
+    sample.temp_x10 = isnan(temp) ? INT16_MIN : (int16_t)lroundf(temp * 10);
+    sample.hum      = isnan(hum) ? 0xFF : (uint8_t)lroundf(hum);
+    sample.battery  = BatteryMonitor::getPercentage();
+
+    if (pmOk) {
+        PowerManager::store(sample);
+    } else {
+        LOG_W("⚠️ PM read failed this cycle");
+    }
+}
+
+[[noreturn]] static void runLowPowerCycle() {
+    PowerManager::begin();
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+        PowerBudget::printTable(PowerManager::budgetConfig());
+    }
+
+    pm_sensor.begin(PM_RX_PIN, PM_TX_PIN);
+    temp_hum_sensor.begin();
+    tvoc_sensor.begin(AGS_SDA_PIN, AGS_SCL_PIN);
+
+    // The panel keeps its power and state through ESP32 sleep, and its
+    // init sequence switches it on: timer wakeups leave it alone. After a
+    // reset it may still be lit from the always-on firmware, so switch it
+    // off once.
+    bool displayReady = false;
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED) {
+        display.begin();
+        display.setPower(false);
+        displayReady = true;
+    }
+
+    // setup() armed the 30 s task watchdog for this task. A cycle (warm-up,
+    // WiFi, several TLS POSTs) can outlast it, so each step feeds it; a
+    // step that hangs still resets the board.
+    bool touched = PowerManager::wokeByTouch();
+    while (true) {
+        esp_task_wdt_reset();
+        if (touched) {
+            // Touch wakeup: show the newest buffered sample, then back to sleep
+            const LowPowerSample* s = PowerManager::latest();
+            if (!displayReady) {
+                display.begin();
+                displayReady = true;
+            }
+            display.setPower(true);
+            if (s) {
+                // Same "no reading" markers as takeLowPowerSample() writes
+                float tvoc = (s->tvoc == 0xFFFF) ? NAN : s->tvoc;
+                float temp = (s->temp_x10 == INT16_MIN) ? NAN : s->temp_x10 / 10.0f;
+                float hum  = (s->hum == 0xFF) ? NAN : s->hum;
+                int aqi = IAQ::adjustAQIWithTVOC(IAQ::calculateAQI(s->pm2_5, s->pm10), tvoc);
+                display.setMode(OLEDDisplay::AQI_SCREEN);
+                display.show(s->pm2_5, s->pm10, temp, hum, tvoc, aqi, s->battery);
+            } else {
+                display.showMessage("Sampling...");
+            }
+            delay(LP_TOUCH_SHOW_MS);
+        } else {
+            PowerManager::beginSample();
+            takeLowPowerSample();
+            if (PowerManager::flushDue()) flushLowPowerBuffer();
+        }
+
+        if (touched) display.setPower(false);
+        PowerManager::sleep();  // deep sleep restarts at setup(); light sleep returns here
+        touched = PowerManager::wokeByTouch();
+    }
+}
+
+// ======================================================================
+// BOOT STEPS (see boot_sequence.h; the sensor steps run concurrently)
+// ======================================================================
+static bool mountFS(void*) {
+    if (!LittleFS.begin(true)) {
+        LOG_E("❌ LittleFS mount failed");
+        return false;
+    }
+    LOG_I("✅ LittleFS mounted");
+    return true;
+}
+
+static bool initDisplay(void*) {
+    display.begin();
+    LOG_I("📺 OLED Display initialized");
+
+    // Render on its own task so the boot animation runs while sensors and
+    // WiFi come up
+    if (!display.startRenderTask()) {
+        LOG_W("⚠️ OLED render task unavailable - drawing inline");
+    }
+
+    // Check reset reason - skip boot animation if we just restarted (might be in a loop)
+    if (bootResetReason == ESP_RST_SW || bootResetReason == ESP_RST_PANIC) {
+        LOG_W("⚠️ Software reset detected - skipping boot animation");
+        display.showMessage("Booting...");
+    } else {
+        display.showBootAnimation(WebUpdater::VERSION);
+    }
+    return true;
+}
+
+static bool initPM(void*) {
+    pm_sensor.begin(PM_RX_PIN, PM_TX_PIN);
+    LOG_I("📡 PM Sensor initialized");
+    return true;
+}
+
+static bool initClimate(void*) {
+    temp_hum_sensor.begin();
+    LOG_I("🌡️  Temp/Humidity Sensor initialized");
+    return true;
+}
+
+static bool initTVOC(void*) {
+    if (!tvoc_sensor.begin(AGS_SDA_PIN, AGS_SCL_PIN)) {
+        LOG_E("❌ TVOC sensor not found");
+        return false;
+    }
+    LOG_I("☁️  TVOC Sensor initialized");
+    return true;
+}
 
 // ======================================================================
 // SETUP
 // ======================================================================
 void setup() {
-    // Initialize Serial early and flush any bootloader garbage
     Serial.begin(115200);
-    delay(500); // Give serial time to stabilize
-    
-    // Flush any pending data from bootloader
+    // Phase timing starts here; the report survives resets (see boot_sequence.h)
+    BootSequence::begin();
+    firstSamplePhase = BootSequence::open("sample", BOOT_FIRST_SAMPLE_BUDGET_MS);
+
+    // -----------------------------
+    // Watchdog Timer
+    // -----------------------------
+    // Armed before any init step: a hung step resets the board, and the
+    // previous boot's report at /api/boot shows which one
+    esp_task_wdt_init(30, true);  // 30 second timeout, panic on timeout
+    esp_task_wdt_add(NULL);        // Add current task to watchdog
+    LOG_I("✅ Watchdog timer enabled (30s timeout)");
+
+    // Flush any pending data from bootloader (no settle delay: /api/logs
+    // keeps what a late serial monitor misses)
     while (Serial.available() > 0) {
         Serial.read();
     }
@@ -55,6 +365,7 @@ void setup() {
     // Hardware Diagnostic (Hardening)
     // -----------------------------
     esp_reset_reason_t reason = esp_reset_reason();
+    bootResetReason = reason;
     Serial.print("🔍 Reset Reason: ");
     switch (reason) {
         case ESP_RST_POWERON: Serial.println("Power-on"); break;
@@ -70,187 +381,154 @@ void setup() {
     // -----------------------------
     // Filesystem
     // -----------------------------
-    if (!LittleFS.begin(true)) {
-        Serial.println("❌ LittleFS mount failed");
-    } else {
-        Serial.println("✅ LittleFS mounted");
+    BootSequence::run("fs", BOOT_FS_BUDGET_MS, mountFS);
+
+    // Sampling interval adapts to how fast PM2.5/TVOC are changing
+    AdaptiveSampler::Settings samplerSettings;
+    samplerSettings.minIntervalMs  = SAMPLE_MIN_INTERVAL_MS;
+    samplerSettings.baseIntervalMs = SAMPLE_BASE_INTERVAL_MS;
+    samplerSettings.maxIntervalMs  = SAMPLE_MAX_INTERVAL_MS;
+    sampler.begin(samplerSettings);
+
+    // DVFS + automatic light sleep (subsystems take locks when busy)
+    PowerLocks::begin();
+
+    // Battery mode: duty-cycled sampling instead of the always-on loop
+    PowerManager::loadConfig();
+    loadCalibration();
+    if (PowerManager::enabled()) {
+        LOG_I("🔋 Low-power mode enabled");
+        runLowPowerCycle();
     }
+    PowerBudget::printTable(PowerManager::budgetConfig());
 
-    // Initialize OLED
-    display.begin();
-    Serial.println("📺 OLED Display initialized");
-    
-    // Check reset reason - skip boot animation if we just restarted (might be in a loop)
-    if (reason == ESP_RST_SW || reason == ESP_RST_PANIC) {
-        // Software reset or panic - might be in restart loop, skip animation
-        Serial.println("⚠️ Software reset detected - skipping boot animation");
-        display.showMessage("Booting...");
-        delay(300);
-    } else {
-        // Normal boot - show animation
-        display.showBootAnimation(WebUpdater::VERSION);
+    // Deferred logging from here on: the boot steps below log from
+    // several tasks at once
+    if (!Log::begin()) {
+        Serial.println("⚠️ Log drain task unavailable - logging inline");
     }
 
-    // Initialize sensors
-    Serial.print("📡 Initializing PM Sensor... ");
-    Serial.flush();
-    pm_sensor.begin(PM_RX_PIN, PM_TX_PIN);
-    Serial.println("Done");
+    // Panel first (the render task needs it); the animation then plays on
+    // its own while the rest comes up
+    BootSequence::run("display", BOOT_DISPLAY_BUDGET_MS, initDisplay);
 
-    Serial.print("🌡️  Initializing Temp/Humidity Sensor... ");
-    Serial.flush();
-    temp_hum_sensor.begin();
-    Serial.println("Done");
+    // WiFi Connection (non-blocking; association overlaps the sensor init,
+    // completion arrives via onConnectivityChange)
+    LOG_I("📶 Connecting to WiFi...");
+    wifiPhase = BootSequence::open("wifi", BOOT_WIFI_BUDGET_MS);
+    connectivity.onStateChange(onConnectivityChange);
+    connectivity.begin();
 
-    Serial.print("☁️  Initializing TVOC Sensor... ");
-    Serial.flush();
-    if (tvoc_sensor.begin(AGS_SDA_PIN, AGS_SCL_PIN)) {
-        Serial.println("Done");
-    } else {
-        Serial.println("❌ TVOC sensor not found");
+    // Sensors are independent (UART, GPIO, I2C): bring them up concurrently
+    BootSequence::spawn("pm", BOOT_SENSOR_BUDGET_MS, initPM);
+    BootSequence::spawn("climate", BOOT_SENSOR_BUDGET_MS, initClimate);
+    BootSequence::spawn("tvoc", BOOT_SENSOR_BUDGET_MS, initTVOC);
+
+    // Touch gestures (interrupt + debounce task; loop() only drains the queue)
+    if (!TouchInput::begin(TOUCH_PIN)) {
+        LOG_E("❌ Touch input unavailable");
     }
 
-    // WiFi Connection
-    Serial.println("\n📶 Connecting to WiFi...");
-    bool wifiConnected = connectWiFi();
-    
-    if (wifiConnected) {
-        Serial.printf("✅ WiFi Connected: %s\n", WiFi.localIP().toString().c_str());
-        display.showMessage("WiFi OK!");
-        
-        // Start web server with current WiFi credentials
-        Serial.println("🌐 Starting Web Server...");
-        web.begin(WiFi.SSID().c_str(), WiFi.psk().c_str());
-        Serial.println("✅ Web Server Started");
-        
-        // Initialize OTA Updater (GitHub Check)
-        // Skip OTA check if we just had a software reset (might be in restart loop)
-        if (reason == ESP_RST_SW || reason == ESP_RST_PANIC) {
-            Serial.println("⚠️ Skipping OTA check (software reset detected - possible restart loop)");
-            Serial.println("✅ Continuing with normal operation");
-        } else {
-            Serial.println("🔍 Starting OTA check...");
-            WebUpdater::checkAndApplyUpdate(&display);
-            Serial.println("✅ Remote OTA Check Complete");
-        }
-        
-    } else {
-        Serial.println("⚠️  WiFi connection failed - Starting AP mode");
-        display.showMessage("WiFi Failed\nAP Mode");
-        startAPForConfig(&display);  // Pass display pointer for password display
-        
-        Serial.println("⚠️ In AP mode - web server not started for sensor data");
-        Serial.println("📱 Connect to 'HomeSense-Setup' to configure WiFi");
+    // A sensor that missed its budget reads as unavailable until it recovers
+    if (!BootSequence::join()) {
+        LOG_W("⚠️ Continuing boot with degraded sensors");
     }
 
-    // -----------------------------
-    // Watchdog Timer
-    // -----------------------------
-    esp_task_wdt_init(30, true);  // 30 second timeout, panic on timeout
-    esp_task_wdt_add(NULL);        // Add current task to watchdog
-    Serial.println("✅ Watchdog timer enabled (30s timeout)");
+    // loop() sleeps until a gesture or a display sample wakes it
+    TouchInput::setListener(xTaskGetCurrentTaskHandle());
+    pipeline.setDisplayListener(xTaskGetCurrentTaskHandle());
 
-    Serial.println("\n🚀 System Ready!");
-    Serial.println("==============================");
+    // Acquisition / fusion / sink tasks (see sensor_pipeline.h)
+    if (!pipeline.begin()) {
+        LOG_E("❌ Sensor pipeline failed to start - restarting");
+        Log::flush();
+        delay(1000);
+        ESP.restart();
+    }
+
+    BootSequence::ready();
+    LOG_I("==============================");
 }
 
 // ======================================================================
 // LOOP
 // ======================================================================
 void loop() {
-    // Persistent Sensor Data (for UI redraws)
-    static PMData lastValidPM = {0, 0, 0};
-    static int pmReadFailures = 0;
-    static float tvoc = 0;
-    static float temp = 0;
-    static float hum = 0;
-    static int aqi = 0;
-    static int batteryPercent = 0;
-
-    // Non-blocking timer for sensors (10 seconds)
-    static unsigned long lastSensorRead = 0;
-    const unsigned long sensorInterval = 10000;
-
-    // Non-blocking timer for OTA check (1 hour)
-    static unsigned long lastOTACheck = millis();
-    const unsigned long otaInterval = 3600000; 
-
-    if (millis() - lastOTACheck > otaInterval) {
-        lastOTACheck = millis();
-        WebUpdater::checkAndApplyUpdate(&display);
-    }
-
-    if (millis() - lastSensorRead > sensorInterval) {
-        lastSensorRead = millis();
+    // Latest fused sample (for UI redraws); sensors, uploads, logging and
+    // the WiFi state machine run on the pipeline tasks
+    static FusedSample latest = {};
+    static bool displayOn = true;
 
-        // Read sensors
-        if (pm_sensor.read(pm)) {
-            lastValidPM = pm;
-            pmReadFailures = 0;
-        } else {
-            pm = lastValidPM;
-            pmReadFailures++;
-            if (pmReadFailures > 10) Serial.println("⚠️ PM Fail");
+    // Display sink
+    FusedSample sample;
+    while (pipeline.pollDisplay(sample)) {
+        latest = sample;
+        if (latest.pmValid && firstSamplePhase >= 0) {
+            BootSequence::close(firstSamplePhase, true);
+            firstSamplePhase = -1;
         }
-
-        // Read other sensors
-        tvoc = tvoc_sensor.readTVOC();
-        temp = temp_hum_sensor.readTemperature();
-        hum  = temp_hum_sensor.readHumidity();
-
-        // Calculate AQI
-        aqi = IAQ::calculateAQI(pm.pm2_5, pm.pm10);
-        aqi = IAQ::adjustAQIWithTVOC(aqi, tvoc);
-        const char* category = IAQ::getAQICategory(aqi);
-
-        // Read battery
-        batteryPercent = BatteryMonitor::getPercentage();
-
-        // Cloud upload handler - passing FRESH data
-        web.loop(pm, tvoc, temp, hum, aqi, batteryPercent);
-
-        // Serial Log
-        Serial.printf(
-            "📊 PM2.5:%3u | PM10:%3u | TVOC:%6.2f | Temp:%4.1f°C | Hum:%4.1f%% | AQI:%3d (%s) | Batt:%d%%\n",
-            pm.pm2_5, pm.pm10, tvoc, temp, hum, aqi, category, batteryPercent
-        );
-
-        // Update OLED content
-        display.show(pm.pm2_5, pm.pm10, temp, hum, tvoc, aqi, batteryPercent);
+        display.show(latest.pm.pm2_5, latest.pm.pm10, latest.temp, latest.hum,
+                     latest.tvoc, latest.aqi, latest.battery);
     }
     
     // ------------------------------------
     // UI Loop (Fast Response)
     // ------------------------------------
-    static bool lastTouch = LOW;
-    
-    // Handle Touch Button instantly
-    bool currentTouch = digitalRead(TOUCH_PIN);
-
-    // Detect Rising Edge (LOW -> HIGH)
-    if (currentTouch == HIGH && lastTouch == LOW) {
-        // Cycle Mode
-        switch (currentMode) {
-            case OLEDDisplay::AQI_SCREEN:  currentMode = OLEDDisplay::PM25_SCREEN; break;
-            case OLEDDisplay::PM25_SCREEN: currentMode = OLEDDisplay::PM10_SCREEN; break;
-            case OLEDDisplay::PM10_SCREEN: currentMode = OLEDDisplay::TEMP_SCREEN; break;
-            case OLEDDisplay::TEMP_SCREEN: currentMode = OLEDDisplay::HUM_SCREEN;  break;
-            case OLEDDisplay::HUM_SCREEN:  currentMode = OLEDDisplay::TVOC_SCREEN; break;
-            case OLEDDisplay::TVOC_SCREEN: currentMode = OLEDDisplay::CYCLE_ALL;   break;
-            case OLEDDisplay::CYCLE_ALL:   currentMode = OLEDDisplay::AQI_SCREEN;  break;
+    TouchInput::Gesture gesture;
+    while (TouchInput::poll(gesture)) {
+        LOG_I("👆 Touch: %s", TouchInput::name(gesture));
+
+        switch (gesture) {
+            case TouchInput::TAP:
+                if (!displayOn) {
+                    // First tap only wakes the panel
+                    displayOn = true;
+                    display.setPower(true);
+                    break;
+                }
+                // Cycle Mode (trend screens show 1 h first, then 24 h on the next tap)
+                if (currentMode >= OLEDDisplay::PM25_TREND && !trendDay) {
+                    trendDay = true;
+                } else {
+                    trendDay = false;
+                    switch (currentMode) {
+                        case OLEDDisplay::AQI_SCREEN:  currentMode = OLEDDisplay::PM25_SCREEN; break;
+                        case OLEDDisplay::PM25_SCREEN: currentMode = OLEDDisplay::PM10_SCREEN; break;
+                        case OLEDDisplay::PM10_SCREEN: currentMode = OLEDDisplay::TEMP_SCREEN; break;
+                        case OLEDDisplay::TEMP_SCREEN: currentMode = OLEDDisplay::HUM_SCREEN;  break;
+                        case OLEDDisplay::HUM_SCREEN:  currentMode = OLEDDisplay::TVOC_SCREEN; break;
+                        case OLEDDisplay::TVOC_SCREEN: currentMode = OLEDDisplay::PM25_TREND;  break;
+                        case OLEDDisplay::PM25_TREND:  currentMode = OLEDDisplay::AQI_TREND;   break;
+                        case OLEDDisplay::AQI_TREND:   currentMode = OLEDDisplay::TVOC_TREND;  break;
+                        case OLEDDisplay::TVOC_TREND:  currentMode = OLEDDisplay::TEMP_TREND;  break;
+                        case OLEDDisplay::TEMP_TREND:  currentMode = OLEDDisplay::CYCLE_ALL;   break;
+                        case OLEDDisplay::CYCLE_ALL:   currentMode = OLEDDisplay::AQI_SCREEN;  break;
+                    }
+                }
+                display.setMode(currentMode, trendDay);
+
+                // Redraw with CACHED data (queued to the render task)
+                display.show(latest.pm.pm2_5, latest.pm.pm10, latest.temp, latest.hum,
+                             latest.tvoc, latest.aqi, latest.battery);
+                break;
+
+            case TouchInput::DOUBLE_TAP:
+                // Fresh reading now, uploaded regardless of the upload interval
+                web.requestUpload(true);
+                pipeline.requestSample();
+                break;
+
+            case TouchInput::LONG_PRESS:
+                displayOn = !displayOn;
+                display.setPower(displayOn);
+                break;
         }
-        display.setMode(currentMode);
-        
-        // Force redraw immediately using CACHED data
-        display.show(pm.pm2_5, pm.pm10, temp, hum, tvoc, aqi, batteryPercent);
-        
-        // Simple debounce delay to prevent double-taps
-        delay(200); 
     }
-    
-    lastTouch = currentTouch;
 
-    // Reset watchdog timer
+    // Display timers when rendering inline (deferred frames, screen cycle)
+    uint32_t waitMs = min<uint32_t>(display.service(), UI_IDLE_WAKE_MS);
+
+    // Reset watchdog timer, then sleep until a gesture, a sample or a timer
     esp_task_wdt_reset();
-    delay(50); // Small delay for CPU breath
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));
 }
@@ -0,0 +1,20 @@
+#pragma once
+#include <stdio.h>
+#include <unity.h>
+
+// -----------------------------------
+// Host Test Checks
+// Shared by the Unity tests in test/test_*/ (pio test -e native).
+// CHECK(cond, fmt, ...) is TEST_ASSERT with a printf-style detail line
+// (which sample / job / unit went wrong) printed ahead of Unity's FAIL
+// line; like every Unity assertion it ends the current test.
+// -----------------------------------
+#define CHECK(cond, ...)               \
+    do {                               \
+        if (!(cond)) {                 \
+            printf("  ");              \
+            printf(__VA_ARGS__);       \
+            printf("\n");              \
+            TEST_FAIL_MESSAGE(#cond);  \
+        }                              \
+    } while (0)
@@ -0,0 +1,522 @@
+// -----------------------------------
+// Fleet Host Test
+//
+// Runs several units in one process, each with its own FleetSync and
+// UDP socket on loopback multicast, on the virtual clock. Each unit
+// samples at its own jittered interval. The upload path of
+// WebServerModule::loop() is mirrored: on the unit's 30 s tick the next
+// sample uploads singly, as a batch, or is left to the aggregator.
+// Checks:
+//   HMAC vectors, frame round trip (fixed-point, NAN, quality, day
+//   stats), bad and unauthenticated frames, ACKs and the direct-upload
+//   fallback when they stop,
+//   every unit agreeing on one aggregator (lowest id, never a "member"),
+//   failover when the aggregator goes silent and again when its batches
+//   fail, and its return after a restart,
+//   and how stale each unit's data gets before it is uploaded, against
+//   every unit uploading on its own.
+// Reports POSTs and body bytes for both, and wire bytes with an assumed
+// per-connection TLS + HTTP overhead.
+//
+// Run:    pio test -e native -f test_fleet
+// -----------------------------------
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <random>
+#include <vector>
+
+#include "../check.h"
+#include "sim_hal.h"
+#include "fleet_sync.h"
+
+// Full TLS 1.2 handshake with a two-certificate chain plus HTTP request
+// and response headers. Not measured here: an estimate, for scale.
+static constexpr size_t POST_OVERHEAD_EST = 5000;
+
+static constexpr int UNITS = 5;
+static constexpr uint32_t UPLOAD_INTERVAL_MS = 30000;
+static constexpr uint32_t STEP_MS = 250;
+static const char BATCH_URL[] = "https://example.com/api/aqi/batch";   // never contacted
+static const char GROUP_KEY[] = "test group key";
+
+static HmacSha256 groupKey() {
+    HmacSha256 k;
+    k.setKey((const uint8_t*)GROUP_KEY, strlen(GROUP_KEY));
+    return k;
+}
+
+static FleetSync::Settings groupSettings(uint16_t port) {
+    FleetSync::Settings s;
+    s.enabled = true;
+    s.port = port;
+    snprintf(s.endpoint, sizeof(s.endpoint), "%s", BATCH_URL);
+    snprintf(s.key, sizeof(s.key), "%s", GROUP_KEY);
+    return s;
+}
+
+static uint16_t testPort() {
+    return FLEET_PORT + 1 + getpid() % 2000;   // parallel runs do not mix
+}
+
+static FusedSample makeSample(uint32_t seq, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(0, 1);
+    FusedSample s;
+    memset(&s, 0, sizeof(s));
+    s.seq = seq;
+    s.tMs = millis();
+    s.pm = {(uint16_t)(5 + u(rng) * 20), (uint16_t)(8 + u(rng) * 30), (uint16_t)(12 + u(rng) * 40)};
+    s.pmValid = true;
+    s.tvoc = u(rng) < 0.1f ? NAN : roundf(100 + u(rng) * 400);
+    s.temp = 20 + u(rng) * 5;
+    s.hum = 40 + u(rng) * 20;
+    s.aqi = IAQ::calculateAQI(s.pm.pm2_5, s.pm.pm10);
+    s.battery = 100;
+    return s;
+}
+
+// RFC 4231 test cases 2 and 6 (key longer than a block)
+static void testHmac() {
+    uint8_t tag[32];
+    char hex[65];
+    auto toHex = [&]() {
+        for (int i = 0; i < 32; i++) snprintf(hex + 2 * i, 3, "%02x", tag[i]);
+        return hex;
+    };
+
+    HmacSha256 k;
+    k.setKey((const uint8_t*)"Jefe", 4);
+    const char* m = "what do ya want for nothing?";
+    k.tag((const uint8_t*)m, strlen(m), tag, sizeof(tag));
+    CHECK(!strcmp(toHex(), "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"), "case 2: %s", hex);
+
+    uint8_t longKey[131];
+    memset(longKey, 0xaa, sizeof(longKey));
+    k.setKey(longKey, sizeof(longKey));
+    m = "Test Using Larger Than Block-Size Key - Hash Key First";
+    k.tag((const uint8_t*)m, strlen(m), tag, sizeof(tag));
+    CHECK(!strcmp(toHex(), "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"), "case 6: %s", hex);
+    CHECK(k.check((const uint8_t*)m, strlen(m), tag, 8) && (tag[0] ^= 1, !k.check((const uint8_t*)m, strlen(m), tag, 8)),
+          "truncated tag check");
+}
+
+static void testFrames() {
+    HmacSha256 key = groupKey();
+    std::mt19937 rng(7);
+    FusedSample s = makeSample(123456, rng);
+    s.tvoc = NAN;
+    s.temp = -12.34f;
+    s.hum = 55.55f;
+    s.quality[SENSOR_TVOC] = QUALITY_MISSING;
+    s.quality[SENSOR_CLIMATE] = QUALITY_HELD;
+    SampleJson::DayStats day = {true, 12.34f, 30.06f, 75, 88};
+
+    uint8_t frame[FleetFrame::MAX_LEN];
+    FleetFrame::Header h = {FleetFrame::SAMPLE, 0xA1B2C3D4, FleetFrame::CAN_AGGREGATE, 2};
+    size_t len = FleetFrame::writeSample(frame, sizeof(frame), h, FleetFrame::fromFused(s, day), key);
+    CHECK(len == FleetFrame::SAMPLE_LEN && len == 46, "sample frame %zu bytes", len);
+
+    FleetFrame::Header r;
+    FleetFrame::Sample f;
+    CHECK(FleetFrame::readHeader(frame, len, r) && r.type == FleetFrame::SAMPLE && r.id == 0xA1B2C3D4 &&
+          r.priority == 2 && (r.flags & FleetFrame::CAN_AGGREGATE) && (r.flags & FleetFrame::DAY_VALID),
+          "header");
+    CHECK(FleetFrame::authentic(frame, r, key), "tag of a sample frame");
+    FleetFrame::readSample(frame, f);
+    CHECK(f.seq == 123456 && f.pm1 == s.pm.pm1_0 && f.pm25 == s.pm.pm2_5 && f.pm10 == s.pm.pm10 &&
+          f.aqi == s.aqi && f.battery == 100, "integers");
+    CHECK(isnan(f.tvoc) && fabsf(f.temp + 12.3f) < 1e-4f && fabsf(f.hum - 55.6f) < 1e-4f,
+          "fixed point: tvoc %.2f temp %.2f hum %.2f", f.tvoc, f.temp, f.hum);
+    CHECK(f.quality[SENSOR_PM] == QUALITY_GOOD && f.quality[SENSOR_TVOC] == QUALITY_MISSING &&
+          f.quality[SENSOR_CLIMATE] == QUALITY_HELD, "quality");
+    CHECK(f.day.valid && fabsf(f.day.pm25Mean - 12.3f) < 1e-4f && fabsf(f.day.pm25P95 - 30.1f) < 1e-4f &&
+          f.day.pm25OverMin == 75 && f.day.aqiMax == 88, "day stats");
+
+    FleetFrame::Announce a = {3600, FIRMWARE_VERSION}, b;
+    len = FleetFrame::writeAnnounce(frame, sizeof(frame), h, a, key);
+    CHECK(len == FleetFrame::ANNOUNCE_LEN && FleetFrame::readHeader(frame, len, r) &&
+          r.type == FleetFrame::ANNOUNCE && FleetFrame::authentic(frame, r, key), "announce header");
+    FleetFrame::readAnnounce(frame, b);
+    CHECK(b.uptimeS == 3600 && !strcmp(b.version, FIRMWARE_VERSION), "announce %s", b.version);
+
+    // Any changed bit, or another key, fails the tag
+    frame[9] ^= 1;   // priority
+    CHECK(FleetFrame::readHeader(frame, len, r) && !FleetFrame::authentic(frame, r, key), "changed priority accepted");
+    len = FleetFrame::writeAnnounce(frame, sizeof(frame), h, a, key);
+    HmacSha256 other;
+    other.setKey((const uint8_t*)"other group", 11);
+    CHECK(!FleetFrame::authentic(frame, r, other), "frame of another group accepted");
+
+    FleetFrame::Ack ack = {3, {0x10, 0x20, 0x30}, {7, 8, 9}}, back;
+    uint8_t ackFrame[FleetFrame::ACK_MAX_LEN];
+    size_t ackLen = FleetFrame::writeAck(ackFrame, sizeof(ackFrame), h, ack, key);
+    CHECK(ackLen == FleetFrame::HEADER_LEN + 1 + 3 * 8 + FleetFrame::TAG_LEN && FleetFrame::readHeader(ackFrame, ackLen, r) &&
+          r.type == FleetFrame::ACK && FleetFrame::authentic(ackFrame, r, key), "ack header (%zu bytes)", ackLen);
+    FleetFrame::readAck(ackFrame, back);
+    CHECK(back.count == 3 && back.id[1] == 0x20 && back.seq[2] == 9, "ack round trip");
+    CHECK(!FleetFrame::readHeader(ackFrame, ackLen - 1, r), "truncated ack accepted");
+    ackFrame[FleetFrame::HEADER_LEN] = FleetFrame::ACK_MAX_ENTRIES + 1;
+    CHECK(!FleetFrame::readHeader(ackFrame, sizeof(ackFrame), r), "oversized ack accepted");
+
+    CHECK(!FleetFrame::readHeader(frame, len - 1, r), "truncated frame accepted");
+    frame[0] = 'X';
+    CHECK(!FleetFrame::readHeader(frame, len, r), "bad magic accepted");
+    frame[0] = 'H';
+    frame[2] = FleetFrame::VERSION + 1;
+    CHECK(!FleetFrame::readHeader(frame, len, r), "other version accepted");
+}
+
+// One simulated unit: sensor timing plus the WebServerModule upload path
+struct Unit {
+    FleetSync fleet;
+    uint32_t id = 0;
+    FleetSync::Role role = FleetSync::ROLE_AUTO;
+    std::mt19937 rng;
+    uint32_t seq = 0;
+    uint32_t nextSampleMs = 0;
+    uint32_t nextUploadMs = 0;
+    uint32_t nextPollMs = 0;
+    bool uploadDue = false;
+    bool up = true;
+    bool postsFail = false;
+    FusedSample last;
+    std::vector<uint32_t> publishedMs;   // by seq
+    uint32_t coveredSeq = 0;             // samples below this are uploaded
+    uint32_t maxStaleMs = 0;
+    uint32_t aloneSeq = 0;               // same, had every unit uploaded itself
+    uint32_t aloneStaleMs = 0;
+};
+
+struct Totals {
+    uint32_t posts = 0;
+    uint64_t body = 0;
+};
+
+static size_t singleBody(const FusedSample& s, const SampleJson::DayStats& day) {
+    char body[SampleJson::MAX_LEN];
+    SampleJson::Fields f = FleetFrame::toFields(FleetFrame::fromFused(s, day), nullptr, 0);
+    return SampleJson::write(body, sizeof(body), f);
+}
+
+// Every sample of u up to seq made it to the cloud now
+static void cover(const Unit& u, uint32_t seq, uint32_t& covered, uint32_t& maxStale) {
+    for (; covered <= seq && covered < u.publishedMs.size(); covered++) {
+        uint32_t stale = millis() - u.publishedMs[covered];
+        if (stale > maxStale) maxStale = stale;
+    }
+}
+
+static void cover(Unit& u, uint32_t seq) {
+    cover(u, seq, u.coveredSeq, u.maxStaleMs);
+}
+
+static Unit* byId(Unit* units, uint32_t id) {
+    for (int i = 0; i < UNITS; i++) {
+        if (units[i].id == id) return &units[i];
+    }
+    return nullptr;
+}
+
+static bool agree(Unit* units, uint32_t want) {
+    for (int i = 0; i < UNITS; i++) {
+        if (units[i].up && units[i].fleet.aggregator() != want) return false;
+    }
+    return true;
+}
+
+static void startUnit(Unit& u, uint16_t port) {
+    FleetSync::Settings s = groupSettings(port);
+    s.role = u.role;
+    CHECK(u.fleet.begin(u.id, s), "unit %08lx could not join the group", (unsigned long)u.id);
+    u.fleet.setOnline(true);
+    u.up = true;
+}
+
+static void testFleet() {
+    printf("  %d units on loopback multicast\n", UNITS);
+    uint16_t port = testPort();
+    static Unit units[UNITS];
+    static const uint32_t ids[UNITS] = {0x0000A101, 0x0000A102, 0x0000A0FF, 0x0000A103, 0x0000A104};
+    for (int i = 0; i < UNITS; i++) {
+        Unit& u = units[i];
+        u.id = ids[i];
+        u.role = i == 2 ? FleetSync::ROLE_MEMBER : FleetSync::ROLE_AUTO;   // lowest id, never aggregates
+        u.rng.seed(100 + i);
+        u.nextSampleMs = millis() + u.rng() % 10000;
+        u.nextUploadMs = millis() + u.rng() % UPLOAD_INTERVAL_MS;
+        u.nextPollMs = millis() + u.rng() % FLEET_POLL_MS;
+        startUnit(u, port);
+    }
+
+    Totals alone, fleet;
+    uint32_t lanBytes = 0;
+    const uint32_t start = millis();
+    const uint32_t stopAt = start + 60 * 60000, restartAt = start + 90 * 60000;
+    const uint32_t failFrom = start + 120 * 60000, failTo = start + 125 * 60000;
+    const uint32_t end = start + 180 * 60000;
+    uint32_t firstAgreeMs = 0, failoverMs = 0, returnMs = 0, handoverMs = 0;
+    uint32_t batchedDevices = 0, batches = 0;
+    uint8_t batch[FleetSync::BATCH_MAX_LEN];
+
+    for (uint32_t now = start; now < end; now += STEP_MS) {
+        SimHAL::advanceToMs(now);
+
+        // Aggregator silent for 30 min (power cut), then back
+        if (now == stopAt) {
+            units[0].fleet.stop();
+            units[0].up = false;
+        }
+        if (now == restartAt) startUnit(units[0], port);
+        units[0].postsFail = now >= failFrom && now < failTo;
+
+        for (int i = 0; i < UNITS; i++) {
+            Unit& u = units[i];
+            if (!u.up) continue;
+            if ((int32_t)(now - u.nextPollMs) >= 0) {
+                u.fleet.poll();
+                u.nextPollMs += FLEET_POLL_MS;
+            }
+            if ((int32_t)(now - u.nextUploadMs) >= 0) {
+                u.uploadDue = true;
+                u.nextUploadMs += UPLOAD_INTERVAL_MS;
+            }
+            if ((int32_t)(now - u.nextSampleMs) < 0) continue;
+
+            // -------- New sample (WebServerModule::loop) --------
+            u.nextSampleMs = now + 10000 + u.rng() % 50000;
+            u.last = makeSample(u.seq++, u.rng);
+            u.publishedMs.push_back(now);
+            SampleJson::DayStats day = {true, 10.0f + i, 20.0f + i, 5, 60};
+            u.fleet.publish(u.last, day, false);
+            lanBytes += FleetFrame::SAMPLE_LEN;
+            if (!u.uploadDue) continue;
+            u.uploadDue = false;
+
+            size_t single = singleBody(u.last, day);
+            alone.posts++;
+            alone.body += single;
+            cover(u, u.last.seq, u.aloneSeq, u.aloneStaleMs);
+
+            switch (u.fleet.claimUpload()) {
+                case FleetSync::UPLOAD_SINGLE:
+                    fleet.posts++;
+                    fleet.body += single;
+                    if (!u.postsFail) cover(u, u.last.seq);
+                    u.fleet.uploadDone(!u.postsFail);
+                    break;
+                case FleetSync::UPLOAD_BATCH: {
+                    // Units in the batch and their latest seq, before it is marked sent
+                    std::vector<std::pair<uint32_t, uint32_t>> in;
+                    FleetSync::Device d;
+                    for (uint8_t k = 0; u.fleet.unit(k, d); k++) {
+                        if (d.pending) in.push_back({d.id, d.sample.seq});
+                    }
+                    size_t len = u.fleet.writeBatch(batch, sizeof(batch), false);
+                    CHECK(len, "batch of %zu not written", in.size());
+                    fleet.posts++;
+                    fleet.body += len;
+                    if (!u.postsFail) {
+                        batches++;
+                        batchedDevices += in.size();
+                        for (auto& e : in) cover(*byId(units, e.first), e.second);
+                    }
+                    u.fleet.uploadDone(!u.postsFail);
+                    break;
+                }
+                case FleetSync::UPLOAD_DELEGATED:
+                    break;
+            }
+        }
+
+        if (!firstAgreeMs && agree(units, 0x0000A101)) firstAgreeMs = now;
+        if (now > stopAt && now < restartAt && !failoverMs && agree(units, 0x0000A102)) failoverMs = now;
+        if (now > restartAt && now < failFrom && !returnMs && agree(units, 0x0000A101)) returnMs = now;
+        if (now > failFrom && !handoverMs && agree(units, 0x0000A102)) handoverMs = now;
+    }
+
+    CHECK(firstAgreeMs && firstAgreeMs - start <= 2 * FLEET_POLL_MS,
+          "agreed on the aggregator after %lu ms", (unsigned long)(firstAgreeMs - start));
+    CHECK(failoverMs && failoverMs - stopAt <= FLEET_PEER_TIMEOUT_MS + 2 * FLEET_POLL_MS,
+          "failover after %lu ms", (unsigned long)(failoverMs - stopAt));
+    CHECK(returnMs && returnMs - restartAt <= 2 * FLEET_POLL_MS,
+          "restarted aggregator back after %lu ms", (unsigned long)(returnMs - restartAt));
+    CHECK(handoverMs && handoverMs - failFrom <= (FLEET_BATCH_FAIL_LIMIT + 2) * UPLOAD_INTERVAL_MS,
+          "handover after failed batches took %lu ms", (unsigned long)(handoverMs - failFrom));
+
+    // Stale data: upload tick + next sample, plus the failover window
+    uint32_t bound = UPLOAD_INTERVAL_MS + 60000 + FLEET_PEER_TIMEOUT_MS + UPLOAD_INTERVAL_MS + 2 * FLEET_POLL_MS;
+    for (int i = 0; i < UNITS; i++) {
+        Unit& u = units[i];
+        uint32_t missing = u.publishedMs.size() - u.coveredSeq;
+        printf("  unit %08lx (%-6s): %zu samples, max %3lu s before upload (%3lu s alone), %u not yet uploaded\n",
+               (unsigned long)u.id, u.role == FleetSync::ROLE_MEMBER ? "member" : "auto",
+               u.publishedMs.size(), (unsigned long)(u.maxStaleMs / 1000),
+               (unsigned long)(u.aloneStaleMs / 1000), missing);
+        CHECK(u.maxStaleMs <= bound, "unit %08lx waited %lu ms", (unsigned long)u.id,
+              (unsigned long)u.maxStaleMs);
+        CHECK(missing <= 3, "unit %08lx: %u samples never uploaded", (unsigned long)u.id, missing);
+    }
+
+    FleetSync::Stats agg = units[1].fleet.stats();
+    CHECK(!agg.badFrames && !agg.unauthenticated && !agg.sendErrors, "bad frames %lu, unauthenticated %lu, send errors %lu",
+          (unsigned long)agg.badFrames, (unsigned long)agg.unauthenticated, (unsigned long)agg.sendErrors);
+    CHECK(units[2].fleet.stats().batches == 0, "member unit batched");
+
+    double perBatch = batches ? (double)batchedDevices / batches : 0;
+    printf("  %u batches, %.1f units each\n", batches, perBatch);
+    printf("  %-12s %6s %10s %14s\n", "", "POSTs", "body B", "est. wire B");
+    printf("  %-12s %6u %10llu %14llu\n", "each unit", alone.posts, (unsigned long long)alone.body,
+           (unsigned long long)(alone.body + (uint64_t)alone.posts * POST_OVERHEAD_EST));
+    printf("  %-12s %6u %10llu %14llu\n", "fleet", fleet.posts, (unsigned long long)fleet.body,
+           (unsigned long long)(fleet.body + (uint64_t)fleet.posts * POST_OVERHEAD_EST));
+    printf("  LAN multicast: %u B of sample frames (+ announces)\n", lanBytes);
+    CHECK(fleet.posts * 3 < alone.posts, "POSTs %u vs %u alone", fleet.posts, alone.posts);
+    CHECK(perBatch > UNITS - 1.5, "batches carry %.1f units", perBatch);
+
+    for (int i = 0; i < UNITS; i++) units[i].fleet.stop();
+}
+
+// JSON and CBOR batch bodies from a two-unit group
+static void testBatchBody() {
+    uint16_t port = testPort();
+    FleetSync a, b;
+    FleetSync::Settings s = groupSettings(port);
+    CHECK(a.begin(0x10, s) && b.begin(0x20, s), "join");
+    a.setOnline(true);
+    b.setOnline(true);
+
+    std::mt19937 rng(3);
+    SampleJson::DayStats none;
+    a.publish(makeSample(1, rng), none, false);
+    b.publish(makeSample(1, rng), none, true);
+    SimHAL::advanceUs(2500 * 1000);
+    a.poll();
+    b.poll();
+
+    CHECK(a.isAggregator() && b.aggregator() == 0x10, "aggregator %lx / %lx", (unsigned long)a.aggregator(),
+          (unsigned long)b.aggregator());
+    CHECK(a.takeUrgent() && !a.takeUrgent(), "urgent flag");
+    CHECK(a.claimUpload() == FleetSync::UPLOAD_BATCH && b.claimUpload() == FleetSync::UPLOAD_DELEGATED,
+          "upload modes");
+
+    uint8_t out[FleetSync::BATCH_MAX_LEN];
+    size_t len = a.writeBatch(out, sizeof(out), false);
+    out[len] = 0;
+    CHECK(len && !strncmp((char*)out, "{\"aggregator\":\"00000010\",\"devices\":[{\"device\":\"00000010\",\"sample\":{", 66) &&
+          strstr((char*)out, "},{\"device\":\"00000020\",\"sample\":{") && !strcmp((char*)out + len - 4, "}}]}"),
+          "JSON batch: %s", (char*)out);
+    a.uploadDone(false);
+
+    len = a.writeBatch(out, sizeof(out), true);
+    // map(2) "aggregator" text(8) ... "devices" array(2)
+    CHECK(len && out[0] == 0xA2 && out[1] == 0x6A && !memcmp(out + 2, "aggregator", 10) && out[12] == 0x68 &&
+          out[21] == 0x67 && !memcmp(out + 22, "devices", 7) && out[29] == 0x82, "CBOR batch head");
+    a.uploadDone(true);
+    CHECK(a.writeBatch(out, sizeof(out), false) == 0, "nothing pending after a batch");
+    FleetSync::Stats st = a.stats();
+    CHECK(st.batches == 1 && st.batchFailures == 1 && st.samplesBatched == 2 && st.uploadsSaved == 1,
+          "stats: %lu batches, %lu failed, %lu samples", (unsigned long)st.batches,
+          (unsigned long)st.batchFailures, (unsigned long)st.samplesBatched);
+
+    // Offline units cannot aggregate
+    a.setOnline(false);
+    a.poll();
+    SimHAL::advanceUs(1000 * 1000);
+    b.poll();
+    CHECK(b.isAggregator() && a.aggregator() == 0x20, "offline aggregator replaced");
+    a.stop();
+    b.stop();
+
+    // No batch route: nobody aggregates, everybody uploads alone
+    s.endpoint[0] = '\0';
+    CHECK(a.begin(0x10, s) && b.begin(0x20, s), "join");
+    a.setOnline(true);
+    b.setOnline(true);
+    a.publish(makeSample(2, rng), none, false);
+    b.publish(makeSample(2, rng), none, false);
+    SimHAL::advanceUs(2500 * 1000);
+    a.poll();
+    b.poll();
+    CHECK(!a.aggregator() && !b.aggregator(), "aggregator %lx without an endpoint", (unsigned long)a.aggregator());
+    CHECK(a.claimUpload() == FleetSync::UPLOAD_SINGLE && b.claimUpload() == FleetSync::UPLOAD_SINGLE,
+          "upload modes without an endpoint");
+    a.stop();
+    b.stop();
+}
+
+// Members trust the aggregator only as far as its ACKs, and ignore
+// units without the group key
+static void testAcks() {
+    uint16_t port = testPort();
+    FleetSync a, b, c;
+    FleetSync::Settings s = groupSettings(port);
+    s.ackTimeoutMs = 5000;
+    CHECK(a.begin(0x10, s) && b.begin(0x20, s), "join");
+    a.setOnline(true);
+    b.setOnline(true);
+
+    std::mt19937 rng(5);
+    SampleJson::DayStats none;
+    FleetSync::Device self;
+    a.publish(makeSample(1, rng), none, false);
+    b.publish(makeSample(1, rng), none, false);
+    SimHAL::advanceUs(2500 * 1000);
+    a.poll();
+    b.poll();
+
+    uint8_t out[FleetSync::BATCH_MAX_LEN];
+    CHECK(a.claimUpload() == FleetSync::UPLOAD_BATCH && a.writeBatch(out, sizeof(out), false), "batch");
+    a.uploadDone(true);
+    b.poll();
+    CHECK(b.unit(0, self) && !self.pending && b.claimUpload() == FleetSync::UPLOAD_DELEGATED,
+          "acknowledged sample still pending");
+    CHECK(a.stats().acksSent == 1, "%lu ACKs sent", (unsigned long)a.stats().acksSent);
+
+    // Aggregator alive but never batching: the member uploads itself
+    b.publish(makeSample(2, rng), none, false);
+    for (int i = 0; i < 6; i++) {
+        SimHAL::advanceUs(1000 * 1000);
+        a.poll();
+        b.poll();
+    }
+    CHECK(b.aggregator() == 0x10, "aggregator %lx", (unsigned long)b.aggregator());
+    CHECK(b.claimUpload() == FleetSync::UPLOAD_SINGLE && b.stats().ackTimeouts == 1, "no fallback after %lu ms",
+          (unsigned long)s.ackTimeoutMs);
+    b.uploadDone(true);
+    b.publish(makeSample(3, rng), none, false);
+    CHECK(b.claimUpload() == FleetSync::UPLOAD_DELEGATED, "fallback outlasted the direct upload");
+
+    // Another group's key: not a unit, never elected
+    FleetSync::Settings other = groupSettings(port);
+    other.role = FleetSync::ROLE_AGGREGATOR;
+    snprintf(other.key, sizeof(other.key), "%s", "other group");
+    CHECK(c.begin(0x01, other), "join with another key");
+    c.setOnline(true);
+    c.publish(makeSample(1, rng), none, false);
+    SimHAL::advanceUs(1000 * 1000);
+    b.poll();
+    CHECK(b.units() == 2 && b.aggregator() == 0x10 && b.stats().unauthenticated >= 2,
+          "%u units, aggregator %lx, %lu unauthenticated", b.units(), (unsigned long)b.aggregator(),
+          (unsigned long)b.stats().unauthenticated);
+
+    // No key, no fleet
+    s.key[0] = '\0';
+    c.stop();
+    CHECK(!c.begin(0x01, s) && !c.active(), "started without a key");
+    a.stop();
+    b.stop();
+}
+
+void setUp() { SimHAL::state().logEnabled = false; }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testHmac);
+    RUN_TEST(testFrames);
+    RUN_TEST(testBatchBody);
+    RUN_TEST(testAcks);
+    RUN_TEST(testFleet);
+    return UNITY_END();
+}
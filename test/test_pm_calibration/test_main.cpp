@@ -0,0 +1,202 @@
+// -----------------------------------
+// PM Calibration Host Test
+//
+// Checks PMCalibration's humidity x PM table against
+//   hand-computed reference pairs (kappa-Koehler drying, linear and
+//   piecewise device curves, RH clamping, missing humidity),
+//   direct() over a dense RH x PM sweep for several settings,
+//   monotonicity in PM and in RH,
+//   and the config.json parser when ArduinoJson is available.
+// Also reports host ns per lookup vs the direct formula.
+//
+// Run:    pio test -e native -f test_pm_calibration
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "../check.h"
+#include "sim_hal.h"
+#include "pm_calibration.h"
+
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#define HAVE_ARDUINOJSON 1
+#else
+#define HAVE_ARDUINOJSON 0
+#endif
+
+// Table error budget: 0.1 ug/m3 storage steps plus interpolation
+static bool close(float got, float want) {
+    return fabsf(got - want) <= 0.3f + 0.02f * want;
+}
+
+struct Pair {
+    float pm, rh, want;
+};
+
+static void checkPairs(const char* what, PMCalibration::Channel ch, const Pair* pairs, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        const Pair& p = pairs[i];
+        float got = PMCalibration::apply(ch, p.pm, p.rh);
+        CHECK(close(got, p.want), "%s: pm %.1f rh %.1f -> %.3f, want %.3f", what, p.pm, p.rh, got, p.want);
+        float ref = PMCalibration::direct(PMCalibration::settings(), ch, p.pm, p.rh);
+        CHECK(isnan(p.rh) || fabsf(ref - p.want) < 0.01f, "%s: direct pm %.1f rh %.1f -> %.3f, want %.3f",
+              what, p.pm, p.rh, ref, p.want);
+    }
+}
+
+static PMCalibration::Curve piecewise() {
+    PMCalibration::Curve c = {};
+    const float raw[] = {0, 50, 200}, ref[] = {0, 40, 180};
+    c.n = 3;
+    memcpy(c.raw, raw, sizeof(raw));
+    memcpy(c.ref, ref, sizeof(ref));
+    return c;
+}
+
+static void testReferencePairs() {
+
+    // kappa 0.4, density 1.65: C(RH) = 1 + 0.2424 / (100 / RH - 1)
+    PMCalibration::configure(PMCalibration::Settings());
+    const Pair drying[] = {
+        {50, 0, 50},          // dry: unchanged
+        {50, 50, 40.244f},    // C = 1.242
+        {50, 80, 25.385f},    // C = 1.970
+        {100, 85, 42.129f},   // C = 2.374
+        {100, 90, 31.429f},   // C = 3.182
+        {37, 72.3f, 22.661f}, // between table rows
+        {200, 95, 35.676f},   // C = 5.606
+        {200, 99, 35.676f},   // clamped to 95 %
+        {12, 45, 10.014f},    // between PM knots
+        {0, 60, 0},
+        {1000, 30, 905.882f},  // top of the table
+    };
+    checkPairs("drying", PMCalibration::PM25, drying, sizeof(drying) / sizeof(drying[0]));
+
+    // No humidity reading yet: no drying
+    CHECK(close(PMCalibration::apply(PMCalibration::PM25, 50, NAN), 50), "NAN humidity");
+
+    // Per-device linear curve on PM2.5, piecewise on PM10
+    PMCalibration::Settings s;
+    s.curve[PMCalibration::PM25] = PMCalibration::Curve::linear(0.9f, 1.0f);
+    s.curve[PMCalibration::PM10] = piecewise();
+    PMCalibration::configure(s);
+    const Pair linear[] = {
+        {50, 0, 46},
+        {50, 50, 37.220f},
+        {100, 90, 29.286f},
+    };
+    checkPairs("linear", PMCalibration::PM25, linear, sizeof(linear) / sizeof(linear[0]));
+    const Pair pieces[] = {
+        {25, 0, 20},
+        {50, 0, 40},
+        {100, 0, 86.667f},
+        {300, 0, 273.333f},   // beyond the last point: last segment extended
+        {100, 80, 40.718f},   // dried to 50.77, just past the first kink
+    };
+    checkPairs("piecewise", PMCalibration::PM10, pieces, sizeof(pieces) / sizeof(pieces[0]));
+
+    // PMData overload rounds each field; PM1.0 uses the PM2.5 curve
+    PMData raw = {50, 50, 100};
+    PMData out = PMCalibration::apply(raw, 0);
+    CHECK(out.pm1_0 == 46 && out.pm2_5 == 46 && out.pm10 == 87, "PMData -> %u %u %u",
+          out.pm1_0, out.pm2_5, out.pm10);
+}
+
+static void testSweep() {
+    PMCalibration::Settings variants[3];
+    variants[1].kappa = 0.2f;
+    variants[1].curve[PMCalibration::PM25] = PMCalibration::Curve::linear(1.3f, -2.0f);
+    variants[2].kappa = 0.6f;
+    variants[2].curve[PMCalibration::PM25] = piecewise();
+
+    for (int v = 0; v < 3; v++) {
+        PMCalibration::configure(variants[v]);
+        float worst = 0, worstPm = 0, worstRh = 0;
+        for (float rh = 0; rh <= 100; rh += 0.7f) {
+            float prev = -1;
+            for (float pm = 0; pm <= 1000; pm += 0.9f) {
+                float got = PMCalibration::apply(PMCalibration::PM25, pm, rh);
+                float want = PMCalibration::direct(variants[v], PMCalibration::PM25, pm, rh);
+                float err = fabsf(got - want) / (0.3f + 0.02f * want);
+                if (err > worst) {
+                    worst = err;
+                    worstPm = pm;
+                    worstRh = rh;
+                }
+                CHECK(got >= prev - 0.05f, "settings %d: not monotonic in PM at pm %.1f rh %.1f", v, pm, rh);
+                prev = got;
+            }
+        }
+        printf("  settings %d: worst error %.0f%% of budget (pm %.1f, rh %.1f)\n", v, worst * 100,
+               worstPm, worstRh);
+        CHECK(worst <= 1, "settings %d: table error over budget at pm %.1f rh %.1f", v, worstPm, worstRh);
+    }
+
+    // Wetter air never reads higher
+    PMCalibration::configure(PMCalibration::Settings());
+    for (float pm = 1; pm <= 1000; pm *= 1.7f) {
+        float prev = 1e9f;
+        for (float rh = 0; rh <= 100; rh += 1) {
+            float got = PMCalibration::apply(PMCalibration::PM25, pm, rh);
+            CHECK(got <= prev + 0.05f, "not monotonic in RH at pm %.1f rh %.1f", pm, rh);
+            prev = got;
+        }
+    }
+}
+
+static void testConfig() {
+#if HAVE_ARDUINOJSON
+    StaticJsonDocument<512> doc;
+    deserializeJson(doc, R"({"kappa": 0.3,
+        "pm25": {"slope": 0.8, "offset": 2},
+        "pm10": {"points": [[0, 0], [50, 40], [40, 1], [200, 180]]}})");
+    JsonVariantConst cfg = doc.as<JsonVariantConst>();
+    PMCalibration::Settings s = PMCalibration::fromJson(cfg);
+    CHECK(fabsf(s.kappa - 0.3f) < 1e-6f, "kappa %.3f", s.kappa);
+    CHECK(fabsf(s.density - PM_CAL_DENSITY) < 1e-6f, "density default %.3f", s.density);
+    const PMCalibration::Curve& l = s.curve[PMCalibration::PM25];
+    CHECK(l.n == 2 && fabsf(l.ref[0] - 2) < 1e-6f && fabsf(l.ref[1] - 802) < 1e-3f, "linear curve");
+    const PMCalibration::Curve& p = s.curve[PMCalibration::PM10];
+    CHECK(p.n == 3 && p.raw[2] == 200, "piecewise: out-of-order point dropped (n %u)", p.n);
+
+    deserializeJson(doc, R"({"pm10": {"points": [[10, 5]]}})");
+    s = PMCalibration::fromJson(doc.as<JsonVariantConst>());
+    CHECK(s.curve[PMCalibration::PM10].n == 0 && s.curve[PMCalibration::PM25].n == 0,
+          "single point falls back to identity");
+#else
+    TEST_IGNORE_MESSAGE("no ArduinoJson");
+#endif
+}
+
+// Host numbers only: x86 divides are cheap. The ESP32 FPU has no divide
+// instruction, so direct() costs two or three soft-float divisions there.
+static void testBenchmark() {
+    PMCalibration::configure(PMCalibration::Settings());
+    const PMCalibration::Settings& s = PMCalibration::settings();
+    const int N = 2000000;
+    volatile float sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) sink = sink + PMCalibration::apply(PMCalibration::PM25, i % 997, i % 93);
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) sink = sink + PMCalibration::direct(s, PMCalibration::PM25, i % 997, i % 93);
+    auto t2 = std::chrono::steady_clock::now();
+    double a = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+    double d = std::chrono::duration<double, std::nano>(t2 - t1).count() / N;
+    printf("  host ns/value: table %.1f | direct %.1f\n", a, d);
+}
+
+void setUp() { SimHAL::state().logEnabled = false; }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testReferencePairs);
+    RUN_TEST(testSweep);
+    RUN_TEST(testConfig);
+    RUN_TEST(testBenchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,224 @@
+// -----------------------------------
+// Sensor Health Host Test
+//
+// Checks the plausibility screen, SampleFusion's hold / missing
+// fallback and SensorHealth's recovery ladder:
+//   ChannelScreen: range, one-sample spikes rejected, real steps accepted
+//   one sample late, stuck after HEALTH_STUCK_MS above the floor, the
+//   DHT11's whole-unit channels never stuck,
+//   SampleFusion: failed reads held with QUALITY_HELD, NAN / null and
+//   QUALITY_MISSING past HEALTH_HOLD_MS, cached TVOC not re-screened,
+//   SensorHealth: BUS / SENSOR steps alternating with doubling runs up to
+//   HEALTH_BACKOFF_MAX, recovery counted on the next good read, stuck
+//   sensors counted as bad reads,
+//   and the quality / null fields of the upload body.
+//
+// Run:    pio test -e native -f test_sensor_health
+// -----------------------------------
+#include <stdio.h>
+#include <string.h>
+
+#include "../check.h"
+#include "sim_hal.h"
+#include "sample_fusion.h"
+#include "sample_json.h"
+#include "sample_cbor.h"
+
+static void testScreen() {
+    ChannelScreen pm(SensorHealth::limits(SensorHealth::CH_PM25));
+
+    uint32_t t = 0;
+    auto feed = [&](float v) {
+        ChannelScreen::Verdict r = pm.check(v, t += 20000);
+        if (ChannelScreen::usable(r)) pm.accept(v);
+        return r;
+    };
+
+    CHECK(feed(20) == ChannelScreen::PASS, "first reading");
+    CHECK(feed(-1) == ChannelScreen::OUT_OF_RANGE, "below range");
+    CHECK(feed(1001) == ChannelScreen::OUT_OF_RANGE, "above range");
+    CHECK(feed(22) == ChannelScreen::PASS, "small change");
+
+    // One-sample spike: far from the previous reading and the accepted value
+    CHECK(feed(22 + HEALTH_PM_JUMP + 50) == ChannelScreen::JUMP, "spike rejected");
+    CHECK(feed(23) == ChannelScreen::PASS, "back to normal after the spike");
+
+    // Real step: the second reading at the new level agrees with the first
+    float step = 23 + HEALTH_PM_JUMP + 100;
+    CHECK(feed(step) == ChannelScreen::JUMP, "first reading of a step rejected");
+    CHECK(feed(step) == ChannelScreen::PASS, "step accepted one sample late");
+
+    // Stuck: the same reading above the floor for HEALTH_STUCK_MS, at any
+    // sampling rate
+    ChannelScreen tv(SensorHealth::limits(SensorHealth::CH_TVOC));
+    uint32_t firstStuck = 0;
+    for (t = 0; t <= HEALTH_STUCK_MS + 60000 && !firstStuck; t += 20000) {
+        if (tv.check(250, t) == ChannelScreen::STUCK) firstStuck = t;
+    }
+    CHECK(firstStuck == HEALTH_STUCK_MS, "stuck after %lu ms, want %lu", (unsigned long)firstStuck,
+          (unsigned long)HEALTH_STUCK_MS);
+    CHECK(tv.check(251, t) == ChannelScreen::PASS, "a change clears stuck");
+
+    // Clean air reads 0 for hours: never stuck at the floor
+    ChannelScreen clean(SensorHealth::limits(SensorHealth::CH_PM25));
+    bool stuck = false;
+    for (t = 0; t < 3 * HEALTH_STUCK_MS; t += 20000) stuck |= clean.check(0, t) == ChannelScreen::STUCK;
+    CHECK(!stuck, "zero readings flagged stuck");
+
+    // A steady room holds the DHT11's whole C / %RH for a day
+    ChannelScreen temp(SensorHealth::limits(SensorHealth::CH_TEMP));
+    ChannelScreen hum(SensorHealth::limits(SensorHealth::CH_HUM));
+    for (t = 0; t < 24 * 3600000UL; t += 20000) {
+        stuck |= temp.check(22, t) == ChannelScreen::STUCK || hum.check(45, t) == ChannelScreen::STUCK;
+    }
+    CHECK(DHT_TYPE != DHT11 || !stuck, "steady DHT11 readings flagged stuck");
+    CHECK(temp.check(-5, t) == ChannelScreen::OUT_OF_RANGE && hum.check(95, t) == ChannelScreen::OUT_OF_RANGE,
+          "readings outside the DHT11 range accepted");
+}
+
+static SampleFusion::Input input(bool pmOk, float pm25, bool tvocFresh, float tvoc, float temp, float hum) {
+    SampleFusion::Input in;
+    in.havePM = true;
+    in.pmOk = pmOk;
+    in.pm = {(uint16_t)pm25, (uint16_t)pm25, (uint16_t)(pm25 * 1.5f)};
+    in.haveTVOC = true;
+    in.tvocFresh = tvocFresh;
+    in.tvoc = tvoc;
+    in.haveClimate = true;
+    in.temp = temp;
+    in.hum = hum;
+    in.battery = 80;
+    return in;
+}
+
+static void testFusion() {
+    SensorHealth::reset();
+    AdaptiveSampler sampler;
+    sampler.begin(AdaptiveSampler::Settings());
+    SampleFusion fusion(sampler);
+    bool changed;
+    uint32_t t = 1000, seq = 0;
+
+    FusedSample s = fusion.fuse(seq++, t, input(true, 12, true, 150, 21.5f, 45), changed);
+    CHECK(s.pmValid && s.quality[SENSOR_PM] == QUALITY_GOOD, "good PM");
+    CHECK(s.quality[SENSOR_TVOC] == QUALITY_GOOD && s.tvoc == 150, "good TVOC");
+    CHECK(s.quality[SENSOR_CLIMATE] == QUALITY_GOOD && s.temp == 21.5f, "good climate");
+
+    // Failed reads: last good values held
+    t += 60000;
+    s = fusion.fuse(seq++, t, input(false, 0, false, 150, NAN, NAN), changed);
+    CHECK(!s.pmValid && s.quality[SENSOR_PM] == QUALITY_HELD && s.pmRaw.pm2_5 == 12,
+          "PM held (quality %d, pm %u)", s.quality[SENSOR_PM], s.pmRaw.pm2_5);
+    CHECK(s.quality[SENSOR_TVOC] == QUALITY_HELD && s.tvoc == 150, "cached TVOC held");
+    CHECK(s.quality[SENSOR_CLIMATE] == QUALITY_HELD && s.temp == 21.5f && s.hum == 45, "climate held");
+
+    // Spike rejected and held; out-of-range humidity held
+    t += 60000;
+    s = fusion.fuse(seq++, t, input(true, 12 + HEALTH_PM_JUMP + 50, true, 150, 21.6f, 140), changed);
+    CHECK(s.quality[SENSOR_PM] == QUALITY_HELD && s.pmRaw.pm2_5 == 12, "PM spike held");
+    CHECK(s.quality[SENSOR_CLIMATE] == QUALITY_HELD && s.temp == 21.6f && s.hum == 45,
+          "humidity out of range held, temperature updated");
+    SensorHealth::Counters pmc = SensorHealth::snapshot(SENSOR_PM);
+    SensorHealth::Counters cc = SensorHealth::snapshot(SENSOR_CLIMATE);
+    CHECK(pmc.jumps == 2 && cc.outOfRange == 1, "rejections counted (pm jump %lu, climate range %lu)",
+          (unsigned long)pmc.jumps, (unsigned long)cc.outOfRange);
+
+    // Past the hold time: missing
+    t += HEALTH_HOLD_MS + 60000;
+    s = fusion.fuse(seq++, t, input(false, 0, false, 150, NAN, NAN), changed);
+    CHECK(s.quality[SENSOR_PM] == QUALITY_MISSING && !s.pmValid, "PM missing after the hold");
+    CHECK(s.quality[SENSOR_TVOC] == QUALITY_MISSING && isnan(s.tvoc), "TVOC missing after the hold");
+    CHECK(s.quality[SENSOR_CLIMATE] == QUALITY_MISSING && isnan(s.temp) && isnan(s.hum),
+          "climate missing after the hold");
+
+    // Upload body: PM and AQI null, quality listed
+    SampleJson::Fields f{s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum, s.aqi, s.battery};
+    memcpy(f.quality, s.quality, sizeof(f.quality));
+    char body[SampleJson::MAX_LEN];
+    size_t n = SampleJson::write(body, sizeof(body), f);
+    CHECK(n && strstr(body, "\"pm2_5\":null") && strstr(body, "\"aqi\":null,\"aqi_category\":null"),
+          "null PM fields: %s", body);
+    CHECK(strstr(body, "\"quality\":{\"pm\":\"missing\",\"tvoc\":\"missing\",\"climate\":\"missing\"}"),
+          "quality object: %s", body);
+    uint8_t cbor[SampleCbor::MAX_LEN];
+    CHECK(SampleCbor::write(cbor, sizeof(cbor), f), "CBOR body fits");
+
+    // Recovered
+    t += 60000;
+    s = fusion.fuse(seq++, t, input(true, 30, true, 200, 22, 50), changed);
+    CHECK(s.pmValid && s.quality[SENSOR_PM] == QUALITY_GOOD && s.pmRaw.pm2_5 == 30, "PM back");
+    CHECK(s.quality[SENSOR_TVOC] == QUALITY_GOOD && s.quality[SENSOR_CLIMATE] == QUALITY_GOOD,
+          "TVOC and climate back");
+    f = SampleJson::Fields{s.pm.pm1_0, s.pm.pm2_5, s.pm.pm10, s.tvoc, s.temp, s.hum, s.aqi, s.battery};
+    memcpy(f.quality, s.quality, sizeof(f.quality));
+    SampleJson::write(body, sizeof(body), f);
+    CHECK(!strstr(body, "quality"), "all good: no quality object: %s", body);
+
+    // Stuck: used, flagged suspect
+    for (uint32_t i = 0; i <= HEALTH_STUCK_MS / 60000; i++) {
+        t += 60000;
+        s = fusion.fuse(seq++, t, input(true, 30, true, 200 + i, 22, 50), changed);
+    }
+    CHECK(s.pmValid && s.quality[SENSOR_PM] == QUALITY_SUSPECT, "stuck PM suspect (quality %d)",
+          s.quality[SENSOR_PM]);
+    CHECK(s.quality[SENSOR_TVOC] == QUALITY_GOOD, "changing TVOC good");
+    CHECK(SensorHealth::snapshot(SENSOR_PM).stuckNow, "PM flagged stuck");
+}
+
+static void testRecovery() {
+    SensorHealth::reset();
+
+    // Step k needs HEALTH_RECOVER_AFTER << min(k, HEALTH_BACKOFF_MAX) bad reads
+    int reads = 0;
+    for (int k = 0; k < HEALTH_BACKOFF_MAX + 3; k++) {
+        int want = HEALTH_RECOVER_AFTER << (k < HEALTH_BACKOFF_MAX ? k : HEALTH_BACKOFF_MAX);
+        SensorHealth::Recovery step = SensorHealth::RECOVER_NONE;
+        int n = 0;
+        while (step == SensorHealth::RECOVER_NONE && n < 10000) {
+            step = SensorHealth::recordRead(SENSOR_TVOC, SensorHealth::FAULT_NACK);
+            n++;
+        }
+        reads += n;
+        SensorHealth::Recovery expect = k % 2 ? SensorHealth::RECOVER_SENSOR : SensorHealth::RECOVER_BUS;
+        CHECK(n == want && step == expect, "step %d after %d reads (%d), want %d after %d", k, n, step,
+              expect, want);
+    }
+    SensorHealth::Counters c = SensorHealth::snapshot(SENSOR_TVOC);
+    CHECK(c.state == SensorHealth::STATE_FAILED, "state failed");
+    CHECK(c.reads == (uint32_t)reads && c.faults[SensorHealth::FAULT_NACK] == (uint32_t)reads, "fault counts");
+
+    SensorHealth::recordRead(SENSOR_TVOC, SensorHealth::FAULT_NONE);
+    c = SensorHealth::snapshot(SENSOR_TVOC);
+    CHECK(c.state == SensorHealth::STATE_OK && c.recovered == 1 && c.attempt == 0 && c.consecutive == 0,
+          "recovered on the next good read");
+
+    // Ladder restarts from the first step
+    int n = 0;
+    while (SensorHealth::recordRead(SENSOR_TVOC, SensorHealth::FAULT_BUSY) == SensorHealth::RECOVER_NONE) n++;
+    CHECK(n + 1 == HEALTH_RECOVER_AFTER, "ladder restarted (%d reads)", n + 1);
+
+    // Good reads from a stuck sensor are still bad
+    SensorHealth::reset();
+    SensorHealth::setStuck(SENSOR_PM, true);
+    n = 0;
+    while (SensorHealth::recordRead(SENSOR_PM, SensorHealth::FAULT_NONE) == SensorHealth::RECOVER_NONE &&
+           n < 100) {
+        n++;
+    }
+    CHECK(n + 1 == HEALTH_RECOVER_AFTER, "stuck sensor recovered after %d reads", n + 1);
+    SensorHealth::setStuck(SENSOR_PM, false);
+    SensorHealth::recordRead(SENSOR_PM, SensorHealth::FAULT_NONE);
+    CHECK(SensorHealth::snapshot(SENSOR_PM).state == SensorHealth::STATE_OK, "unstuck sensor ok");
+}
+
+void setUp() { SimHAL::state().logEnabled = false; }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testScreen);
+    RUN_TEST(testFusion);
+    RUN_TEST(testRecovery);
+    return UNITY_END();
+}
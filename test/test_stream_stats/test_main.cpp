@@ -0,0 +1,332 @@
+// -----------------------------------
+// Stream Stats Host Test
+//
+// Checks StreamStats against exact offline computation over the same
+// samples:
+//   P² p50/p95/p99 vs sorted-sample quantiles (rank error) on uniform,
+//   normal, log-normal, bimodal and sorted streams, exact below 5 samples,
+//   Welford mean/stddev vs two-pass on values with a large offset,
+//   and every finished hour/day/week window of a 15-day feed with gaps
+//   and irregular intervals: count, min/max, mean, stddev, quantile rank
+//   error, covered time and time above each limit.
+// Also reports host ns per add().
+//
+// Run:    pio test -e native -f test_stream_stats
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "../check.h"
+#include "sim_hal.h"
+#include "stream_stats.h"
+
+// Rank error of an estimate: how far the order statistics on either side
+// of it are from the target quantile (0.01 = one percentile). Estimates
+// interpolate, so one between two sample values is judged by both.
+static double rankError(const std::vector<float>& sorted, float est, double p) {
+    auto below = std::lower_bound(sorted.begin(), sorted.end(), est);
+    auto above = std::upper_bound(sorted.begin(), sorted.end(), est);
+    if (below != sorted.begin() && (below == sorted.end() || *below != est)) {
+        below = std::lower_bound(sorted.begin(), sorted.end(), *(below - 1));
+    }
+    if (above != sorted.end() && (above == sorted.begin() || *(above - 1) != est)) {
+        above = std::upper_bound(sorted.begin(), sorted.end(), *above);
+    }
+    double n = sorted.size();
+    double lo = (below - sorted.begin()) / n, hi = (above - sorted.begin()) / n;
+    if (p < lo) return lo - p;
+    if (p > hi) return p - hi;
+    return 0;
+}
+
+static double exactQuantile(const std::vector<float>& sorted, double p) {
+    size_t r = (size_t)ceil(p * sorted.size());
+    return sorted[r ? r - 1 : 0];
+}
+
+static const double QUANTILES[3] = {0.50, 0.95, 0.99};
+
+static void testQuantiles() {
+    std::mt19937 rng(7);
+    struct Dist {
+        const char* name;
+        float (*gen)(std::mt19937&);
+    };
+    const Dist dists[] = {
+        {"uniform", [](std::mt19937& r) { return std::uniform_real_distribution<float>(0, 100)(r); }},
+        {"normal", [](std::mt19937& r) { return std::normal_distribution<float>(22, 3)(r); }},
+        {"lognormal", [](std::mt19937& r) { return std::lognormal_distribution<float>(2.5f, 0.8f)(r); }},
+        {"bimodal", [](std::mt19937& r) {
+             return std::bernoulli_distribution(0.8)(r) ? std::normal_distribution<float>(10, 2)(r)
+                                                        : std::normal_distribution<float>(80, 10)(r);
+         }},
+        {"integer", [](std::mt19937& r) { return (float)std::poisson_distribution<int>(12)(r); }},
+    };
+
+    for (const Dist& d : dists) {
+        P2Quantile est[3];
+        for (int q = 0; q < 3; q++) est[q].begin(QUANTILES[q]);
+        std::vector<float> xs;
+        for (int i = 0; i < 20000; i++) {
+            float x = d.gen(rng);
+            xs.push_back(x);
+            for (P2Quantile& e : est) e.add(x);
+        }
+        std::sort(xs.begin(), xs.end());
+        printf("  %-9s", d.name);
+        for (int q = 0; q < 3; q++) {
+            double err = rankError(xs, est[q].value(), QUANTILES[q]);
+            printf(" | p%02d %7.2f (exact %7.2f, rank err %.4f)", (int)(QUANTILES[q] * 100),
+                   est[q].value(), exactQuantile(xs, QUANTILES[q]), err);
+            CHECK(err <= 0.01, "%s p%d rank error %.4f", d.name, (int)(QUANTILES[q] * 100), err);
+        }
+        printf("\n");
+    }
+
+    // Sorted input is P²'s worst case: markers only ever move one way
+    P2Quantile asc;
+    asc.begin(0.95f);
+    std::vector<float> xs;
+    for (int i = 0; i < 10000; i++) {
+        asc.add(i);
+        xs.push_back(i);
+    }
+    double err = rankError(xs, asc.value(), 0.95);
+    printf("  ascending p95 %.1f, rank err %.4f\n", asc.value(), err);
+    CHECK(err <= 0.01, "ascending p95 rank error %.4f", err);
+
+    // Fewer than five samples: nearest rank, exact
+    P2Quantile few;
+    few.begin(0.5f);
+    CHECK(isnan(few.value()), "empty estimator");
+    const float small[] = {7, 3, 9, 1};
+    const float median[] = {7, 3, 7, 3};
+    for (int i = 0; i < 4; i++) {
+        few.add(small[i]);
+        CHECK(few.value() == median[i], "median of %d samples %.1f, want %.1f", i + 1, few.value(),
+              median[i]);
+    }
+}
+
+static void testWelford() {
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(0, 0.05);
+    StreamStats::Accumulator a;
+    a.reset();
+    std::vector<double> xs;
+    for (int i = 0; i < 100000; i++) {
+        float x = (float)(1000 + noise(rng));   // small spread on a large offset
+        xs.push_back(x);
+        a.add(x, i * 1000, 1e9f);
+    }
+    double sum = 0;
+    for (double x : xs) sum += x;
+    double mean = sum / xs.size(), ss = 0;
+    for (double x : xs) ss += (x - mean) * (x - mean);
+    double sd = sqrt(ss / (xs.size() - 1));
+    StreamStats::Summary s = a.summary();
+    printf("  mean %.6f (exact %.6f) | stddev %.6f (exact %.6f)\n", s.mean, mean, s.stddev, sd);
+    CHECK(fabs(s.mean - mean) < 1e-4, "mean %.6f vs %.6f", s.mean, mean);
+    CHECK(fabs(s.stddev - sd) / sd < 1e-3, "stddev %.6f vs %.6f", s.stddev, sd);
+    CHECK(s.count == xs.size() && s.spanS == (xs.size() - 1), "count %lu span %lu",
+          (unsigned long)s.count, (unsigned long)s.spanS);
+}
+
+// -------- Window feed --------
+
+struct Sample {
+    uint32_t t;
+    float v[StreamStats::CHANNELS];   // NAN = gap
+};
+
+static float channelValue(const FusedSample& x, int c) {
+    switch (c) {
+        case StreamStats::PM25: return x.pmValid ? x.pm.pm2_5 : NAN;
+        case StreamStats::PM10: return x.pmValid ? x.pm.pm10 : NAN;
+        case StreamStats::AQI:  return x.pmValid ? x.aqi : NAN;
+        case StreamStats::TVOC: return x.tvoc;
+        case StreamStats::TEMP: return x.temp;
+        default:                return x.hum;
+    }
+}
+
+// P² markers move one position per sample, so on a steady trend they lag
+// until the window has a few thousand samples. An hour holds only 60-1800
+// (at the 2 s .. 60 s adaptive interval): its p95 can be a quarter of the
+// ranks off on a rising temperature, while the mean error stays small.
+static const double RANK_BOUND[StreamStats::WINDOWS] = {0.30, 0.12, 0.03};
+static const double MEAN_RANK_BOUND = 0.025;
+
+struct Worst {
+    double rank[3] = {};
+    double sum[3] = {};
+    size_t n = 0;
+};
+
+// Exact figures for [a, b) from the whole feed, compared with the summary
+static void checkWindow(const std::vector<Sample>& feed, uint32_t a, uint32_t b, int w, int c,
+                        const StreamStats::Summary& got, Worst& worst) {
+    const char* tag = StreamStats::windowName((StreamStats::Window)w);
+    const char* ch = StreamStats::channelName((StreamStats::Channel)c);
+    float lim = StreamStats::limit((StreamStats::Channel)c);
+    std::vector<float> xs;
+    uint64_t spanMs = 0, overMs = 0;
+    for (size_t i = 0; i < feed.size(); i++) {
+        const Sample& s = feed[i];
+        if (s.t >= a && s.t < b && !isnan(s.v[c])) xs.push_back(s.v[c]);
+        // Sample-and-hold: sample i covers [t_i, t_i+1), clipped to the window
+        if (isnan(s.v[c]) || i + 1 == feed.size()) continue;
+        uint32_t lo = std::max(s.t, a), hi = std::min(feed[i + 1].t, b);
+        if (hi <= lo) continue;
+        spanMs += hi - lo;
+        if (s.v[c] > lim) overMs += hi - lo;
+    }
+
+    CHECK(got.count == xs.size(), "%s %s: count %lu, want %zu", tag, ch, (unsigned long)got.count,
+          xs.size());
+    CHECK(got.spanS == spanMs / 1000, "%s %s: span %lu s, want %llu", tag, ch,
+          (unsigned long)got.spanS, (unsigned long long)(spanMs / 1000));
+    CHECK(got.overS == overMs / 1000, "%s %s: over %lu s, want %llu", tag, ch,
+          (unsigned long)got.overS, (unsigned long long)(overMs / 1000));
+    if (xs.empty()) return;
+
+    double sum = 0;
+    for (float x : xs) sum += x;
+    double mean = sum / xs.size(), ss = 0;
+    for (float x : xs) ss += (x - mean) * (x - mean);
+    std::sort(xs.begin(), xs.end());
+    CHECK(got.min == xs.front() && got.max == xs.back(), "%s %s: min/max %.2f/%.2f, want %.2f/%.2f",
+          tag, ch, got.min, got.max, xs.front(), xs.back());
+    CHECK(fabs(got.mean - mean) <= 1e-4 * (1 + fabs(mean)), "%s %s: mean %.4f, want %.4f", tag, ch,
+          got.mean, mean);
+    if (xs.size() > 1) {
+        double sd = sqrt(ss / (xs.size() - 1));
+        CHECK(fabs(got.stddev - sd) <= 1e-3 * (1 + sd), "%s %s: stddev %.4f, want %.4f", tag, ch,
+              got.stddev, sd);
+    }
+    const float est[3] = {got.p50, got.p95, got.p99};
+    for (int q = 0; q < 3; q++) {
+        double err = rankError(xs, est[q], QUANTILES[q]);
+        if (err > worst.rank[q]) worst.rank[q] = err;
+        worst.sum[q] += err;
+        CHECK(err <= RANK_BOUND[w], "%s %s: p%d %.2f rank error %.4f (n %zu)", tag, ch,
+              (int)(QUANTILES[q] * 100), est[q], err, xs.size());
+    }
+}
+
+static void testWindows() {
+    StreamStats::reset();
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint32_t> interval(2000, 60000);
+    std::normal_distribution<float> noise(0, 1);
+
+    std::vector<Sample> feed;
+    uint32_t t0 = 123456, t = t0;
+    uint32_t windowIndex[StreamStats::WINDOWS] = {};
+    size_t checked = 0;
+    Worst worst[StreamStats::WINDOWS];
+    while (t - t0 < 15UL * 24 * 3600 * 1000) {
+        // Daily cycle with evening cooking peaks, some dropped PM frames and
+        // a TVOC outage
+        double h = fmod((t - t0) / 3600000.0, 24);
+        float pm = 12 + 10 * sin(h / 24 * 2 * M_PI) + 3 * noise(rng) + (h > 18 && h < 20 ? 40 : 0);
+        FusedSample s = {};
+        s.tMs = t;
+        s.pmValid = std::uniform_int_distribution<int>(0, 19)(rng) != 0;
+        s.pm.pm2_5 = (uint16_t)std::max(0.0f, roundf(pm));
+        s.pm.pm10 = (uint16_t)std::max(0.0f, roundf(pm * 1.6f));
+        s.aqi = IAQ::calculateAQI(s.pm.pm2_5, s.pm.pm10);
+        s.tvoc = (t - t0) / 3600000 % 50 == 7 ? NAN : 300 + 200 * sin(h / 3) + 30 * noise(rng);
+        s.temp = 24 + 6 * sin(h / 24 * 2 * M_PI) + 0.3f * noise(rng);
+        s.hum = 55 + 20 * cos(h / 24 * 2 * M_PI) + noise(rng);
+
+        Sample rec;
+        rec.t = t;
+        for (int c = 0; c < StreamStats::CHANNELS; c++) rec.v[c] = channelValue(s, c);
+        feed.push_back(rec);
+        StreamStats::add(s);
+
+        // A sample in a new window finishes the previous one
+        for (int w = 0; w < StreamStats::WINDOWS; w++) {
+            uint32_t len = StreamStats::windowMs((StreamStats::Window)w);
+            uint32_t k = (t - t0) / len;
+            if (k == windowIndex[w]) continue;
+            uint32_t a = t0 + (k - 1) * len;
+            for (int c = 0; c < StreamStats::CHANNELS; c++) {
+                StreamStats::Summary got;
+                bool ok = StreamStats::summary((StreamStats::Window)w, (StreamStats::Channel)c, got, true);
+                CHECK(ok, "%s: no previous window", StreamStats::windowName((StreamStats::Window)w));
+                if (ok) {
+                    checkWindow(feed, a, a + len, w, c, got, worst[w]);
+                    worst[w].n++;
+                }
+                checked++;
+            }
+            windowIndex[w] = k;
+        }
+        t += interval(rng);
+    }
+    printf("  %zu samples, %zu window summaries\n", feed.size(), checked);
+    size_t finished = 0;
+    for (int w = 0; w < StreamStats::WINDOWS; w++) {
+        const Worst& e = worst[w];
+        finished += (feed.back().t - t0) / StreamStats::windowMs((StreamStats::Window)w);
+        printf("  %-4s rank error  p50 mean %.4f worst %.4f | p95 mean %.4f worst %.4f | p99 mean %.4f worst %.4f\n",
+               StreamStats::windowName((StreamStats::Window)w), e.sum[0] / e.n, e.rank[0], e.sum[1] / e.n,
+               e.rank[1], e.sum[2] / e.n, e.rank[2]);
+        for (int q = 0; q < 3; q++) {
+            CHECK(e.sum[q] / e.n <= MEAN_RANK_BOUND, "%s p%d mean rank error %.4f",
+                  StreamStats::windowName((StreamStats::Window)w), (int)(QUANTILES[q] * 100), e.sum[q] / e.n);
+        }
+    }
+    CHECK(checked == finished * StreamStats::CHANNELS, "checked %zu of %zu windows", checked,
+          finished * StreamStats::CHANNELS);
+
+    // Current window: in progress, covering up to the last sample
+    StreamStats::Summary cur;
+    CHECK(StreamStats::summary(StreamStats::HOUR, StreamStats::TEMP, cur) && cur.count > 0,
+          "current hour");
+    SampleJson::DayStats day = StreamStats::dayStats();
+    CHECK(day.valid && day.aqiMax > 0, "day stats for the upload");
+}
+
+static void testBenchmark() {
+    StreamStats::reset();
+    FusedSample s = {};
+    s.pmValid = true;
+    const int N = 200000;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; i++) {
+        s.tMs = i * 5000u;
+        s.pm.pm2_5 = i % 97;
+        s.pm.pm10 = i % 131;
+        s.aqi = i % 211;
+        s.tvoc = i % 701;
+        s.temp = 20 + i % 13;
+        s.hum = 40 + i % 37;
+        StreamStats::add(s);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    printf("  host ns/add (6 channels x 3 windows): %.0f | state %zu B\n",
+           std::chrono::duration<double, std::nano>(t1 - t0).count() / N,
+           sizeof(StreamStats::Accumulator) * StreamStats::CHANNELS * StreamStats::WINDOWS +
+               sizeof(StreamStats::Summary) * StreamStats::CHANNELS * StreamStats::WINDOWS);
+}
+
+void setUp() { SimHAL::state().logEnabled = false; }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testQuantiles);
+    RUN_TEST(testWelford);
+    RUN_TEST(testWindows);
+    RUN_TEST(testBenchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,429 @@
+// -----------------------------------
+// Timer Wheel Host Test
+//
+// Drives TimerWheel on the SimHAL virtual clock the way a task does: run
+// the due jobs, sleep for the returned time, repeat. Checks
+//   one-shot and periodic timing (no drift under wakeup latency),
+//   delays beyond the wheel range (re-cascade), coalescing with slack,
+//   stop/restart from inside callbacks, skipped-period and overrun stats,
+//   no idle wakeups (msUntilNext is exact), 32-bit tick wraparound,
+//   and a random mix of jobs against a reference model.
+//
+// Run:    pio test -e native -f test_timer_wheel
+//         (other fuzz runs: -DFUZZ_SEED=N -DFUZZ_STEPS=N in build_flags)
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../check.h"
+#include "sim_hal.h"
+#include "timer_wheel.h"
+
+#ifndef FUZZ_SEED
+#define FUZZ_SEED 12345
+#endif
+#ifndef FUZZ_STEPS
+#define FUZZ_STEPS 200000
+#endif
+
+static const uint32_t TICK = TimerWheel::TICK_MS;
+
+static uint64_t nowMs() { return SimHAL::nowUs() / 1000; }
+
+static void setClockMs(uint64_t ms) { SimHAL::state().nowUs = ms * 1000; }
+
+struct StringPrint : Print {
+    std::string s;
+    size_t write(uint8_t c) override {
+        s += (char)c;
+        return 1;
+    }
+    using Print::write;
+};
+
+static std::string json(const TimerWheel& w) {
+    StringPrint p;
+    w.writeJson(p);
+    return p.s;
+}
+
+// -------- Driver: the owning task's loop --------
+static uint32_t firedThisWake = 0;
+
+struct Driver {
+    TimerWheel& w;
+    uint32_t wakes = 0;
+    uint32_t idle = 0;      // wakeups that ran nothing
+
+    // Run and sleep until endMs; latency(…) adds wakeup delay to each sleep
+    void until(uint64_t endMs, uint32_t (*latency)() = nullptr) {
+        for (;;) {
+            firedThisWake = 0;
+            uint32_t wait = w.run();
+            wakes++;
+            if (!firedThisWake) idle++;
+            if (wait == TimerWheel::NEVER || nowMs() + wait > endMs) break;
+            SimHAL::advanceUs((uint64_t)(wait + (latency ? latency() : 0)) * 1000);
+        }
+        if (nowMs() < endMs) setClockMs(endMs);
+    }
+};
+
+struct Rec {
+    std::vector<uint64_t> at;
+    static void cb(void* arg) {
+        ((Rec*)arg)->at.push_back(nowMs());
+        firedThisWake++;
+    }
+};
+
+static uint32_t rng = 1;
+static uint32_t rnd() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+static uint32_t jitter3() { return rnd() % 4; }
+
+// -----------------------------
+// Cases
+// -----------------------------
+static void testOneShot() {
+    setClockMs(1000);
+    TimerWheel w("t");
+    Rec a, b, c;
+    w.after("a", 1234, Rec::cb, &a);
+    w.after("b", 1, Rec::cb, &b);
+    w.after("c", 0, Rec::cb, &c);
+    Driver d{w};
+    d.until(10000);
+    CHECK(a.at.size() == 1 && a.at[0] >= 2234 && a.at[0] < 2234 + TICK, "a fired %zu times, at %llu",
+          a.at.size(), a.at.empty() ? 0ULL : (unsigned long long)a.at[0]);
+    CHECK(b.at.size() == 1 && b.at[0] >= 1001 && b.at[0] < 1001 + TICK, "b at %llu",
+          b.at.empty() ? 0ULL : (unsigned long long)b.at[0]);
+    CHECK(c.at.size() == 1 && c.at[0] == 1000 + TICK, "c: zero delay runs on the next tick");
+    CHECK(d.idle == 1, "idle wakeups %u (only the final one)", d.idle);
+}
+
+static void testPeriodicNoDrift() {
+    setClockMs(0);
+    TimerWheel w("t");
+    Rec r;
+    uint64_t start = nowMs();
+    w.every("p", 1000, Rec::cb, &r);
+    Driver d{w};
+    d.until(start + 1000 * 1000 + 500, jitter3);
+    CHECK(r.at.size() == 1000, "%zu runs", r.at.size());
+    uint64_t worst = 0;
+    for (size_t k = 0; k < r.at.size(); k++) {
+        uint64_t due = start + (k + 1) * 1000;
+        CHECK(r.at[k] >= due, "run %zu early", k);
+        if (r.at[k] - due > worst) worst = r.at[k] - due;
+    }
+    CHECK(worst < TICK + 4, "worst lateness %llu ms", (unsigned long long)worst);
+    CHECK(json(w).find("\"skipped\":0") != std::string::npos, "%s", json(w).c_str());
+}
+
+static void testLongDelays() {
+    setClockMs(12345);
+    TimerWheel w("t");
+    const uint32_t delays[] = {63 * TICK, 64 * TICK, 4095 * TICK, 4096 * TICK, 262144 * TICK,
+                               (uint32_t)(47UL * 3600 * 1000), (uint32_t)(72UL * 3600 * 1000),
+                               (uint32_t)(30UL * 24 * 3600 * 1000)};
+    const int n = sizeof(delays) / sizeof(delays[0]);
+    Rec r[n];
+    uint64_t start = nowMs();
+    for (int i = 0; i < n; i++) {
+        int id = w.add("long", Rec::cb, &r[i]);
+        CHECK(id >= 0 || i >= TimerWheel::MAX_JOBS, "add %d", i);
+        w.startOnce(id, delays[i]);
+    }
+    Driver d{w};
+    d.until(start + 31ULL * 24 * 3600 * 1000);
+    for (int i = 0; i < n && i < TimerWheel::MAX_JOBS; i++) {
+        uint64_t due = start + delays[i];
+        CHECK(r[i].at.size() == 1 && r[i].at[0] >= due && r[i].at[0] < due + TICK,
+              "delay %u fired %zu times at +%lld ms", delays[i], r[i].at.size(),
+              r[i].at.empty() ? -1LL : (long long)(r[i].at[0] - due));
+    }
+    // Beyond the range a job wakes the wheel once per lap to re-cascade
+    uint32_t laps = (uint32_t)(30ULL * 24 * 3600 * 1000 / (TimerWheel::RANGE_TICKS * TICK));
+    CHECK(d.idle <= 1 + laps, "%u idle wakeups", d.idle);
+}
+
+// Jobs at related rates, started at staggered times (as they are at boot)
+static uint32_t coalesceRun(uint32_t slack, uint32_t& idle, uint64_t& worstLate) {
+    setClockMs(0);
+    TimerWheel w("t");
+    const uint32_t periods[] = {1000, 1000, 2000, 500, 1000, 3000, 1000};
+    const uint32_t phase[] = {0, 17, 33, 48, 71, 90, 55};
+    const int n = sizeof(periods) / sizeof(periods[0]);
+    const uint64_t end = 600500;
+    Rec r[n];
+    for (int i = 0; i < n; i++) {
+        int id = w.add("j", Rec::cb, &r[i], slack);
+        w.startPeriodic(id, periods[i], phase[i] + periods[i]);
+    }
+    Driver d{w};
+    d.until(end);
+    worstLate = 0;
+    for (int i = 0; i < n; i++) {
+        for (size_t k = 0; k < r[i].at.size(); k++) {
+            uint64_t due = phase[i] + (k + 1) * (uint64_t)periods[i];
+            if (r[i].at[k] < due) worstLate = UINT64_MAX;   // early: always wrong
+            else if (r[i].at[k] - due > worstLate) worstLate = r[i].at[k] - due;
+        }
+        CHECK(r[i].at.size() == (end - phase[i]) / periods[i], "job %d ran %zu times", i,
+              r[i].at.size());
+    }
+    idle = d.idle;
+    return d.wakes - d.idle;
+}
+
+static void testCoalescing() {
+    uint32_t idle0, idle1;
+    uint64_t late0, late1;
+    uint32_t exact = coalesceRun(0, idle0, late0);
+    uint32_t slack = coalesceRun(100, idle1, late1);
+    printf("  wakeups: %u without slack, %u with 100 ms slack\n", exact, slack);
+    CHECK(slack * 2 < exact, "coalescing saved too little (%u vs %u)", slack, exact);
+    CHECK(late0 < TICK, "no-slack lateness %llu", (unsigned long long)late0);
+    CHECK(late1 <= 100 + TICK, "slack lateness %llu", (unsigned long long)late1);
+    CHECK(idle0 <= 1 && idle1 <= 1, "idle wakeups %u / %u", idle0, idle1);
+}
+
+struct Ctl {
+    TimerWheel* w;
+    int other;
+    int self;
+    int runs = 0;
+};
+
+static void testCallbackControl() {
+    setClockMs(0);
+    TimerWheel w("t");
+    Ctl killer, victim, again, selfStop;
+
+    // killer and victim share a tick; killer runs first (added later = list head)
+    victim.self = w.add("victim", [](void* a) { ((Ctl*)a)->runs++; }, &victim);
+    killer.self = w.add("killer", [](void* a) {
+        Ctl* c = (Ctl*)a;
+        c->runs++;
+        c->w->stop(c->other);
+    }, &killer);
+    killer.w = &w;
+    killer.other = victim.self;
+    w.startOnce(victim.self, 500);
+    w.startOnce(killer.self, 500);
+
+    // one-shot that re-arms itself three times, 100 ms apart
+    again.w = &w;
+    again.self = w.add("again", [](void* a) {
+        Ctl* c = (Ctl*)a;
+        if (++c->runs < 4) c->w->startOnce(c->self, 100);
+    }, &again);
+    w.startOnce(again.self, 1000);
+
+    // periodic job that stops itself on the third run
+    selfStop.w = &w;
+    selfStop.self = w.add("selfstop", [](void* a) {
+        Ctl* c = (Ctl*)a;
+        if (++c->runs == 3) c->w->stop(c->self);
+    }, &selfStop);
+    w.startPeriodic(selfStop.self, 200);
+
+    Driver d{w};
+    d.until(5000);
+    CHECK(killer.runs + victim.runs == 1, "killer %d victim %d", killer.runs, victim.runs);
+    CHECK(again.runs == 4, "again ran %d", again.runs);
+    CHECK(selfStop.runs == 3 && !w.active(selfStop.self), "selfstop ran %d", selfStop.runs);
+
+    // a restarted job keeps its slot (no duplicate) and a full wheel refuses jobs
+    int extra = 0;
+    while (w.add("fill", Rec::cb) >= 0) extra++;
+    CHECK(extra == TimerWheel::MAX_JOBS - 4, "filled %d", extra);
+}
+
+static void testSkipAndOverrun() {
+    setClockMs(0);
+    TimerWheel w("t");
+    Rec r;
+    int p = w.every("p", 100, Rec::cb, &r);
+    w.after("slow", 2090, [](void*) { SimHAL::advanceUs(30000); });
+
+    // The owner blocks for 1050 ms: one run, nine periods skipped
+    SimHAL::advanceUs(1050 * 1000);
+    w.run();
+    CHECK(r.at.size() == 1, "%zu catch-up runs", r.at.size());
+    std::string s = json(w);
+    CHECK(s.find("\"skipped\":9") != std::string::npos, "%s", s.c_str());
+    CHECK(s.find("\"jitter_max_ms\":950") != std::string::npos, "%s", s.c_str());
+    CHECK(w.msUntilNext() == 50, "next in %u", w.msUntilNext());
+
+    // Phase is kept: subsequent runs land on multiples of 100 again
+    Driver d{w};
+    d.until(3000);
+    CHECK(!r.at.empty() && r.at.back() % 100 < TICK, "phase lost: %llu",
+          (unsigned long long)r.at.back());
+    s = json(w);
+    CHECK(s.find("\"run_max_us\":30000") != std::string::npos, "%s", s.c_str());
+    // late: the 1050 ms block, then the 2100 run behind slow's 30 ms
+    CHECK(s.find("\"late\":2") != std::string::npos, "%s", s.c_str());
+
+    w.setPeriod(p, 250);
+    uint64_t from = nowMs();
+    size_t before = r.at.size();
+    d.until(from + 1000);
+    CHECK(r.at.size() - before == 4, "%zu runs after setPeriod", r.at.size() - before);
+}
+
+static void testWraparound() {
+    uint64_t wrapMs = (1ULL << 32) * TICK;
+    setClockMs(wrapMs - 5000);
+    TimerWheel w("t");
+    Rec r, once;
+    uint64_t start = nowMs();
+    w.every("p", 700, Rec::cb, &r);
+    w.after("once", 6000, Rec::cb, &once);
+    Driver d{w};
+    d.until(start + 70000);
+    CHECK(r.at.size() == 100, "%zu periodic runs", r.at.size());
+    for (size_t k = 0; k < r.at.size(); k++) {
+        uint64_t due = start + (k + 1) * 700;
+        CHECK(r.at[k] >= due && r.at[k] < due + TICK, "run %zu off by %lld", k,
+              (long long)(r.at[k] - due));
+    }
+    CHECK(once.at.size() == 1 && once.at[0] >= start + 6000 && once.at[0] < start + 6000 + TICK,
+          "one-shot across the wrap");
+}
+
+// -------- Random jobs against a reference model --------
+struct ModelJob {
+    int id;
+    bool active = false;
+    uint32_t period = 0;
+    uint32_t slack = 0;
+    uint64_t due = 0;
+    uint32_t runs = 0;
+};
+
+static std::vector<ModelJob>* model = nullptr;
+static TimerWheel* fuzzWheel = nullptr;
+
+static void fuzzCb(void* arg) {
+    ModelJob& j = *(ModelJob*)arg;
+    uint64_t now = nowMs();
+    firedThisWake++;
+    CHECK(j.active, "job %d ran while stopped", j.id);
+    CHECK(now >= j.due, "job %d early by %llu ms", j.id, (unsigned long long)(j.due - now));
+    CHECK(now <= j.due + j.slack + TICK, "job %d late by %llu ms (slack %u)", j.id,
+          (unsigned long long)(now - j.due), j.slack);
+    j.runs++;
+    if (j.period) j.due += j.period;
+    else j.active = false;
+
+    // Sometimes stop or re-arm another job from inside the callback
+    if (rnd() % 8 == 0) {
+        ModelJob& o = (*model)[rnd() % model->size()];
+        if (rnd() % 2) {
+            fuzzWheel->stop(o.id);
+            o.active = false;
+        } else if (&o != &j) {
+            uint32_t delay = rnd() % 5000;
+            fuzzWheel->startOnce(o.id, delay);
+            o.period = 0;
+            o.active = true;
+            o.due = now + delay;
+        }
+    }
+}
+
+static void testFuzz() {
+    const uint32_t seed = FUZZ_SEED, steps = FUZZ_STEPS;
+    printf("  seed %u, %u steps\n", seed, steps);
+    rng = seed ? seed : 1;
+    setClockMs((uint64_t)(rnd() % 100000) * 1000);
+    TimerWheel w("fuzz");
+    std::vector<ModelJob> jobs(TimerWheel::MAX_JOBS);
+    model = &jobs;
+    fuzzWheel = &w;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].slack = (rnd() % 3) ? 0 : rnd() % 200;
+        jobs[i].id = w.add("f", fuzzCb, &jobs[i], jobs[i].slack);
+    }
+
+    uint32_t totalRuns = 0;
+    for (uint32_t step = 0; step < steps; step++) {
+        // Random operation between wakeups
+        ModelJob& j = jobs[rnd() % jobs.size()];
+        uint64_t now = nowMs();
+        switch (rnd() % 6) {
+            case 0:
+            case 1: {
+                uint32_t period = 2 * j.slack + 20 + rnd() % 3000;
+                w.startPeriodic(j.id, period);
+                j.period = period;
+                j.due = now + period;
+                j.active = true;
+                break;
+            }
+            case 2: {
+                // Mostly short, sometimes hours or days
+                uint32_t delay = (rnd() % 10) ? rnd() % 10000 : rnd() % (5U * 24 * 3600 * 1000);
+                w.startOnce(j.id, delay);
+                j.period = 0;
+                j.due = now + delay;
+                j.active = true;
+                break;
+            }
+            case 3:
+                w.stop(j.id);
+                j.active = false;
+                break;
+            default:
+                break;
+        }
+
+        // Sleep as told, or get woken early by some other event
+        firedThisWake = 0;
+        uint32_t wait = w.run();
+        CHECK(w.active(j.id) == j.active, "job %d active mismatch", j.id);
+        if (wait == TimerWheel::NEVER) wait = 1 + rnd() % 100000;
+        else if (rnd() % 3 == 0) wait = rnd() % (wait + 1);
+        SimHAL::advanceUs((uint64_t)wait * 1000);
+        firedThisWake = 0;
+        w.run();
+
+        // Nothing may be overdue after a run
+        for (const ModelJob& m : jobs) {
+            CHECK(!m.active || nowMs() < m.due + m.slack + TICK, "job %d overdue by %llu ms", m.id,
+                  (unsigned long long)(nowMs() - m.due));
+            CHECK(w.active(m.id) == m.active, "job %d active mismatch", m.id);
+        }
+    }
+    for (const ModelJob& m : jobs) totalRuns += m.runs;
+    printf("  %u callbacks checked\n", totalRuns);
+    model = nullptr;
+    fuzzWheel = nullptr;
+}
+
+void setUp() { SimHAL::state().logEnabled = false; }
+
+void tearDown() {}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(testOneShot);
+    RUN_TEST(testPeriodicNoDrift);
+    RUN_TEST(testLongDelays);
+    RUN_TEST(testCoalescing);
+    RUN_TEST(testCallbackControl);
+    RUN_TEST(testSkipAndOverrun);
+    RUN_TEST(testWraparound);
+    RUN_TEST(testFuzz);
+    return UNITY_END();
+}
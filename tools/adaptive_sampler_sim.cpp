@@ -0,0 +1,182 @@
+// -----------------------------------
+// Adaptive Sampler Trace Replay (host tool)
+//
+// Replays a recorded trace through AdaptiveSampler and compares it with
+// the old fixed 10 s schedule: number of samples taken vs. error of the
+// reconstructed signal (linear interpolation between samples).
+// Both schedules are replayed from every start phase within one max
+// interval, so an event onset cannot land on a lucky sample time; the
+// worst case over all phases is reported.
+//
+// Pass/fail: the adaptive peak error of each channel must stay within
+// MAX_ERROR_RATIO x the fixed schedule's peak. A sampler cannot foresee
+// an onset, so its peak error is set by the longest interval it allows:
+// that is what SAMPLE_MAX_INTERVAL_MS is sized against. Exit status 1
+// when the bound is missed.
+//
+// Build:  g++ -std=c++17 -O2 -Iinclude tools/adaptive_sampler_sim.cpp -o sampler_sim
+// Run:    ./sampler_sim trace.csv [max_interval_ms]
+//         ./sampler_sim            (built-in synthetic day with cooking events)
+//
+// Trace format: CSV lines "t_ms,pm25,tvoc" (header line optional),
+// ideally at 1 s resolution so the reference is dense.
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <memory>
+#include <vector>
+#include "adaptive_sampler.h"
+
+struct TracePoint {
+    uint32_t t;
+    float pm25;
+    float tvoc;
+};
+
+static bool loadTrace(const char* path, std::vector<TracePoint>& out) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        TracePoint p;
+        unsigned long t;
+        if (sscanf(line, "%lu,%f,%f", &t, &p.pm25, &p.tvoc) == 3) {
+            p.t = (uint32_t)t;
+            out.push_back(p);
+        }
+    }
+    fclose(f);
+    return !out.empty();
+}
+
+// 24 h at 1 s: stable baseline + sensor jitter, two cooking events and incense
+static void syntheticTrace(std::vector<TracePoint>& out) {
+    srand(42);
+    for (uint32_t s = 0; s < 24 * 3600; s++) {
+        float pm = 12.0f + 3.0f * sinf(s / 7200.0f);
+        float tv = 120.0f;
+
+        auto event = [&](uint32_t start, float peakPm, float peakTv, float riseS, float decayS) {
+            if (s < start) return;
+            float dt = (float)(s - start);
+            float shape = (dt < riseS) ? dt / riseS : expf(-(dt - riseS) / decayS);
+            pm += peakPm * shape;
+            tv += peakTv * shape;
+        };
+        event(8 * 3600, 140, 400, 300, 900);     // breakfast
+        event(13 * 3600, 60, 900, 120, 1800);    // incense
+        event(19 * 3600, 220, 600, 600, 1200);   // dinner
+
+        pm += (rand() % 3) - 1;                  // whole ug/m3 jitter
+        tv += (rand() % 11) - 5;
+        out.push_back({s * 1000, roundf(pm), roundf(tv)});
+    }
+}
+
+struct Result {
+    size_t samples;
+    double rmsePm, maxPm, rmseTvoc, maxTvoc;
+};
+
+static constexpr double MAX_ERROR_RATIO = 1.5;
+
+// Sample the trace at the scheduled times, reconstruct linearly, score
+template <typename NextInterval>
+static Result replay(const std::vector<TracePoint>& trace, NextInterval next) {
+    std::vector<size_t> taken;
+    uint32_t due = trace.front().t;
+    for (size_t i = 0; i < trace.size(); i++) {
+        if (trace[i].t < due) continue;
+        taken.push_back(i);
+        due = trace[i].t + next(trace[i]);
+    }
+
+    Result r = {taken.size(), 0, 0, 0, 0};
+    size_t k = 0;
+    for (size_t i = 0; i < trace.size(); i++) {
+        while (k + 1 < taken.size() && taken[k + 1] <= i) k++;
+        const TracePoint& a = trace[taken[k]];
+        const TracePoint& b = trace[taken[k + 1 < taken.size() ? k + 1 : k]];
+        float w = (b.t == a.t) ? 0 : (float)(trace[i].t - a.t) / (float)(b.t - a.t);
+        float pm = a.pm25 + w * (b.pm25 - a.pm25);
+        float tv = a.tvoc + w * (b.tvoc - a.tvoc);
+
+        double ePm = fabs(pm - trace[i].pm25), eTv = fabs(tv - trace[i].tvoc);
+        r.rmsePm += ePm * ePm;
+        r.rmseTvoc += eTv * eTv;
+        if (ePm > r.maxPm) r.maxPm = ePm;
+        if (eTv > r.maxTvoc) r.maxTvoc = eTv;
+    }
+    r.rmsePm = sqrt(r.rmsePm / trace.size());
+    r.rmseTvoc = sqrt(r.rmseTvoc / trace.size());
+    return r;
+}
+
+// Replay from each start phase (1 s steps up to one max interval) with a
+// fresh schedule; samples and RMSE are averaged, peak errors are the worst
+template <typename MakeSchedule>
+static Result replayPhases(const std::vector<TracePoint>& trace, uint32_t spanMs, MakeSchedule make) {
+    Result worst = {0, 0, 0, 0, 0};
+    size_t runs = 0;
+    for (size_t start = 0; start < trace.size() && trace[start].t - trace.front().t < spanMs; start++) {
+        std::vector<TracePoint> shifted(trace.begin() + start, trace.end());
+        Result r = replay(shifted, make());
+        worst.samples += r.samples;
+        worst.rmsePm += r.rmsePm;
+        worst.rmseTvoc += r.rmseTvoc;
+        worst.maxPm = fmax(worst.maxPm, r.maxPm);
+        worst.maxTvoc = fmax(worst.maxTvoc, r.maxTvoc);
+        runs++;
+    }
+    worst.samples /= runs;
+    worst.rmsePm /= runs;
+    worst.rmseTvoc /= runs;
+    return worst;
+}
+
+static bool withinBound(const char* channel, double adaptive, double fixed) {
+    bool ok = adaptive <= fixed * MAX_ERROR_RATIO;
+    printf("%-6s peak error %.1f vs fixed %.1f (bound %.1fx): %s\n",
+           channel, adaptive, fixed, MAX_ERROR_RATIO, ok ? "ok" : "FAIL");
+    return ok;
+}
+
+static void print(const char* name, const Result& r) {
+    printf("%-18s samples:%7zu  PM2.5 rmse:%6.2f max:%7.1f  TVOC rmse:%7.2f max:%7.1f\n",
+           name, r.samples, r.rmsePm, r.maxPm, r.rmseTvoc, r.maxTvoc);
+}
+
+int main(int argc, char** argv) {
+    std::vector<TracePoint> trace;
+    if (argc > 1) {
+        if (!loadTrace(argv[1], trace)) {
+            fprintf(stderr, "Cannot read trace %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        syntheticTrace(trace);
+    }
+
+    AdaptiveSampler::Settings settings;
+    if (argc > 2) settings.maxIntervalMs = (uint32_t)strtoul(argv[2], nullptr, 10);
+
+    printf("Trace: %zu points, %.1f h\n", trace.size(),
+           (trace.back().t - trace.front().t) / 3600000.0);
+
+    Result fixed = replayPhases(trace, settings.maxIntervalMs, [] {
+        return [](const TracePoint&) { return 10000u; };
+    });
+    Result adaptive = replayPhases(trace, settings.maxIntervalMs, [&] {
+        auto sampler = std::make_shared<AdaptiveSampler>();
+        sampler->begin(settings);
+        return [sampler](const TracePoint& p) { return sampler->update(p.t, p.pm25, p.tvoc); };
+    });
+    print("fixed 10s", fixed);
+    print("adaptive", adaptive);
+
+    bool ok = withinBound("PM2.5", adaptive.maxPm, fixed.maxPm);
+    ok = withinBound("TVOC", adaptive.maxTvoc, fixed.maxTvoc) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+// -----------------------------------
+// OLED Refresh Byte Count (host tool)
+//
+// Replays typical screen updates on a host copy of the SSD1306
+// framebuffer and compares I2C bytes for full refreshes (the old
+// Adafruit display() on every frame) against dirty-page partial
+// refreshes (OLEDDisplay::flush).
+//
+// Pass/fail (exit status 1 on any failure):
+//  - no frame costs more than a full refresh
+//  - frames submitted faster than OLED_MAX_FPS are spaced at least
+//    OLED_MIN_FRAME_MS apart, and the last frame is never left deferred
+//
+// Build:  g++ -std=c++17 -O2 -Iinclude tools/oled_refresh_bench.cpp -o oled_bench
+// Run:    ./oled_bench
+// -----------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "oled_frame_diff.h"
+
+using namespace OLEDFrameDiff;
+
+static uint8_t frame[BUFFER_SIZE];
+static uint8_t sent[BUFFER_SIZE];
+
+// Same page layout as Adafruit_SSD1306: byte = 8 vertical pixels
+static void fillRect(int x, int y, int w, int h, bool on) {
+    for (int i = x; i < x + w && i < WIDTH; i++) {
+        for (int j = y; j < y + h && j < PAGES * 8; j++) {
+            uint8_t bit = 1 << (j & 7);
+            if (on) frame[(j / 8) * WIDTH + i] |= bit;
+            else    frame[(j / 8) * WIDTH + i] &= ~bit;
+        }
+    }
+}
+
+// Stand-in for a rendered glyph run: pseudo-random pixels in a box
+static void drawText(int x, int y, int chars, int size, unsigned seed) {
+    srand(seed);
+    fillRect(x, y, chars * 6 * size, 8 * size, false);
+    for (int i = 0; i < chars * 5 * size; i++) {
+        for (int j = 0; j < 7 * size; j++) {
+            if (rand() & 1) fillRect(x + i + (i / (5 * size)) * size, y + j, 1, 1, true);
+        }
+    }
+}
+
+struct Totals {
+    unsigned frames = 0;
+    unsigned long full = 0;
+    unsigned long partial = 0;
+    unsigned long worst = 0;   // most bytes for one frame
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* name, const char* what) {
+    if (ok) return;
+    printf("FAIL %s: %s\n", name, what);
+    failures++;
+}
+
+static void push(Totals& t) {
+    uint32_t bytes = refreshBytes(frame, sent);
+    t.frames++;
+    t.full += fullRefreshBytes();
+    t.partial += bytes;
+    if (bytes > t.worst) t.worst = bytes;
+    memcpy(sent, frame, BUFFER_SIZE);
+}
+
+static void report(const char* name, const Totals& t) {
+    printf("%-26s frames:%4u  full:%7lu B  partial:%7lu B  (%5.1f%%, %6.1f B/frame)\n",
+           name, t.frames, t.full, t.partial, t.full ? 100.0 * t.partial / t.full : 0.0,
+           t.frames ? (double)t.partial / t.frames : 0.0);
+    check(t.worst <= fullRefreshBytes(), name, "a frame cost more than a full refresh");
+}
+
+// Views submitted every submitMs through the frame-rate cap, the way
+// OLEDDisplay::flush() and its frame timer handle them; the last view is
+// forced. Checks the spacing of unforced frames and that the final frame
+// reached the panel.
+static void rateCapped(const char* name, int views, uint32_t submitMs) {
+    FrameGate gate(OLED_MIN_FRAME_MS);
+    Totals t;
+    uint32_t lastSent = 0, minGap = UINT32_MAX;
+    bool pending = false;
+
+    auto send = [&](uint32_t now, bool forced) {
+        if (t.frames && !forced && now - lastSent < minGap) minGap = now - lastSent;
+        gate.sent(now);
+        lastSent = now;
+        pending = false;
+        push(t);
+    };
+
+    memset(frame, 0, BUFFER_SIZE);
+    memset(sent, 0, BUFFER_SIZE);
+    drawText(20, 0, 15, 1, 3);
+    for (int v = 0; v < views; v++) {
+        uint32_t now = v * submitMs;
+        // Frame timer: a deferred frame goes out as soon as the cap allows
+        uint32_t timerAt = lastSent + gate.waitMs(lastSent);
+        if (pending && timerAt <= now) send(timerAt, false);
+        fillRect(11, 21, (v * 106) / (views - 1), 6, true);
+        drawText(50, 22, 4, 1, 300 + v);
+        bool last = v == views - 1;
+        if (gate.due(now, last)) send(now, last);
+        else pending = true;
+    }
+
+    printf("%-26s views:%4d  frames:%4u  min gap:%4lu ms (cap %d ms)\n", name, views, t.frames,
+           minGap == UINT32_MAX ? 0UL : (unsigned long)minGap, OLED_MIN_FRAME_MS);
+    check(minGap >= OLED_MIN_FRAME_MS, name, "frames closer than OLED_MIN_FRAME_MS");
+    check(!pending && memcmp(frame, sent, BUFFER_SIZE) == 0, name, "final frame left deferred");
+    check(t.frames < (unsigned)views, name, "no frames were deferred");
+}
+
+int main() {
+    // Boot animation progress bar: 26 frames, 2 rows change each time
+    {
+        Totals t;
+        drawText(10, 2, 9, 2, 1);
+        push(t);
+        for (int i = 0; i <= 100; i += 4) {
+            fillRect(0, 30, 128, 2, false);
+            fillRect(0, 30, 128, 1, true);
+            fillRect(1, 30, (i * 126) / 100, 1, true);
+            push(t);
+        }
+        report("boot progress bar", t);
+    }
+
+    // Sensor tick on a fixed screen: value and battery digits change
+    {
+        Totals t;
+        drawText(0, 8, 8, 2, 2);
+        push(t);
+        for (int tick = 0; tick < 60; tick++) {
+            if (tick % 3 == 0) drawText(72, 8, 2, 2, 100 + tick);   // PM2.5 digits
+            if (tick % 20 == 0) drawText(95, 0, 3, 1, 200 + tick);  // battery %
+            push(t);
+        }
+        report("sensor ticks (fixed screen)", t);
+    }
+
+    // Identical redraws (touch repeat / unchanged values)
+    {
+        Totals t;
+        for (int i = 0; i < 30; i++) push(t);
+        report("identical frames", t);
+    }
+
+    // OTA progress: title static, bar + percentage change
+    {
+        Totals t;
+        drawText(20, 0, 15, 1, 3);
+        fillRect(10, 20, 108, 8, true);
+        fillRect(11, 21, 106, 6, false);
+        push(t);
+        for (int p = 0; p <= 100; p++) {
+            fillRect(11, 21, (p * 106) / 100, 6, true);
+            drawText(50, 22, 4, 1, 300 + p);
+            push(t);
+        }
+        report("OTA progress", t);
+    }
+
+    // Screen cycling: whole content replaced each frame
+    {
+        Totals t;
+        for (int s = 0; s < 12; s++) {
+            fillRect(0, 0, 128, 32, false);
+            drawText(0, 8, 9, 2, 400 + s);
+            drawText(0, 24, 5, 1, 500 + s);
+            push(t);
+        }
+        report("screen cycling", t);
+    }
+
+    // Inverted screen: every column of every page changes
+    {
+        Totals t;
+        drawText(0, 8, 9, 2, 600);
+        push(t);
+        for (int i = 0; i < BUFFER_SIZE; i++) frame[i] = ~frame[i];
+        push(t);
+        report("inverted screen", t);
+    }
+
+    // OTA chunks arrive far faster than the panel refreshes
+    rateCapped("OTA chunks @ 5 ms", 101, 5);
+    rateCapped("OTA chunks @ 30 ms", 101, 30);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}